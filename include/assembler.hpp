@@ -0,0 +1,37 @@
+#ifndef ASSEMBLER_HPP
+#define ASSEMBLER_HPP
+
+#include "chip8.hpp"
+#include <map>
+#include <string>
+#include <vector>
+
+struct AssemblyError {
+    int line;               // 1-based
+    std::string message;
+};
+
+struct Assembly {
+    std::vector<byte> rom;                  // Loaded at 0x200
+    std::map<std::string, word> labels;
+    std::vector<AssemblyError> errors;
+
+    bool ok() const;
+
+    // The ROM zero-padded to CHIP8_ROM_BYTES, ready for Chip8::load()
+    std::vector<byte> image() const;
+};
+
+// Assembles the mnemonics disassemble() prints, one instruction per line:
+//
+//     loop:   LD V0, 0x10         ; comments run to the end of the line
+//             CALL draw
+//             JP loop
+//     sprite: DB 0xF0, 0x90, 0xF0
+//
+// Numbers are decimal, 0x hex or 0b binary; a label, optionally plus or
+// minus a number, can stand in for any of them. DB emits bytes and DW
+// big-endian words. Mnemonics and registers are case-insensitive.
+Assembly assemble(const std::string &source);
+
+#endif // ASSEMBLER_HPP
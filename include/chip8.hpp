@@ -1,12 +1,22 @@
 #ifndef CHIP8_HPP
 #define CHIP8_HPP
 
+#include <cstdint>
+#include <string>
+
 #define CHIP8_SCREEN_WIDTH 64
 #define CHIP8_SCREEN_HEIGHT 32
 #define CHIP8_RAM_BYTES 4096
 #define CHIP8_VARIABLE_REGISTERS 16
 #define CHIP8_STACK_HEIGHT 16
 #define CHIP8_ROM_BYTES 3584
+#define CHIP8_MAX_FUSED_BYTES 6
+#define CHIP8_PAGE_BYTES 256
+#define CHIP8_PAGES (CHIP8_RAM_BYTES / CHIP8_PAGE_BYTES)
+
+// Fingerprint slots: RAM bytes, then display rows, then registers
+#define CHIP8_FINGERPRINT_DISPLAY_SLOT CHIP8_RAM_BYTES
+#define CHIP8_FINGERPRINT_REGISTER_SLOT (CHIP8_FINGERPRINT_DISPLAY_SLOT + CHIP8_SCREEN_HEIGHT)
 
 // 16 bit type
 typedef unsigned short word;
@@ -16,6 +26,76 @@ typedef unsigned char byte;
 
 word combine(byte leftByte, byte rightByte);
 
+// Zobrist key for a value held in a fingerprint slot. Mixed on the fly: a
+// table for every RAM byte value would be 8 MB and miss the cache.
+inline uint64_t fingerprintKey(uint64_t slot, uint64_t value) {
+    uint64_t h = value * 0x9E3779B97F4A7C15ULL + (slot << 1 | 1) * 0xC2B2AE3D27D4EB4FULL;
+    h = (h ^ (h >> 31)) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+    return h ^ (h >> 31);
+}
+
+// Why an instruction could not run
+enum Chip8Fault : byte {
+    FAULT_NONE = 0,
+    FAULT_ILLEGAL_OPCODE,
+    FAULT_STACK_OVERFLOW,
+    FAULT_STACK_UNDERFLOW,
+    FAULT_MEMORY_RANGE,     // RAM access past 0xFFF, wrapped around
+    FAULT_KEY_RANGE,        // EX9E/EXA1 with VX above 0xF
+};
+
+const char * faultName(byte fault);
+
+// Machine state when a fault was raised, PC pointing at the faulting opcode
+struct CrashSnapshot {
+    byte fault;
+    word programCounter;
+    word opcode;
+    word indexRegister;
+    byte stackPointer;
+    word stack[CHIP8_STACK_HEIGHT];
+    byte variableRegisters[CHIP8_VARIABLE_REGISTERS];
+    byte delayTimer;
+    byte soundTimer;
+
+    std::string toJson() const;
+};
+
+class Tracer;
+
+// Counters for the frontend's performance overlay. The frontend reads and
+// clears them once per frame.
+struct Profile {
+    uint32_t pcHits[CHIP8_RAM_BYTES];   // Instructions run by cycle() at each address
+    uint32_t reads[CHIP8_RAM_BYTES];    // Sprite and FX65 reads
+    uint32_t writes[CHIP8_RAM_BYTES];
+    uint64_t instructions;
+    uint64_t sprites;                   // DXYN executed
+};
+
+// Superinstructions: common opcode sequences executed in one dispatch
+enum FusedOp : byte {
+    FUSED_NONE = 0,
+    FUSED_INDEX_DRAW,   // ANNN, DXYN
+    FUSED_SET_PAIR,     // 6XNN, 6YNN
+    FUSED_ADD_SKIP,     // 7XNN, 3YNN
+    FUSED_TIMER_WAIT,   // FX07, 3XNN, 1NNN
+    FUSED_SPIN,         // 1NNN jumping to itself
+};
+
+class Chip8;
+
+// Watches run() step by step, e.g. to compare against another machine
+class StepObserver {
+public:
+    virtual ~StepObserver() {}
+
+    // After each instruction, or superinstruction of count instructions,
+    // with the timers settled. Returning false stops run() there.
+    virtual bool stepped(Chip8 &sys, int count) = 0;
+};
+
 class Chip8 {
 public:
     
@@ -39,6 +119,9 @@ public:
     // Display buffer: displayBuffer[y][x] = 0x01, on / 0x00, off
     byte displayBuffer[CHIP8_SCREEN_HEIGHT][CHIP8_SCREEN_WIDTH];
 
+    // The same display packed one bit per pixel, bit 63 is x = 0
+    uint64_t displayRows[CHIP8_SCREEN_HEIGHT];
+
     bool draw;
     bool sound;
     bool copyBeforeShifting;
@@ -48,7 +131,81 @@ public:
     byte lastKey;
     bool lastKeyFromBlock;
 
-    void execute(word opcode);
+    // fusedOps[addr] is the superinstruction starting at addr, if any
+    byte fusedOps[CHIP8_RAM_BYTES];
+    bool useSuperinstructions;
+
+    // Records every instruction run by cycle() when set. Not owned.
+    Tracer * tracer;
+
+    // CXNN generator state, per machine so that machines on other threads
+    // or run side by side do not disturb each other's sequences
+    uint32_t randomState;
+
+    // Counts instructions and RAM traffic when set; one untaken branch per
+    // access otherwise. Not owned.
+    Profile * profile;
+
+    // Told of every step run() takes when set, which also stops run() from
+    // batching timer ticks across steps or waiting out FX0A, since the
+    // observer may change keys in between. Not owned.
+    StepObserver * observer;
+
+    // Faults
+    byte fault;             // Last fault raised, FAULT_NONE until then
+    byte pendingFault;      // Raised by the instruction being executed
+    int addressOverflow;    // Out-of-range bits of masked RAM addresses
+    CrashSnapshot crash;    // State when fault was raised
+
+    // Wrap a RAM address into range without branching, noting overflow
+    word ramAddress(int address) {
+        addressOverflow |= address & ~(CHIP8_RAM_BYTES - 1);
+        return address & (CHIP8_RAM_BYTES - 1);
+    }
+
+    // Pages of RAM written, and whether the display changed, since the
+    // last Forker snapshot. Direct writes to ram must mark their page.
+    word dirtyPages;
+    bool displayDirty;
+
+    // XOR of the keys of every RAM byte and display row, kept up to date
+    // by writeRam() and writeDisplayRow(). Direct writes must call
+    // rehashMemory().
+    uint64_t memoryFingerprint;
+
+    // Masked RAM write that marks its page dirty
+    void writeRam(int address, byte value) {
+        word masked = ramAddress(address);
+        memoryFingerprint ^= fingerprintKey(masked, ram[masked]) ^ fingerprintKey(masked, value);
+        ram[masked] = value;
+        dirtyPages |= 1 << (masked / CHIP8_PAGE_BYTES);
+        if (profile != nullptr)
+            profile->writes[masked]++;
+    }
+
+    // Packed display row write; displayBuffer is left to the caller
+    void writeDisplayRow(int y, uint64_t value) {
+        uint64_t slot = CHIP8_FINGERPRINT_DISPLAY_SLOT + y;
+        memoryFingerprint ^= fingerprintKey(slot, displayRows[y]) ^ fingerprintKey(slot, value);
+        displayRows[y] = value;
+    }
+
+    // Recompute memoryFingerprint from scratch
+    void rehashMemory();
+
+    // 64-bit hash of RAM, display, registers, I, PC, stack and timers.
+    // Keys and frontend flags are left out. Equal machines always have equal
+    // fingerprints; costs a few multiplies, not a pass over memory.
+    uint64_t fingerprint() const;
+
+    // Keep the first fault raised by an instruction
+    void raiseFault(byte newFault) {
+        if (pendingFault == FAULT_NONE)
+            pendingFault = newFault;
+    }
+
+    // Runs one opcode. Returns the fault it raised, or FAULT_NONE.
+    Chip8Fault execute(word opcode);
 
     void executeKeyInstruction(word opcode, byte X);
 
@@ -64,6 +221,9 @@ public:
     // 1NNN: Jump
     void opJump(word NNN);
 
+    // BNNN: Jump to NNN + V0
+    void opJumpOffset(word NNN);
+
     // 6XNN: Set register VX to value NN
     void opSetRegister(byte X, word NN);
     
@@ -124,6 +284,9 @@ public:
     // CXNN: Random number & NN
     void opRandom(byte X, byte NN);
 
+    // Restart the CXNN sequence; equal seeds give equal sequences
+    void seedRandom(uint32_t seed);
+
     // EX9E: Skip if key X is pressed
     void opSkipKeyDown(byte X);
     
@@ -157,8 +320,45 @@ public:
     // FX65: Load registers 0 to X from memory at I.
     void opRamToRegisters(byte X);
 
+    // Keypad input, as from the frontend
+    void pressKey(byte key);
+    void releaseKey(byte key);
+
+    // Peephole pass: match superinstructions at every address in RAM.
+    // Call again after writing to ram directly.
+    void fuseInstructions();
+
+    // Rematch superinstructions overlapping [address, address + length)
+    void fuseRange(word address, word length);
+
+    // Execute the superinstruction at the PC, using at most budget
+    // instructions. Returns instructions consumed, timers already ticked.
+    int executeFused(byte fusedOp, int budget);
+
+    // Execute opcode, with the PC already past it, if it cannot fault;
+    // false to leave it to cycle(). Timer opcodes settle ticks, the
+    // cycles run since the timers last ticked, first.
+    bool executeInline(word opcode, int &ticks);
+
+    // Tick timers as if by that many calls to cycle()
+    void tickTimers(int ticks);
+
     Chip8();
-    void cycle();
+
+    // Fetch, execute and tick timers. On a fault the PC is left on the
+    // faulting opcode, crash is filled in and the fault is returned.
+    Chip8Fault cycle();
+
+    // Fill in crash from the current state
+    void recordCrash(byte raised, word opcode);
+
+    // Run one superinstruction of at most budget instructions, or else one
+    // instruction. Returns instructions run, 0 if it faulted.
+    int dispatch(int budget);
+
+    // Run up to n instructions, fusing where possible. Returns instructions
+    // run, fewer than n if one faulted.
+    int run(int n);
     void reset();
     void load(byte * rom);
     void dumpState();
@@ -0,0 +1,60 @@
+#ifndef CRAWLER_HPP
+#define CRAWLER_HPP
+
+#include "chip8.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Emulated seconds each ROM runs by default, at 60 frames a second
+#define CRAWL_SECONDS 60
+#define CRAWL_FRAME_RATE 60
+#define CRAWL_CYCLES_PER_FRAME 12
+// Frames of unchanged RAM and display, with keys still arriving, that make
+// a hang: ten emulated seconds
+#define CRAWL_HANG_FRAMES 600
+// On average, one random key press or release per this many frames
+#define CRAWL_KEY_PERIOD 6
+
+// How a ROM fared, worst first
+enum CrawlVerdict : byte {
+    CRAWL_ILLEGAL_OPCODE,
+    CRAWL_STACK_FAULT,
+    CRAWL_OTHER_FAULT,      // A memory or key range fault
+    CRAWL_HANG,
+    CRAWL_BLANK_SCREEN,
+    CRAWL_OK,
+};
+
+const char * verdictName(byte verdict);
+
+// One ROM's row in the report
+struct CrawlResult {
+    std::string rom;
+    byte verdict;
+    byte fault;             // FAULT_NONE unless the verdict is a fault
+    word programCounter;    // Where it faulted, or stood at the end; hex in reports
+    word opcode;            // At programCounter
+    long frames;            // Run before the verdict was reached
+    long instructions;
+    int litPixels;          // On the screen at the end
+};
+
+// Runs rom headless for frames 60 Hz frames of cyclesPerFrame instructions,
+// pressing random keys from seed, and classifies it. A fault ends the run
+// at once. So does RAM and display unchanged for CRAWL_HANG_FRAMES while
+// keys kept arriving: ok if the ROM drew and parked on a jump to itself,
+// which is how finished ROMs stop, and otherwise a hang. A run that never
+// lit a pixel is a blank screen.
+CrawlResult crawlRom(const std::string &name, const std::vector<byte> &rom, long frames,
+                     int cyclesPerFrame, uint32_t seed);
+
+// Reports: a CSV row per ROM under a header, which is also the journal a
+// resumed crawl reads back, and a JSON array of the same fields
+std::string crawlCsvHeader();
+std::string crawlToCsv(const CrawlResult &result);
+// False on the header or a line that is not a row
+bool crawlFromCsv(const std::string &line, CrawlResult &result);
+std::string crawlToJson(const CrawlResult &result);
+
+#endif // CRAWLER_HPP
@@ -0,0 +1,133 @@
+#ifndef DEBUGGER_HPP
+#define DEBUGGER_HPP
+
+#include "chip8.hpp"
+#include <bitset>
+#include <string>
+#include <vector>
+
+#define DEBUGGER_PROMPT "(chip8) "
+// Instructions run by "continue" with no count before it gives up
+#define DEBUGGER_CONTINUE_LIMIT 100000000L
+
+enum DebugStop : byte {
+    STOP_NONE = 0,
+    STOP_BREAKPOINT,
+    STOP_WATCHPOINT,
+    STOP_STEP,          // Step, step-over or step-out finished
+    STOP_FAULT,
+    STOP_LIMIT,         // Ran the instructions asked for
+};
+
+enum WatchKind : byte {
+    WATCH_READ = 1,
+    WATCH_WRITE = 2,
+    WATCH_ACCESS = WATCH_READ | WATCH_WRITE,
+};
+
+// Stops before the instruction at pc, if the condition holds. The
+// condition compares a register, or I when reg is 16, with value.
+struct Breakpoint {
+    int id;
+    word pc;
+    bool conditional;
+    int reg;
+    std::string compare;    // ==, !=, <, <=, >, >=
+    int value;
+};
+
+// Stops after an instruction that touches RAM in [start, end], or that
+// reads or writes I itself
+struct Watchpoint {
+    int id;
+    byte kind;
+    bool index;
+    word start;
+    word end;
+};
+
+// Runs a Chip8 under breakpoints and watchpoints. The core is untouched:
+// the debugger steps it with cycle() and decodes each instruction's RAM
+// and I accesses before running it. That decoding lives in the watched
+// instantiation of the run loop only, so with no watchpoints armed each
+// step costs one bit test for breakpoints, and with neither armed
+// "continue" runs the fused fast path.
+class Debugger {
+public:
+    Debugger(Chip8 &sys);
+
+    int addBreakpoint(word pc);
+    int addBreakpoint(word pc, int reg, const std::string &compare, int value);
+    int addWatchpoint(byte kind, word start, word end);
+    int addIndexWatchpoint(byte kind);
+    bool remove(int id);
+
+    // Run up to limit instructions, stopping at breakpoints, watchpoints
+    // and faults. A breakpoint at the current PC is stepped past.
+    DebugStop resume(long limit);
+
+    DebugStop step(long count = 1);
+
+    // Runs a 2NNN at the PC through to its return, otherwise steps
+    DebugStop stepOver();
+
+    // Runs until the current subroutine returns
+    DebugStop stepOut();
+
+    // Return addresses from stack[], innermost first
+    std::vector<word> callStack() const;
+
+    // One command line from the console or the socket, and its output
+    std::string command(const std::string &line);
+
+    // Why and where the last run stopped, as printed after commands
+    std::string describeStop() const;
+
+    Chip8 &sys;
+    DebugStop lastStop;
+    int lastHit;            // Breakpoint or watchpoint id
+    word lastHitAddress;    // Watched address touched
+    word lastHitPc;         // Instruction that touched it
+    bool quit;
+
+private:
+    // Picks the loop for what is armed. Stops with STOP_STEP once the
+    // stack is at most stopDepth deep at stopPc, or at any PC if negative.
+    DebugStop runUntil(long limit, int stopPc, int stopDepth);
+    template <bool Watched>
+    DebugStop run(long limit, int stopPc, int stopDepth);
+    bool breakpointHolds(word pc);
+    bool watchHit(word opcode);
+
+    int nextId;
+    std::vector<Breakpoint> breakpoints;
+    std::vector<Watchpoint> watchpoints;
+    std::bitset<CHIP8_RAM_BYTES> breakAt;
+};
+
+// Serves debugger commands over a local Unix socket, a line at a time,
+// replying with the output and a prompt. Polled from the thread that owns
+// the debugger.
+class DebugSocket {
+public:
+    DebugSocket(const std::string &path);
+    ~DebugSocket();
+
+    bool ok() const;
+
+    // Accepts connections and runs any complete command lines, waiting up
+    // to timeout milliseconds
+    void poll(Debugger &debugger, int timeout);
+
+private:
+    struct Client {
+        int fd;
+        std::string pending;
+    };
+
+    std::string path;
+    int listener;
+    std::vector<Client> clients;
+};
+
+#endif // DEBUGGER_HPP
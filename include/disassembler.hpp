@@ -0,0 +1,62 @@
+#ifndef DISASSEMBLER_HPP
+#define DISASSEMBLER_HPP
+
+#include "chip8.hpp"
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#define CHIP8_PROGRAM_START 0x200
+
+// Mnemonic for one opcode, e.g. "LD V1, 0x05". Empty if illegal.
+std::string disassemble(word opcode);
+
+// Straight-line run of instructions [start, end) entered only at start
+struct BasicBlock {
+    word start;
+    word end;
+    std::vector<word> successors;
+};
+
+// A write to RAM through I, with the target if I is known in the block
+struct RamWrite {
+    word address;
+    int target;     // -1 if I was not set by an ANNN in the same block
+    int length;
+};
+
+struct RomAnalysis {
+    std::string name;
+    int size;
+    std::vector<byte> bytes;
+
+    // Reachable instructions from 0x200, address -> opcode
+    std::map<word, word> instructions;
+
+    // Basic blocks by start address
+    std::map<word, BasicBlock> blocks;
+
+    // Subroutine entry (0x200 for the main program) -> subroutines it calls
+    std::map<word, std::set<word> > callGraph;
+
+    // BNNN jumps, whose targets depend on V0
+    std::vector<word> computedJumps;
+
+    // FX33/FX55 writes, and those known to land on reachable code
+    std::vector<RamWrite> ramWrites;
+    std::vector<word> selfModifyingWrites;
+
+    // Reachable opcodes that no interpreter instruction matches
+    std::vector<word> illegalOpcodes;
+
+    bool isCode(word address) const;
+};
+
+// Follow control flow from 0x200 through a ROM loaded at 0x200
+RomAnalysis analyzeRom(const std::string &name, const byte * rom, int size);
+
+std::string analysisToText(const RomAnalysis &analysis);
+std::string analysisToJson(const RomAnalysis &analysis);
+
+#endif // DISASSEMBLER_HPP
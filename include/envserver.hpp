@@ -0,0 +1,117 @@
+#ifndef ENVSERVER_HPP
+#define ENVSERVER_HPP
+
+#include "libchip8.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Shared-memory environment server. One process hosts the machines and
+// client processes exchange actions and frames with it through a POSIX
+// shared-memory segment, waking each other with futexes. Linux only.
+//
+// Protocol: a client owns a set of slots. To step one, it writes action
+// and reset, then increments request. The server worker owning the slot
+// (slot index % workerCount) steps it, writes frame, reward and fault,
+// and sets response equal to request. Clients ring the worker's bell after
+// submitting so a sleeping worker wakes up.
+
+#define ENV_SHM_MAGIC 0x56453843    // "C8EV"
+#define ENV_PROTOCOL_VERSION 1
+#define ENV_MAX_WORKERS 64
+#define ENV_SPIN_ITERATIONS 2000
+
+struct alignas(64) EnvWorkerBell {
+    std::atomic<uint32_t> ring;
+    std::atomic<uint32_t> sleeping;
+};
+
+struct alignas(64) EnvSlot {
+    std::atomic<uint32_t> request;
+    std::atomic<uint32_t> response;
+    std::atomic<uint32_t> clientWaiting;
+    uint16_t action;                // Keypad bitmask, bit k for key k
+    uint8_t reset;                  // Reset the machine before stepping
+    uint8_t fault;
+    float reward;
+    uint64_t frame[CHIP8_FRAME_ROWS];
+};
+
+struct EnvShmHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t headerBytes;
+    uint32_t slotBytes;
+    uint32_t envCount;
+    uint32_t workerCount;
+    uint32_t framesPerStep;
+    std::atomic<uint32_t> serverRunning;   // Cleared once serve() returns
+    EnvWorkerBell bells[ENV_MAX_WORKERS];
+};
+
+// Futex wait and wake on words that may live in shared memory
+void futexWait(std::atomic<uint32_t> &word, uint32_t expected, int timeoutMs);
+void futexWake(std::atomic<uint32_t> &word);
+
+class EnvServer {
+public:
+    EnvServer(const std::string &name, const std::vector<uint8_t> &rom, int envCount,
+              int workerCount, int framesPerStep);
+
+    // Unlinks the shared memory
+    ~EnvServer();
+
+    bool ok() const;
+    // Why the server could not be created, if it was not
+    const std::string &error() const;
+
+    // Applies to every environment; call before serve()
+    void setReward(const std::vector<chip8_reward_term> &terms);
+
+    // Blocks on worker threads until stop() is called
+    void serve();
+    void stop();
+
+private:
+    void work(int worker);
+    bool stepSlot(int index);
+
+    std::string name;
+    std::string failure;
+    size_t bytes;
+    EnvShmHeader * header;
+    EnvSlot * slots;
+    std::vector<chip8_env *> envs;
+    std::atomic<bool> stopping;
+};
+
+class EnvClient {
+public:
+    EnvClient(const std::string &name);
+    ~EnvClient();
+
+    // False if the segment is missing or speaks another protocol version
+    bool ok() const;
+    int envCount() const;
+
+    // Queue a step; rings are sent by flush()
+    void submit(int env, uint16_t action, bool reset = false);
+    void flush();
+
+    // Block until the last step submitted for env has completed
+    void wait(int env);
+
+    const uint64_t * frame(int env) const;
+    float reward(int env) const;
+    uint8_t fault(int env) const;
+
+private:
+    size_t bytes;
+    EnvShmHeader * header;
+    EnvSlot * slots;
+    std::vector<bool> pendingBells;
+};
+
+#endif // ENVSERVER_HPP
@@ -0,0 +1,64 @@
+#ifndef FORK_HPP
+#define FORK_HPP
+
+#include "chip8.hpp"
+#include <cstdint>
+#include <memory>
+
+struct RamPage {
+    byte bytes[CHIP8_PAGE_BYTES];
+};
+
+// One bit per pixel, bit 63 is the leftmost column
+struct PackedDisplay {
+    uint64_t rows[CHIP8_SCREEN_HEIGHT];
+};
+
+// A saved machine. Registers are copied; RAM pages and the display are
+// shared copy-on-write between every state that has not changed them,
+// so a branch costs a few hundred bytes plus the pages it wrote.
+struct MachineState {
+    std::shared_ptr<const RamPage> pages[CHIP8_PAGES];
+    std::shared_ptr<const PackedDisplay> display;
+
+    byte variableRegisters[CHIP8_VARIABLE_REGISTERS];
+    word stack[CHIP8_STACK_HEIGHT];
+    byte stackPointer;
+    word programCounter;
+    word indexRegister;
+    byte delayTimer;
+    byte soundTimer;
+    byte keyState[16];
+    byte lastKey;
+    bool lastKeyFromBlock;
+    bool blockingForKey;
+    bool draw;
+    bool sound;
+    byte fault;
+    uint64_t memoryFingerprint;
+    uint32_t randomState;
+};
+
+// Forks and restores the state of one Chip8 used as a worker for tree
+// search. The forker remembers which state the machine's RAM matches, so
+// fork() only copies the pages written since, and restore() only copies
+// the pages that differ between the two states.
+class Forker {
+public:
+    // Takes the machine's current state as the root
+    Forker(Chip8 &sys);
+
+    // Snapshot the machine, sharing every page it has not written
+    MachineState fork();
+
+    // Put the machine into a previously forked state
+    void restore(const MachineState &state);
+
+private:
+    void saveRegisters(MachineState &state);
+
+    Chip8 &sys;
+    MachineState base;
+};
+
+#endif // FORK_HPP
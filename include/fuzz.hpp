@@ -0,0 +1,48 @@
+#ifndef FUZZ_HPP
+#define FUZZ_HPP
+
+#include "chip8.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Instructions run per input, across the whole keypad script
+#define FUZZ_INSTRUCTIONS 4096
+// Key events read from the front of an input at most
+#define FUZZ_MAX_KEY_EVENTS 32
+// Instructions per unit of a key event's wait
+#define FUZZ_KEY_STEP 16
+// Fixed CXNN seed, so a crashing input replays the same way
+#define FUZZ_SEED 1
+
+// Runs fuzz inputs against one Chip8. An input is a keypad script followed
+// by ROM bytes:
+//
+//   byte 0         number of key events K, modulo FUZZ_MAX_KEY_EVENTS + 1
+//   K byte pairs   wait in FUZZ_KEY_STEP instructions, then a key: low
+//                  nibble the key, bit 4 set to press, clear to release
+//   the rest       the ROM, loaded at 0x200
+//
+// Rather than reset() and load() per input, the machine is assigned from a
+// pristine copy built once (a single bulk copy of the whole object), then
+// only the ROM bytes are written, fingerprinted and fused.
+class FuzzHarness {
+public:
+    FuzzHarness();
+
+    // Restore, load and run one input. Returns instructions run.
+    long run(const uint8_t * data, size_t size);
+
+    // What is wrong with the machine after run(), or empty if nothing
+    std::string checkInvariants() const;
+
+    // Counts pcHits for the standalone driver's coverage; null by default
+    void setProfile(Profile * profile);
+
+    Chip8 sys;
+
+private:
+    Chip8 pristine;
+};
+
+#endif // FUZZ_HPP
@@ -0,0 +1,50 @@
+#ifndef GOVERNOR_HPP
+#define GOVERNOR_HPP
+
+#include <string>
+
+// Frames skipped in a row at most, so a slow host still sees the screen move
+#define GOVERNOR_MAX_SKIP 4
+// Present cost is averaged over roughly this many presents
+#define GOVERNOR_COST_WEIGHT 8
+// Further behind than this, emulation drops the backlog instead of racing
+#define GOVERNOR_MAX_CATCH_UP_MICROSECONDS 250000
+
+// Decides, once per 60 Hz frame, whether the frontend presents. Emulation
+// and timers always run to schedule; only presentation gives way. A frame
+// is skipped when presenting it, at the average host cost of a present,
+// would run into the next frame, and always while the window is hidden.
+class FrameGovernor {
+public:
+    FrameGovernor(long frameMicroseconds);
+
+    // Hidden or minimized windows present nothing
+    void setVisible(bool visible);
+
+    // At a frame with something to draw, reached lateMicroseconds after it
+    // was due: whether to present it
+    bool shouldPresent(long long lateMicroseconds);
+
+    // Host time the last present took
+    void presented(long long microseconds);
+
+    // Emulation fell further behind than the catch-up limit
+    void droppedBacklog(long long microseconds);
+
+    // One line for the log: presents, skips and their reasons
+    std::string summary() const;
+
+    bool visible;
+    long presents;
+    long skippedBehind;
+    long skippedHidden;
+    long backlogs;
+    long long droppedMicroseconds;
+    long long averageCost;
+
+private:
+    long frameMicroseconds;
+    int consecutiveSkips;
+};
+
+#endif // GOVERNOR_HPP
@@ -0,0 +1,62 @@
+#ifndef HUD_HPP
+#define HUD_HPP
+
+#include "chip8.hpp"
+#include <cstdint>
+
+#define HUD_WIDTH 200
+#define HUD_HEIGHT 320
+#define HUD_HOT_PCS 5
+#define HUD_HISTOGRAM_BUCKETS 16
+#define HUD_BUCKET_MILLISECONDS 2.0
+// Instructions per second are averaged over this long
+#define HUD_RATE_MILLISECONDS 500.0
+// Emulated clock, for converting instructions to emulated time
+#define HUD_CLOCK_HZ 700
+// Share of the heat, PC counts and histogram kept from one frame to the next
+#define HUD_HEAT_FADE 0.92f
+#define HUD_PC_FADE 0.97f
+#define HUD_HISTOGRAM_FADE 0.99f
+
+// Performance overlay for the frontend's sidebar. sample() takes a frame's
+// worth of Profile counters, render() draws them into ARGB pixels; both
+// are meant to be called at most once per presented frame.
+class Hud {
+public:
+    Hud(uint32_t foreground, uint32_t background);
+
+    // Fold in and clear the counters gathered since the last sample.
+    // hostMilliseconds is the wall time since then, presents the frames
+    // shown in that time.
+    void sample(Profile &profile, double hostMilliseconds, int presents);
+
+    // Draw HUD_WIDTH x HUD_HEIGHT pixels; pitch is in bytes
+    void render(void * pixels, int pitch) const;
+
+    double instructionsPerSecond;
+    double hostFrameMilliseconds;
+    double emulatedFrameMilliseconds;   // Time the machine advanced
+    uint64_t sprites;                   // DXYN in the last frame
+    int presents;
+
+    // Recent host frame times, HUD_BUCKET_MILLISECONDS per bucket
+    float histogram[HUD_HISTOGRAM_BUCKETS];
+
+    // Hottest addresses first, with their share of recent instructions
+    int hotCount;
+    word hotPcs[HUD_HOT_PCS];
+    float hotShares[HUD_HOT_PCS];
+
+    // Fading read and write counts of every RAM byte
+    float readHeat[CHIP8_RAM_BYTES];
+    float writeHeat[CHIP8_RAM_BYTES];
+
+private:
+    uint32_t foreground;
+    uint32_t background;
+    float pcHeat[CHIP8_RAM_BYTES];
+    uint64_t rateInstructions;
+    double rateMilliseconds;
+};
+
+#endif // HUD_HPP
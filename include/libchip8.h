@@ -0,0 +1,109 @@
+#ifndef LIBCHIP8_H
+#define LIBCHIP8_H
+
+/*
+ * C interface for driving many CHIP-8 machines as environments.
+ *
+ * Environments are opaque handles. Functions on different environments
+ * may be called from different threads at the same time; one environment
+ * must only be used by one thread at a time.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define CHIP8_API __attribute__((visibility("default")))
+#else
+#define CHIP8_API
+#endif
+
+#define CHIP8_ABI_VERSION 1
+
+#define CHIP8_FRAME_ROWS 32
+#define CHIP8_DEFAULT_CYCLES_PER_FRAME 12
+#define CHIP8_MAX_REWARD_TERMS 8
+
+/* How a reward term reads its value from RAM */
+#define CHIP8_REWARD_BYTE 0     /* ram[address] */
+#define CHIP8_REWARD_BCD 1      /* ram[address..address+2] as FX33 digits */
+
+typedef struct chip8_env chip8_env;
+typedef struct chip8_visited chip8_visited;
+
+typedef struct chip8_reward_term {
+    uint16_t address;
+    uint8_t kind;
+    int32_t weight;
+} chip8_reward_term;
+
+CHIP8_API int chip8_abi_version(void);
+
+/* ROM is copied; NULL if it does not fit in memory */
+CHIP8_API chip8_env * chip8_create(const uint8_t * rom, size_t size);
+CHIP8_API void chip8_destroy(chip8_env * env);
+
+/* Reload the ROM and clear the machine, keeping settings */
+CHIP8_API void chip8_reset(chip8_env * env);
+
+/*
+ * Seed the random numbers CXNN draws, now and again on every chip8_reset,
+ * so an episode replays exactly. Unseeded environments are seeded from
+ * the system and carry on their sequence across resets.
+ */
+CHIP8_API void chip8_seed(chip8_env * env, uint32_t seed);
+
+/* Instructions run per frame by chip8_step_batch */
+CHIP8_API void chip8_set_cycles_per_frame(chip8_env * env, int cycles);
+
+/*
+ * Score = sum of weight * value over the terms. Each step's reward is the
+ * change in score. Returns -1 if there are too many terms.
+ */
+CHIP8_API int chip8_set_reward(chip8_env * env, const chip8_reward_term * terms, int count);
+
+/*
+ * Advance n environments by frames frames each. actions[i] is the keypad
+ * state for envs[i], bit k set while key k is held. rewards and faults may
+ * be NULL; faults[i] is nonzero once envs[i] has faulted, and faulted
+ * environments stop advancing until reset.
+ */
+CHIP8_API void chip8_step_batch(chip8_env ** envs, const uint16_t * actions, int n, int frames,
+                                float * rewards, uint8_t * faults);
+
+/*
+ * Display packed one bit per pixel, CHIP8_FRAME_ROWS rows of 64 pixels with
+ * bit 63 the leftmost. Points into the machine and stays valid until
+ * chip8_destroy; it changes as the machine runs.
+ */
+CHIP8_API const uint64_t * chip8_frame(const chip8_env * env);
+
+/* The machine's 4096 bytes of RAM, read-only */
+CHIP8_API const uint8_t * chip8_ram(const chip8_env * env);
+
+/*
+ * 64-bit hash of the machine state (RAM, display, registers, stack and
+ * timers), maintained incrementally as the machine runs, so it is cheap
+ * to call after every step.
+ */
+CHIP8_API uint64_t chip8_fingerprint(const chip8_env * env);
+
+/*
+ * Set of fingerprints that any number of threads may insert into at once,
+ * holding up to capacity entries. insert returns 1 if the fingerprint was
+ * new, 0 if it was already seen or the set is full.
+ */
+CHIP8_API chip8_visited * chip8_visited_create(size_t capacity);
+CHIP8_API void chip8_visited_destroy(chip8_visited * set);
+CHIP8_API int chip8_visited_insert(chip8_visited * set, uint64_t fingerprint);
+CHIP8_API size_t chip8_visited_size(const chip8_visited * set);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBCHIP8_H */
@@ -0,0 +1,105 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include "chip8.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define METRICS_FAULT_KINDS (FAULT_KEY_RANGE + 1)
+#define METRICS_PUBLISH_MILLISECONDS 1000
+// Prefix selecting a Unix-domain socket instead of a file
+#define METRICS_SOCKET_PREFIX "unix:"
+
+// Monotonic count, safe to add to from any thread
+class MetricCounter {
+public:
+    MetricCounter() : count(0) {}
+
+    void add(uint64_t n = 1) {
+        count.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t value() const {
+        return count.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> count;
+};
+
+// Distribution over fixed upper bounds. The sum is kept in millionths so
+// that it can be a plain atomic integer.
+class MetricHistogram {
+public:
+    MetricHistogram(const std::vector<double> &bounds);
+
+    void observe(double value);
+
+    const std::vector<double> bounds;
+    std::unique_ptr<std::atomic<uint64_t>[]> counts;    // Per bucket, +Inf last
+    std::atomic<uint64_t> sumMillionths;
+};
+
+// Everything a frontend reports. Updates are relaxed atomics, so the hot
+// path never waits on the publisher reading them.
+class Metrics {
+public:
+    // labels are added to every sample, e.g. rom="pong.ch8"
+    Metrics(const std::string &labels = "");
+
+    MetricCounter instructions;
+    MetricCounter framesPresented;
+    MetricCounter framesSkipped;        // Left unpresented by the frame governor
+    MetricCounter lateFrames;           // 60 Hz ticks missed entirely
+    MetricCounter drawCalls;            // Textures copied to the renderer
+    MetricCounter soundEvents;
+    MetricCounter faults[METRICS_FAULT_KINDS];
+    MetricHistogram frameSeconds;       // Time between 60 Hz ticks
+
+    void fault(byte kind) {
+        faults[kind < METRICS_FAULT_KINDS ? kind : 0].add();
+    }
+
+    // Prometheus text exposition format, version 0.0.4
+    std::string format() const;
+
+    // Write to a temporary file and rename it over filename, so a scraper
+    // never reads half a file
+    bool writeFile(const std::string &filename) const;
+
+    // label="value" with the value escaped for the exposition format
+    static std::string label(const std::string &name, const std::string &value);
+
+private:
+    std::string labels;
+};
+
+// Publishes metrics from a background thread: rewrites a file every
+// METRICS_PUBLISH_MILLISECONDS, or answers every connection to a
+// Unix-domain socket (target "unix:PATH") with the current values.
+class MetricsPublisher {
+public:
+    MetricsPublisher(const Metrics &metrics, const std::string &target);
+
+    // Publishes one last time and removes the socket
+    ~MetricsPublisher();
+
+    bool ok() const;
+
+private:
+    void publishLoop();
+    void serveSocket();
+
+    const Metrics &metrics;
+    std::string path;
+    int listener;
+    bool valid;
+    std::atomic<bool> stopping;
+    std::thread publisher;
+};
+
+#endif // METRICS_HPP
@@ -0,0 +1,170 @@
+#ifndef NETPLAY_HPP
+#define NETPLAY_HPP
+
+#include "chip8.hpp"
+#include "fork.hpp"
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+#include <netinet/in.h>
+
+#define NETPLAY_MAGIC 0x4E503843        // "C8PN"
+#define NETPLAY_VERSION 1
+// Frames the local side may run ahead of the last confirmed remote input.
+// 8 frames at 60 Hz hides about 130 ms of one-way latency.
+#define NETPLAY_MAX_ROLLBACK 8
+// Saved states kept, covering every frame that can be rolled back to
+#define NETPLAY_RING (NETPLAY_MAX_ROLLBACK + 2)
+// Most inputs sent in one packet; older ones the peer must already have
+#define NETPLAY_MAX_INPUTS (4 * NETPLAY_MAX_ROLLBACK)
+#define NETPLAY_CYCLES_PER_FRAME 12
+#define NETPLAY_PACKET_BYTES 512
+
+enum NetplayPacket : byte {
+    NETPLAY_HELLO = 1,      // Joiner to host, until welcomed
+    NETPLAY_WELCOME,        // Host to joiner, with the CXNN seed
+    NETPLAY_INPUT,          // Unacknowledged inputs, ack and sync check
+};
+
+// Deterministic rollback over two keypad streams. Each frame runs
+// cyclesPerFrame instructions with the local keys ORed with the remote
+// keys, predicted as the last ones received until the real ones arrive.
+// A misprediction restores the state saved at that frame and runs the
+// frames since again, headless, before the next frame.
+class RollbackSession {
+public:
+    RollbackSession(const std::vector<byte> &rom, uint32_t seed,
+                    int cyclesPerFrame = NETPLAY_CYCLES_PER_FRAME);
+
+    // Run the next frame. False, without running it, when it would get
+    // more than NETPLAY_MAX_ROLLBACK frames ahead of the remote inputs.
+    bool advance(uint16_t localKeys);
+
+    // Remote keys for a frame; repeats and stale frames are ignored
+    void remoteInput(uint32_t frame, uint16_t keys);
+
+    // Apply a pending rollback without running a new frame
+    void settle();
+
+    uint16_t localInput(uint32_t frame) const;
+
+    // Latest frame whose starting state no longer depends on predictions,
+    // and that state's fingerprint. False before the first frame.
+    bool syncPoint(uint32_t &frame, uint64_t &fingerprint) const;
+
+    // Compare the peer's sync point with ours, if we still have it.
+    // Returns false and sets desynced when they differ.
+    bool checkSync(uint32_t frame, uint64_t fingerprint);
+
+    Chip8 sys;
+    uint32_t frame;             // Frames run
+    uint32_t remoteFrames;      // Remote inputs known for every frame before this
+    bool desynced;
+    uint64_t rollbacks;
+    uint64_t resimulatedFrames;
+
+private:
+    // The machine at the start of a frame, kept while it may be rolled
+    // back to
+    struct FrameSlot {
+        uint32_t frame;
+        uint16_t usedRemote;    // Known or predicted keys the frame ran with
+        uint64_t fingerprint;
+        MachineState state;
+    };
+
+    const FrameSlot * find(uint32_t frame) const;
+    void simulate(uint32_t frame);
+
+    Forker forker;
+    int cyclesPerFrame;
+    std::vector<FrameSlot> ring;
+    std::vector<uint16_t> localInputs;
+    std::vector<int32_t> remoteInputs;      // -1 until received
+    bool pendingRollback;
+    uint32_t rollbackFrom;
+};
+
+// Non-blocking UDP socket to one peer, with optional injected delay and
+// loss on sent packets for testing over loopback
+class NetplayLink {
+public:
+    // Binds to port on all interfaces, or an ephemeral port for 0
+    NetplayLink(int port = 0);
+    ~NetplayLink();
+
+    bool ok() const;
+    int port() const;
+
+    // Send to this peer from now on
+    bool connect(const std::string &host, int port);
+    bool connected() const;
+
+    // Queued behind the injected delay, or dropped
+    void send(const byte * data, size_t size);
+
+    // Next packet from the peer, or -1. Until connected, the first sender
+    // becomes the peer.
+    int receive(byte * data, size_t size);
+
+    // Sends delayed packets that are due; called by receive() as well
+    void flush();
+
+    // Packets still waiting out the injected delay
+    size_t queued() const;
+
+    int delayMilliseconds;
+    int lossPercent;
+
+private:
+    struct Delayed {
+        int64_t due;
+        std::vector<byte> data;
+    };
+
+    int fd;
+    bool hasPeer;
+    sockaddr_in peer;
+    std::deque<Delayed> delayed;
+    std::mt19937 loss;
+};
+
+// Rollback netplay between two processes: the handshake, sending inputs
+// every frame and checking both sides stay in sync
+class Netplay {
+public:
+    // The host waits for a joiner and picks the seed; the joiner says hello
+    // to a link already connected to the host
+    Netplay(NetplayLink &link, const std::vector<byte> &rom, bool host, uint32_t seed = 0,
+            int cyclesPerFrame = NETPLAY_CYCLES_PER_FRAME);
+    ~Netplay();
+
+    // Handle incoming packets and the handshake. True once started.
+    bool poll();
+
+    // Once per host frame: run the next frame if the remote inputs allow,
+    // then send. Returns whether a frame ran.
+    bool frame(uint16_t localKeys);
+
+    // Sends inputs and the sync point without running a frame, so the
+    // peer can catch up after this side has stopped
+    void sendInputs();
+
+    // Null until the handshake is done
+    RollbackSession * session;
+
+private:
+    NetplayLink &link;
+    std::vector<byte> rom;
+    bool host;
+    uint32_t seed;
+    int cyclesPerFrame;
+    uint32_t peerAck;           // Local frames the peer has inputs for
+};
+
+// Keypad state as a bitmask, bit k for key k
+uint16_t keypadMask(const byte keyState[16]);
+
+#endif // NETPLAY_HPP
@@ -0,0 +1,43 @@
+#ifndef PROBES_HPP
+#define PROBES_HPP
+
+// USDT probes under the chip8 provider, built in with -DCHIP8_USDT=ON and
+// systemtap's sys/sdt.h. An unattached probe is one NOP in the instruction
+// stream and its arguments are values already in registers, so they can
+// stay in release builds. Without CHIP8_USDT they compile to nothing.
+//
+//   frame(pc, opcode, microseconds)      chipemu's 60 Hz frame boundary
+//   draw(pc, opcode, x, y)               DXYN, with VX and VY
+//   timer(pc, delay, sound)              a timer tick while either runs
+//   key(pc, key, down)                   a keypad key pressed or released
+//   fault(pc, opcode, fault)             a fault was raised, see faultName()
+//   key_wait(pc, opcode)                 FX0A started waiting
+//   key_wait_done(pc, opcode, key)       FX0A got its key
+//
+// Each probe has a semaphore that tracers raise while attached, so a probe
+// needing work to decide whether to fire can skip it behind
+// CHIP8_PROBE_ENABLED(name).
+#ifdef CHIP8_USDT
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+#define CHIP8_PROBE2(name, a, b) DTRACE_PROBE2(chip8, name, a, b)
+#define CHIP8_PROBE3(name, a, b, c) DTRACE_PROBE3(chip8, name, a, b, c)
+#define CHIP8_PROBE4(name, a, b, c, d) DTRACE_PROBE4(chip8, name, a, b, c, d)
+#define CHIP8_PROBE_ENABLED(name) __builtin_expect(chip8_##name##_semaphore != 0, 0)
+
+// Defined in chip8.cpp
+extern unsigned short chip8_frame_semaphore;
+extern unsigned short chip8_draw_semaphore;
+extern unsigned short chip8_timer_semaphore;
+extern unsigned short chip8_key_semaphore;
+extern unsigned short chip8_fault_semaphore;
+extern unsigned short chip8_key_wait_semaphore;
+extern unsigned short chip8_key_wait_done_semaphore;
+#else
+#define CHIP8_PROBE2(name, a, b) do {} while (0)
+#define CHIP8_PROBE3(name, a, b, c) do {} while (0)
+#define CHIP8_PROBE4(name, a, b, c, d) do {} while (0)
+#define CHIP8_PROBE_ENABLED(name) false
+#endif
+
+#endif // PROBES_HPP
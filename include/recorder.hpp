@@ -0,0 +1,88 @@
+#ifndef RECORDER_HPP
+#define RECORDER_HPP
+
+#include "chip8.hpp"
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define VIDEO_MAGIC "CH8VIDEO"
+#define VIDEO_VERSION 1
+#define VIDEO_FRAME_RATE 60
+#define VIDEO_FRAME_BYTES (CHIP8_SCREEN_HEIGHT * 8)
+#define VIDEO_RING_FRAMES 256
+#define VIDEO_POLL_MILLISECONDS 20
+
+// A distinct frame and how many ticks of 1/VIDEO_FRAME_RATE s it stayed
+// on screen
+struct VideoFrame {
+    uint64_t rows[CHIP8_SCREEN_HEIGHT];     // Packed like Chip8::displayRows
+    uint32_t repeats;
+};
+
+// Writes frames to a video file. Each frame is XORed with the one before
+// it, so only changed pixels are nonzero, then runs of zero bytes are
+// run-length encoded.
+class VideoWriter {
+public:
+    VideoWriter(const std::string &filename);
+
+    bool ok() const;
+    void write(const VideoFrame &frame);
+    void flush();
+
+private:
+    std::ofstream out;
+    uint64_t previous[CHIP8_SCREEN_HEIGHT];
+};
+
+// Reads frames back from a video file
+class VideoReader {
+public:
+    VideoReader(const std::string &filename);
+
+    bool ok() const;
+
+    // False at the end of the video or on a corrupt frame
+    bool next(VideoFrame &frame);
+
+private:
+    std::ifstream in;
+    bool valid;
+    uint64_t previous[CHIP8_SCREEN_HEIGHT];
+};
+
+// Records the presented display. Repeated frames are folded into a repeat
+// count on the calling thread; distinct frames go through a single
+// producer, single consumer ring to a background thread that encodes and
+// writes them.
+class Recorder {
+public:
+    Recorder(const std::string &filename, int ringFrames = VIDEO_RING_FRAMES);
+
+    // Writes the last frame, drains the ring and closes the file
+    ~Recorder();
+
+    bool ok() const;
+
+    // Called by the frontend with the display as shown for that many ticks
+    void frame(const uint64_t rows[CHIP8_SCREEN_HEIGHT], uint32_t ticks = 1);
+
+private:
+    void push(const VideoFrame &frame);
+    void writeLoop();
+
+    VideoWriter file;
+    VideoFrame held;
+    std::vector<VideoFrame> ring;
+    size_t mask;
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+    std::atomic<bool> stopping;
+    std::thread writer;
+};
+
+#endif // RECORDER_HPP
@@ -0,0 +1,17 @@
+#ifndef ROMFILE_HPP
+#define ROMFILE_HPP
+
+#include "chip8.hpp"
+#include <string>
+#include <vector>
+
+// Adds a ROM path, or every .ch8 file in a directory in name order, to the
+// list
+void collectRoms(const std::string &path, std::vector<std::string> &roms);
+
+// Reads a ROM into a zero-padded buffer of CHIP8_ROM_BYTES. length, if
+// given, gets the bytes actually read. Empty if the file cannot be read or
+// holds nothing.
+std::vector<byte> loadRom(const std::string &filename, long * length = nullptr);
+
+#endif // ROMFILE_HPP
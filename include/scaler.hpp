@@ -0,0 +1,53 @@
+#ifndef SCALER_HPP
+#define SCALER_HPP
+
+#include <cstdint>
+#include <vector>
+
+// Filters for enlarging the 1-bit display
+enum ScaleFilter {
+    SCALE_NEAREST = 0,
+    SCALE_2X,           // Scale2x (EPX), used when the scale is even
+    SCALE_3X,           // Scale3x, used when the scale is a multiple of 3
+    SCALE_FILTERS,
+};
+
+const char * scaleFilterName(int filter);
+
+// Images are rows of words 64-bit words, one bit per pixel, bit 63 of
+// the first word leftmost, like Chip8::displayRows.
+
+// Scale2x on whole words at a time: dst has 2 * words words per row and
+// 2 * height rows
+void scale2x(const uint64_t * src, int words, int height, uint64_t * dst);
+
+// Scale3x: dst has 3 * words words per row and 3 * height rows
+void scale3x(const uint64_t * src, int words, int height, uint64_t * dst);
+
+// Expand each pixel to factor x factor ARGB pixels. pitch is in bytes, as
+// from SDL_LockTexture. Uses AVX2 or SSE2 when the CPU has them.
+void expandPixels(const uint64_t * src, int words, int width, int height, int factor,
+                  uint32_t onColour, uint32_t offColour, void * pixels, int pitch);
+
+// Renders the display into ARGB pixels scale times its size, applying the
+// filter when it divides the scale and nearest neighbour otherwise. Keeps
+// its scratch buffers between frames.
+class Scaler {
+public:
+    Scaler(uint32_t onColour, uint32_t offColour);
+
+    ScaleFilter filter;
+
+    // Largest integer scale at which the image fits in the area, at least 1
+    static int fitScale(int width, int height, int areaWidth, int areaHeight);
+
+    void render(const uint64_t * rows, int width, int height, int scale,
+                void * pixels, int pitch);
+
+private:
+    uint32_t onColour;
+    uint32_t offColour;
+    std::vector<uint64_t> filtered;
+};
+
+#endif // SCALER_HPP
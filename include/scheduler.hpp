@@ -0,0 +1,88 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include "chip8.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#define SCHEDULER_WHEEL_SLOTS 256
+#define SCHEDULER_TICK_MICROSECONDS 16667
+#define SCHEDULER_CYCLES_PER_FRAME 12
+
+// Why a session gave up the core
+enum SessionWait : byte {
+    WAIT_NONE = 0,      // Ran its frame; due again next tick
+    WAIT_KEY,           // Blocked in FX0A until a key event
+    WAIT_SPIN,          // Jumping to itself; only the timers change
+    WAIT_TIMER,         // Polling the delay timer in FX07, 3X00, 1NNN
+    WAIT_FAULT,         // Stopped for good
+};
+
+// One Chip8 run as a stackless coroutine: all of its state is in the
+// object, and resume() returns at the end of its frame or at a wait.
+struct Session {
+    Chip8 sys;
+    SessionWait wait;
+    int64_t lastTick;       // Last tick whose instructions are run or owed
+    int64_t wakeTick;       // Tick it is scheduled for, -1 when parked
+    long owed;              // Instructions skipped while waiting
+};
+
+// Runs thousands of sessions on one thread. Every 60 Hz tick, each session
+// due runs up to cyclesPerFrame instructions through cycle(), fused where
+// possible. Sessions waiting on a key or spinning are parked; sessions
+// polling the delay timer sleep on a timer wheel until the tick the wait
+// can end. Instructions skipped while waiting are caught up when the
+// session wakes, before any key event is applied, so every session ends
+// up exactly where running it continuously would have.
+//
+// Not thread safe: call everything from the thread that calls tick().
+class Scheduler {
+public:
+    Scheduler(int cyclesPerFrame = SCHEDULER_CYCLES_PER_FRAME);
+
+    // Starts a session on the next tick; rom is CHIP8_ROM_BYTES long
+    int add(const byte * rom);
+    void remove(int id);
+
+    // Key events wake the session, which runs on the next tick
+    void pressKey(int id, byte key);
+    void releaseKey(int id, byte key);
+
+    // Catch a session up to the last tick, e.g. before reading its state
+    Chip8 &machine(int id);
+
+    SessionWait wait(int id) const;
+
+    // Runs the sessions due this tick. Returns how many ran.
+    int tick();
+
+    // Ticks at 60 Hz until stop(); late ticks are run at once, and more
+    // than a frame behind the clock is dropped rather than replayed
+    void serve();
+    void stop();
+
+    // Called with each session whose display changed this tick
+    std::function<void(int id, const Chip8 &sys)> onFrame;
+
+    int64_t ticks;              // Ticks run so far
+    uint64_t resumes;           // Sessions run, over all ticks
+
+private:
+    Session * get(int id) const;
+    void schedule(int id, int64_t at);
+    void catchUp(Session &session, int64_t through);
+    void resume(int id, Session &session, int64_t now);
+    SessionWait detectWait(Session &session, int remaining, int64_t now, int64_t &wake);
+
+    int cyclesPerFrame;
+    std::vector<std::unique_ptr<Session>> sessions;
+    std::vector<int> freeIds;
+    std::vector<int> wheel[SCHEDULER_WHEEL_SLOTS];
+    std::atomic<bool> stopping;
+};
+
+#endif // SCHEDULER_HPP
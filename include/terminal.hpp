@@ -0,0 +1,39 @@
+#ifndef TERMINAL_HPP
+#define TERMINAL_HPP
+
+#include "chip8.hpp"
+#include <cstdint>
+#include <string>
+
+// Each character cell shows two pixel rows with half-block glyphs
+#define TERMINAL_CELL_ROWS (CHIP8_SCREEN_HEIGHT / 2)
+
+// Draws the packed display on an ANSI terminal. Each frame is diffed
+// against the last one drawn; only changed cells are sent, with cursor
+// moves between them, and the whole frame goes out in one write().
+class TerminalRenderer {
+public:
+    TerminalRenderer(int fd);
+
+    // Puts the cursor below the display and restores colours
+    ~TerminalRenderer();
+
+    // Returns the bytes written, 0 when nothing changed
+    size_t render(const uint64_t rows[CHIP8_SCREEN_HEIGHT]);
+
+    // Redraw every cell next time, e.g. after the terminal was cleared
+    void invalidate();
+
+private:
+    void moveTo(int row, int column);
+    void flush();
+
+    int fd;
+    uint64_t shown[CHIP8_SCREEN_HEIGHT];
+    bool valid;
+    int cursorRow;
+    int cursorColumn;
+    std::string buffer;
+};
+
+#endif // TERMINAL_HPP
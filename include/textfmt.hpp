@@ -0,0 +1,12 @@
+#ifndef TEXTFMT_HPP
+#define TEXTFMT_HPP
+
+#include <string>
+
+// Formats a value as 0x followed by at least digits upper-case hex digits
+std::string hex(int value, int digits);
+
+// Quotes a string for JSON, escaping quotes, backslashes and control bytes
+std::string jsonString(const std::string &value);
+
+#endif // TEXTFMT_HPP
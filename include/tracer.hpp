@@ -0,0 +1,121 @@
+#ifndef TRACER_HPP
+#define TRACER_HPP
+
+#include "chip8.hpp"
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define TRACE_MAGIC "CH8TRACE"
+#define TRACE_VERSION 1
+#define TRACE_RECORD_BYTES 9
+#define TRACE_RING_RECORDS 65536
+#define TRACE_CHUNK_RECORDS 4096
+// Largest chunk payload a writer emits: every delta byte a lone zero run
+#define TRACE_CHUNK_PAYLOAD_BYTES (2 * TRACE_RECORD_BYTES * TRACE_CHUNK_RECORDS)
+#define TRACE_NO_REGISTER 0xFF
+
+// One executed instruction, as of after it ran
+struct TraceRecord {
+    word pc;            // Address the opcode was fetched from
+    word opcode;
+    word index;         // I
+    byte reg;           // Register the instruction wrote, or TRACE_NO_REGISTER
+    byte value;         // New value of reg
+    byte vf;
+};
+
+bool operator==(const TraceRecord &a, const TraceRecord &b);
+
+// Register an opcode writes (the highest one for FX65), or TRACE_NO_REGISTER
+byte tracedRegister(word opcode);
+
+// Writes records to a trace file in chunks of TRACE_CHUNK_RECORDS.
+// Each record is XORed with a prediction from earlier records, then
+// runs of zero bytes are run-length encoded.
+class TraceWriter {
+public:
+    TraceWriter(const std::string &filename);
+    ~TraceWriter();
+
+    bool ok() const;
+    void write(const TraceRecord &record);
+    void flush();
+
+private:
+    std::ofstream out;
+    std::vector<TraceRecord> pending;
+};
+
+// Records every instruction into a ring that a background thread drains
+// into a delta-compressed trace file. The ring is single producer, single
+// consumer: one Chip8 records, the writer thread consumes.
+class Tracer {
+public:
+    Tracer(const std::string &filename, int ringRecords = TRACE_RING_RECORDS);
+
+    // Drains the ring and closes the file
+    ~Tracer();
+
+    // False once the file could not be opened or a write failed
+    bool ok() const;
+
+    // Drains the ring and flushes the file, after which ok() tells whether
+    // every record was written. Record nothing after this.
+    void close();
+
+    // Called by Chip8::cycle() after each instruction
+    void record(const Chip8 &sys, word pc, word opcode) {
+        size_t h = head.load(std::memory_order_relaxed);
+
+        // Wait for the writer rather than lose records
+        while (h - tail.load(std::memory_order_acquire) > mask) {
+            std::this_thread::yield();
+        }
+
+        TraceRecord &r = ring[h & mask];
+        r.pc = pc;
+        r.opcode = opcode;
+        r.index = sys.indexRegister;
+        // VX for now: the writer thread works out whether X was written
+        r.reg = (opcode & 0x0F00) >> 8;
+        r.value = sys.variableRegisters[r.reg];
+        r.vf = sys.variableRegisters[0xF];
+
+        head.store(h + 1, std::memory_order_release);
+    }
+
+private:
+    void writeLoop();
+
+    TraceWriter file;
+    std::vector<TraceRecord> ring;
+    size_t mask;
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+    std::atomic<bool> stopping;
+    std::thread writer;
+};
+
+// Reads records back from a trace file
+class TraceReader {
+public:
+    TraceReader(const std::string &filename);
+
+    bool ok() const;
+
+    // False at the end of the trace or on a corrupt chunk
+    bool next(TraceRecord &record);
+
+private:
+    bool readChunk();
+
+    std::ifstream in;
+    bool valid;
+    std::vector<TraceRecord> chunk;
+    size_t position;
+};
+
+#endif // TRACER_HPP
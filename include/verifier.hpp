@@ -0,0 +1,86 @@
+#ifndef VERIFIER_HPP
+#define VERIFIER_HPP
+
+#include "chip8.hpp"
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+// Most instructions a backend is asked to run per call. Chip8::run()
+// reports every step as it goes; other backends are compared after the
+// call, which for dispatch() is at most 3 instructions or one spin.
+#define VERIFY_BATCH_BUDGET 4096
+// On average, one random key press or release per this many steps
+#define VERIFY_KEY_PERIOD 64
+
+// The state compared after every step
+struct VerifyState {
+    byte variableRegisters[CHIP8_VARIABLE_REGISTERS];
+    word indexRegister;
+    word programCounter;
+    byte stackPointer;
+    word stack[CHIP8_STACK_HEIGHT];
+    byte delayTimer;
+    byte soundTimer;
+    byte fault;
+    uint64_t memoryHash;            // RAM and display, hashed from scratch
+    uint64_t memoryFingerprint;     // As kept up to date by the machine
+
+    VerifyState(const Chip8 &sys);
+
+    // Names of the fields that differ, empty if none do
+    std::vector<std::string> differences(const VerifyState &other) const;
+
+    std::string toJson() const;
+};
+
+// Advances the candidate by at most budget instructions, at least one
+// unless it faulted. Returns instructions run before any fault.
+typedef std::function<int(Chip8 &sys, int budget)> VerifyBackend;
+
+// The superinstruction fast path, Chip8::dispatch()
+int fusedBackend(Chip8 &sys, int budget);
+
+// Chip8::run(), with opcodes decoded inline and timer ticks batched
+int runBackend(Chip8 &sys, int budget);
+
+// Runs a reference machine one cycle() at a time alongside a candidate
+// stepped by a backend, from the same ROM, seed and key presses. After
+// each candidate step the reference catches up to the same instruction
+// and the two are compared, and keys may change. Inside Chip8::run() a
+// step is one instruction or superinstruction.
+class Lockstep : public StepObserver {
+public:
+    Lockstep(const std::vector<byte> &rom, VerifyBackend backend = fusedBackend);
+
+    // Runs until instructions have been compared or the machines diverge
+    // or fault. Keys are pressed and released at random, from seed.
+    // Returns false at the first mismatch.
+    bool run(long instructions, uint32_t seed);
+
+    Chip8 reference;
+    Chip8 candidate;
+    long executed;          // Instructions both machines agree on
+    bool mismatch;
+
+    // JSON with the step and both states at the mismatch
+    std::string report() const;
+
+    bool stepped(Chip8 &sys, int count) override;
+
+private:
+    // Catches the reference up by count cycles, plus one more where the
+    // candidate faulted, and compares. False once they differ or fault.
+    bool compare(int count, bool candidateFaulted);
+    void changeKeys();
+
+    VerifyBackend backend;
+    std::vector<byte> rom;
+    std::mt19937 input;
+    long observed;          // Instructions run() reported in this call
+    bool faulted;
+};
+
+#endif // VERIFIER_HPP
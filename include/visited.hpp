@@ -0,0 +1,35 @@
+#ifndef VISITED_HPP
+#define VISITED_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Set of machine fingerprints shared by any number of threads without
+// locks. Open addressing with linear probing over one atomic word per
+// slot; slots are claimed with compare-and-swap and never removed. A zero
+// slot is empty, so fingerprint 0 is kept in a flag of its own.
+class VisitedSet {
+public:
+    // Room for capacity fingerprints; the table is at least twice that
+    VisitedSet(size_t capacity);
+
+    // True if fingerprint was not in the set before. Once the set is full,
+    // new fingerprints are not added and false is returned.
+    bool insert(uint64_t fingerprint);
+
+    bool contains(uint64_t fingerprint) const;
+
+    size_t size() const;
+    bool full() const;
+
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> slots;
+    size_t mask;
+    size_t capacity;
+    std::atomic<size_t> count;
+    std::atomic<bool> zero;     // Fingerprint 0 is in the set
+};
+
+#endif // VISITED_HPP
@@ -0,0 +1,107 @@
+#ifndef WALL_HPP
+#define WALL_HPP
+
+#include "chip8.hpp"
+#include "scheduler.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pixels around each tile, drawn in the focus colour on the focused tile
+#define WALL_BORDER 2
+
+// A rectangle of the atlas, in pixels
+struct WallRect {
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+// Runs many ROMs at once for an attract screen and composes their displays
+// into one ARGB atlas of tiles. Sessions are dealt round-robin to a
+// Scheduler per worker thread, so parked and sleeping sessions cost nothing
+// and each worker only touches its own sessions and tiles. frame() runs one
+// 60 Hz tick on every worker and waits for them all; between frames the
+// workers are idle, so keys and compose() need no locks.
+class AttractWall {
+public:
+    // roms are CHIP8_ROM_BYTES long, repeated to fill tiles
+    AttractWall(const std::vector<std::vector<byte>> &roms, int tiles, int threads,
+                int cyclesPerFrame = SCHEDULER_CYCLES_PER_FRAME);
+    ~AttractWall();
+
+    // Run one tick on every session
+    void frame();
+
+    // Draw tiles whose display changed since the last call, and the
+    // borders of tiles that gained or lost focus, into the atlas at scale.
+    // dirty gets the changed areas, runs of adjacent tiles in a grid row
+    // merged, for uploading; returns how many.
+    int compose(int scale, void * pixels, int pitch, std::vector<WallRect> &dirty);
+
+    // Atlas size at scale
+    int atlasWidth(int scale) const;
+    int atlasHeight(int scale) const;
+
+    // Tile under an atlas pixel at scale, or -1
+    int tileAt(int scale, int x, int y) const;
+
+    // Keys go to the focused tile. Moving the focus releases its keys.
+    void setFocus(int tile);
+    void moveFocus(int dx, int dy);
+    void pressKey(byte key);
+    void releaseKey(byte key);
+
+    // A tile's machine, caught up to the last frame
+    const Chip8 &machine(int tile);
+
+    int tiles;
+    int columns;
+    int rows;
+    int focus;
+    uint64_t frames;
+
+    uint32_t onColour;
+    uint32_t offColour;
+    uint32_t focusColour;
+    uint32_t borderColour;
+
+private:
+    struct Shard {
+        Scheduler scheduler;
+        std::vector<int> sessionTile;   // Session id to tile
+        std::thread thread;
+
+        Shard(int cyclesPerFrame) : scheduler(cyclesPerFrame) {}
+    };
+
+    struct Tile {
+        int shard;
+        int session;
+        uint64_t rows[CHIP8_SCREEN_HEIGHT];
+        bool dirty;
+        bool borderDirty;
+    };
+
+    void work(Shard &shard);
+    void drawBorder(int tile, int scale, void * pixels, int pitch);
+    WallRect tileRect(int tile, int scale) const;
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::vector<Tile> tileState;
+    byte keys[16];
+
+    // Workers wait for generation to move on, then count down pending
+    std::mutex lock;
+    std::condition_variable start;
+    std::condition_variable done;
+    uint64_t generation;
+    int pending;
+    bool stopping;
+};
+
+#endif // WALL_HPP
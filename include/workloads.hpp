@@ -0,0 +1,35 @@
+#ifndef WORKLOADS_HPP
+#define WORKLOADS_HPP
+
+#include "chip8.hpp"
+#include <string>
+#include <vector>
+
+// Synthetic ROMs that each stress one class of instruction, looping
+// forever so they can be run for any instruction count
+enum Workload {
+    WORKLOAD_ALU,       // 8XYN and 7XNN, param instructions per loop
+    WORKLOAD_DRAW,      // DXYN across the screen edges, param sprites per loop
+    WORKLOAD_CALLS,     // 2NNN/00EE chain param deep, at most 16
+    WORKLOAD_MEMORY,    // FX55/FX65 of param registers, 1 to 16
+    WORKLOAD_BCD,       // FX33, param per loop
+    WORKLOAD_TIMER,     // FX15, then an FX07 wait loop from param
+    WORKLOADS,
+};
+
+const char * workloadName(int workload);
+
+// Parameter used when none is given
+int workloadDefault(Workload workload);
+
+// "draw" or "draw:32" to a workload and parameter, clamped to what the
+// workload supports. False if unknown.
+bool parseWorkload(const std::string &spec, Workload &workload, int &param);
+
+// Assembly source, for reading or for the assembler
+std::string workloadSource(Workload workload, int param);
+
+// Assembled and padded to CHIP8_ROM_BYTES
+std::vector<byte> workloadRom(Workload workload, int param);
+
+#endif // WORKLOADS_HPP
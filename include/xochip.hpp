@@ -0,0 +1,162 @@
+#ifndef XOCHIP_HPP
+#define XOCHIP_HPP
+
+#include "chip8.hpp"
+#include <cstdint>
+
+#define XOCHIP_RAM_BYTES 65536
+#define XOCHIP_ROM_BYTES (XOCHIP_RAM_BYTES - 0x200)
+#define XOCHIP_SCREEN_WIDTH 128
+#define XOCHIP_SCREEN_HEIGHT 64
+#define XOCHIP_ROW_WORDS (XOCHIP_SCREEN_WIDTH / 64)
+// FN01 takes a 4-bit mask; Octo and most ROMs use two planes
+#ifndef XOCHIP_PLANES
+#define XOCHIP_PLANES 2
+#endif
+#define XOCHIP_COLOURS (1 << XOCHIP_PLANES)
+#define XOCHIP_FLAG_REGISTERS 16
+#define XOCHIP_PATTERN_BYTES 16
+#define XOCHIP_SMALL_FONT 0x050
+#define XOCHIP_BIG_FONT 0x0A0
+
+// Pattern playback rate at pitch 64; each 48 pitch steps is an octave
+#define XOCHIP_PATTERN_RATE 4000.0
+
+// An XO-CHIP machine, kept apart from Chip8 so the classic core keeps its
+// 4 KB address space, fused dispatch and fingerprinting untouched.
+//
+// Quirks follow Octo's XO-CHIP defaults: shifts read VY, FX55/FX65 and
+// 5XY2/5XY3 behave as in Octo (I advances past FX55/FX65 only), BNNN adds
+// V0, and sprites wrap at both edges. Timers tick once per frame() rather
+// than per instruction, since XO-CHIP games run at hundreds of
+// instructions a frame.
+//
+// Each plane is stored as packed rows of 64-bit words, bit 63 of word 0 at
+// x = 0, always at 128x64. Low resolution doubles every pixel, so a draw
+// or scroll touches XOCHIP_ROW_WORDS words per row per selected plane.
+class XoChip {
+public:
+    XoChip();
+
+    byte ram[XOCHIP_RAM_BYTES];
+    byte variableRegisters[CHIP8_VARIABLE_REGISTERS];
+    byte flagRegisters[XOCHIP_FLAG_REGISTERS];
+    word stack[CHIP8_STACK_HEIGHT];
+
+    byte stackPointer;
+    word programCounter;
+    word indexRegister;
+
+    byte delayTimer;
+    byte soundTimer;
+
+    // planes[p][y][w]: plane p, row y, word w
+    uint64_t planes[XOCHIP_PLANES][XOCHIP_SCREEN_HEIGHT][XOCHIP_ROW_WORDS];
+    byte planeMask;         // FN01: planes drawn, cleared and scrolled
+    bool hires;
+    bool exited;            // 00FD ran
+    bool draw;              // Display changed since the frontend cleared it
+
+    byte pattern[XOCHIP_PATTERN_BYTES];     // F002: 128 one-bit samples
+    byte pitch;                             // FX3A
+
+    byte keyState[16];
+    bool blockingForKey;
+    bool keyFromBlock;
+    byte blockKey;
+
+    uint32_t randomState;
+
+    byte fault;
+    byte pendingFault;
+    CrashSnapshot crash;    // Registers, stack and timers at the fault
+
+    void reset();
+
+    // Copy a ROM of up to XOCHIP_ROM_BYTES to 0x200
+    void load(const byte * rom, size_t length);
+
+    void seedRandom(uint32_t seed);
+
+    // Runs one instruction. Returns the fault it raised, or FAULT_NONE.
+    Chip8Fault cycle();
+
+    // Run up to n instructions, stopping at a fault or 00FD. Returns
+    // instructions run.
+    int run(int n);
+
+    // One 60 Hz frame: up to n instructions, then the timers tick once
+    int frame(int n);
+
+    void tickTimers();
+
+    void pressKey(byte key);
+    void releaseKey(byte key);
+
+    // Colour index (bit p from plane p) of a pixel at 128x64
+    int pixel(int x, int y) const;
+
+    // Fill 128x64 ARGB pixels at scale from palette[XOCHIP_COLOURS]
+    void render(const uint32_t * palette, int scale, void * pixels, int pitch) const;
+
+    // Pattern playback rate in samples per second for the current pitch
+    double patternRate() const;
+
+    // Fill count mono samples at sampleRate, advancing phase (in pattern
+    // bits). Silent unless the sound timer is running.
+    void renderAudio(int16_t * out, int count, int sampleRate, double &phase) const;
+
+private:
+    Chip8Fault execute(word opcode);
+    void executeClearScroll(word opcode);
+    void executeLogicMathInstruction(word opcode, byte X, byte Y);
+    void executeMiscInstruction(word opcode, byte X);
+
+    void raiseFault(byte newFault) {
+        if (pendingFault == FAULT_NONE)
+            pendingFault = newFault;
+    }
+
+    // Opcode after the one at the PC is F000: skips step over 4 bytes
+    void skip();
+
+    // 00E0: Clear selected planes
+    void opClear();
+
+    // 00CN / 00DN: Scroll selected planes down / up N pixels
+    void opScrollDown(byte N);
+    void opScrollUp(byte N);
+
+    // 00FB / 00FC: Scroll selected planes right / left 4 pixels
+    void opScrollRight();
+    void opScrollLeft();
+
+    // 00FE / 00FF: Low / high resolution, clearing the display
+    void opResolution(bool high);
+
+    // 5XY2 / 5XY3: Save / load VX through VY at I, in either order
+    void opSaveRange(byte X, byte Y);
+    void opLoadRange(byte X, byte Y);
+
+    // 8XY6 / 8XYE: Shift VY into VX
+    void opRightShift(byte X, byte Y);
+    void opLeftShift(byte X, byte Y);
+
+    // DXYN: Draw N rows to each selected plane, 16x16 when N is 0
+    void opDraw(byte X, byte Y, byte N);
+
+    // F000 NNNN: Load I with the following word
+    void opLongIndex();
+
+    // FX0A: Wait for a key to be pressed and released
+    void opGetKey(byte X);
+
+    // FX33: Store the decimal digits of VX at I
+    void opBinaryCodedDecimal(byte X);
+
+    // FX55 / FX65: Store / load V0 through VX at I, I advancing
+    void opRegistersToRam(byte X);
+    void opRamToRegisters(byte X);
+};
+
+#endif // XOCHIP_HPP
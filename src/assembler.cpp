@@ -0,0 +1,384 @@
+#include "assembler.hpp"
+#include "disassembler.hpp"
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+
+// Operand kinds besides plain values
+enum OperandKind {
+    OPERAND_VALUE,
+    OPERAND_REGISTER,       // V0-VF
+    OPERAND_I,
+    OPERAND_I_INDIRECT,     // [I]
+    OPERAND_DT,
+    OPERAND_ST,
+    OPERAND_K,
+    OPERAND_F,
+    OPERAND_B,
+};
+
+struct Operand {
+    OperandKind kind;
+    int reg;
+    std::string text;       // For values: a number or label expression
+};
+
+struct Statement {
+    int line;
+    word address;
+    std::string mnemonic;
+    std::vector<Operand> operands;
+};
+
+bool Assembly::ok() const {
+    return errors.empty();
+}
+
+std::vector<byte> Assembly::image() const {
+    std::vector<byte> padded(rom);
+    padded.resize(CHIP8_ROM_BYTES, 0);
+    return padded;
+}
+
+static std::string trim(const std::string &text) {
+    size_t start = text.find_first_not_of(" \t\r");
+    if (start == std::string::npos)
+        return "";
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(start, end - start + 1);
+}
+
+static std::string upper(std::string text) {
+    for (size_t i = 0; i < text.size(); i++)
+        text[i] = toupper((unsigned char) text[i]);
+    return text;
+}
+
+static bool isIdentifier(const std::string &text) {
+    if (text.empty() || !(isalpha((unsigned char) text[0]) || text[0] == '_'))
+        return false;
+    for (size_t i = 1; i < text.size(); i++) {
+        if (!(isalnum((unsigned char) text[i]) || text[i] == '_' || text[i] == '.'))
+            return false;
+    }
+    return true;
+}
+
+static Operand parseOperand(const std::string &text) {
+    std::string name = upper(text);
+    if (name.size() == 2 && name[0] == 'V' && isxdigit((unsigned char) name[1]))
+        return Operand{OPERAND_REGISTER, (int) strtol(name.c_str() + 1, nullptr, 16), text};
+    if (name == "I")    return Operand{OPERAND_I, 0, text};
+    if (name == "[I]")  return Operand{OPERAND_I_INDIRECT, 0, text};
+    if (name == "DT")   return Operand{OPERAND_DT, 0, text};
+    if (name == "ST")   return Operand{OPERAND_ST, 0, text};
+    if (name == "K")    return Operand{OPERAND_K, 0, text};
+    if (name == "F")    return Operand{OPERAND_F, 0, text};
+    if (name == "B")    return Operand{OPERAND_B, 0, text};
+    return Operand{OPERAND_VALUE, 0, text};
+}
+
+static bool parseNumber(const std::string &text, long &value) {
+    if (text.empty())
+        return false;
+
+    const char * start = text.c_str();
+    bool negative = *start == '-';
+    if (negative)
+        start++;
+
+    int base = 10;
+    if (start[0] == '0' && (start[1] == 'x' || start[1] == 'X')) {
+        base = 16;
+        start += 2;
+    } else if (start[0] == '0' && (start[1] == 'b' || start[1] == 'B')) {
+        base = 2;
+        start += 2;
+    }
+
+    char * end;
+    value = strtol(start, &end, base);
+    if (end == start || *end != '\0')
+        return false;
+    if (negative)
+        value = -value;
+    return true;
+}
+
+class Assembler {
+public:
+    Assembler(Assembly &out) : out(out) {}
+
+    void parse(const std::string &source);
+    void layout();
+    void encode();
+
+private:
+    void error(int line, const std::string &message);
+    bool value(const Statement &s, const Operand &operand, long low, long high, long &result);
+    bool instruction(const Statement &s, word &opcode);
+    int size(const Statement &s);
+
+    Assembly &out;
+    std::vector<Statement> statements;
+};
+
+void Assembler::error(int line, const std::string &message) {
+    out.errors.push_back(AssemblyError{line, message});
+}
+
+void Assembler::parse(const std::string &source) {
+    std::istringstream in(source);
+    std::string text;
+    int line = 0;
+
+    while (std::getline(in, text)) {
+        line++;
+        text = trim(text.substr(0, text.find(';')));
+
+        // Any number of labels before the statement
+        size_t colon;
+        while ((colon = text.find(':')) != std::string::npos) {
+            std::string label = trim(text.substr(0, colon));
+            if (!isIdentifier(label) || parseOperand(label).kind != OPERAND_VALUE) {
+                error(line, "bad label '" + label + "'");
+            } else if (out.labels.count(label)) {
+                error(line, "label '" + label + "' defined twice");
+            } else {
+                // Placed in layout(); an empty statement marks where
+                out.labels[label] = 0;
+                statements.push_back(Statement{line, 0, ":" + label, {}});
+            }
+            text = trim(text.substr(colon + 1));
+        }
+        if (text.empty())
+            continue;
+
+        size_t space = text.find_first_of(" \t");
+        Statement s{line, 0, upper(text.substr(0, space)), {}};
+        if (space != std::string::npos) {
+            std::istringstream operands(text.substr(space));
+            std::string operand;
+            while (std::getline(operands, operand, ','))
+                s.operands.push_back(parseOperand(trim(operand)));
+        }
+        statements.push_back(s);
+    }
+}
+
+int Assembler::size(const Statement &s) {
+    if (s.mnemonic[0] == ':')
+        return 0;
+    if (s.mnemonic == "DB")
+        return s.operands.size();
+    if (s.mnemonic == "DW")
+        return 2 * s.operands.size();
+    return 2;
+}
+
+void Assembler::layout() {
+    int address = CHIP8_PROGRAM_START;
+    for (Statement &s : statements) {
+        s.address = address;
+        if (s.mnemonic[0] == ':')
+            out.labels[s.mnemonic.substr(1)] = address;
+        address += size(s);
+    }
+    if (address > CHIP8_RAM_BYTES)
+        error(statements.back().line, "program does not fit in RAM");
+}
+
+// A number, label, or label plus or minus a number, within [low, high]
+bool Assembler::value(const Statement &s, const Operand &operand, long low, long high, long &result) {
+    if (operand.kind != OPERAND_VALUE) {
+        error(s.line, "expected a value, not '" + operand.text + "'");
+        return false;
+    }
+
+    std::string text = operand.text;
+    size_t sign = text.find_first_of("+-", 1);
+    std::string base = trim(text.substr(0, sign));
+    long offset = 0;
+    if (sign != std::string::npos) {
+        std::string rest = trim(text.substr(sign + 1));
+        if (!parseNumber(rest, offset)) {
+            error(s.line, "bad offset '" + rest + "'");
+            return false;
+        }
+        if (text[sign] == '-')
+            offset = -offset;
+    }
+
+    if (!parseNumber(base, result)) {
+        std::map<std::string, word>::const_iterator label = out.labels.find(base);
+        if (label == out.labels.end()) {
+            error(s.line, "unknown label or bad number '" + base + "'");
+            return false;
+        }
+        result = label->second;
+    }
+    result += offset;
+
+    if (result < low || result > high) {
+        error(s.line, "value '" + text + "' out of range");
+        return false;
+    }
+    return true;
+}
+
+// Encodes one instruction. False after reporting an error.
+bool Assembler::instruction(const Statement &s, word &opcode) {
+    const std::string &m = s.mnemonic;
+    const std::vector<Operand> &ops = s.operands;
+    size_t count = ops.size();
+    OperandKind a = count > 0 ? ops[0].kind : OPERAND_VALUE;
+    OperandKind b = count > 1 ? ops[1].kind : OPERAND_VALUE;
+    int X = count > 0 ? ops[0].reg : 0;
+    int Y = count > 1 ? ops[1].reg : 0;
+    long v;
+
+    if (m == "CLS" && count == 0) {
+        opcode = 0x00E0;
+        return true;
+    }
+    if (m == "RET" && count == 0) {
+        opcode = 0x00EE;
+        return true;
+    }
+    if ((m == "JP" || m == "CALL") && count == 1) {
+        if (!value(s, ops[0], 0, 0xFFF, v))
+            return false;
+        opcode = (m == "JP" ? 0x1000 : 0x2000) | v;
+        return true;
+    }
+    if (m == "JP" && count == 2 && a == OPERAND_REGISTER && X == 0) {
+        if (!value(s, ops[1], 0, 0xFFF, v))
+            return false;
+        opcode = 0xB000 | v;
+        return true;
+    }
+    if ((m == "SE" || m == "SNE") && count == 2 && a == OPERAND_REGISTER) {
+        if (b == OPERAND_REGISTER) {
+            opcode = (m == "SE" ? 0x5000 : 0x9000) | X << 8 | Y << 4;
+            return true;
+        }
+        if (!value(s, ops[1], -128, 0xFF, v))
+            return false;
+        opcode = (m == "SE" ? 0x3000 : 0x4000) | X << 8 | (v & 0xFF);
+        return true;
+    }
+    if (m == "ADD" && count == 2 && a == OPERAND_I && b == OPERAND_REGISTER) {
+        opcode = 0xF01E | Y << 8;
+        return true;
+    }
+    if (m == "ADD" && count == 2 && a == OPERAND_REGISTER && b != OPERAND_REGISTER) {
+        if (!value(s, ops[1], -128, 0xFF, v))
+            return false;
+        opcode = 0x7000 | X << 8 | (v & 0xFF);
+        return true;
+    }
+
+    // 8XYN arithmetic; the shifts may name one register
+    static const char * const alu[] = {
+        "LD", "OR", "AND", "XOR", "ADD", "SUB", "SHR", "SUBN",
+        "", "", "", "", "", "", "SHL",
+    };
+    for (int n = 0; n < 15; n++) {
+        if (m != alu[n] || a != OPERAND_REGISTER)
+            continue;
+        if (count == 2 && b == OPERAND_REGISTER) {
+            opcode = 0x8000 | X << 8 | Y << 4 | n;
+            return true;
+        }
+        if (count == 1 && (n == 0x6 || n == 0xE)) {
+            opcode = 0x8000 | X << 8 | X << 4 | n;
+            return true;
+        }
+    }
+
+    if (m == "LD" && count == 2) {
+        if (a == OPERAND_REGISTER) {
+            switch (b) {
+                case OPERAND_DT:            opcode = 0xF007 | X << 8; return true;
+                case OPERAND_K:             opcode = 0xF00A | X << 8; return true;
+                case OPERAND_I_INDIRECT:    opcode = 0xF065 | X << 8; return true;
+                case OPERAND_VALUE:
+                    if (!value(s, ops[1], -128, 0xFF, v))
+                        return false;
+                    opcode = 0x6000 | X << 8 | (v & 0xFF);
+                    return true;
+                default:
+                    break;
+            }
+        }
+        if (a == OPERAND_I) {
+            if (!value(s, ops[1], 0, 0xFFF, v))
+                return false;
+            opcode = 0xA000 | v;
+            return true;
+        }
+        if (b == OPERAND_REGISTER) {
+            switch (a) {
+                case OPERAND_DT:            opcode = 0xF015 | Y << 8; return true;
+                case OPERAND_ST:            opcode = 0xF018 | Y << 8; return true;
+                case OPERAND_F:             opcode = 0xF029 | Y << 8; return true;
+                case OPERAND_B:             opcode = 0xF033 | Y << 8; return true;
+                case OPERAND_I_INDIRECT:    opcode = 0xF055 | Y << 8; return true;
+                default:
+                    break;
+            }
+        }
+    }
+    if (m == "RND" && count == 2 && a == OPERAND_REGISTER) {
+        if (!value(s, ops[1], 0, 0xFF, v))
+            return false;
+        opcode = 0xC000 | X << 8 | v;
+        return true;
+    }
+    if (m == "DRW" && count == 3 && a == OPERAND_REGISTER && b == OPERAND_REGISTER) {
+        if (!value(s, ops[2], 0, 0xF, v))
+            return false;
+        opcode = 0xD000 | X << 8 | Y << 4 | v;
+        return true;
+    }
+    if ((m == "SKP" || m == "SKNP") && count == 1 && a == OPERAND_REGISTER) {
+        opcode = (m == "SKP" ? 0xE09E : 0xE0A1) | X << 8;
+        return true;
+    }
+
+    error(s.line, "bad instruction '" + m + "' with " + std::to_string(count) + " operands");
+    return false;
+}
+
+void Assembler::encode() {
+    for (const Statement &s : statements) {
+        if (s.mnemonic[0] == ':')
+            continue;
+
+        if (s.mnemonic == "DB" || s.mnemonic == "DW") {
+            bool words = s.mnemonic == "DW";
+            for (const Operand &operand : s.operands) {
+                long v = 0;
+                value(s, operand, words ? -32768 : -128, words ? 0xFFFF : 0xFF, v);
+                if (words)
+                    out.rom.push_back((v >> 8) & 0xFF);
+                out.rom.push_back(v & 0xFF);
+            }
+            continue;
+        }
+
+        word opcode = 0;
+        instruction(s, opcode);
+        out.rom.push_back(opcode >> 8);
+        out.rom.push_back(opcode & 0xFF);
+    }
+}
+
+Assembly assemble(const std::string &source) {
+    Assembly assembly;
+    Assembler assembler(assembly);
+    assembler.parse(source);
+    assembler.layout();
+    assembler.encode();
+    return assembly;
+}
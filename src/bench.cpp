@@ -0,0 +1,105 @@
+#include "chip8.hpp"
+#include "workloads.hpp"
+#include "romfile.hpp"
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define BENCH_INSTRUCTIONS 20000000
+#define BENCH_SLICE 1000
+#define BENCH_REPEATS 5
+
+// Runs a ROM headless for a fixed instruction count, returns instructions/sec
+double measure(Chip8 &sys, std::vector<byte> &rom, bool fuse, long instructions) {
+	sys.reset();
+	sys.load(rom.data());
+	sys.useSuperinstructions = fuse;
+	sys.seedRandom(1);
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	long executed = 0;
+	while (executed < instructions && sys.fault == FAULT_NONE) {
+		executed += sys.run(BENCH_SLICE);
+	}
+
+	auto elapsed = std::chrono::high_resolution_clock::now() - start;
+	double seconds = std::chrono::duration<double>(elapsed).count();
+	return executed / seconds;
+}
+
+int main(int argc, char ** argv)
+{
+	// Named ROMs: files, or workloads generated in memory
+	std::vector<std::string> names;
+	std::vector<std::vector<byte>> roms;
+	for (int i = 1; i < argc; i++) {
+		Workload workload;
+		int param;
+		if (strcmp(argv[i], "--workloads") == 0) {
+			for (int w = 0; w < WORKLOADS; w++) {
+				param = workloadDefault((Workload) w);
+				names.push_back(std::string(workloadName(w)) + ":" + std::to_string(param));
+				roms.push_back(workloadRom((Workload) w, param));
+			}
+		} else if (strcmp(argv[i], "--workload") == 0 && i + 1 < argc) {
+			if (!parseWorkload(argv[++i], workload, param)) {
+				std::cout << "Unknown workload " << argv[i] << std::endl;
+				exit(1);
+			}
+			names.push_back(std::string(workloadName(workload)) + ":" + std::to_string(param));
+			roms.push_back(workloadRom(workload, param));
+		} else {
+			names.push_back(argv[i]);
+			roms.push_back(loadRom(argv[i]));
+			if (roms.back().empty()) {
+				std::cout << "Could not read " << argv[i] << std::endl;
+				exit(1);
+			}
+		}
+	}
+
+	if (roms.empty()) {
+		std::cout << "Usage: chipbench [--workloads] [--workload NAME[:PARAM]]... [ROM...]\n"
+		"Workloads: alu, draw, calls, memory, bcd, timer" << std::endl;
+		exit(0);
+	}
+
+	Chip8 * plain = new Chip8();
+	Chip8 * fused = new Chip8();
+
+	std::cout << "rom\tplain_ips\tfused_ips\tspeedup" << std::endl;
+
+	for (size_t i = 0; i < roms.size(); i++) {
+		std::vector<byte> &rom = roms[i];
+
+		// Alternate runs and keep the best of each to filter out host noise
+		double plainIps = 0;
+		double fusedIps = 0;
+		for (int r = 0; r < BENCH_REPEATS; r++) {
+			plainIps = std::max(plainIps, measure(*plain, rom, false, BENCH_INSTRUCTIONS));
+			fusedIps = std::max(fusedIps, measure(*fused, rom, true, BENCH_INSTRUCTIONS));
+		}
+
+		// Both runs must end in the same machine state
+		bool same = memcmp(plain->variableRegisters, fused->variableRegisters, CHIP8_VARIABLE_REGISTERS) == 0
+			&& memcmp(plain->displayBuffer, fused->displayBuffer, sizeof(plain->displayBuffer)) == 0
+			&& memcmp(plain->ram, fused->ram, CHIP8_RAM_BYTES) == 0
+			&& plain->programCounter == fused->programCounter
+			&& plain->indexRegister == fused->indexRegister;
+
+		std::cout << names[i] << "\t" << (long) plainIps << "\t" << (long) fusedIps
+			<< "\t" << fusedIps / plainIps << (same ? "" : "\tSTATE MISMATCH");
+		if (plain->fault != FAULT_NONE)
+			std::cout << "\tfault " << faultName(plain->fault);
+		std::cout << std::endl;
+	}
+
+	delete plain;
+	delete fused;
+	return 0;
+}
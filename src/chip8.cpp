@@ -1,23 +1,78 @@
 #include "chip8.hpp"
+#include "probes.hpp"
+#include "tracer.hpp"
 #include <iostream>
 #include <iomanip>
 #include <cstdlib>
+#include <cstring>
+#include <random>
+#include <sstream>
+
+#ifdef CHIP8_USDT
+// The probe semaphores, in the .probes section where tracers find them
+#define CHIP8_SEMAPHORE(name) \
+    unsigned short chip8_##name##_semaphore __attribute__((unused, section(".probes")))
+CHIP8_SEMAPHORE(frame);
+CHIP8_SEMAPHORE(draw);
+CHIP8_SEMAPHORE(timer);
+CHIP8_SEMAPHORE(key);
+CHIP8_SEMAPHORE(fault);
+CHIP8_SEMAPHORE(key_wait);
+CHIP8_SEMAPHORE(key_wait_done);
+#endif
 
 word combine(byte leftByte, byte rightByte) {
     return ((leftByte << 8) | rightByte);
 }
 
+const char * faultName(byte fault) {
+    switch (fault) {
+        case FAULT_NONE:                return "none";
+        case FAULT_ILLEGAL_OPCODE:      return "illegal_opcode";
+        case FAULT_STACK_OVERFLOW:      return "stack_overflow";
+        case FAULT_STACK_UNDERFLOW:     return "stack_underflow";
+        case FAULT_MEMORY_RANGE:        return "memory_range";
+        case FAULT_KEY_RANGE:           return "key_range";
+    }
+    return "unknown";
+}
+
+std::string CrashSnapshot::toJson() const {
+    std::ostringstream out;
+    out << "{\"fault\":\"" << faultName(fault) << "\""
+        << ",\"pc\":" << programCounter
+        << ",\"opcode\":" << opcode
+        << ",\"i\":" << indexRegister
+        << ",\"sp\":" << (int) stackPointer
+        << ",\"dt\":" << (int) delayTimer
+        << ",\"st\":" << (int) soundTimer
+        << ",\"v\":[";
+    for (int i = 0; i < CHIP8_VARIABLE_REGISTERS; i++) {
+        out << (i ? "," : "") << (int) variableRegisters[i];
+    }
+    out << "],\"stack\":[";
+    for (int i = 0; i < CHIP8_STACK_HEIGHT; i++) {
+        out << (i ? "," : "") << stack[i];
+    }
+    out << "]}";
+    return out.str();
+}
+
 Chip8::Chip8() {
     // Load user settings
     copyBeforeShifting = false;
+    useSuperinstructions = true;
+    tracer = nullptr;
+    profile = nullptr;
+    observer = nullptr;
 
     // Seed random number generator
-    srand(time(nullptr));
+    seedRandom(std::random_device()());
 
     reset();    
 }
 
-void Chip8::execute(word opcode) {
+Chip8Fault Chip8::execute(word opcode) {
 
     byte X = (opcode & 0x0F00) >> 8;    // nib 2
     byte Y = (opcode & 0x00F0) >> 4;    // nib 3
@@ -31,28 +86,47 @@ void Chip8::execute(word opcode) {
         case 0x2000:    opCall(NNN);                                break;
         case 0x3000:    opSkipByteEqual(X, NN);                     break;
         case 0x4000:    opSkipByteUnequal(X, NN);                   break;
-        case 0x5000:    opSkipRegEqual(X, Y);                       break;
+        case 0x5000:
+            if (N == 0)
+                opSkipRegEqual(X, Y);
+            else
+                raiseFault(FAULT_ILLEGAL_OPCODE);
+            break;
         case 0x6000:    opSetRegister(X, NN);                       break;
         case 0x7000:    opAdd(X, NN);                               break;
         case 0x8000:    executeLogicMathInstruction(opcode, X, Y);  break;
-        case 0x9000:    opSkipRegUnequal(X, Y);                     break;
+        case 0x9000:
+            if (N == 0)
+                opSkipRegUnequal(X, Y);
+            else
+                raiseFault(FAULT_ILLEGAL_OPCODE);
+            break;
         case 0xA000:    opSetIndex(NNN);                            break;
+        case 0xB000:    opJumpOffset(NNN);                          break;
         case 0xC000:    opRandom(X, NN);                            break;
         case 0xD000:    opDraw(X, Y, N);                            break;
         case 0xE000:    executeKeyInstruction(opcode, X);           break;
         case 0xF000:    executeMiscInstruction(opcode, X);          break;
-        default:
-            std::cerr << "Unsupported instruction: " << std::hex << opcode << std::endl;
-            exit(1);
-            break;
+        default:        raiseFault(FAULT_ILLEGAL_OPCODE);           break;
+    }
+
+    // Masked RAM accesses that wrapped around
+    if (addressOverflow != 0) {
+        raiseFault(FAULT_MEMORY_RANGE);
+        addressOverflow = 0;
     }
+
+    Chip8Fault raised = (Chip8Fault) pendingFault;
+    pendingFault = FAULT_NONE;
+    return raised;
 }
 
 void Chip8::executeKeyInstruction(word opcode, byte X)
 {
-    switch (opcode & 0x000F) {
-        case 0x000E:    opSkipKeyDown(X);       break;
-        case 0x0001:    opSkipKeyNotDown(X);    break;
+    switch (opcode & 0x00FF) {
+        case 0x009E:    opSkipKeyDown(X);       break;
+        case 0x00A1:    opSkipKeyNotDown(X);    break;
+        default:        raiseFault(FAULT_ILLEGAL_OPCODE);   break;
     }
 }
 
@@ -68,14 +142,16 @@ void Chip8::executeMiscInstruction(word opcode, byte X)
         case 0x001E:    opAddRegToIndex(X);         break;
         case 0x0055:    opRegistersToRam(X);        break;
         case 0x0065:    opRamToRegisters(X);        break;
+        default:        raiseFault(FAULT_ILLEGAL_OPCODE);   break;
     }
 }
 
 void Chip8::executeClearReturn(word opcode)
 {
-    switch (opcode & 0x000F) {
-        case 0x0000:    opClear();      break;
-        case 0x000E:    opReturn();     break;
+    switch (opcode) {
+        case 0x00E0:    opClear();      break;
+        case 0x00EE:    opReturn();     break;
+        default:        raiseFault(FAULT_ILLEGAL_OPCODE);   break;
     }
 }
 
@@ -90,10 +166,17 @@ void Chip8::executeLogicMathInstruction(word opcode, byte X, byte Y) {
         case 0x0006:    opRightShift(X, Y);     break;
         case 0x0007:    opSubRL(X, Y);          break;
         case 0x000E:    opLeftShift(X, Y);      break;
+        default:        raiseFault(FAULT_ILLEGAL_OPCODE);   break;
     }
 }
 
 void Chip8::opClear() {
+    displayDirty = true;
+
+    for (int y = 0; y < CHIP8_SCREEN_HEIGHT; y++) {
+        writeDisplayRow(y, 0);
+    }
+
     for (int y = 0; y < CHIP8_SCREEN_HEIGHT; y++) {
         for (int x = 0; x < CHIP8_SCREEN_WIDTH; x++) {
             displayBuffer[y][x] = 0x00;
@@ -105,6 +188,11 @@ void Chip8::opJump(word NNN) {
     programCounter = NNN;
 }
 
+void Chip8::opJumpOffset(word NNN) {
+    // NNN + V0 can pass 0xFFF; the jump wraps within RAM
+    programCounter = (NNN + variableRegisters[0]) & 0x0FFF;
+}
+
 void Chip8::opSetRegister(byte X, word NN)
 {
     variableRegisters[X] = NN;
@@ -132,10 +220,22 @@ void Chip8::opDraw(byte X, byte Y, byte N)
     // Turn off VF
     variableRegisters[0xF] = 0;
 
+    if (profile != nullptr)
+        profile->sprites++;
+
+    CHIP8_PROBE4(draw, programCounter - 2, 0xD000 | (X << 8) | (Y << 4) | N,
+                 variableRegisters[X], variableRegisters[Y]);
+
     // Draw bytes I up to I+N 8px wide
     for (int y = 0; y < N; y++) {
         // Get the row of the sprite
-        byte spriteRow = ram[indexRegister + y];
+        word spriteAddress = ramAddress(indexRegister + y);
+        byte spriteRow = ram[spriteAddress];
+        if (profile != nullptr)
+            profile->reads[spriteAddress]++;
+
+        // Packed copy: bits past the right edge shift out
+        writeDisplayRow(yCoord, displayRows[yCoord] ^ (((uint64_t) spriteRow << 56) >> startX));
         
         // For bits in the byte, from MSB to LSB
         for (int x = 7; x >= 0; x--) {
@@ -165,14 +265,24 @@ void Chip8::opDraw(byte X, byte Y, byte N)
             break;
         }
     }
+
+    displayDirty |= draw;
 }
 
 void Chip8::opCall(word NNN) {
+    if (stackPointer >= CHIP8_STACK_HEIGHT) {
+        raiseFault(FAULT_STACK_OVERFLOW);
+        return;
+    }
     stack[stackPointer++] = programCounter;
 	programCounter = NNN;
 }
 
 void Chip8::opReturn() {
+    if (stackPointer == 0) {
+        raiseFault(FAULT_STACK_UNDERFLOW);
+        return;
+    }
     programCounter = stack[--stackPointer];
 }
 
@@ -263,14 +373,23 @@ void Chip8::opRightShift(byte X, byte Y) {
 }
 
 void Chip8::opRandom(byte X, byte NN) {
-    variableRegisters[X] = rand() & NN;
+    // xorshift32, taking the well-mixed top byte
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    variableRegisters[X] = (randomState >> 24) & NN;
+}
+
+void Chip8::seedRandom(uint32_t seed) {
+    // xorshift never leaves zero
+    randomState = seed != 0 ? seed : 0x9E3779B9;
 }
 
 void Chip8::opSkipKeyDown(byte X) {
-    byte state = keyState[variableRegisters[X]];
-    
-    if (state > 0xF)
-        exit(1);
+    if (variableRegisters[X] > 0xF)
+        raiseFault(FAULT_KEY_RANGE);
+
+    byte state = keyState[variableRegisters[X] & 0xF];
     
     if (state == 1) {
         programCounter += 2;
@@ -278,26 +397,41 @@ void Chip8::opSkipKeyDown(byte X) {
 }
 
 void Chip8::opSkipKeyNotDown(byte X) {
-    byte state = keyState[variableRegisters[X]];
-    
-    if (state > 0xF)
-        exit(1);
+    if (variableRegisters[X] > 0xF)
+        raiseFault(FAULT_KEY_RANGE);
+
+    byte state = keyState[variableRegisters[X] & 0xF];
     
     if (state == 0) {
         programCounter += 2;
     }
 }
 
+void Chip8::pressKey(byte key) {
+    // A press during FX0A is the one it is waiting for
+    if (blockingForKey)
+        lastKeyFromBlock = true;
+
+    keyState[key & 0xF] = 1;
+    lastKey = key & 0xF;
+    CHIP8_PROBE3(key, programCounter, key & 0xF, 1);
+}
+
+void Chip8::releaseKey(byte key) {
+    keyState[key & 0xF] = 0;
+    CHIP8_PROBE3(key, programCounter, key & 0xF, 0);
+}
+
 void Chip8::opDelayToReg(byte X) {
     variableRegisters[X] = delayTimer;
 }
 
 void Chip8::opSetDelayTimer(byte X) {
-    delayTimer = X;
+    delayTimer = variableRegisters[X];
 }
 
 void Chip8::opSetSoundTimer(byte X) {
-    soundTimer = X;
+    soundTimer = variableRegisters[X];
 }
 
 void Chip8::opAddRegToIndex(byte X) {
@@ -312,12 +446,14 @@ void Chip8::opGetKey(byte X) {
     // If not blocking, zero out the key state and set to blocking
     if (!blockingForKey) {
         blockingForKey = true;
+        CHIP8_PROBE2(key_wait, programCounter - 2, 0xF00A | (X << 8));
     }
 
     // If the last key was fetched during a block and has been released, get it & return
     if (lastKeyFromBlock && (keyState[lastKey] == 0)) {
         variableRegisters[X] = lastKey;
         blockingForKey = false;
+        CHIP8_PROBE3(key_wait_done, programCounter - 2, 0xF00A | (X << 8), lastKey);
         return;
     }
 
@@ -326,36 +462,187 @@ void Chip8::opGetKey(byte X) {
 }
 
 void Chip8::opFontChar(byte X) {
-    indexRegister = ram[0x050 + (5 * X)];
+    indexRegister = 0x050 + 5 * (variableRegisters[X] & 0x0F);
 }
 
 void Chip8::opBinaryCodedDecimal(byte X) {
-    ram[indexRegister] = variableRegisters[X] / 100;
-    ram[indexRegister + 1] = (variableRegisters[X] / 10) % 10;
-    ram[indexRegister + 2] = variableRegisters[X] % 10;
+    writeRam(indexRegister, variableRegisters[X] / 100);
+    writeRam(indexRegister + 1, (variableRegisters[X] / 10) % 10);
+    writeRam(indexRegister + 2, variableRegisters[X] % 10);
+    fuseRange(indexRegister, 3);
 }
 
 void Chip8::opRegistersToRam(byte X) {
     for (int i = 0; i <= X; i++) {
-        ram[indexRegister + i] = variableRegisters[i];   
+        writeRam(indexRegister + i, variableRegisters[i]);
+    }
+    fuseRange(indexRegister, X + 1);
+}
+
+// Returns the superinstruction starting at address, or FUSED_NONE
+static byte matchFused(const byte * ram, int address) {
+    if (address + 4 > CHIP8_RAM_BYTES) {
+        return FUSED_NONE;
+    }
+
+    word first = combine(ram[address], ram[address + 1]);
+
+    if (first == (0x1000 | address)) {
+        return FUSED_SPIN;
+    }
+
+    word second = combine(ram[address + 2], ram[address + 3]);
+    byte X = (first & 0x0F00) >> 8;
+
+    switch (first & 0xF000) {
+        case 0xA000:
+            if ((second & 0xF000) == 0xD000)
+                return FUSED_INDEX_DRAW;
+            break;
+        case 0x6000:
+            if ((second & 0xF000) == 0x6000)
+                return FUSED_SET_PAIR;
+            break;
+        case 0x7000:
+            if ((second & 0xF000) == 0x3000)
+                return FUSED_ADD_SKIP;
+            break;
+        case 0xF000:
+            // FX07, 3XNN on the same register, then a jump
+            if ((first & 0x00FF) == 0x0007
+                && (second & 0xFF00) == (0x3000 | (X << 8))
+                && address + 6 <= CHIP8_RAM_BYTES
+                && (ram[address + 4] & 0xF0) == 0x10)
+                return FUSED_TIMER_WAIT;
+            break;
+    }
+
+    return FUSED_NONE;
+}
+
+void Chip8::fuseInstructions() {
+    fuseRange(0, CHIP8_RAM_BYTES);
+}
+
+void Chip8::fuseRange(word address, word length) {
+    // A write can break up a sequence starting up to 5 bytes earlier
+    int start = (int) address - (CHIP8_MAX_FUSED_BYTES - 1);
+    int end = (int) address + length;
+
+    if (start < 0)
+        start = 0;
+    if (end > CHIP8_RAM_BYTES)
+        end = CHIP8_RAM_BYTES;
+
+    for (int i = start; i < end; i++) {
+        fusedOps[i] = matchFused(ram, i);
+    }
+}
+
+int Chip8::executeFused(byte fusedOp, int budget) {
+    word pc = programCounter;
+    word first = combine(ram[ramAddress(pc)], ram[ramAddress(pc + 1)]);
+    word second = combine(ram[ramAddress(pc + 2)], ram[ramAddress(pc + 3)]);
+    byte X = (first & 0x0F00) >> 8;
+    byte X2 = (second & 0x0F00) >> 8;
+    byte Y2 = (second & 0x00F0) >> 4;
+    int executed = 0;
+
+    switch (fusedOp) {
+        case FUSED_INDEX_DRAW:
+            // Leave sprites running off the end of RAM to cycle() to fault
+            if ((first & 0x0FFF) + (second & 0x000F) > CHIP8_RAM_BYTES)
+                return 0;
+            indexRegister = first & 0x0FFF;
+            programCounter += 4;
+            opDraw(X2, Y2, second & 0x000F);
+            executed = 2;
+            break;
+
+        case FUSED_SET_PAIR:
+            variableRegisters[X] = first & 0x00FF;
+            variableRegisters[X2] = second & 0x00FF;
+            programCounter += 4;
+            executed = 2;
+            break;
+
+        case FUSED_ADD_SKIP:
+            variableRegisters[X] += first & 0x00FF;
+            programCounter += 4;
+            opSkipByteEqual(X2, second & 0x00FF);
+            executed = 2;
+            break;
+
+        case FUSED_TIMER_WAIT:
+            variableRegisters[X] = delayTimer;
+
+            // The skip steps over the jump, which then never executes
+            if (variableRegisters[X] == (second & 0x00FF)) {
+                programCounter += 6;
+                executed = 2;
+            } else {
+                programCounter = combine(ram[ramAddress(pc + 4)], ram[ramAddress(pc + 5)]) & 0x0FFF;
+                executed = 3;
+            }
+            break;
+
+        case FUSED_SPIN:
+            // Nothing but the timers changes until the budget runs out
+            if (profile != nullptr)
+                profile->pcHits[pc & 0x0FFF] += budget;
+            tickTimers(budget);
+            return budget;
+
+        default:
+            return 0;
+    }
+
+    // The fused instructions run back to back from pc
+    if (profile != nullptr) {
+        for (int i = 0; i < executed; i++)
+            profile->pcHits[(pc + 2 * i) & 0x0FFF]++;
     }
+    tickTimers(executed);
+    return executed;
 }
 
 void Chip8::opRamToRegisters(byte X) {
     for (int i = 0; i <= X; i++) {
-        variableRegisters[i] = ram[indexRegister + i];
+        word address = ramAddress(indexRegister + i);
+        variableRegisters[i] = ram[address];
+        if (profile != nullptr)
+            profile->reads[address]++;
     }
 }
 
-void Chip8::cycle() {
+Chip8Fault Chip8::cycle() {
     // Fetch
-    word opcode = combine(ram[programCounter], ram[programCounter + 1]);
+    word pc = programCounter;
+    word opcode = combine(ram[ramAddress(pc)], ram[ramAddress(pc + 1)]);
     programCounter += 2;
     
     // Decode, Execute
-    execute(opcode);
+    Chip8Fault raised = execute(opcode);
+
+    if (raised != FAULT_NONE) {
+        programCounter = pc;
+        recordCrash(raised, opcode);
+        return raised;
+    }
+
+    if (tracer != nullptr) {
+        tracer->record(*this, pc, opcode);
+    }
+
+    if (profile != nullptr) {
+        profile->pcHits[ramAddress(pc)]++;
+        profile->instructions++;
+    }
     
     // Update timers
+    if (CHIP8_PROBE_ENABLED(timer) && (delayTimer > 0 || soundTimer > 0))
+        CHIP8_PROBE3(timer, pc, delayTimer, soundTimer);
+
     if (delayTimer > 0) {
         delayTimer--;
     }
@@ -366,6 +653,262 @@ void Chip8::cycle() {
     } else {
         sound = false;
     }
+
+    return FAULT_NONE;
+}
+
+void Chip8::recordCrash(byte raised, word opcode) {
+    fault = raised;
+    CHIP8_PROBE3(fault, programCounter, opcode, raised);
+
+    crash.fault = raised;
+    crash.programCounter = programCounter;
+    crash.opcode = opcode;
+    crash.indexRegister = indexRegister;
+    crash.stackPointer = stackPointer;
+    crash.delayTimer = delayTimer;
+    crash.soundTimer = soundTimer;
+
+    for (int i = 0; i < CHIP8_STACK_HEIGHT; i++) {
+        crash.stack[i] = stack[i];
+    }
+
+    for (int i = 0; i < CHIP8_VARIABLE_REGISTERS; i++) {
+        crash.variableRegisters[i] = variableRegisters[i];
+    }
+}
+
+bool Chip8::executeInline(word opcode, int &ticks) {
+    byte X = (opcode & 0x0F00) >> 8;
+    byte Y = (opcode & 0x00F0) >> 4;
+    byte N = (opcode & 0x000F);
+    word NN = opcode & 0x00FF;
+    word NNN = opcode & 0x0FFF;
+
+    switch (opcode & 0xF000) {
+        case 0x0000:
+            if (opcode == 0x00E0)
+                opClear();
+            else if (opcode == 0x00EE && stackPointer > 0)
+                opReturn();
+            else
+                return false;
+            return true;
+        case 0x1000:    opJump(NNN);                return true;
+        case 0x2000:
+            if (stackPointer >= CHIP8_STACK_HEIGHT)
+                return false;
+            opCall(NNN);
+            return true;
+        case 0x3000:    opSkipByteEqual(X, NN);     return true;
+        case 0x4000:    opSkipByteUnequal(X, NN);   return true;
+        case 0x5000:
+            if (N != 0)
+                return false;
+            opSkipRegEqual(X, Y);
+            return true;
+        case 0x6000:    opSetRegister(X, NN);       return true;
+        case 0x7000:    opAdd(X, NN);               return true;
+        case 0x8000:
+            if (N > 0x7 && N != 0xE)
+                return false;
+            executeLogicMathInstruction(opcode, X, Y);
+            return true;
+        case 0x9000:
+            if (N != 0)
+                return false;
+            opSkipRegUnequal(X, Y);
+            return true;
+        case 0xA000:    opSetIndex(NNN);            return true;
+        case 0xB000:    opJumpOffset(NNN);          return true;
+        case 0xC000:    opRandom(X, NN);            return true;
+        case 0xD000:
+            // Sprites running off the end of RAM fault in cycle()
+            if (indexRegister + N > CHIP8_RAM_BYTES)
+                return false;
+            opDraw(X, Y, N);
+            return true;
+        case 0xE000:
+            if (variableRegisters[X] > 0xF)
+                return false;
+            if (NN == 0x9E)
+                opSkipKeyDown(X);
+            else if (NN == 0xA1)
+                opSkipKeyNotDown(X);
+            else
+                return false;
+            return true;
+        case 0xF000:
+            switch (NN) {
+                case 0x07:
+                case 0x15:
+                case 0x18:
+                    // These see the timers, so settle them first
+                    tickTimers(ticks);
+                    ticks = 0;
+                    executeMiscInstruction(opcode, X);
+                    return true;
+                case 0x1E:  opAddRegToIndex(X);     return true;
+                case 0x29:  opFontChar(X);          return true;
+            }
+
+            // RAM transfers that stay inside RAM
+            if (NN == 0x33 && indexRegister + 3 <= CHIP8_RAM_BYTES)
+                opBinaryCodedDecimal(X);
+            else if (NN == 0x55 && indexRegister + X < CHIP8_RAM_BYTES)
+                opRegistersToRam(X);
+            else if (NN == 0x65 && indexRegister + X < CHIP8_RAM_BYTES)
+                opRamToRegisters(X);
+            else
+                return false;
+            return true;
+    }
+    return false;
+}
+
+int Chip8::dispatch(int budget) {
+    // Past the end of RAM nothing is fused; cycle() raises the range fault
+    byte fusedOp = (programCounter < CHIP8_RAM_BYTES) ? fusedOps[programCounter] : (byte) FUSED_NONE;
+
+    // The longest superinstruction other than a spin runs 3 instructions.
+    // Tracing needs a record per instruction, so it turns fusion off.
+    int count = 0;
+    if (fusedOp != FUSED_NONE && budget >= 3 && tracer == nullptr) {
+        count = executeFused(fusedOp, budget);
+        if (profile != nullptr)
+            profile->instructions += count;
+    }
+
+    // Not fused, or the superinstruction declined to run
+    if (count == 0) {
+        if (cycle() != FAULT_NONE)
+            return 0;
+        count = 1;
+    }
+    return count;
+}
+
+int Chip8::run(int n) {
+    int executed = 0;
+
+    // Superinstructions, and opcodes that cannot fault, run without going
+    // through cycle(). Their timer ticks are saved up and settled before
+    // anything that could see the timers. Stop when the longest sequence
+    // no longer fits in what is left.
+    // Tracing needs a record per instruction, so it turns this off.
+    if (useSuperinstructions && tracer == nullptr) {
+        int ticks = 0;
+        while (executed <= n - 3) {
+            // Near the end of RAM, cycle() below raises the range fault
+            word pc = programCounter;
+            if (pc >= CHIP8_RAM_BYTES - 1)
+                break;
+
+            byte fusedOp = fusedOps[pc];
+            if (fusedOp != FUSED_NONE) {
+                tickTimers(ticks);
+                ticks = 0;
+                int count = executeFused(fusedOp, n - executed);
+                if (count > 0) {
+                    if (profile != nullptr)
+                        profile->instructions += count;
+                    executed += count;
+                    if (observer != nullptr && !observer->stepped(*this, count))
+                        return executed;
+                    continue;
+                }
+            }
+
+            // The commonest opcodes are decoded here, the rest that cannot
+            // fault in executeInline()
+            word opcode = combine(ram[pc], ram[pc + 1]);
+            byte X = (opcode & 0x0F00) >> 8;
+            bool done = true;
+            programCounter = pc + 2;
+
+            switch (opcode & 0xF000) {
+                case 0x1000:    opJump(opcode & 0x0FFF);                break;
+                case 0x3000:    opSkipByteEqual(X, opcode & 0x00FF);    break;
+                case 0x4000:    opSkipByteUnequal(X, opcode & 0x00FF);  break;
+                case 0x6000:    opSetRegister(X, opcode & 0x00FF);      break;
+                case 0x7000:    opAdd(X, opcode & 0x00FF);              break;
+                case 0xA000:    opSetIndex(opcode & 0x0FFF);            break;
+                case 0x8000:
+                    if ((opcode & 0x000F) <= 0x7 || (opcode & 0x000F) == 0xE)
+                        executeLogicMathInstruction(opcode, X, (opcode & 0x00F0) >> 4);
+                    else
+                        done = false;
+                    break;
+                default:        done = executeInline(opcode, ticks);    break;
+            }
+
+            if (done) {
+                if (profile != nullptr) {
+                    profile->pcHits[pc]++;
+                    profile->instructions++;
+                }
+                ticks++;
+                executed++;
+                if (observer != nullptr) {
+                    tickTimers(ticks);
+                    ticks = 0;
+                    if (!observer->stepped(*this, 1))
+                        return executed;
+                }
+                continue;
+            }
+
+            // The rest go through cycle(), which ticks the timers itself
+            programCounter = pc;
+            tickTimers(ticks);
+            ticks = 0;
+            if (cycle() != FAULT_NONE)
+                return executed;
+            executed++;
+            if (observer != nullptr) {
+                if (!observer->stepped(*this, 1))
+                    return executed;
+                continue;
+            }
+
+            // A blocked FX0A waits out the budget: keys only change between runs
+            if (programCounter == pc && blockingForKey && (opcode & 0xF0FF) == 0xF00A) {
+                int waits = n - executed;
+                if (profile != nullptr) {
+                    profile->pcHits[pc] += waits;
+                    profile->instructions += waits;
+                }
+                ticks = waits;
+                executed = n;
+            }
+        }
+        tickTimers(ticks);
+    }
+
+    while (executed < n) {
+        if (cycle() != FAULT_NONE)
+            return executed;
+        executed++;
+        if (observer != nullptr && !observer->stepped(*this, 1))
+            return executed;
+    }
+
+    return executed;
+}
+
+void Chip8::tickTimers(int ticks) {
+    // No cycles, no change, not even to the sound flag
+    if (ticks <= 0)
+        return;
+
+    if (CHIP8_PROBE_ENABLED(timer) && (delayTimer > 0 || soundTimer > 0))
+        CHIP8_PROBE3(timer, programCounter, delayTimer, soundTimer);
+
+    delayTimer = (delayTimer > ticks) ? delayTimer - ticks : 0;
+
+    // The sound flag follows the last tick: set if the timer was still running
+    sound = (soundTimer >= ticks);
+    soundTimer = (soundTimer > ticks) ? soundTimer - ticks : 0;
 }
 
 void Chip8::reset() {
@@ -373,9 +916,7 @@ void Chip8::reset() {
     opClear();
     
     // Clear RAM
-    for (int i = 0; i < CHIP8_RAM_BYTES; i++) {
-        ram[i] = 0x00;
-    }
+    memset(ram, 0, sizeof(ram));
 
     // Clear registers
     for (int i = 0; i < CHIP8_VARIABLE_REGISTERS; i++) {
@@ -388,7 +929,7 @@ void Chip8::reset() {
     }
 
     // Clear key buffer
-    for (int i = 0; i < 0xF; i++) {
+    for (int i = 0; i < 16; i++) {
         keyState[i] = 0x00;
     }
 
@@ -400,7 +941,7 @@ void Chip8::reset() {
     soundTimer      = 0x00;
 
     // Load font
-    byte font[80] = { 
+    static const byte font[80] = {
         0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
         0x20, 0x60, 0x20, 0x20, 0x70, // 1
         0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
@@ -419,9 +960,7 @@ void Chip8::reset() {
         0xF0, 0x80, 0xF0, 0x80, 0x80  // F
     };
 
-    for (int i = 0; i < 80; i++) {
-        ram[0x050 + i] = font[i];
-    }
+    memcpy(ram + 0x050, font, sizeof(font));
 
     // Set PC to start
     programCounter = 0x200;
@@ -429,6 +968,20 @@ void Chip8::reset() {
     // Set switch for FX0A
     blockingForKey = false;
     lastKeyFromBlock = false;
+
+    // Clear faults
+    fault = FAULT_NONE;
+    pendingFault = FAULT_NONE;
+    addressOverflow = 0;
+    crash = CrashSnapshot();
+
+    // Clear superinstructions
+    memset(fusedOps, FUSED_NONE, sizeof(fusedOps));
+
+    // Everything changed
+    dirtyPages = (1 << CHIP8_PAGES) - 1;
+    displayDirty = true;
+    rehashMemory();
 }
 
 void Chip8::load(byte * rom)
@@ -436,6 +989,47 @@ void Chip8::load(byte * rom)
     for (int i = 0; i < CHIP8_RAM_BYTES - 512; i++) {
         ram[512 + i] = rom[i];
     }
+
+    for (int page = 512 / CHIP8_PAGE_BYTES; page < CHIP8_PAGES; page++) {
+        dirtyPages |= 1 << page;
+    }
+
+    fuseInstructions();
+    rehashMemory();
+}
+
+void Chip8::rehashMemory() {
+    memoryFingerprint = 0;
+
+    for (int i = 0; i < CHIP8_RAM_BYTES; i++) {
+        memoryFingerprint ^= fingerprintKey(i, ram[i]);
+    }
+
+    for (int y = 0; y < CHIP8_SCREEN_HEIGHT; y++) {
+        memoryFingerprint ^= fingerprintKey(CHIP8_FINGERPRINT_DISPLAY_SLOT + y, displayRows[y]);
+    }
+}
+
+uint64_t Chip8::fingerprint() const {
+    uint64_t registers[2];
+    memcpy(registers, variableRegisters, sizeof(registers));
+
+    uint64_t pointers = programCounter
+        | (uint64_t) indexRegister << 16
+        | (uint64_t) stackPointer << 32
+        | (uint64_t) delayTimer << 40
+        | (uint64_t) soundTimer << 48;
+
+    uint64_t h = memoryFingerprint
+        ^ fingerprintKey(CHIP8_FINGERPRINT_REGISTER_SLOT, registers[0])
+        ^ fingerprintKey(CHIP8_FINGERPRINT_REGISTER_SLOT + 1, registers[1])
+        ^ fingerprintKey(CHIP8_FINGERPRINT_REGISTER_SLOT + 2, pointers);
+
+    // Only live stack entries: stale ones past SP do not affect execution
+    for (int i = 0; i < stackPointer && i < CHIP8_STACK_HEIGHT; i++) {
+        h ^= fingerprintKey(CHIP8_FINGERPRINT_REGISTER_SLOT + 3 + i, stack[i]);
+    }
+    return h;
 }
 
 void Chip8::dumpState() {
@@ -0,0 +1,72 @@
+#include "assembler.hpp"
+#include "workloads.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+int main(int argc, char ** argv)
+{
+	std::string source;
+	std::string sourceName;
+	std::string output;
+	bool printSource = false;
+
+	for (int i = 1; i < argc; i++) {
+		Workload workload;
+		int param;
+		if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			output = argv[++i];
+		} else if (strcmp(argv[i], "--workload") == 0 && i + 1 < argc) {
+			if (!parseWorkload(argv[++i], workload, param)) {
+				std::cerr << "Unknown workload " << argv[i] << std::endl;
+				return 1;
+			}
+			source = workloadSource(workload, param);
+			sourceName = argv[i];
+		} else if (strcmp(argv[i], "--source") == 0) {
+			printSource = true;
+		} else {
+			std::ifstream in(argv[i]);
+			if (!in) {
+				std::cerr << "Could not read " << argv[i] << std::endl;
+				return 1;
+			}
+			std::stringstream text;
+			text << in.rdbuf();
+			source = text.str();
+			sourceName = argv[i];
+		}
+	}
+
+	if (sourceName.empty() || (output.empty() && !printSource)) {
+		std::cout << "Usage: chipasm SOURCE -o ROM\n"
+		"       chipasm --workload NAME[:PARAM] [--source] [-o ROM]\n"
+		"Assembles the syntax chipdis prints. Workloads: alu, draw, calls,\n"
+		"memory, bcd, timer; --source prints a workload's assembly." << std::endl;
+		exit(0);
+	}
+
+	if (printSource)
+		std::cout << source;
+
+	Assembly assembly = assemble(source);
+	for (size_t i = 0; i < assembly.errors.size(); i++) {
+		std::cerr << sourceName << ":" << assembly.errors[i].line << ": "
+			<< assembly.errors[i].message << std::endl;
+	}
+	if (!assembly.ok())
+		return 1;
+
+	if (!output.empty()) {
+		std::ofstream out(output, std::ios_base::out | std::ios_base::binary);
+		out.write((const char *) assembly.rom.data(), assembly.rom.size());
+		if (!out) {
+			std::cerr << "Could not write " << output << std::endl;
+			return 1;
+		}
+	}
+	return 0;
+}
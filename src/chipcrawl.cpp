@@ -0,0 +1,149 @@
+#include "crawler.hpp"
+#include "romfile.hpp"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define DEFAULT_REPORT "crawl.csv"
+
+bool byRom(const CrawlResult &a, const CrawlResult &b) {
+	return a.rom < b.rom;
+}
+
+int main(int argc, char ** argv)
+{
+	long seconds = CRAWL_SECONDS;
+	int cyclesPerFrame = CRAWL_CYCLES_PER_FRAME;
+	uint32_t seed = 1;
+	unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+	std::string csvPath = DEFAULT_REPORT;
+	std::string jsonPath;
+	bool resume = false;
+	std::vector<std::string> roms;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+			seconds = std::max(1L, atol(argv[++i]));
+		} else if (strcmp(argv[i], "--ipf") == 0 && i + 1 < argc) {
+			cyclesPerFrame = std::max(1, atoi(argv[++i]));
+		} else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			seed = strtoul(argv[++i], nullptr, 0);
+		} else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			threads = std::max(1, atoi(argv[++i]));
+		} else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+			csvPath = argv[++i];
+		} else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+			jsonPath = argv[++i];
+		} else if (strcmp(argv[i], "--resume") == 0) {
+			resume = true;
+		} else {
+			collectRoms(argv[i], roms);
+		}
+	}
+
+	if (roms.empty()) {
+		std::cout << "Usage: chipcrawl [--seconds S] [--ipf N] [--seed SEED] [-j THREADS]\n"
+		"                 [--csv FILE] [--json FILE] [--resume] ROM|DIRECTORY...\n"
+		"Runs each ROM headless with random keys and classifies it as ok,\n"
+		"illegal_opcode, stack_fault, fault, hang or blank_screen. Rows are\n"
+		"appended to the CSV as ROMs finish; --resume skips ROMs already in it." << std::endl;
+		exit(0);
+	}
+
+	// A resumed crawl keeps the rows of an interrupted one
+	std::vector<CrawlResult> results;
+	std::set<std::string> done;
+	if (resume) {
+		std::ifstream previous(csvPath);
+		std::string line;
+		CrawlResult result;
+		while (std::getline(previous, line)) {
+			if (crawlFromCsv(line, result) && done.insert(result.rom).second)
+				results.push_back(result);
+		}
+	}
+
+	std::vector<std::string> pending;
+	for (size_t i = 0; i < roms.size(); i++) {
+		if (done.count(roms[i]) == 0)
+			pending.push_back(roms[i]);
+	}
+	std::cerr << "Crawling " << pending.size() << " ROMs, " << results.size() << " already done" << std::endl;
+
+	// Journal: each row is appended and flushed as its ROM finishes
+	std::ofstream journal(csvPath, resume ? std::ios_base::app : std::ios_base::trunc);
+	if (!journal) {
+		std::cerr << "Cannot write " << csvPath << std::endl;
+		return 1;
+	}
+	if (!resume || results.empty())
+		journal << crawlCsvHeader() << std::endl;
+
+	// Workers take the next unclaimed ROM
+	std::mutex lock;
+	std::atomic<size_t> next(0);
+	int unreadable = 0;
+	std::vector<std::thread> workers;
+	for (unsigned t = 0; t < std::min<size_t>(threads, pending.size()); t++) {
+		workers.push_back(std::thread([&]() {
+			for (size_t i = next++; i < pending.size(); i = next++) {
+				// Unreadable ROMs are reported and get no row
+				std::vector<byte> rom = loadRom(pending[i]);
+				if (rom.empty()) {
+					std::lock_guard<std::mutex> guard(lock);
+					std::cerr << "Could not read " << pending[i] << std::endl;
+					unreadable++;
+					continue;
+				}
+				CrawlResult result = crawlRom(pending[i], rom,
+					seconds * CRAWL_FRAME_RATE, cyclesPerFrame, seed);
+
+				std::lock_guard<std::mutex> guard(lock);
+				journal << crawlToCsv(result) << std::endl;
+				results.push_back(result);
+			}
+		}));
+	}
+
+	for (size_t t = 0; t < workers.size(); t++) {
+		workers[t].join();
+	}
+	journal.close();
+
+	// Rewrite the finished report sorted by ROM, replacing the journal whole
+	std::sort(results.begin(), results.end(), byRom);
+	std::string sortedPath = csvPath + ".tmp";
+	std::ofstream sorted(sortedPath);
+	sorted << crawlCsvHeader() << "\n";
+	for (size_t i = 0; i < results.size(); i++)
+		sorted << crawlToCsv(results[i]) << "\n";
+	sorted.close();
+	if (!sorted || rename(sortedPath.c_str(), csvPath.c_str()) != 0)
+		std::cerr << "Cannot replace " << csvPath << "; the unsorted journal is kept" << std::endl;
+
+	if (!jsonPath.empty()) {
+		std::ofstream json(jsonPath);
+		json << "[";
+		for (size_t i = 0; i < results.size(); i++)
+			json << (i ? ",\n" : "") << crawlToJson(results[i]);
+		json << "]" << std::endl;
+	}
+
+	std::map<std::string, int> counts;
+	for (size_t i = 0; i < results.size(); i++)
+		counts[verdictName(results[i].verdict)]++;
+	for (std::map<std::string, int>::iterator it = counts.begin(); it != counts.end(); ++it)
+		std::cout << it->first << "\t" << it->second << std::endl;
+
+	return unreadable > 0 ? 1 : 0;
+}
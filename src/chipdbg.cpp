@@ -0,0 +1,94 @@
+#include "debugger.hpp"
+#include "romfile.hpp"
+#include <iostream>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <poll.h>
+#include <unistd.h>
+
+#define STDIN_POLL_MILLISECONDS 50
+
+int main(int argc, char ** argv)
+{
+	std::string romFile;
+	std::string socketPath;
+	uint32_t seed = 1;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+			socketPath = argv[++i];
+		} else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			seed = strtoul(argv[++i], nullptr, 0);
+		} else {
+			romFile = argv[i];
+		}
+	}
+
+	if (romFile.empty()) {
+		std::cout << "Usage: chipdbg ROM [--socket PATH] [--seed SEED]\n"
+		"Debugs a ROM headless from the console, and from a Unix socket if given.\n"
+		"Type help for commands." << std::endl;
+		exit(0);
+	}
+
+	Chip8 sys;
+	std::vector<byte> rom = loadRom(romFile);
+	if (rom.empty()) {
+		std::cerr << "Could not read " << romFile << std::endl;
+		return 1;
+	}
+	sys.load(rom.data());
+	sys.seedRandom(seed);
+	Debugger debugger(sys);
+
+	DebugSocket * server = nullptr;
+	if (!socketPath.empty()) {
+		server = new DebugSocket(socketPath);
+		if (!server->ok()) {
+			std::cerr << "Could not listen on " << socketPath << std::endl;
+			return 1;
+		}
+	}
+
+	std::cout << debugger.describeStop() << DEBUGGER_PROMPT << std::flush;
+	bool console = true;
+	std::string pending;
+	while (!debugger.quit && (console || server != nullptr)) {
+		// Console lines and socket commands run on this thread in turn.
+		// stdin is read into our own buffer, as the socket is, so lines
+		// that arrive together all run without waiting for the next poll.
+		pollfd input = {STDIN_FILENO, POLLIN, 0};
+		if (console && poll(&input, 1, server != nullptr ? STDIN_POLL_MILLISECONDS : -1) > 0) {
+			char buffer[1024];
+			ssize_t n = read(STDIN_FILENO, buffer, sizeof(buffer));
+			if (n > 0) {
+				pending.append(buffer, n);
+			} else if (n == 0 || errno != EINTR) {
+				// The last line may have no newline
+				console = false;
+				if (!pending.empty())
+					pending += '\n';
+			}
+
+			size_t newline;
+			while (!debugger.quit && (newline = pending.find('\n')) != std::string::npos) {
+				std::string line = pending.substr(0, newline);
+				pending.erase(0, newline + 1);
+				std::cout << debugger.command(line);
+				if (!debugger.quit)
+					std::cout << DEBUGGER_PROMPT << std::flush;
+			}
+			if (!console)
+				continue;
+		}
+
+		if (server != nullptr)
+			server->poll(debugger, console ? 0 : STDIN_POLL_MILLISECONDS);
+	}
+
+	delete server;
+	return 0;
+}
@@ -0,0 +1,81 @@
+#include "disassembler.hpp"
+#include "romfile.hpp"
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Empty if the ROM cannot be read
+std::string analyzeFile(const std::string &filename, bool json) {
+	long length;
+	std::vector<byte> rom = loadRom(filename, &length);
+	if (rom.empty())
+		return "";
+
+	RomAnalysis analysis = analyzeRom(filename, rom.data(), length);
+	return json ? analysisToJson(analysis) : analysisToText(analysis);
+}
+
+int main(int argc, char ** argv)
+{
+	bool json = false;
+	unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<std::string> roms;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--json") == 0) {
+			json = true;
+		} else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			threads = std::max(1, atoi(argv[++i]));
+		} else {
+			collectRoms(argv[i], roms);
+		}
+	}
+
+	if (roms.empty()) {
+		std::cout << "Usage: chipdis [--json] [-j THREADS] ROM|DIRECTORY..." << std::endl;
+		exit(0);
+	}
+
+	// Workers take the next unclaimed ROM; output keeps the input order
+	std::vector<std::string> results(roms.size());
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> workers;
+
+	for (unsigned t = 0; t < std::min<size_t>(threads, roms.size()); t++) {
+		workers.push_back(std::thread([&]() {
+			for (size_t i = next++; i < roms.size(); i = next++) {
+				results[i] = analyzeFile(roms[i], json);
+			}
+		}));
+	}
+
+	for (size_t t = 0; t < workers.size(); t++) {
+		workers[t].join();
+	}
+
+	// Unreadable ROMs are reported and left out
+	int unreadable = 0;
+	bool first = true;
+	if (json)
+		std::cout << "[";
+	for (size_t i = 0; i < results.size(); i++) {
+		if (results[i].empty()) {
+			std::cerr << "Could not read " << roms[i] << std::endl;
+			unreadable++;
+		} else if (json) {
+			std::cout << (first ? "" : ",\n") << results[i];
+			first = false;
+		} else {
+			std::cout << results[i] << std::endl;
+		}
+	}
+	if (json)
+		std::cout << "]" << std::endl;
+
+	return unreadable > 0 ? 1 : 0;
+}
@@ -0,0 +1,248 @@
+#include "fuzz.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Built with -fsanitize=fuzzer (libFuzzer, or AFL++'s afl-clang-fast), the
+// fuzzer supplies main() and calls this for every input
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t * data, size_t size)
+{
+	static FuzzHarness harness;
+	harness.run(data, size);
+
+	std::string broken = harness.checkInvariants();
+	if (!broken.empty()) {
+		std::cerr << "chipfuzz: " << broken << std::endl;
+		abort();
+	}
+	return 0;
+}
+
+#ifndef CHIP8_LIBFUZZER
+
+#include <chrono>
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Inputs larger than this are trimmed by the standalone mutator
+#define STANDALONE_MAX_INPUT 1024
+
+static uint32_t randomState = 1;
+
+static uint32_t nextRandom()
+{
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 17;
+	randomState ^= randomState << 5;
+	return randomState;
+}
+
+static bool readFile(const std::string &path, std::vector<uint8_t> &data)
+{
+	std::ifstream in(path, std::ios_base::in | std::ios_base::binary);
+	if (!in)
+		return false;
+	std::stringstream bytes;
+	bytes << in.rdbuf();
+	std::string text = bytes.str();
+	data.assign(text.begin(), text.end());
+	return true;
+}
+
+static void writeFile(const std::string &path, const std::vector<uint8_t> &data)
+{
+	std::ofstream out(path, std::ios_base::out | std::ios_base::binary);
+	out.write((const char *) data.data(), data.size());
+}
+
+static std::string inputName(const std::vector<uint8_t> &data)
+{
+	uint64_t h = 0xCBF29CE484222325ULL;
+	for (size_t i = 0; i < data.size(); i++)
+		h = (h ^ data[i]) * 0x100000001B3ULL;
+	std::ostringstream name;
+	name << std::hex << h;
+	return name.str();
+}
+
+// One of a few byte-level mutations, or a splice with another input
+static void mutate(std::vector<uint8_t> &data, const std::vector<std::vector<uint8_t>> &corpus)
+{
+	int rounds = 1 + nextRandom() % 4;
+	for (int r = 0; r < rounds; r++) {
+		size_t at = data.empty() ? 0 : nextRandom() % data.size();
+		switch (nextRandom() % 6) {
+			case 0:
+				if (!data.empty())
+					data[at] ^= 1 << (nextRandom() % 8);
+				break;
+			case 1:
+				if (!data.empty())
+					data[at] = nextRandom();
+				break;
+			case 2:
+				// Whole opcodes are more use than stray bytes
+				data.insert(data.begin() + (at & ~(size_t) 1), 2, 0);
+				data[at & ~(size_t) 1] = nextRandom();
+				data[(at & ~(size_t) 1) + 1] = nextRandom();
+				break;
+			case 3:
+				if (data.size() > 2)
+					data.erase(data.begin() + at, data.begin() + std::min(data.size(), at + 2));
+				break;
+			case 4:
+				if (!data.empty())
+					data[at] = data[nextRandom() % data.size()];
+				break;
+			case 5: {
+				const std::vector<uint8_t> &other = corpus[nextRandom() % corpus.size()];
+				if (other.empty())
+					break;
+				size_t from = nextRandom() % other.size();
+				size_t length = std::min(other.size() - from, (size_t) (1 + nextRandom() % 32));
+				data.insert(data.begin() + at, other.begin() + from, other.begin() + from + length);
+				break;
+			}
+		}
+	}
+	if (data.size() > STANDALONE_MAX_INPUT)
+		data.resize(STANDALONE_MAX_INPUT);
+}
+
+// Coverage for the standalone driver: which opcode forms cycle() ran, and
+// which faults were raised. Coarser than compiler edge coverage, and blind
+// to fused instructions, but it needs no instrumentation.
+static int newFeatures(const FuzzHarness &harness, Profile &profile, std::vector<bool> &seen)
+{
+	int found = 0;
+	for (int pc = 0; pc < CHIP8_RAM_BYTES; pc++) {
+		if (profile.pcHits[pc] == 0)
+			continue;
+		word opcode = combine(harness.sys.ram[pc], harness.sys.ram[(pc + 1) & (CHIP8_RAM_BYTES - 1)]);
+		word form;
+		switch (opcode & 0xF000) {
+			case 0x0000: case 0xE000: case 0xF000:  form = opcode & 0xF0FF; break;
+			case 0x5000: case 0x8000: case 0x9000:  form = opcode & 0xF00F; break;
+			default:                                form = opcode & 0xF000; break;
+		}
+		if (!seen[form]) {
+			seen[form] = true;
+			found++;
+		}
+	}
+	if (!seen[0x10000 + harness.sys.fault]) {
+		seen[0x10000 + harness.sys.fault] = true;
+		found++;
+	}
+	memset(profile.pcHits, 0, sizeof(profile.pcHits));
+	return found;
+}
+
+int main(int argc, char ** argv)
+{
+	long runs = -1;
+	std::string corpusDir;
+	std::vector<std::string> files;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+			runs = atol(argv[++i]);
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			randomState = strtoul(argv[++i], nullptr, 0) | 1;
+		else if (strcmp(argv[i], "--corpus") == 0 && i + 1 < argc)
+			corpusDir = argv[++i];
+		else if (strcmp(argv[i], "--help") == 0) {
+			std::cout << "Usage: chipfuzz FILE...\n"
+			"       chipfuzz --runs N [--seed S] [--corpus DIR] [FILE...]\n"
+			"Replays inputs, or mutates them for N runs keeping those that\n"
+			"reach new opcodes. New inputs and crashes go to DIR." << std::endl;
+			return 0;
+		} else
+			files.push_back(argv[i]);
+	}
+
+	std::vector<std::vector<uint8_t>> corpus;
+	if (!corpusDir.empty()) {
+		DIR * dir = opendir(corpusDir.c_str());
+		if (dir != nullptr) {
+			while (dirent * entry = readdir(dir)) {
+				if (entry->d_name[0] != '.')
+					files.push_back(corpusDir + "/" + entry->d_name);
+			}
+			closedir(dir);
+		}
+	}
+	for (size_t i = 0; i < files.size(); i++) {
+		std::vector<uint8_t> data;
+		if (!readFile(files[i], data)) {
+			std::cerr << "Could not read " << files[i] << std::endl;
+			return 1;
+		}
+		corpus.push_back(data);
+	}
+
+	// Replay only
+	if (runs < 0) {
+		FuzzHarness harness;
+		int failed = 0;
+		for (size_t i = 0; i < corpus.size(); i++) {
+			long executed = harness.run(corpus[i].data(), corpus[i].size());
+			std::string broken = harness.checkInvariants();
+			std::cout << files[i] << ": " << executed << " instructions, fault "
+				<< faultName(harness.sys.fault) << (broken.empty() ? "" : ", " + broken) << std::endl;
+			failed += !broken.empty();
+		}
+		return failed != 0;
+	}
+
+	if (corpus.empty())
+		corpus.push_back(std::vector<uint8_t>());
+
+	Profile * profile = new Profile();
+	FuzzHarness harness;
+	harness.setProfile(profile);
+	std::vector<bool> seen(0x10000 + 256);
+	int features = 0;
+	for (size_t i = 0; i < corpus.size(); i++) {
+		harness.run(corpus[i].data(), corpus[i].size());
+		features += newFeatures(harness, *profile, seen);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	for (long run = 1; run <= runs; run++) {
+		std::vector<uint8_t> input = corpus[nextRandom() % corpus.size()];
+		mutate(input, corpus);
+		harness.run(input.data(), input.size());
+
+		std::string broken = harness.checkInvariants();
+		if (!broken.empty()) {
+			std::string path = (corpusDir.empty() ? "." : corpusDir) + "/crash-" + inputName(input);
+			writeFile(path, input);
+			std::cout << "chipfuzz: " << broken << ", input written to " << path << std::endl;
+			return 1;
+		}
+
+		int found = newFeatures(harness, *profile, seen);
+		if (found > 0) {
+			features += found;
+			corpus.push_back(input);
+			if (!corpusDir.empty())
+				writeFile(corpusDir + "/" + inputName(input), input);
+		}
+
+		if ((run & (run - 1)) == 0 || run == runs) {
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			std::cout << "#" << run << "\tfeatures " << features << "\tcorpus " << corpus.size()
+				<< "\texec/s " << (long) (run / (seconds > 0 ? seconds : 1e-9)) << std::endl;
+		}
+	}
+	delete profile;
+	return 0;
+}
+
+#endif // CHIP8_LIBFUZZER
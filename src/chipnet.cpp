@@ -0,0 +1,117 @@
+#include "netplay.hpp"
+#include "romfile.hpp"
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+
+#define FRAME_MICROSECONDS 16667
+#define DEFAULT_FRAMES 600
+// Frames to keep sending after the last one, so the peer can finish too
+#define LINGER_FRAMES 120
+
+void usage() {
+	std::cout << "Usage: chipnet host PORT ROM [options]\n"
+	"       chipnet join HOST PORT ROM [options]\n"
+	"Plays a ROM against a peer with rollback netplay, pressing random keys,\n"
+	"and prints the final frame's fingerprint to compare with the peer's.\n"
+	"  --frames N      frames to play (default 600)\n"
+	"  --delay MS      delay every packet sent\n"
+	"  --loss PCT      drop this percentage of packets sent\n"
+	"  --bot SEED      seed for the random keys" << std::endl;
+	exit(0);
+}
+
+int main(int argc, char ** argv)
+{
+	std::vector<std::string> positional;
+	uint32_t frames = DEFAULT_FRAMES;
+	int delay = 0;
+	int loss = 0;
+	uint32_t botSeed = std::random_device()();
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			frames = strtoul(argv[++i], nullptr, 0);
+		} else if (strcmp(argv[i], "--delay") == 0 && i + 1 < argc) {
+			delay = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--loss") == 0 && i + 1 < argc) {
+			loss = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--bot") == 0 && i + 1 < argc) {
+			botSeed = strtoul(argv[++i], nullptr, 0);
+		} else {
+			positional.push_back(argv[i]);
+		}
+	}
+
+	bool host;
+	if (positional.size() == 3 && positional[0] == "host") {
+		host = true;
+	} else if (positional.size() == 4 && positional[0] == "join") {
+		host = false;
+	} else {
+		usage();
+	}
+
+	NetplayLink link(host ? atoi(positional[1].c_str()) : 0);
+	if (!link.ok()) {
+		std::cerr << "Could not open a UDP socket" << std::endl;
+		return 1;
+	}
+	if (!host && !link.connect(positional[1], atoi(positional[2].c_str()))) {
+		std::cerr << "Could not resolve " << positional[1] << std::endl;
+		return 1;
+	}
+	link.delayMilliseconds = delay;
+	link.lossPercent = loss;
+
+	std::vector<byte> rom = loadRom(positional.back());
+	if (rom.empty()) {
+		std::cerr << "Could not read " << positional.back() << std::endl;
+		return 1;
+	}
+	Netplay netplay(link, rom, host);
+	std::mt19937 bot(botSeed);
+	uint16_t keys = 0;
+	uint32_t linger = 0;
+	uint32_t stalls = 0;
+
+	auto next = std::chrono::steady_clock::now();
+	while (linger < LINGER_FRAMES) {
+		if (netplay.poll()) {
+			RollbackSession &session = *netplay.session;
+			if (session.frame < frames) {
+				// A new key combination about every 8 frames
+				if (bot() % 8 == 0)
+					keys = 1 << (bot() % 16);
+				if (!netplay.frame(keys))
+					stalls++;
+			} else {
+				netplay.sendInputs();
+				if (session.remoteFrames >= frames)
+					linger++;
+			}
+
+			if (session.desynced) {
+				std::cerr << "Desynced at frame " << session.frame << std::endl;
+				return 1;
+			}
+		}
+
+		next += std::chrono::microseconds(FRAME_MICROSECONDS);
+		std::this_thread::sleep_until(next);
+	}
+
+	RollbackSession &session = *netplay.session;
+	session.settle();
+	std::cout << "frame " << session.frame
+		<< "\tfingerprint " << std::hex << session.sys.fingerprint() << std::dec
+		<< "\trollbacks " << session.rollbacks
+		<< "\tresimulated " << session.resimulatedFrames
+		<< "\tstalls " << stalls << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,137 @@
+#include "envserver.hpp"
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define DEFAULT_SHM_NAME "/chip8env"
+#define DEFAULT_FRAMES_PER_STEP 4
+
+EnvServer * server = nullptr;
+
+void stopServer(int) {
+	if (server != nullptr)
+		server->stop();
+}
+
+// Parses kind:address:weight, kind being "byte" or "bcd"
+bool parseReward(const char * text, chip8_reward_term &term) {
+	char kind[8];
+	unsigned address;
+	int weight;
+	if (sscanf(text, "%7[a-z]:%x:%d", kind, &address, &weight) != 3)
+		return false;
+
+	if (strcmp(kind, "byte") == 0)
+		term.kind = CHIP8_REWARD_BYTE;
+	else if (strcmp(kind, "bcd") == 0)
+		term.kind = CHIP8_REWARD_BCD;
+	else
+		return false;
+
+	term.address = address;
+	term.weight = weight;
+	return true;
+}
+
+int serve(int argc, char ** argv) {
+	std::string name = DEFAULT_SHM_NAME;
+	int workers = std::max(1u, std::thread::hardware_concurrency());
+	int frames = DEFAULT_FRAMES_PER_STEP;
+	std::vector<chip8_reward_term> terms;
+
+	for (int i = 4; i < argc; i++) {
+		chip8_reward_term term;
+		if (strcmp(argv[i], "--name") == 0 && i + 1 < argc) {
+			name = argv[++i];
+		} else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+			workers = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			frames = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--reward") == 0 && i + 1 < argc && parseReward(argv[i + 1], term)) {
+			terms.push_back(term);
+			i++;
+		} else {
+			std::cerr << "Unknown option: " << argv[i] << std::endl;
+			return 2;
+		}
+	}
+
+	std::ifstream in(argv[2], std::ios_base::in | std::ios_base::binary);
+	std::vector<uint8_t> rom((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	int envs = atoi(argv[3]);
+	if (envs <= 0) {
+		std::cerr << "COUNT must be a positive number of environments" << std::endl;
+		return 2;
+	}
+
+	server = new EnvServer(name, rom, envs, workers, frames);
+	if (!server->ok()) {
+		std::cerr << "Could not create " << name << ": " << server->error() << std::endl;
+		return 1;
+	}
+	server->setReward(terms);
+
+	signal(SIGINT, stopServer);
+	signal(SIGTERM, stopServer);
+	std::cout << "Serving " << envs << " environments on " << name << std::endl;
+	server->serve();
+
+	delete server;
+	return 0;
+}
+
+// Steps COUNT environments starting at FIRST with random actions
+int bench(const char * name, int first, int count, long steps) {
+	EnvClient client(name);
+	if (!client.ok()) {
+		std::cerr << "No compatible server on " << name << std::endl;
+		return 1;
+	}
+	if (first < 0 || count < 1 || first + count > client.envCount()) {
+		std::cerr << "Server has " << client.envCount() << " environments" << std::endl;
+		return 2;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	for (long s = 0; s < steps; s++) {
+		for (int e = first; e < first + count; e++) {
+			client.submit(e, 1 << (rand() % 16));
+		}
+		client.flush();
+		for (int e = first; e < first + count; e++) {
+			client.wait(e);
+		}
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	std::cout << (steps * count / elapsed.count()) << " steps/s" << std::endl;
+	return 0;
+}
+
+void usage() {
+	std::cout << "Usage:\n"
+	"  chipserve serve ROM COUNT [--name NAME] [--workers N] [--frames N]\n"
+	"                  [--reward byte|bcd:ADDRESS:WEIGHT]...\n"
+	"  chipserve bench NAME FIRST COUNT STEPS\n"
+	<< std::endl;
+}
+
+int main(int argc, char ** argv)
+{
+	if (argc >= 4 && strcmp(argv[1], "serve") == 0)
+		return serve(argc, argv);
+	if (argc == 6 && strcmp(argv[1], "bench") == 0)
+		return bench(argv[2], atoi(argv[3]), atoi(argv[4]), atol(argv[5]));
+
+	usage();
+	return 0;
+}
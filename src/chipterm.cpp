@@ -0,0 +1,107 @@
+#include "terminal.hpp"
+#include "romfile.hpp"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <termios.h>
+#include <unistd.h>
+
+#define FRAME_MICROSECONDS 16667
+#define DEFAULT_CYCLES_PER_FRAME 12
+// Terminals only report presses, so a key is held this many frames
+#define KEY_HOLD_FRAMES 6
+#define ESCAPE_KEY 0x1B
+
+volatile sig_atomic_t quit = 0;
+
+void requestQuit(int) {
+	quit = 1;
+}
+
+// Same layout as the SDL frontend: 1234/QWER/ASDF/ZXCV
+int keypadKey(char c) {
+	const char * layout = "x123qweasdzc4rfv";
+	const char * found = strchr(layout, c | 0x20);
+	return (found != nullptr && c != 0) ? found - layout : -1;
+}
+
+int main(int argc, char ** argv)
+{
+	if (argc < 2) {
+		std::cout << "Usage: chipterm ROM [CYCLES_PER_FRAME]\n"
+		"Keys 1234/QWER/ASDF/ZXCV, [Escape] or Ctrl-C to quit." << std::endl;
+		exit(0);
+	}
+
+	std::vector<byte> rom = loadRom(argv[1]);
+	if (rom.empty()) {
+		std::cerr << "Could not read " << argv[1] << std::endl;
+		return 1;
+	}
+	int cyclesPerFrame = argc > 2 ? std::max(1, atoi(argv[2])) : DEFAULT_CYCLES_PER_FRAME;
+
+	Chip8 * sys = new Chip8();
+	sys->load(rom.data());
+
+	// Raw, non-blocking input; Ctrl-C still raises SIGINT
+	struct termios original, raw;
+	bool interactive = tcgetattr(STDIN_FILENO, &original) == 0;
+	if (interactive) {
+		raw = original;
+		raw.c_lflag &= ~(ICANON | ECHO);
+		raw.c_cc[VMIN] = 0;
+		raw.c_cc[VTIME] = 0;
+		tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+	}
+	signal(SIGINT, requestQuit);
+	signal(SIGTERM, requestQuit);
+
+	TerminalRenderer * renderer = new TerminalRenderer(STDOUT_FILENO);
+	int heldFrames[16] = {};
+	auto next = std::chrono::steady_clock::now();
+
+	while (!quit) {
+		char input[64];
+		ssize_t count = interactive ? read(STDIN_FILENO, input, sizeof(input)) : 0;
+		for (ssize_t i = 0; i < count; i++) {
+			if (input[i] == ESCAPE_KEY) {
+				quit = 1;
+			}
+			int key = keypadKey(input[i]);
+			if (key >= 0) {
+				sys->pressKey(key);
+				heldFrames[key] = KEY_HOLD_FRAMES;
+			}
+		}
+
+		for (int key = 0; key < 16; key++) {
+			if (heldFrames[key] > 0 && --heldFrames[key] == 0)
+				sys->releaseKey(key);
+		}
+
+		if (sys->run(cyclesPerFrame) < cyclesPerFrame) {
+			quit = 1;
+		}
+		renderer->render(sys->displayRows);
+
+		next += std::chrono::microseconds(FRAME_MICROSECONDS);
+		std::this_thread::sleep_until(next);
+	}
+
+	delete renderer;
+	if (interactive) {
+		tcsetattr(STDIN_FILENO, TCSANOW, &original);
+	}
+
+	if (sys->fault != FAULT_NONE) {
+		std::cerr << "Fault: " << sys->crash.toJson() << std::endl;
+	}
+	delete sys;
+	return 0;
+}
@@ -0,0 +1,175 @@
+#include "tracer.hpp"
+#include "romfile.hpp"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define DIFF_CONTEXT_RECORDS 4
+
+// Text form: PC OPCODE I REG VALUE VF in hex, REG FF when none was written
+std::string formatRecord(const TraceRecord &r) {
+	std::ostringstream out;
+	out << std::hex << std::uppercase << std::setfill('0')
+		<< std::setw(4) << r.pc << " " << std::setw(4) << r.opcode << " "
+		<< std::setw(4) << r.index << " " << std::setw(2) << (int) r.reg << " "
+		<< std::setw(2) << (int) r.value << " " << std::setw(2) << (int) r.vf;
+	return out.str();
+}
+
+bool parseRecord(const std::string &line, TraceRecord &r) {
+	unsigned pc, opcode, index, reg, value, vf;
+	std::istringstream in(line);
+	in >> std::hex >> pc >> opcode >> index >> reg >> value >> vf;
+	if (in.fail())
+		return false;
+
+	r.pc = pc;
+	r.opcode = opcode;
+	r.index = index;
+	r.reg = reg;
+	r.value = value;
+	r.vf = vf;
+	return true;
+}
+
+int record(const char * romFile, const char * traceFile, long instructions) {
+	std::vector<byte> rom = loadRom(romFile);
+	if (rom.empty()) {
+		std::cerr << "Could not read " << romFile << std::endl;
+		return 1;
+	}
+
+	Chip8 * sys = new Chip8();
+	Tracer * tracer = new Tracer(traceFile);
+	if (!tracer->ok()) {
+		std::cerr << "Could not write " << traceFile << std::endl;
+		delete tracer;
+		return 1;
+	}
+	sys->load(rom.data());
+	sys->tracer = tracer;
+
+	// Fixed seed so repeated recordings of a ROM can be diffed
+	sys->seedRandom(1);
+
+	for (long i = 0; i < instructions; i++) {
+		if (sys->cycle() != FAULT_NONE) {
+			std::cerr << "Fault: " << sys->crash.toJson() << std::endl;
+			break;
+		}
+	}
+
+	// Only a drained writer knows whether every record reached the file
+	tracer->close();
+	bool written = tracer->ok();
+	delete tracer;
+	delete sys;
+
+	if (!written) {
+		std::cerr << "Could not write " << traceFile << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+int dump(const char * traceFile) {
+	TraceReader reader(traceFile);
+	if (!reader.ok()) {
+		std::cerr << "Not a trace file: " << traceFile << std::endl;
+		return 2;
+	}
+
+	TraceRecord r;
+	while (reader.next(r)) {
+		std::cout << formatRecord(r) << "\n";
+	}
+	return 0;
+}
+
+int convert(const char * textFile, const char * traceFile) {
+	std::ifstream in(textFile);
+	TraceWriter writer(traceFile);
+	std::string line;
+	int lineNumber = 0;
+
+	while (std::getline(in, line)) {
+		lineNumber++;
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		TraceRecord r;
+		if (!parseRecord(line, r)) {
+			std::cerr << textFile << ":" << lineNumber << ": bad record" << std::endl;
+			return 2;
+		}
+		writer.write(r);
+	}
+	return 0;
+}
+
+int diff(const char * fileA, const char * fileB) {
+	TraceReader a(fileA);
+	TraceReader b(fileB);
+	if (!a.ok() || !b.ok()) {
+		std::cerr << "Not a trace file: " << (a.ok() ? fileB : fileA) << std::endl;
+		return 2;
+	}
+
+	std::vector<TraceRecord> context;
+	TraceRecord ra, rb;
+	long index = 0;
+
+	for (;; index++) {
+		bool moreA = a.next(ra);
+		bool moreB = b.next(rb);
+
+		if (!moreA && !moreB) {
+			std::cout << "Traces match (" << index << " records)" << std::endl;
+			return 0;
+		}
+
+		if (moreA && moreB && ra == rb) {
+			context.push_back(ra);
+			if (context.size() > DIFF_CONTEXT_RECORDS)
+				context.erase(context.begin());
+			continue;
+		}
+
+		std::cout << "First divergence at record " << std::dec << index << std::endl;
+		for (size_t i = 0; i < context.size(); i++) {
+			std::cout << "  " << formatRecord(context[i]) << std::endl;
+		}
+		std::cout << "< " << (moreA ? formatRecord(ra) : "(end of trace)") << std::endl;
+		std::cout << "> " << (moreB ? formatRecord(rb) : "(end of trace)") << std::endl;
+		return 1;
+	}
+}
+
+void usage() {
+	std::cout << "Usage:\n"
+	"  chiptrace record ROM TRACE INSTRUCTIONS\n"
+	"  chiptrace dump TRACE\n"
+	"  chiptrace convert TEXT TRACE\n"
+	"  chiptrace diff TRACE TRACE\n"
+	<< std::endl;
+}
+
+int main(int argc, char ** argv)
+{
+	if (argc == 5 && strcmp(argv[1], "record") == 0)
+		return record(argv[2], argv[3], atol(argv[4]));
+	if (argc == 3 && strcmp(argv[1], "dump") == 0)
+		return dump(argv[2]);
+	if (argc == 4 && strcmp(argv[1], "convert") == 0)
+		return convert(argv[2], argv[3]);
+	if (argc == 4 && strcmp(argv[1], "diff") == 0)
+		return diff(argv[2], argv[3]);
+
+	usage();
+	return 0;
+}
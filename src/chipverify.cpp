@@ -0,0 +1,113 @@
+#include "verifier.hpp"
+#include "romfile.hpp"
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define DEFAULT_INSTRUCTIONS 1000000
+#define DEFAULT_SEEDS 8
+
+// One ROM run with one seed
+struct Job {
+	size_t rom;
+	uint32_t seed;
+	long executed;
+	bool passed;
+	byte fault;     // Raised by both machines, ending the run early
+	std::string report;
+};
+
+int main(int argc, char ** argv)
+{
+	long instructions = DEFAULT_INSTRUCTIONS;
+	int seeds = DEFAULT_SEEDS;
+	uint32_t firstSeed = 1;
+	unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+	VerifyBackend backend = runBackend;
+	std::vector<std::string> roms;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			instructions = atol(argv[++i]);
+		} else if (strcmp(argv[i], "--seeds") == 0 && i + 1 < argc) {
+			seeds = std::max(1, atoi(argv[++i]));
+		} else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			firstSeed = strtoul(argv[++i], nullptr, 0);
+			seeds = 1;
+		} else if (strcmp(argv[i], "--dispatch") == 0) {
+			backend = fusedBackend;
+		} else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			threads = std::max(1, atoi(argv[++i]));
+		} else {
+			collectRoms(argv[i], roms);
+		}
+	}
+
+	if (roms.empty()) {
+		std::cout << "Usage: chipverify [-n INSTRUCTIONS] [--seeds N | --seed SEED] [--dispatch] [-j THREADS] ROM|DIRECTORY...\n"
+		"Runs each ROM with random input on the fast path, run() or with --dispatch\n"
+		"dispatch(), and on cycle() in lockstep, stopping each run at the first\n"
+		"state that differs." << std::endl;
+		exit(0);
+	}
+
+	std::vector<std::vector<byte>> images;
+	std::vector<Job> jobs;
+	for (size_t r = 0; r < roms.size(); r++) {
+		images.push_back(loadRom(roms[r]));
+		if (images.back().empty()) {
+			std::cerr << "Could not read " << roms[r] << std::endl;
+			return 1;
+		}
+		for (int s = 0; s < seeds; s++)
+			jobs.push_back(Job{r, firstSeed + s, 0, false, FAULT_NONE, ""});
+	}
+
+	// Workers take the next unclaimed job; output keeps the job order
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> workers;
+	for (unsigned t = 0; t < std::min<size_t>(threads, jobs.size()); t++) {
+		workers.push_back(std::thread([&]() {
+			Lockstep * lockstep = nullptr;
+			size_t loaded = roms.size();
+			for (size_t i = next++; i < jobs.size(); i = next++) {
+				if (jobs[i].rom != loaded) {
+					delete lockstep;
+					lockstep = new Lockstep(images[jobs[i].rom], backend);
+					loaded = jobs[i].rom;
+				}
+				jobs[i].passed = lockstep->run(instructions, jobs[i].seed);
+				jobs[i].executed = lockstep->executed;
+				jobs[i].fault = lockstep->reference.fault;
+				if (!jobs[i].passed)
+					jobs[i].report = lockstep->report();
+			}
+			delete lockstep;
+		}));
+	}
+
+	for (size_t t = 0; t < workers.size(); t++) {
+		workers[t].join();
+	}
+
+	int failures = 0;
+	for (size_t i = 0; i < jobs.size(); i++) {
+		std::cout << roms[jobs[i].rom] << "\tseed " << jobs[i].seed << "\t"
+			<< jobs[i].executed << "\t" << (jobs[i].passed ? "ok" : "MISMATCH");
+		if (jobs[i].passed && jobs[i].fault != FAULT_NONE)
+			std::cout << "\tfault " << faultName(jobs[i].fault);
+		std::cout << std::endl;
+		if (!jobs[i].passed) {
+			std::cout << jobs[i].report << std::endl;
+			failures++;
+		}
+	}
+	std::cout << jobs.size() - failures << "/" << jobs.size() << " runs matched" << std::endl;
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,347 @@
+#include "recorder.hpp"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define DEFAULT_SCALE 4
+#define MAX_SCALE 32
+#define PNG_MAX_DELAY 0xFFFF
+#define DEFLATE_STORED_BLOCK 0xFFFF
+#define AVI_MAX_BYTES 0xFFFFFFFFUL
+
+// Same colours as the SDL frontend
+const byte offColour[3] = { 0x00, 0x00, 0x00 };
+const byte onColour[3] = { 0x00, 0xFF, 0x55 };
+
+bool pixelOn(const VideoFrame &frame, int x, int y) {
+	return (frame.rows[y] >> (CHIP8_SCREEN_WIDTH - 1 - x)) & 1;
+}
+
+void putLittle(std::string &out, unsigned value, int bytes) {
+	for (int i = 0; i < bytes; i++)
+		out += (char) ((value >> (8 * i)) & 0xFF);
+}
+
+void putBig(std::string &out, unsigned value, int bytes) {
+	for (int i = bytes - 1; i >= 0; i--)
+		out += (char) ((value >> (8 * i)) & 0xFF);
+}
+
+// First pass: frame count and length, needed up front by both formats
+bool measure(const char * videoFile, long &frames, long &ticks) {
+	VideoReader reader(videoFile);
+	if (!reader.ok()) {
+		std::cerr << "Not a video file: " << videoFile << std::endl;
+		return false;
+	}
+
+	VideoFrame frame;
+	frames = 0;
+	ticks = 0;
+	while (reader.next(frame)) {
+		frames++;
+		ticks += frame.repeats;
+	}
+
+	if (frames == 0) {
+		std::cerr << "No frames in " << videoFile << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int info(const char * videoFile) {
+	long frames, ticks;
+	if (!measure(videoFile, frames, ticks))
+		return 2;
+
+	std::cout << frames << " distinct frames, " << ticks << " ticks, "
+		<< (double) ticks / VIDEO_FRAME_RATE << " s" << std::endl;
+	return 0;
+}
+
+// Uncompressed AVI 1.0 with 8-bit palettized frames. A repeated frame is
+// a zero-length chunk, which players show as the previous frame again.
+int toAvi(const char * videoFile, const char * aviFile, int scale) {
+	long frames, ticks;
+	if (!measure(videoFile, frames, ticks))
+		return 2;
+
+	int width = CHIP8_SCREEN_WIDTH * scale;
+	int height = CHIP8_SCREEN_HEIGHT * scale;
+	int stride = (width + 3) & ~3;
+	long frameBytes = (long) stride * height;
+
+	long strlBytes = 4 + (8 + 56) + (8 + 40 + 8);
+	long hdrlBytes = 4 + (8 + 56) + (8 + strlBytes);
+	long moviBytes = 4 + frames * (8 + frameBytes) + (ticks - frames) * 8;
+	long indexBytes = ticks * 16;
+	long riffBytes = 4 + (8 + hdrlBytes) + (8 + moviBytes) + (8 + indexBytes);
+
+	if (riffBytes > (long) AVI_MAX_BYTES) {
+		std::cerr << "Too large for AVI at scale " << scale
+			<< ": use a smaller scale or apng" << std::endl;
+		return 1;
+	}
+
+	std::string header;
+	header += "RIFF";
+	putLittle(header, riffBytes, 4);
+	header += "AVI LIST";
+	putLittle(header, hdrlBytes, 4);
+	header += "hdrlavih";
+	putLittle(header, 56, 4);
+	putLittle(header, 1000000 / VIDEO_FRAME_RATE, 4);	// Microseconds per frame
+	putLittle(header, frameBytes * VIDEO_FRAME_RATE, 4);	// Max bytes per second
+	putLittle(header, 0, 4);							// Padding granularity
+	putLittle(header, 0x10, 4);							// AVIF_HASINDEX
+	putLittle(header, ticks, 4);
+	putLittle(header, 0, 4);							// Initial frames
+	putLittle(header, 1, 4);							// Streams
+	putLittle(header, frameBytes, 4);					// Suggested buffer size
+	putLittle(header, width, 4);
+	putLittle(header, height, 4);
+	header += std::string(16, '\0');
+	header += "LIST";
+	putLittle(header, strlBytes, 4);
+	header += "strlstrh";
+	putLittle(header, 56, 4);
+	header += "vidsDIB ";
+	putLittle(header, 0, 4);							// Flags
+	putLittle(header, 0, 4);							// Priority, language
+	putLittle(header, 0, 4);							// Initial frames
+	putLittle(header, 1, 4);							// Scale
+	putLittle(header, VIDEO_FRAME_RATE, 4);				// Rate
+	putLittle(header, 0, 4);							// Start
+	putLittle(header, ticks, 4);						// Length
+	putLittle(header, frameBytes, 4);
+	putLittle(header, 0xFFFFFFFF, 4);					// Quality
+	putLittle(header, 0, 4);							// Sample size
+	putLittle(header, 0, 4);
+	putLittle(header, width, 2);
+	putLittle(header, height, 2);
+	header += "strf";
+	putLittle(header, 40 + 8, 4);
+	putLittle(header, 40, 4);							// BITMAPINFOHEADER
+	putLittle(header, width, 4);
+	putLittle(header, height, 4);						// Positive: bottom-up
+	putLittle(header, 1, 2);							// Planes
+	putLittle(header, 8, 2);							// Bits per pixel
+	putLittle(header, 0, 4);							// BI_RGB
+	putLittle(header, frameBytes, 4);
+	putLittle(header, 0, 4);
+	putLittle(header, 0, 4);
+	putLittle(header, 2, 4);							// Colours used
+	putLittle(header, 2, 4);
+	header += std::string(1, offColour[2]) + (char) offColour[1] + (char) offColour[0] + '\0';
+	header += std::string(1, onColour[2]) + (char) onColour[1] + (char) onColour[0] + '\0';
+	header += "LIST";
+	putLittle(header, moviBytes, 4);
+	header += "movi";
+
+	std::ofstream out(aviFile, std::ios_base::out | std::ios_base::binary);
+	out.write(header.data(), header.size());
+
+	VideoReader reader(videoFile);
+	VideoFrame frame;
+	std::string index, pixels(frameBytes, '\0');
+	long offset = 4;
+
+	while (reader.next(frame)) {
+		// Bottom-up rows of palette indices
+		for (int y = 0; y < height; y++) {
+			char * row = &pixels[(long) (height - 1 - y) * stride];
+			for (int x = 0; x < width; x++) {
+				row[x] = pixelOn(frame, x / scale, y / scale);
+			}
+		}
+
+		std::string chunk = "00db";
+		putLittle(chunk, frameBytes, 4);
+		out.write(chunk.data(), chunk.size());
+		out.write(pixels.data(), pixels.size());
+
+		index += "00db";
+		putLittle(index, 0x10, 4);						// AVIIF_KEYFRAME
+		putLittle(index, offset, 4);
+		putLittle(index, frameBytes, 4);
+		offset += 8 + frameBytes;
+
+		for (uint32_t r = 1; r < frame.repeats; r++) {
+			std::string repeat = "00db";
+			putLittle(repeat, 0, 4);
+			out.write(repeat.data(), repeat.size());
+
+			index += "00db";
+			putLittle(index, 0, 4);
+			putLittle(index, offset, 4);
+			putLittle(index, 0, 4);
+			offset += 8;
+		}
+	}
+
+	std::string indexHeader = "idx1";
+	putLittle(indexHeader, index.size(), 4);
+	out.write(indexHeader.data(), indexHeader.size());
+	out.write(index.data(), index.size());
+	return out.good() ? 0 : 1;
+}
+
+unsigned crc32(const std::string &data, size_t start) {
+	static unsigned table[256];
+	if (table[1] == 0) {
+		for (unsigned n = 0; n < 256; n++) {
+			unsigned c = n;
+			for (int k = 0; k < 8; k++)
+				c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+			table[n] = c;
+		}
+	}
+
+	unsigned crc = 0xFFFFFFFF;
+	for (size_t i = start; i < data.size(); i++)
+		crc = table[(crc ^ (byte) data[i]) & 0xFF] ^ (crc >> 8);
+	return crc ^ 0xFFFFFFFF;
+}
+
+void writeChunk(std::ofstream &out, const char * type, const std::string &data) {
+	std::string chunk;
+	putBig(chunk, data.size(), 4);
+	chunk += type;
+	chunk += data;
+	putBig(chunk, crc32(chunk, 4), 4);
+	out.write(chunk.data(), chunk.size());
+}
+
+// zlib stream of stored (uncompressed) deflate blocks
+std::string zlibStored(const std::string &data) {
+	std::string out("\x78\x01", 2);
+	unsigned a = 1, b = 0;
+
+	for (size_t i = 0; i < data.size(); i++) {
+		a = (a + (byte) data[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+
+	size_t position = 0;
+	do {
+		size_t length = std::min<size_t>(data.size() - position, DEFLATE_STORED_BLOCK);
+		bool last = position + length == data.size();
+		out += (char) last;
+		putLittle(out, length, 2);
+		putLittle(out, ~length & 0xFFFF, 2);
+		out.append(data, position, length);
+		position += length;
+	} while (position < data.size());
+
+	putBig(out, (b << 16) | a, 4);
+	return out;
+}
+
+// Animated PNG, two-colour palette at one bit per pixel. Repeats become the
+// frame's delay instead of extra frames.
+int toApng(const char * videoFile, const char * pngFile, int scale) {
+	long frames, ticks;
+	if (!measure(videoFile, frames, ticks))
+		return 2;
+
+	int width = CHIP8_SCREEN_WIDTH * scale;
+	int height = CHIP8_SCREEN_HEIGHT * scale;
+	int rowBytes = (width + 7) / 8;
+
+	std::ofstream out(pngFile, std::ios_base::out | std::ios_base::binary);
+	out.write("\x89PNG\r\n\x1A\n", 8);
+
+	std::string ihdr;
+	putBig(ihdr, width, 4);
+	putBig(ihdr, height, 4);
+	ihdr += std::string("\x01\x03\x00\x00\x00", 5);		// 1 bit, palette
+	writeChunk(out, "IHDR", ihdr);
+
+	std::string actl;
+	putBig(actl, frames, 4);
+	putBig(actl, 0, 4);									// Loop forever
+	writeChunk(out, "acTL", actl);
+
+	std::string plte((const char *) offColour, 3);
+	plte.append((const char *) onColour, 3);
+	writeChunk(out, "PLTE", plte);
+
+	VideoReader reader(videoFile);
+	VideoFrame frame;
+	unsigned sequence = 0;
+
+	while (reader.next(frame)) {
+		// Delays past 16 bits fall back to whole seconds
+		unsigned delayNumerator = frame.repeats;
+		unsigned delayDenominator = VIDEO_FRAME_RATE;
+		if (delayNumerator > PNG_MAX_DELAY) {
+			delayNumerator = std::min<unsigned>(frame.repeats / VIDEO_FRAME_RATE, PNG_MAX_DELAY);
+			delayDenominator = 1;
+		}
+
+		bool first = sequence == 0;
+		std::string fctl;
+		putBig(fctl, sequence++, 4);
+		putBig(fctl, width, 4);
+		putBig(fctl, height, 4);
+		putBig(fctl, 0, 4);
+		putBig(fctl, 0, 4);
+		putBig(fctl, delayNumerator, 2);
+		putBig(fctl, delayDenominator, 2);
+		fctl += std::string("\x00\x00", 2);				// No dispose, replace
+		writeChunk(out, "fcTL", fctl);
+
+		std::string image;
+		for (int y = 0; y < height; y++) {
+			image += '\0';								// No filter
+			std::string row(rowBytes, '\0');
+			for (int x = 0; x < width; x++) {
+				if (pixelOn(frame, x / scale, y / scale))
+					row[x / 8] |= 0x80 >> (x % 8);
+			}
+			image += row;
+		}
+
+		// The first frame doubles as the still image
+		if (first) {
+			writeChunk(out, "IDAT", zlibStored(image));
+		} else {
+			std::string fdat;
+			putBig(fdat, sequence++, 4);
+			writeChunk(out, "fdAT", fdat + zlibStored(image));
+		}
+	}
+
+	writeChunk(out, "IEND", "");
+	return out.good() ? 0 : 1;
+}
+
+void usage() {
+	std::cout << "Usage:\n"
+	"  chipvideo info VIDEO\n"
+	"  chipvideo avi VIDEO OUTPUT.avi [SCALE]\n"
+	"  chipvideo apng VIDEO OUTPUT.png [SCALE]\n"
+	<< std::endl;
+}
+
+int main(int argc, char ** argv)
+{
+	int scale = DEFAULT_SCALE;
+	if (argc == 5)
+		scale = std::max(1, std::min(MAX_SCALE, atoi(argv[4])));
+
+	if (argc == 3 && strcmp(argv[1], "info") == 0)
+		return info(argv[2]);
+	if ((argc == 4 || argc == 5) && strcmp(argv[1], "avi") == 0)
+		return toAvi(argv[2], argv[3], scale);
+	if ((argc == 4 || argc == 5) && strcmp(argv[1], "apng") == 0)
+		return toApng(argv[2], argv[3], scale);
+
+	usage();
+	return 0;
+}
@@ -0,0 +1,186 @@
+#include "crawler.hpp"
+#include "textfmt.hpp"
+#include <cstdlib>
+#include <random>
+#include <sstream>
+
+const char * verdictName(byte verdict) {
+    switch (verdict) {
+        case CRAWL_ILLEGAL_OPCODE:  return "illegal_opcode";
+        case CRAWL_STACK_FAULT:     return "stack_fault";
+        case CRAWL_OTHER_FAULT:     return "fault";
+        case CRAWL_HANG:            return "hang";
+        case CRAWL_BLANK_SCREEN:    return "blank_screen";
+        case CRAWL_OK:              return "ok";
+    }
+    return "unknown";
+}
+
+static byte verdictForFault(byte fault) {
+    switch (fault) {
+        case FAULT_ILLEGAL_OPCODE:  return CRAWL_ILLEGAL_OPCODE;
+        case FAULT_STACK_OVERFLOW:
+        case FAULT_STACK_UNDERFLOW: return CRAWL_STACK_FAULT;
+    }
+    return CRAWL_OTHER_FAULT;
+}
+
+static int litPixels(const Chip8 &sys) {
+    int lit = 0;
+    for (int y = 0; y < CHIP8_SCREEN_HEIGHT; y++) {
+        for (uint64_t row = sys.displayRows[y]; row != 0; row &= row - 1)
+            lit++;
+    }
+    return lit;
+}
+
+CrawlResult crawlRom(const std::string &name, const std::vector<byte> &rom, long frames,
+                     int cyclesPerFrame, uint32_t seed) {
+    std::vector<byte> image(rom);
+    image.resize(CHIP8_ROM_BYTES, 0);
+
+    Chip8 sys;
+    sys.reset();
+    sys.load(image.data());
+    sys.seedRandom(seed);
+
+    CrawlResult result;
+    result.rom = name;
+    result.verdict = CRAWL_OK;
+    result.fault = FAULT_NONE;
+    result.frames = 0;
+    result.instructions = 0;
+
+    std::mt19937 input(seed);
+    uint64_t lastMemory = sys.memoryFingerprint;
+    long stalled = 0;
+    bool everLit = false;
+
+    while (result.frames < frames) {
+        if (input() % CRAWL_KEY_PERIOD == 0) {
+            byte key = input() % 16;
+            if (sys.keyState[key])
+                sys.releaseKey(key);
+            else
+                sys.pressKey(key);
+        }
+
+        int executed = sys.run(cyclesPerFrame);
+        result.instructions += executed;
+        result.frames++;
+
+        if (executed < cyclesPerFrame) {
+            result.verdict = verdictForFault(sys.fault);
+            result.fault = sys.fault;
+            break;
+        }
+
+        if (!everLit)
+            everLit = litPixels(sys) > 0;
+
+        // The PC going round with nothing in RAM or on screen changing. A
+        // ROM parked on a jump to itself after drawing has finished.
+        if (sys.memoryFingerprint == lastMemory) {
+            if (++stalled >= CRAWL_HANG_FRAMES) {
+                word pc = sys.programCounter & 0x0FFF;
+                bool parked = combine(sys.ram[pc], sys.ram[(pc + 1) & 0x0FFF]) == (0x1000 | pc);
+                result.verdict = (parked && everLit) ? CRAWL_OK : CRAWL_HANG;
+                break;
+            }
+        } else {
+            stalled = 0;
+            lastMemory = sys.memoryFingerprint;
+        }
+    }
+
+    if (result.verdict == CRAWL_OK && !everLit)
+        result.verdict = CRAWL_BLANK_SCREEN;
+
+    result.programCounter = sys.programCounter & 0x0FFF;
+    result.opcode = combine(sys.ram[result.programCounter], sys.ram[(result.programCounter + 1) & 0x0FFF]);
+    result.litPixels = litPixels(sys);
+    return result;
+}
+
+static std::string csvField(const std::string &value) {
+    if (value.find_first_of(",\"\n") == std::string::npos)
+        return value;
+
+    std::string quoted = "\"";
+    for (size_t i = 0; i < value.size(); i++) {
+        if (value[i] == '"')
+            quoted += '"';
+        quoted += value[i];
+    }
+    return quoted + "\"";
+}
+
+std::string crawlCsvHeader() {
+    return "rom,verdict,fault,pc,opcode,frames,instructions,lit_pixels";
+}
+
+std::string crawlToCsv(const CrawlResult &result) {
+    std::ostringstream out;
+    out << csvField(result.rom) << "," << verdictName(result.verdict) << "," << faultName(result.fault)
+        << "," << hex(result.programCounter, 3) << "," << hex(result.opcode, 4) << "," << result.frames
+        << "," << result.instructions << "," << result.litPixels;
+    return out.str();
+}
+
+bool crawlFromCsv(const std::string &line, CrawlResult &result) {
+    // Split on commas outside quotes, undoubling quotes
+    std::vector<std::string> fields(1);
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); i++) {
+        char c = line[i];
+        if (quoted && c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+            fields.back() += c;
+            i++;
+        } else if (c == '"') {
+            quoted = !quoted;
+        } else if (c == ',' && !quoted) {
+            fields.push_back("");
+        } else if (c != '\r') {
+            fields.back() += c;
+        }
+    }
+    if (fields.size() != 8 || line == crawlCsvHeader())
+        return false;
+
+    bool known = false;
+    for (byte v = CRAWL_ILLEGAL_OPCODE; v <= CRAWL_OK; v++) {
+        if (fields[1] == verdictName(v)) {
+            result.verdict = v;
+            known = true;
+        }
+    }
+    if (!known)
+        return false;
+
+    result.rom = fields[0];
+    result.fault = FAULT_NONE;
+    for (byte f = FAULT_NONE; f <= FAULT_KEY_RANGE; f++) {
+        if (fields[2] == faultName(f))
+            result.fault = f;
+    }
+
+    result.programCounter = strtol(fields[3].c_str(), nullptr, 16);
+    result.opcode = strtol(fields[4].c_str(), nullptr, 16);
+    result.frames = atol(fields[5].c_str());
+    result.instructions = atol(fields[6].c_str());
+    result.litPixels = atoi(fields[7].c_str());
+    return true;
+}
+
+std::string crawlToJson(const CrawlResult &result) {
+    std::ostringstream out;
+    out << "{\"rom\":" << jsonString(result.rom)
+        << ",\"verdict\":\"" << verdictName(result.verdict) << "\""
+        << ",\"fault\":\"" << faultName(result.fault) << "\""
+        << ",\"pc\":\"" << hex(result.programCounter, 3) << "\""
+        << ",\"opcode\":\"" << hex(result.opcode, 4) << "\""
+        << ",\"frames\":" << result.frames
+        << ",\"instructions\":" << result.instructions
+        << ",\"lit_pixels\":" << result.litPixels << "}";
+    return out.str();
+}
@@ -0,0 +1,474 @@
+#include "debugger.hpp"
+#include "disassembler.hpp"
+#include "textfmt.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define INDEX_REGISTER 16
+// Instructions per sys.run() call on the unwatched fast path
+#define FAST_SLICE 65536
+
+static bool parseValue(const std::string &text, long &value) {
+    if (text.empty())
+        return false;
+    char * end;
+    value = strtol(text.c_str(), &end, 0);
+    return *end == '\0';
+}
+
+// V0-VF, or I as INDEX_REGISTER
+static int parseRegister(const std::string &text) {
+    if (text == "i" || text == "I")
+        return INDEX_REGISTER;
+    if (text.size() == 2 && (text[0] == 'v' || text[0] == 'V') && isxdigit((unsigned char) text[1]))
+        return strtol(text.c_str() + 1, nullptr, 16);
+    return -1;
+}
+
+static const char * const compares[] = { "==", "!=", "<", "<=", ">", ">=" };
+
+static bool compare(int left, const std::string &op, int right) {
+    if (op == "==") return left == right;
+    if (op == "!=") return left != right;
+    if (op == "<")  return left < right;
+    if (op == "<=") return left <= right;
+    if (op == ">")  return left > right;
+    return left >= right;
+}
+
+Debugger::Debugger(Chip8 &sys)
+    : sys(sys), lastStop(STOP_NONE), lastHit(0), lastHitAddress(0), lastHitPc(0), quit(false), nextId(1) {}
+
+int Debugger::addBreakpoint(word pc) {
+    return addBreakpoint(pc, -1, "", 0);
+}
+
+int Debugger::addBreakpoint(word pc, int reg, const std::string &compare, int value) {
+    pc &= CHIP8_RAM_BYTES - 1;
+    breakpoints.push_back(Breakpoint{nextId, pc, reg >= 0, reg, compare, value});
+    breakAt[pc] = true;
+    return nextId++;
+}
+
+int Debugger::addWatchpoint(byte kind, word start, word end) {
+    watchpoints.push_back(Watchpoint{nextId, kind, false,
+        (word) (start & (CHIP8_RAM_BYTES - 1)), (word) (end & (CHIP8_RAM_BYTES - 1))});
+    return nextId++;
+}
+
+int Debugger::addIndexWatchpoint(byte kind) {
+    watchpoints.push_back(Watchpoint{nextId, kind, true, 0, 0});
+    return nextId++;
+}
+
+bool Debugger::remove(int id) {
+    for (size_t i = 0; i < breakpoints.size(); i++) {
+        if (breakpoints[i].id != id)
+            continue;
+        word pc = breakpoints[i].pc;
+        breakpoints.erase(breakpoints.begin() + i);
+        breakAt[pc] = false;
+        for (const Breakpoint &b : breakpoints)
+            breakAt[pc] = breakAt[pc] || b.pc == pc;
+        return true;
+    }
+    for (size_t i = 0; i < watchpoints.size(); i++) {
+        if (watchpoints[i].id == id) {
+            watchpoints.erase(watchpoints.begin() + i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Debugger::breakpointHolds(word pc) {
+    for (const Breakpoint &b : breakpoints) {
+        if (b.pc != pc)
+            continue;
+        int value = b.reg == INDEX_REGISTER ? sys.indexRegister : sys.variableRegisters[b.reg & 0xF];
+        if (!b.conditional || compare(value, b.compare, b.value)) {
+            lastHit = b.id;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Whether the instruction about to run touches a watched address or I.
+// Mirrors the accesses in opDraw, FX1E, FX29, FX33, FX55 and FX65.
+bool Debugger::watchHit(word opcode) {
+    word I = sys.indexRegister;
+    int reads = 0;
+    int writes = 0;
+    bool readsIndex = false;
+    bool writesIndex = false;
+    byte X = (opcode & 0x0F00) >> 8;
+
+    switch (opcode & 0xF000) {
+        case 0xA000:
+            writesIndex = true;
+            break;
+        case 0xD000:
+            readsIndex = true;
+            reads = opcode & 0x000F;
+            break;
+        case 0xF000:
+            switch (opcode & 0x00FF) {
+                case 0x1E:  readsIndex = writesIndex = true;        break;
+                case 0x29:  writesIndex = true;                     break;
+                case 0x33:  readsIndex = true; writes = 3;          break;
+                case 0x55:  readsIndex = true; writes = X + 1;      break;
+                case 0x65:  readsIndex = true; reads = X + 1;       break;
+            }
+            break;
+    }
+
+    for (const Watchpoint &w : watchpoints) {
+        if (w.index) {
+            if (((w.kind & WATCH_READ) && readsIndex) || ((w.kind & WATCH_WRITE) && writesIndex)) {
+                lastHit = w.id;
+                lastHitAddress = I;
+                return true;
+            }
+            continue;
+        }
+
+        int count = std::max((w.kind & WATCH_READ) ? reads : 0, (w.kind & WATCH_WRITE) ? writes : 0);
+        for (int i = 0; i < count; i++) {
+            word address = (I + i) & (CHIP8_RAM_BYTES - 1);
+            if (address >= w.start && address <= w.end) {
+                lastHit = w.id;
+                lastHitAddress = address;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// One loop per combination of what is armed. The unwatched instantiation
+// compiles to cycle() plus a bit test.
+template <bool Watched>
+DebugStop Debugger::run(long limit, int stopPc, int stopDepth) {
+    for (long n = 0; n < limit; n++) {
+        word pc = sys.programCounter & (CHIP8_RAM_BYTES - 1);
+        if (n > 0 && breakAt[pc] && breakpointHolds(pc))
+            return STOP_BREAKPOINT;
+
+        // Decoded before running, while I still holds the address used
+        bool hit = false;
+        if (Watched)
+            hit = watchHit(combine(sys.ram[pc], sys.ram[(pc + 1) & (CHIP8_RAM_BYTES - 1)]));
+
+        if (sys.cycle() != FAULT_NONE)
+            return STOP_FAULT;
+        if (hit) {
+            lastHitPc = pc;
+            return STOP_WATCHPOINT;
+        }
+        if (stopDepth >= 0 && sys.stackPointer <= stopDepth
+            && (stopPc < 0 || sys.programCounter == stopPc))
+            return STOP_STEP;
+    }
+    return STOP_LIMIT;
+}
+
+DebugStop Debugger::runUntil(long limit, int stopPc, int stopDepth) {
+    if (sys.fault != FAULT_NONE)
+        return STOP_FAULT;
+    if (!watchpoints.empty())
+        return run<true>(limit, stopPc, stopDepth);
+    if (!breakpoints.empty() || stopDepth >= 0)
+        return run<false>(limit, stopPc, stopDepth);
+
+    // Nothing armed: the fused fast path, as without a debugger
+    for (long executed = 0; executed < limit;) {
+        executed += sys.run((int) std::min<long>(limit - executed, FAST_SLICE));
+        if (sys.fault != FAULT_NONE)
+            return STOP_FAULT;
+    }
+    return STOP_LIMIT;
+}
+
+DebugStop Debugger::resume(long limit) {
+    lastStop = runUntil(limit, -1, -1);
+    return lastStop;
+}
+
+DebugStop Debugger::step(long count) {
+    lastStop = runUntil(count, -1, -1);
+    if (lastStop == STOP_LIMIT)
+        lastStop = STOP_STEP;
+    return lastStop;
+}
+
+DebugStop Debugger::stepOver() {
+    word pc = sys.programCounter & (CHIP8_RAM_BYTES - 1);
+    word opcode = combine(sys.ram[pc], sys.ram[(pc + 1) & (CHIP8_RAM_BYTES - 1)]);
+    if ((opcode & 0xF000) != 0x2000)
+        return step(1);
+
+    lastStop = runUntil(DEBUGGER_CONTINUE_LIMIT, pc + 2, sys.stackPointer);
+    return lastStop;
+}
+
+DebugStop Debugger::stepOut() {
+    if (sys.stackPointer == 0)
+        return step(1);
+
+    lastStop = runUntil(DEBUGGER_CONTINUE_LIMIT, -1, sys.stackPointer - 1);
+    return lastStop;
+}
+
+std::vector<word> Debugger::callStack() const {
+    std::vector<word> frames;
+    for (int i = std::min<int>(sys.stackPointer, CHIP8_STACK_HEIGHT) - 1; i >= 0; i--)
+        frames.push_back(sys.stack[i]);
+    return frames;
+}
+
+std::string Debugger::describeStop() const {
+    std::ostringstream out;
+    word pc = sys.programCounter;
+    switch (lastStop) {
+        case STOP_BREAKPOINT:
+            out << "breakpoint " << lastHit << " at " << hex(pc, 3);
+            break;
+        case STOP_WATCHPOINT:
+            out << "watchpoint " << lastHit << " at " << hex(lastHitAddress, 3)
+                << " by " << hex(lastHitPc, 3) << ", now at " << hex(pc, 3);
+            break;
+        case STOP_FAULT:
+            out << "fault " << faultName(sys.fault) << " at " << hex(pc, 3);
+            break;
+        case STOP_LIMIT:
+            out << "instruction limit reached at " << hex(pc, 3);
+            break;
+        case STOP_STEP:
+        case STOP_NONE:
+            out << "at " << hex(pc, 3);
+            break;
+    }
+    word opcode = combine(sys.ram[pc & (CHIP8_RAM_BYTES - 1)], sys.ram[(pc + 1) & (CHIP8_RAM_BYTES - 1)]);
+    out << ": " << hex(opcode, 4) << "  " << disassemble(opcode) << "\n";
+    return out.str();
+}
+
+static const char * help =
+    "break ADDR [if REG OP VALUE]    stop before ADDR; REG is V0-VF or I\n"
+    "watch [read|write|access] ADDR[-END] | I\n"
+    "                                stop after RAM or I is touched\n"
+    "delete ID                       remove a breakpoint or watchpoint\n"
+    "list                            breakpoints and watchpoints\n"
+    "continue [N]                    run until stopped, or N instructions\n"
+    "step [N]                        run N instructions\n"
+    "next                            step over a CALL\n"
+    "finish                          run until the subroutine returns\n"
+    "regs, stack, mem ADDR [LEN], dis [ADDR] [N]\n"
+    "press KEY, release KEY, quit\n";
+
+std::string Debugger::command(const std::string &line) {
+    std::istringstream in(line);
+    std::vector<std::string> args;
+    std::string arg;
+    while (in >> arg)
+        args.push_back(arg);
+    if (args.empty())
+        return "";
+
+    std::ostringstream out;
+    const std::string &name = args[0];
+    long a = 0, b = 0;
+
+    if (name == "help" || name == "h") {
+        out << help;
+    } else if (name == "break" || name == "b") {
+        if (args.size() == 2 && parseValue(args[1], a)) {
+            out << "breakpoint " << addBreakpoint(a) << " at " << hex(a & 0xFFF, 3) << "\n";
+        } else if (args.size() == 6 && parseValue(args[1], a) && args[2] == "if"
+                   && parseRegister(args[3]) >= 0 && parseValue(args[5], b)
+                   && std::find(std::begin(compares), std::end(compares), args[4]) != std::end(compares)) {
+            out << "breakpoint " << addBreakpoint(a, parseRegister(args[3]), args[4], b)
+                << " at " << hex(a & 0xFFF, 3) << " if " << args[3] << " " << args[4] << " " << b << "\n";
+        } else {
+            out << "usage: break ADDR [if REG OP VALUE]\n";
+        }
+    } else if (name == "watch" || name == "w") {
+        byte kind = WATCH_WRITE;
+        size_t target = 1;
+        if (args.size() == 3) {
+            kind = args[1] == "read" ? WATCH_READ : args[1] == "access" ? WATCH_ACCESS : WATCH_WRITE;
+            target = 2;
+        }
+        std::string range = target < args.size() ? args[target] : "";
+        size_t dash = range.find('-');
+        if (parseRegister(range) == INDEX_REGISTER) {
+            out << "watchpoint " << addIndexWatchpoint(kind) << " on I\n";
+        } else if (parseValue(range.substr(0, dash), a)
+                   && (dash == std::string::npos ? (b = a, true) : parseValue(range.substr(dash + 1), b))) {
+            out << "watchpoint " << addWatchpoint(kind, a, b) << " on "
+                << hex(a & 0xFFF, 3) << "-" << hex(b & 0xFFF, 3) << "\n";
+        } else {
+            out << "usage: watch [read|write|access] ADDR[-END] | I\n";
+        }
+    } else if (name == "delete" || name == "d") {
+        if (args.size() == 2 && parseValue(args[1], a) && remove(a))
+            out << "deleted " << a << "\n";
+        else
+            out << "no such breakpoint or watchpoint\n";
+    } else if (name == "list" || name == "l") {
+        for (const Breakpoint &bp : breakpoints) {
+            out << bp.id << "\tbreak " << hex(bp.pc, 3);
+            if (bp.conditional)
+                out << " if " << (bp.reg == INDEX_REGISTER ? std::string("I") : "V" + hex(bp.reg, 1).substr(2))
+                    << " " << bp.compare << " " << bp.value;
+            out << "\n";
+        }
+        for (const Watchpoint &wp : watchpoints) {
+            static const char * const kinds[] = { "", "read", "write", "access" };
+            out << wp.id << "\twatch " << kinds[wp.kind & 3] << " ";
+            if (wp.index)
+                out << "I\n";
+            else
+                out << hex(wp.start, 3) << "-" << hex(wp.end, 3) << "\n";
+        }
+    } else if (name == "continue" || name == "c") {
+        resume(args.size() > 1 && parseValue(args[1], a) ? a : DEBUGGER_CONTINUE_LIMIT);
+        out << describeStop();
+    } else if (name == "step" || name == "s") {
+        step(args.size() > 1 && parseValue(args[1], a) ? a : 1);
+        out << describeStop();
+    } else if (name == "next" || name == "n") {
+        stepOver();
+        out << describeStop();
+    } else if (name == "finish" || name == "f") {
+        stepOut();
+        out << describeStop();
+    } else if (name == "regs" || name == "r") {
+        out << "pc " << hex(sys.programCounter, 3) << "  i " << hex(sys.indexRegister, 3)
+            << "  sp " << (int) sys.stackPointer << "  dt " << (int) sys.delayTimer
+            << "  st " << (int) sys.soundTimer << "\n";
+        for (int r = 0; r < CHIP8_VARIABLE_REGISTERS; r++)
+            out << "V" << hex(r, 1).substr(2) << " " << hex(sys.variableRegisters[r], 2).substr(2)
+                << (r % 8 == 7 ? "\n" : "  ");
+    } else if (name == "stack" || name == "bt") {
+        out << "#0 " << hex(sys.programCounter, 3) << "\n";
+        std::vector<word> frames = callStack();
+        for (size_t i = 0; i < frames.size(); i++)
+            out << "#" << i + 1 << " " << hex(frames[i], 3) << "  called from " << hex(frames[i] - 2, 3) << "\n";
+    } else if ((name == "mem" || name == "x") && args.size() >= 2 && parseValue(args[1], a)) {
+        long length = args.size() > 2 && parseValue(args[2], b) ? b : 16;
+        for (long i = 0; i < length; i++) {
+            if (i % 16 == 0)
+                out << (i ? "\n" : "") << hex((a + i) & 0xFFF, 3) << ":";
+            out << " " << hex(sys.ram[(a + i) & 0xFFF], 2).substr(2);
+        }
+        out << "\n";
+    } else if (name == "dis") {
+        long address = args.size() > 1 && parseValue(args[1], a) ? a : sys.programCounter;
+        long count = args.size() > 2 && parseValue(args[2], b) ? b : 8;
+        for (long i = 0; i < count; i++) {
+            word at = (address + 2 * i) & 0xFFF;
+            word opcode = combine(sys.ram[at], sys.ram[(at + 1) & 0xFFF]);
+            out << (at == sys.programCounter ? ">" : " ") << (breakAt[at] ? "*" : " ")
+                << " " << hex(at, 3) << "  " << hex(opcode, 4) << "  " << disassemble(opcode) << "\n";
+        }
+    } else if ((name == "press" || name == "release") && args.size() == 2 && parseValue(args[1], a)) {
+        if (name == "press")
+            sys.pressKey(a);
+        else
+            sys.releaseKey(a);
+    } else if (name == "quit" || name == "q") {
+        quit = true;
+    } else {
+        out << "unknown command; try help\n";
+    }
+    return out.str();
+}
+
+DebugSocket::DebugSocket(const std::string &path) : path(path), listener(-1) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+        return;
+    strcpy(address.sun_path, path.c_str());
+
+    unlink(path.c_str());
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener >= 0 && (bind(listener, (sockaddr *) &address, sizeof(address)) != 0
+                          || listen(listener, 4) != 0)) {
+        close(listener);
+        listener = -1;
+    }
+}
+
+DebugSocket::~DebugSocket() {
+    for (const Client &client : clients)
+        close(client.fd);
+    if (listener >= 0) {
+        close(listener);
+        unlink(path.c_str());
+    }
+}
+
+bool DebugSocket::ok() const {
+    return listener >= 0;
+}
+
+static void sendAll(int fd, const std::string &text) {
+    size_t sent = 0;
+    while (sent < text.size()) {
+        ssize_t n = send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+            return;
+        sent += n;
+    }
+}
+
+void DebugSocket::poll(Debugger &debugger, int timeout) {
+    if (listener < 0)
+        return;
+
+    std::vector<pollfd> waiting(1, pollfd{listener, POLLIN, 0});
+    for (const Client &client : clients)
+        waiting.push_back(pollfd{client.fd, POLLIN, 0});
+    if (::poll(waiting.data(), waiting.size(), timeout) <= 0)
+        return;
+
+    // Clients in the order polled; new ones are added after
+    for (size_t i = clients.size(); i > 0; i--) {
+        if (!(waiting[i].revents & (POLLIN | POLLHUP | POLLERR)))
+            continue;
+
+        Client &client = clients[i - 1];
+        char buffer[1024];
+        ssize_t n = recv(client.fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            close(client.fd);
+            clients.erase(clients.begin() + (i - 1));
+            continue;
+        }
+
+        client.pending.append(buffer, n);
+        size_t newline;
+        while ((newline = client.pending.find('\n')) != std::string::npos) {
+            std::string line = client.pending.substr(0, newline);
+            client.pending.erase(0, newline + 1);
+            sendAll(client.fd, debugger.command(line) + DEBUGGER_PROMPT);
+        }
+    }
+
+    if (waiting[0].revents & POLLIN) {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd >= 0) {
+            clients.push_back(Client{fd, ""});
+            sendAll(fd, debugger.describeStop() + DEBUGGER_PROMPT);
+        }
+    }
+}
@@ -0,0 +1,375 @@
+#include "disassembler.hpp"
+#include "textfmt.hpp"
+#include <sstream>
+
+static std::string reg(int X) {
+    std::ostringstream out;
+    out << "V" << std::hex << std::uppercase << X;
+    return out.str();
+}
+
+std::string disassemble(word opcode) {
+    byte X = (opcode & 0x0F00) >> 8;
+    byte Y = (opcode & 0x00F0) >> 4;
+    byte N = (opcode & 0x000F);
+    word NN = opcode & 0x00FF;
+    word NNN = opcode & 0x0FFF;
+
+    switch (opcode & 0xF000) {
+        case 0x0000:
+            if (opcode == 0x00E0) return "CLS";
+            if (opcode == 0x00EE) return "RET";
+            break;
+        case 0x1000:    return "JP " + hex(NNN, 3);
+        case 0x2000:    return "CALL " + hex(NNN, 3);
+        case 0x3000:    return "SE " + reg(X) + ", " + hex(NN, 2);
+        case 0x4000:    return "SNE " + reg(X) + ", " + hex(NN, 2);
+        case 0x5000:
+            if (N == 0) return "SE " + reg(X) + ", " + reg(Y);
+            break;
+        case 0x6000:    return "LD " + reg(X) + ", " + hex(NN, 2);
+        case 0x7000:    return "ADD " + reg(X) + ", " + hex(NN, 2);
+        case 0x8000:
+            switch (N) {
+                case 0x0:   return "LD " + reg(X) + ", " + reg(Y);
+                case 0x1:   return "OR " + reg(X) + ", " + reg(Y);
+                case 0x2:   return "AND " + reg(X) + ", " + reg(Y);
+                case 0x3:   return "XOR " + reg(X) + ", " + reg(Y);
+                case 0x4:   return "ADD " + reg(X) + ", " + reg(Y);
+                case 0x5:   return "SUB " + reg(X) + ", " + reg(Y);
+                case 0x6:   return "SHR " + reg(X) + ", " + reg(Y);
+                case 0x7:   return "SUBN " + reg(X) + ", " + reg(Y);
+                case 0xE:   return "SHL " + reg(X) + ", " + reg(Y);
+            }
+            break;
+        case 0x9000:
+            if (N == 0) return "SNE " + reg(X) + ", " + reg(Y);
+            break;
+        case 0xA000:    return "LD I, " + hex(NNN, 3);
+        case 0xB000:    return "JP V0, " + hex(NNN, 3);
+        case 0xC000:    return "RND " + reg(X) + ", " + hex(NN, 2);
+        case 0xD000:    return "DRW " + reg(X) + ", " + reg(Y) + ", " + hex(N, 1);
+        case 0xE000:
+            if (NN == 0x9E) return "SKP " + reg(X);
+            if (NN == 0xA1) return "SKNP " + reg(X);
+            break;
+        case 0xF000:
+            switch (NN) {
+                case 0x07:  return "LD " + reg(X) + ", DT";
+                case 0x0A:  return "LD " + reg(X) + ", K";
+                case 0x15:  return "LD DT, " + reg(X);
+                case 0x18:  return "LD ST, " + reg(X);
+                case 0x1E:  return "ADD I, " + reg(X);
+                case 0x29:  return "LD F, " + reg(X);
+                case 0x33:  return "LD B, " + reg(X);
+                case 0x55:  return "LD [I], " + reg(X);
+                case 0x65:  return "LD " + reg(X) + ", [I]";
+            }
+            break;
+    }
+
+    return "";
+}
+
+static bool isSkip(word opcode) {
+    switch (opcode & 0xF000) {
+        case 0x3000:
+        case 0x4000:
+            return true;
+        case 0x5000:
+        case 0x9000:
+            return (opcode & 0x000F) == 0;
+        case 0xE000:
+            return (opcode & 0x00FF) == 0x9E || (opcode & 0x00FF) == 0xA1;
+    }
+    return false;
+}
+
+// Instructions after which execution does not simply fall through
+static bool endsBlock(word opcode) {
+    switch (opcode & 0xF000) {
+        case 0x1000:
+        case 0xB000:
+            return true;
+    }
+    return opcode == 0x00EE || isSkip(opcode) || disassemble(opcode).empty();
+}
+
+// Intraprocedural successors: calls fall through to the return address
+static void successors(word address, word opcode, std::vector<word> &out) {
+    if (disassemble(opcode).empty() || opcode == 0x00EE) {
+        return;
+    }
+
+    switch (opcode & 0xF000) {
+        case 0x1000:
+            out.push_back(opcode & 0x0FFF);
+            return;
+        case 0xB000:
+            return;
+    }
+
+    out.push_back(address + 2);
+
+    if (isSkip(opcode)) {
+        out.push_back(address + 4);
+    }
+}
+
+bool RomAnalysis::isCode(word address) const {
+    return instructions.count(address) > 0
+        || (address > 0 && instructions.count(address - 1) > 0);
+}
+
+RomAnalysis analyzeRom(const std::string &name, const byte * rom, int size) {
+    RomAnalysis analysis;
+    analysis.name = name;
+    analysis.size = size;
+    analysis.bytes.assign(rom, rom + size);
+
+    std::set<word> leaders;
+    std::set<word> functions;
+    std::vector<word> worklist;
+
+    leaders.insert(CHIP8_PROGRAM_START);
+    functions.insert(CHIP8_PROGRAM_START);
+    worklist.push_back(CHIP8_PROGRAM_START);
+
+    int romEnd = CHIP8_PROGRAM_START + size;
+
+    // Discover reachable instructions
+    while (!worklist.empty()) {
+        word address = worklist.back();
+        worklist.pop_back();
+
+        if (address < CHIP8_PROGRAM_START || address + 2 > romEnd
+            || analysis.instructions.count(address)) {
+            continue;
+        }
+
+        int offset = address - CHIP8_PROGRAM_START;
+        word opcode = combine(rom[offset], rom[offset + 1]);
+        analysis.instructions[address] = opcode;
+
+        if (disassemble(opcode).empty()) {
+            analysis.illegalOpcodes.push_back(address);
+        }
+
+        if ((opcode & 0xF000) == 0xB000) {
+            analysis.computedJumps.push_back(address);
+        }
+
+        if ((opcode & 0xF000) == 0x2000) {
+            word target = opcode & 0x0FFF;
+            leaders.insert(target);
+            functions.insert(target);
+            worklist.push_back(target);
+        }
+
+        std::vector<word> next;
+        successors(address, opcode, next);
+
+        for (size_t i = 0; i < next.size(); i++) {
+            if (endsBlock(opcode)) {
+                leaders.insert(next[i]);
+            }
+            worklist.push_back(next[i]);
+        }
+    }
+
+    // Split into basic blocks
+    BasicBlock * block = nullptr;
+    int lastIRegister = -1;
+
+    for (std::map<word, word>::iterator it = analysis.instructions.begin();
+         it != analysis.instructions.end(); ++it) {
+        word address = it->first;
+        word opcode = it->second;
+
+        if (block == nullptr || block->end != address || leaders.count(address)) {
+            if (block != nullptr && block->successors.empty() && block->end == address) {
+                block->successors.push_back(address);
+            }
+            block = &analysis.blocks[address];
+            block->start = address;
+            lastIRegister = -1;
+        }
+        block->end = address + 2;
+
+        // Track I within the block to resolve FX33/FX55 targets
+        if ((opcode & 0xF000) == 0xA000) {
+            lastIRegister = opcode & 0x0FFF;
+        } else if ((opcode & 0xF0FF) == 0xF01E || (opcode & 0xF0FF) == 0xF029
+                   || (opcode & 0xF000) == 0x2000) {
+            lastIRegister = -1;
+        } else if ((opcode & 0xF0FF) == 0xF033 || (opcode & 0xF0FF) == 0xF055) {
+            RamWrite write;
+            write.address = address;
+            write.target = lastIRegister;
+            write.length = ((opcode & 0xF0FF) == 0xF033) ? 3 : ((opcode & 0x0F00) >> 8) + 1;
+            analysis.ramWrites.push_back(write);
+        }
+
+        if (endsBlock(opcode)) {
+            successors(address, opcode, block->successors);
+            block = nullptr;
+        }
+    }
+
+    for (size_t i = 0; i < analysis.ramWrites.size(); i++) {
+        const RamWrite &write = analysis.ramWrites[i];
+        for (int t = write.target; write.target >= 0 && t < write.target + write.length; t++) {
+            if (analysis.isCode(t)) {
+                analysis.selfModifyingWrites.push_back(write.address);
+                break;
+            }
+        }
+    }
+
+    // Call graph: walk each subroutine's blocks and collect its calls
+    for (std::set<word>::iterator f = functions.begin(); f != functions.end(); ++f) {
+        std::set<word> &callees = analysis.callGraph[*f];
+        std::set<word> seen;
+        std::vector<word> pending(1, *f);
+
+        while (!pending.empty()) {
+            word start = pending.back();
+            pending.pop_back();
+
+            if (seen.count(start) || !analysis.blocks.count(start)) {
+                continue;
+            }
+            seen.insert(start);
+
+            const BasicBlock &b = analysis.blocks[start];
+            for (word a = b.start; a < b.end; a += 2) {
+                word opcode = analysis.instructions[a];
+                if ((opcode & 0xF000) == 0x2000) {
+                    callees.insert(opcode & 0x0FFF);
+                }
+            }
+            pending.insert(pending.end(), b.successors.begin(), b.successors.end());
+        }
+    }
+
+    return analysis;
+}
+
+std::string analysisToText(const RomAnalysis &analysis) {
+    std::ostringstream out;
+    out << "; " << analysis.name << " (" << analysis.size << " bytes)\n";
+
+    int romEnd = CHIP8_PROGRAM_START + analysis.size;
+    int address = CHIP8_PROGRAM_START;
+
+    while (address < romEnd) {
+        std::map<word, word>::const_iterator it = analysis.instructions.find(address);
+
+        if (it != analysis.instructions.end()) {
+            std::map<word, BasicBlock>::const_iterator b = analysis.blocks.find(address);
+            if (b != analysis.blocks.end()) {
+                out << "\n" << hex(address, 3) << ":";
+                if (address == CHIP8_PROGRAM_START) {
+                    out << " ; entry";
+                } else if (analysis.callGraph.count(address)) {
+                    out << " ; subroutine";
+                }
+                out << "\n";
+            }
+
+            std::string text = disassemble(it->second);
+            out << "    " << hex(address, 3) << "  " << hex(it->second, 4).substr(2)
+                << "  " << (text.empty() ? "??? ; illegal" : text) << "\n";
+            address += 2;
+            continue;
+        }
+
+        // Data: up to 8 bytes on a line, stopping at the next instruction
+        out << "    " << hex(address, 3) << "  .byte";
+        for (int i = 0; i < 8 && address < romEnd
+             && (i == 0 || !analysis.instructions.count(address)); i++) {
+            out << (i ? ", " : " ") << hex(analysis.bytes[address - CHIP8_PROGRAM_START], 2);
+            address++;
+        }
+        out << "\n";
+    }
+
+    out << "\n; call graph\n";
+    for (std::map<word, std::set<word> >::const_iterator f = analysis.callGraph.begin();
+         f != analysis.callGraph.end(); ++f) {
+        out << ";   " << hex(f->first, 3) << " ->";
+        for (std::set<word>::const_iterator c = f->second.begin(); c != f->second.end(); ++c) {
+            out << " " << hex(*c, 3);
+        }
+        out << "\n";
+    }
+
+    for (size_t i = 0; i < analysis.computedJumps.size(); i++) {
+        out << "; computed jump at " << hex(analysis.computedJumps[i], 3) << "\n";
+    }
+    for (size_t i = 0; i < analysis.selfModifyingWrites.size(); i++) {
+        out << "; self-modifying write at " << hex(analysis.selfModifyingWrites[i], 3) << "\n";
+    }
+    for (size_t i = 0; i < analysis.illegalOpcodes.size(); i++) {
+        out << "; illegal opcode at " << hex(analysis.illegalOpcodes[i], 3) << "\n";
+    }
+
+    return out.str();
+}
+
+static void jsonList(std::ostream &out, const std::vector<word> &values) {
+    out << "[";
+    for (size_t i = 0; i < values.size(); i++) {
+        out << (i ? "," : "") << values[i];
+    }
+    out << "]";
+}
+
+std::string analysisToJson(const RomAnalysis &analysis) {
+    std::ostringstream out;
+    int codeBytes = 2 * analysis.instructions.size();
+
+    out << "{\"rom\":" << jsonString(analysis.name)
+        << ",\"size\":" << analysis.size
+        << ",\"code_bytes\":" << codeBytes
+        << ",\"data_bytes\":" << (analysis.size - codeBytes);
+
+    out << ",\"instructions\":[";
+    for (std::map<word, word>::const_iterator it = analysis.instructions.begin();
+         it != analysis.instructions.end(); ++it) {
+        out << (it == analysis.instructions.begin() ? "" : ",")
+            << "{\"address\":" << it->first
+            << ",\"opcode\":" << it->second
+            << ",\"text\":" << jsonString(disassemble(it->second)) << "}";
+    }
+
+    out << "],\"blocks\":[";
+    for (std::map<word, BasicBlock>::const_iterator b = analysis.blocks.begin();
+         b != analysis.blocks.end(); ++b) {
+        out << (b == analysis.blocks.begin() ? "" : ",")
+            << "{\"start\":" << b->second.start
+            << ",\"end\":" << b->second.end
+            << ",\"successors\":";
+        jsonList(out, b->second.successors);
+        out << "}";
+    }
+
+    out << "],\"calls\":[";
+    for (std::map<word, std::set<word> >::const_iterator f = analysis.callGraph.begin();
+         f != analysis.callGraph.end(); ++f) {
+        out << (f == analysis.callGraph.begin() ? "" : ",")
+            << "{\"from\":" << f->first << ",\"to\":";
+        jsonList(out, std::vector<word>(f->second.begin(), f->second.end()));
+        out << "}";
+    }
+
+    out << "],\"computed_jumps\":";
+    jsonList(out, analysis.computedJumps);
+    out << ",\"self_modifying_writes\":";
+    jsonList(out, analysis.selfModifyingWrites);
+    out << ",\"illegal_opcodes\":";
+    jsonList(out, analysis.illegalOpcodes);
+    out << "}";
+
+    return out.str();
+}
@@ -0,0 +1,297 @@
+#include "envserver.hpp"
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static size_t segmentBytes(int envCount) {
+    return sizeof(EnvShmHeader) + envCount * sizeof(EnvSlot);
+}
+
+void futexWait(std::atomic<uint32_t> &word, uint32_t expected, int timeoutMs) {
+    struct timespec timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_nsec = (timeoutMs % 1000) * 1000000L;
+
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT, expected,
+            &timeout, nullptr, 0);
+}
+
+void futexWake(std::atomic<uint32_t> &word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE, INT_MAX,
+            nullptr, nullptr, 0);
+}
+
+EnvServer::EnvServer(const std::string &name, const std::vector<uint8_t> &rom, int envCount,
+                     int workerCount, int framesPerStep)
+    : name(name), bytes(0), header(nullptr), slots(nullptr), stopping(false) {
+    if (envCount < 1) {
+        failure = "at least one environment is needed";
+        return;
+    }
+    bytes = segmentBytes(envCount);
+    if (workerCount < 1)
+        workerCount = 1;
+    if (workerCount > ENV_MAX_WORKERS)
+        workerCount = ENV_MAX_WORKERS;
+
+    for (int i = 0; i < envCount; i++) {
+        chip8_env * env = chip8_create(rom.data(), rom.size());
+        if (env == nullptr) {
+            failure = "the ROM is too large";
+            return;
+        }
+        envs.push_back(env);
+    }
+
+    // Never take over a segment: another server may be serving from it
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        if (errno == EEXIST)
+            failure = name + " already exists; another server is using it, or one that died left "
+                      "it behind in /dev/shm";
+        else
+            failure = name + ": " + strerror(errno);
+        return;
+    }
+
+    void * memory = MAP_FAILED;
+    if (ftruncate(fd, bytes) == 0)
+        memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) {
+        failure = name + ": " + strerror(errno);
+        close(fd);
+        shm_unlink(name.c_str());
+        return;
+    }
+    close(fd);
+
+    // ftruncate zero-fills, so every counter and bell starts at zero
+    header = static_cast<EnvShmHeader *>(memory);
+    slots = reinterpret_cast<EnvSlot *>(header + 1);
+
+    header->headerBytes = sizeof(EnvShmHeader);
+    header->slotBytes = sizeof(EnvSlot);
+    header->envCount = envCount;
+    header->workerCount = workerCount;
+    header->framesPerStep = framesPerStep;
+
+    for (int i = 0; i < envCount; i++) {
+        memcpy(slots[i].frame, chip8_frame(envs[i]), sizeof(slots[i].frame));
+    }
+
+    // Publish the layout last: clients check magic and version first
+    header->version = ENV_PROTOCOL_VERSION;
+    header->serverRunning.store(1);
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = ENV_SHM_MAGIC;
+}
+
+EnvServer::~EnvServer() {
+    if (header != nullptr) {
+        header->serverRunning.store(0);
+        munmap(header, bytes);
+        shm_unlink(name.c_str());
+    }
+
+    for (size_t i = 0; i < envs.size(); i++) {
+        chip8_destroy(envs[i]);
+    }
+}
+
+bool EnvServer::ok() const {
+    return header != nullptr;
+}
+
+const std::string &EnvServer::error() const {
+    return failure;
+}
+
+void EnvServer::setReward(const std::vector<chip8_reward_term> &terms) {
+    for (size_t i = 0; i < envs.size(); i++) {
+        chip8_set_reward(envs[i], terms.data(), terms.size());
+    }
+}
+
+void EnvServer::serve() {
+    std::vector<std::thread> workers;
+
+    for (uint32_t w = 0; w < header->workerCount; w++) {
+        workers.push_back(std::thread(&EnvServer::work, this, w));
+    }
+
+    for (size_t w = 0; w < workers.size(); w++) {
+        workers[w].join();
+    }
+    header->serverRunning.store(0);
+}
+
+void EnvServer::stop() {
+    stopping.store(true);
+
+    for (uint32_t w = 0; w < header->workerCount; w++) {
+        header->bells[w].ring.fetch_add(1);
+        futexWake(header->bells[w].ring);
+    }
+}
+
+bool EnvServer::stepSlot(int index) {
+    EnvSlot &slot = slots[index];
+    uint32_t request = slot.request.load(std::memory_order_acquire);
+
+    if (request == slot.response.load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    chip8_env * env = envs[index];
+    if (slot.reset) {
+        chip8_reset(env);
+    }
+
+    chip8_step_batch(&env, &slot.action, 1, header->framesPerStep, &slot.reward, &slot.fault);
+    memcpy(slot.frame, chip8_frame(env), sizeof(slot.frame));
+
+    // Either we see the client waiting, or it sees the response before sleeping
+    slot.response.store(request, std::memory_order_seq_cst);
+    if (slot.clientWaiting.load(std::memory_order_seq_cst)) {
+        futexWake(slot.response);
+    }
+    return true;
+}
+
+void EnvServer::work(int worker) {
+    EnvWorkerBell &bell = header->bells[worker];
+    int spins = 0;
+
+    while (!stopping.load(std::memory_order_relaxed)) {
+        uint32_t rung = bell.ring.load(std::memory_order_acquire);
+        bool worked = false;
+
+        for (uint32_t i = worker; i < header->envCount; i += header->workerCount) {
+            worked |= stepSlot(i);
+        }
+
+        if (worked || ++spins < ENV_SPIN_ITERATIONS) {
+            spins = worked ? 0 : spins;
+            continue;
+        }
+
+        // Idle: sleep until a client rings, waking now and then to check for stop()
+        bell.sleeping.store(1, std::memory_order_seq_cst);
+        if (bell.ring.load(std::memory_order_seq_cst) == rung) {
+            futexWait(bell.ring, rung, 100);
+        }
+        bell.sleeping.store(0, std::memory_order_relaxed);
+        spins = 0;
+    }
+}
+
+EnvClient::EnvClient(const std::string &name) : bytes(0), header(nullptr), slots(nullptr) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0)
+        return;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(EnvShmHeader)) {
+        close(fd);
+        return;
+    }
+
+    void * memory = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED)
+        return;
+
+    EnvShmHeader * mapped = static_cast<EnvShmHeader *>(memory);
+    bytes = info.st_size;
+
+    bool compatible = mapped->magic == ENV_SHM_MAGIC
+        && mapped->version == ENV_PROTOCOL_VERSION
+        && mapped->headerBytes == sizeof(EnvShmHeader)
+        && mapped->slotBytes == sizeof(EnvSlot)
+        && bytes >= segmentBytes(mapped->envCount);
+
+    if (!compatible) {
+        munmap(memory, bytes);
+        return;
+    }
+
+    header = mapped;
+    slots = reinterpret_cast<EnvSlot *>(header + 1);
+    pendingBells.assign(header->workerCount, false);
+}
+
+EnvClient::~EnvClient() {
+    if (header != nullptr) {
+        munmap(header, bytes);
+    }
+}
+
+bool EnvClient::ok() const {
+    return header != nullptr;
+}
+
+int EnvClient::envCount() const {
+    return header->envCount;
+}
+
+void EnvClient::submit(int env, uint16_t action, bool reset) {
+    EnvSlot &slot = slots[env];
+    slot.action = action;
+    slot.reset = reset;
+    slot.request.fetch_add(1, std::memory_order_release);
+    pendingBells[env % header->workerCount] = true;
+}
+
+void EnvClient::flush() {
+    for (size_t w = 0; w < pendingBells.size(); w++) {
+        if (!pendingBells[w])
+            continue;
+
+        EnvWorkerBell &bell = header->bells[w];
+        bell.ring.fetch_add(1, std::memory_order_seq_cst);
+        if (bell.sleeping.load(std::memory_order_seq_cst)) {
+            futexWake(bell.ring);
+        }
+        pendingBells[w] = false;
+    }
+}
+
+void EnvClient::wait(int env) {
+    EnvSlot &slot = slots[env];
+    uint32_t request = slot.request.load(std::memory_order_relaxed);
+
+    for (int spin = 0; spin < ENV_SPIN_ITERATIONS; spin++) {
+        if (slot.response.load(std::memory_order_acquire) == request)
+            return;
+    }
+
+    for (;;) {
+        slot.clientWaiting.store(1, std::memory_order_seq_cst);
+        uint32_t response = slot.response.load(std::memory_order_seq_cst);
+
+        if (response == request || !header->serverRunning.load())
+            break;
+
+        futexWait(slot.response, response, 100);
+    }
+    slot.clientWaiting.store(0, std::memory_order_relaxed);
+}
+
+const uint64_t * EnvClient::frame(int env) const {
+    return slots[env].frame;
+}
+
+float EnvClient::reward(int env) const {
+    return slots[env].reward;
+}
+
+uint8_t EnvClient::fault(int env) const {
+    return slots[env].fault;
+}
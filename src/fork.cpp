@@ -0,0 +1,105 @@
+#include "fork.hpp"
+#include <cstring>
+
+static std::shared_ptr<const PackedDisplay> packDisplay(const Chip8 &sys) {
+    std::shared_ptr<PackedDisplay> packed = std::make_shared<PackedDisplay>();
+    memcpy(packed->rows, sys.displayRows, sizeof(packed->rows));
+    return packed;
+}
+
+static void unpackDisplay(const PackedDisplay &packed, Chip8 &sys) {
+    memcpy(sys.displayRows, packed.rows, sizeof(packed.rows));
+
+    for (int y = 0; y < CHIP8_SCREEN_HEIGHT; y++) {
+        for (int x = 0; x < CHIP8_SCREEN_WIDTH; x++) {
+            sys.displayBuffer[y][x] = (packed.rows[y] >> (CHIP8_SCREEN_WIDTH - 1 - x)) & 1;
+        }
+    }
+}
+
+Forker::Forker(Chip8 &sys) : sys(sys) {
+    // Everything is written once here; forks share these pages until they
+    // write them, so the ROM image is never copied again
+    sys.dirtyPages = (1 << CHIP8_PAGES) - 1;
+    sys.displayDirty = true;
+    base = fork();
+}
+
+void Forker::saveRegisters(MachineState &state) {
+    memcpy(state.variableRegisters, sys.variableRegisters, sizeof(state.variableRegisters));
+    memcpy(state.stack, sys.stack, sizeof(state.stack));
+    memcpy(state.keyState, sys.keyState, sizeof(state.keyState));
+    state.stackPointer = sys.stackPointer;
+    state.programCounter = sys.programCounter;
+    state.indexRegister = sys.indexRegister;
+    state.delayTimer = sys.delayTimer;
+    state.soundTimer = sys.soundTimer;
+    state.lastKey = sys.lastKey;
+    state.lastKeyFromBlock = sys.lastKeyFromBlock;
+    state.blockingForKey = sys.blockingForKey;
+    state.draw = sys.draw;
+    state.sound = sys.sound;
+    state.fault = sys.fault;
+    state.memoryFingerprint = sys.memoryFingerprint;
+    state.randomState = sys.randomState;
+}
+
+MachineState Forker::fork() {
+    MachineState state;
+
+    for (int p = 0; p < CHIP8_PAGES; p++) {
+        if (sys.dirtyPages & (1 << p)) {
+            std::shared_ptr<RamPage> page = std::make_shared<RamPage>();
+            memcpy(page->bytes, &sys.ram[p * CHIP8_PAGE_BYTES], CHIP8_PAGE_BYTES);
+            state.pages[p] = page;
+        } else {
+            state.pages[p] = base.pages[p];
+        }
+    }
+
+    state.display = sys.displayDirty ? packDisplay(sys) : base.display;
+    saveRegisters(state);
+
+    // The machine now matches the new state
+    base = state;
+    sys.dirtyPages = 0;
+    sys.displayDirty = false;
+
+    return state;
+}
+
+void Forker::restore(const MachineState &state) {
+    for (int p = 0; p < CHIP8_PAGES; p++) {
+        if (state.pages[p] == base.pages[p] && !(sys.dirtyPages & (1 << p))) {
+            continue;
+        }
+
+        memcpy(&sys.ram[p * CHIP8_PAGE_BYTES], state.pages[p]->bytes, CHIP8_PAGE_BYTES);
+        sys.fuseRange(p * CHIP8_PAGE_BYTES, CHIP8_PAGE_BYTES);
+    }
+
+    if (state.display != base.display || sys.displayDirty) {
+        unpackDisplay(*state.display, sys);
+    }
+
+    memcpy(sys.variableRegisters, state.variableRegisters, sizeof(state.variableRegisters));
+    memcpy(sys.stack, state.stack, sizeof(state.stack));
+    memcpy(sys.keyState, state.keyState, sizeof(state.keyState));
+    sys.stackPointer = state.stackPointer;
+    sys.programCounter = state.programCounter;
+    sys.indexRegister = state.indexRegister;
+    sys.delayTimer = state.delayTimer;
+    sys.soundTimer = state.soundTimer;
+    sys.lastKey = state.lastKey;
+    sys.lastKeyFromBlock = state.lastKeyFromBlock;
+    sys.blockingForKey = state.blockingForKey;
+    sys.draw = state.draw;
+    sys.sound = state.sound;
+    sys.fault = state.fault;
+    sys.memoryFingerprint = state.memoryFingerprint;
+    sys.randomState = state.randomState;
+
+    base = state;
+    sys.dirtyPages = 0;
+    sys.displayDirty = false;
+}
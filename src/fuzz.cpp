@@ -0,0 +1,74 @@
+#include "fuzz.hpp"
+#include <cstring>
+
+FuzzHarness::FuzzHarness() {
+    pristine.seedRandom(FUZZ_SEED);
+    pristine.dirtyPages = 0;
+    pristine.displayDirty = false;
+    sys = pristine;
+}
+
+void FuzzHarness::setProfile(Profile * profile) {
+    pristine.profile = profile;
+    sys.profile = profile;
+}
+
+long FuzzHarness::run(const uint8_t * data, size_t size) {
+    sys = pristine;
+
+    size_t events = 0;
+    if (size > 0)
+        events = data[0] % (FUZZ_MAX_KEY_EVENTS + 1);
+    if (1 + 2 * events > size)
+        events = size > 0 ? (size - 1) / 2 : 0;
+    const uint8_t * script = data + 1;
+
+    // Write only the ROM bytes into the pristine RAM, which is all zero
+    // there, so the fingerprint and fusion are updated for those alone
+    size_t skip = size > 0 ? 1 + 2 * events : 0;
+    size_t length = size - skip;
+    if (length > CHIP8_ROM_BYTES)
+        length = CHIP8_ROM_BYTES;
+    for (size_t i = 0; i < length; i++) {
+        if (data[skip + i] != 0)
+            sys.writeRam(0x200 + i, data[skip + i]);
+    }
+    sys.fuseRange(0x200, length);
+
+    long executed = 0;
+    for (size_t e = 0; e <= events; e++) {
+        long until = (e < events) ? executed + script[2 * e] * FUZZ_KEY_STEP : FUZZ_INSTRUCTIONS;
+        if (until > FUZZ_INSTRUCTIONS)
+            until = FUZZ_INSTRUCTIONS;
+
+        int want = (int) (until - executed);
+        int ran = sys.run(want);
+        executed += ran;
+        if (ran < want || executed >= FUZZ_INSTRUCTIONS)
+            break;
+
+        byte key = script[2 * e + 1];
+        if (key & 0x10)
+            sys.pressKey(key & 0x0F);
+        else
+            sys.releaseKey(key & 0x0F);
+    }
+    return executed;
+}
+
+std::string FuzzHarness::checkInvariants() const {
+    if (sys.stackPointer > CHIP8_STACK_HEIGHT)
+        return "stack pointer past the stack";
+    if (sys.fault != FAULT_NONE && sys.crash.fault != sys.fault)
+        return "crash snapshot does not match the fault";
+
+    // The packed rows must agree with the byte display
+    for (int y = 0; y < CHIP8_SCREEN_HEIGHT; y++) {
+        uint64_t row = 0;
+        for (int x = 0; x < CHIP8_SCREEN_WIDTH; x++)
+            row = (row << 1) | (sys.displayBuffer[y][x] & 1);
+        if (row != sys.displayRows[y])
+            return "display row " + std::to_string(y) + " differs from the display buffer";
+    }
+    return "";
+}
@@ -0,0 +1,53 @@
+#include "governor.hpp"
+#include <sstream>
+
+FrameGovernor::FrameGovernor(long frameMicroseconds)
+    : visible(true), presents(0), skippedBehind(0), skippedHidden(0), backlogs(0),
+      droppedMicroseconds(0), averageCost(0), frameMicroseconds(frameMicroseconds),
+      consecutiveSkips(0) {
+}
+
+void FrameGovernor::setVisible(bool visible) {
+    this->visible = visible;
+}
+
+bool FrameGovernor::shouldPresent(long long lateMicroseconds) {
+    if (!visible) {
+        skippedHidden++;
+        return false;
+    }
+
+    if (lateMicroseconds + averageCost > frameMicroseconds && consecutiveSkips < GOVERNOR_MAX_SKIP) {
+        skippedBehind++;
+        consecutiveSkips++;
+        return false;
+    }
+
+    consecutiveSkips = 0;
+    return true;
+}
+
+void FrameGovernor::presented(long long microseconds) {
+    presents++;
+
+    // The first present seeds the average
+    if (presents == 1)
+        averageCost = microseconds;
+    else
+        averageCost += (microseconds - averageCost) / GOVERNOR_COST_WEIGHT;
+}
+
+void FrameGovernor::droppedBacklog(long long microseconds) {
+    backlogs++;
+    droppedMicroseconds += microseconds;
+}
+
+std::string FrameGovernor::summary() const {
+    std::ostringstream out;
+    out << "Presented " << presents << " frames, skipped " << skippedBehind
+        << " behind schedule and " << skippedHidden << " while hidden";
+    out << "; present cost " << averageCost << " us";
+    if (backlogs > 0)
+        out << "; dropped " << droppedMicroseconds / 1000 << " ms of emulation in " << backlogs << " stalls";
+    return out.str();
+}
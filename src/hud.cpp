@@ -0,0 +1,166 @@
+#include "hud.hpp"
+#include <cstdio>
+#include <cstring>
+
+#define GLYPH_SCALE 2
+#define GLYPH_ADVANCE 8
+#define LINE_HEIGHT 12
+#define HEAT_CELL 2
+#define HEAT_TOP 176
+#define HEAT_LEFT ((HUD_WIDTH - CHIP8_SCREEN_WIDTH * HEAT_CELL) / 2)
+#define HISTOGRAM_TOP 30
+#define HISTOGRAM_HEIGHT 32
+#define WARNING_COLOUR 0xFFFF5555
+#define GRID_COLOUR 0xFF202020
+
+// 3x5 glyphs, rows top to bottom, '1' for a lit pixel
+struct Glyph {
+    char c;
+    const char * rows;
+};
+
+static const Glyph font[] = {
+    {'0', "111101101101111"}, {'1', "010110010010111"}, {'2', "111001111100111"},
+    {'3', "111001111001111"}, {'4', "101101111001001"}, {'5', "111100111001111"},
+    {'6', "111100111101111"}, {'7', "111001010010010"}, {'8', "111101111101111"},
+    {'9', "111101111001111"}, {'A', "010101111101101"}, {'B', "110101110101110"},
+    {'C', "011100100100011"}, {'D', "110101101101110"}, {'E', "111100110100111"},
+    {'F', "111100110100100"}, {'G', "011100101101011"}, {'H', "101101111101101"},
+    {'I', "111010010010111"}, {'J', "001001001101010"}, {'K', "101101110101101"},
+    {'L', "100100100100111"}, {'M', "101111111101101"}, {'N', "110101101101101"},
+    {'O', "010101101101010"}, {'P', "110101110100100"}, {'Q', "010101101110011"},
+    {'R', "110101110101101"}, {'S', "011100010001110"}, {'T', "111010010010010"},
+    {'U', "101101101101111"}, {'V', "101101101101010"}, {'W', "101101111111101"},
+    {'X', "101101010101101"}, {'Y', "101101010010010"}, {'Z', "111001010100111"},
+    {'.', "000000000000010"}, {'%', "101001010100101"}, {'/', "001001010100100"},
+    {':', "000010000010000"}, {'=', "000111000111000"}, {'-', "000000111000000"},
+};
+
+static uint32_t * row(void * pixels, int pitch, int y) {
+    return (uint32_t *) ((uint8_t *) pixels + y * pitch);
+}
+
+static void fillRect(void * pixels, int pitch, int x, int y, int w, int h, uint32_t colour) {
+    for (int j = y; j < y + h && j < HUD_HEIGHT; j++) {
+        uint32_t * line = row(pixels, pitch, j);
+        for (int i = x; i < x + w && i < HUD_WIDTH; i++)
+            line[i] = colour;
+    }
+}
+
+// Upper case only; anything without a glyph is left blank
+static void drawText(void * pixels, int pitch, int x, int y, const char * text, uint32_t colour) {
+    for (; *text != 0 && x < HUD_WIDTH; text++, x += GLYPH_ADVANCE) {
+        for (size_t g = 0; g < sizeof(font) / sizeof(font[0]); g++) {
+            if (font[g].c != *text)
+                continue;
+            for (int p = 0; p < 15; p++) {
+                if (font[g].rows[p] == '1')
+                    fillRect(pixels, pitch, x + p % 3 * GLYPH_SCALE, y + p / 3 * GLYPH_SCALE,
+                             GLYPH_SCALE, GLYPH_SCALE, colour);
+            }
+        }
+    }
+}
+
+// 0 to 255, saturating smoothly so a few accesses still show
+static uint32_t intensity(float heat) {
+    return (uint32_t) (255.0f * heat / (heat + 4.0f));
+}
+
+Hud::Hud(uint32_t foreground, uint32_t background)
+    : instructionsPerSecond(0), hostFrameMilliseconds(0), emulatedFrameMilliseconds(0),
+      sprites(0), presents(0), hotCount(0), foreground(foreground), background(background),
+      rateInstructions(0), rateMilliseconds(0) {
+    memset(histogram, 0, sizeof(histogram));
+    memset(readHeat, 0, sizeof(readHeat));
+    memset(writeHeat, 0, sizeof(writeHeat));
+    memset(pcHeat, 0, sizeof(pcHeat));
+}
+
+void Hud::sample(Profile &profile, double hostMilliseconds, int presents) {
+    this->presents = presents;
+    hostFrameMilliseconds = hostMilliseconds;
+    emulatedFrameMilliseconds = profile.instructions * 1000.0 / HUD_CLOCK_HZ;
+    sprites = profile.sprites;
+
+    rateInstructions += profile.instructions;
+    rateMilliseconds += hostMilliseconds;
+    if (rateMilliseconds >= HUD_RATE_MILLISECONDS) {
+        instructionsPerSecond = rateInstructions * 1000.0 / rateMilliseconds;
+        rateInstructions = 0;
+        rateMilliseconds = 0;
+    }
+
+    for (int b = 0; b < HUD_HISTOGRAM_BUCKETS; b++)
+        histogram[b] *= HUD_HISTOGRAM_FADE;
+    int bucket = (int) (hostMilliseconds / HUD_BUCKET_MILLISECONDS);
+    histogram[bucket < HUD_HISTOGRAM_BUCKETS ? bucket : HUD_HISTOGRAM_BUCKETS - 1] += 1.0f;
+
+    // One pass over the counters: fade, add and keep the hottest PCs
+    hotCount = 0;
+    float total = 0;
+    for (int a = 0; a < CHIP8_RAM_BYTES; a++) {
+        readHeat[a] = readHeat[a] * HUD_HEAT_FADE + profile.reads[a];
+        writeHeat[a] = writeHeat[a] * HUD_HEAT_FADE + profile.writes[a];
+        float heat = pcHeat[a] * HUD_PC_FADE + profile.pcHits[a];
+        pcHeat[a] = heat;
+        total += heat;
+
+        if (heat < 0.5f || (hotCount == HUD_HOT_PCS && heat <= hotShares[HUD_HOT_PCS - 1]))
+            continue;
+        int i = hotCount < HUD_HOT_PCS ? hotCount++ : HUD_HOT_PCS - 1;
+        for (; i > 0 && hotShares[i - 1] < heat; i--) {
+            hotPcs[i] = hotPcs[i - 1];
+            hotShares[i] = hotShares[i - 1];
+        }
+        hotPcs[i] = a;
+        hotShares[i] = heat;
+    }
+    for (int i = 0; i < hotCount; i++)
+        hotShares[i] /= total;
+
+    memset(&profile, 0, sizeof(profile));
+}
+
+void Hud::render(void * pixels, int pitch) const {
+    char line[32];
+    fillRect(pixels, pitch, 0, 0, HUD_WIDTH, HUD_HEIGHT, background);
+
+    snprintf(line, sizeof(line), "IPS %.0f", instructionsPerSecond);
+    drawText(pixels, pitch, 4, 4, line, foreground);
+    snprintf(line, sizeof(line), "HOST %.1f EMU %.1f MS", hostFrameMilliseconds, emulatedFrameMilliseconds);
+    drawText(pixels, pitch, 4, 4 + LINE_HEIGHT, line, foreground);
+
+    // Host frame times; buckets past the 60 Hz budget in red
+    float tallest = 0;
+    for (int b = 0; b < HUD_HISTOGRAM_BUCKETS; b++)
+        tallest = histogram[b] > tallest ? histogram[b] : tallest;
+    int barWidth = (HUD_WIDTH - 8) / HUD_HISTOGRAM_BUCKETS;
+    for (int b = 0; b < HUD_HISTOGRAM_BUCKETS && tallest > 0; b++) {
+        int height = (int) (HISTOGRAM_HEIGHT * histogram[b] / tallest + 0.5f);
+        bool late = b * HUD_BUCKET_MILLISECONDS > 1000.0 / 60;
+        fillRect(pixels, pitch, 4 + b * barWidth, HISTOGRAM_TOP + HISTOGRAM_HEIGHT - height,
+                 barWidth - 2, height, late ? WARNING_COLOUR : foreground);
+    }
+
+    int y = HISTOGRAM_TOP + HISTOGRAM_HEIGHT + 6;
+    snprintf(line, sizeof(line), "DXYN %llu PRESENTS %d", (unsigned long long) sprites, presents);
+    drawText(pixels, pitch, 4, y, line, foreground);
+
+    y += LINE_HEIGHT + 4;
+    drawText(pixels, pitch, 4, y, "HOT PCS", foreground);
+    for (int i = 0; i < hotCount; i++) {
+        y += LINE_HEIGHT;
+        snprintf(line, sizeof(line), "%03X %5.1f%%", hotPcs[i], hotShares[i] * 100);
+        drawText(pixels, pitch, 12, y, line, foreground);
+    }
+
+    // RAM, 64 bytes per row: reads green, writes red
+    drawText(pixels, pitch, 4, HEAT_TOP - LINE_HEIGHT - 2, "RAM READ/WRITE", foreground);
+    for (int a = 0; a < CHIP8_RAM_BYTES; a++) {
+        uint32_t colour = 0xFF000000 | intensity(writeHeat[a]) << 16 | intensity(readHeat[a]) << 8;
+        fillRect(pixels, pitch, HEAT_LEFT + a % 64 * HEAT_CELL, HEAT_TOP + a / 64 * HEAT_CELL,
+                 HEAT_CELL, HEAT_CELL, colour == 0xFF000000 ? GRID_COLOUR : colour);
+    }
+}
@@ -0,0 +1,171 @@
+#include "libchip8.h"
+#include "chip8.hpp"
+#include "visited.hpp"
+#include <cstring>
+#include <new>
+#include <vector>
+
+struct chip8_env {
+    Chip8 sys;
+    std::vector<byte> rom;
+    int cyclesPerFrame;
+    word keys;
+    chip8_reward_term terms[CHIP8_MAX_REWARD_TERMS];
+    int termCount;
+    long score;
+    bool seeded;
+    uint32_t seed;
+};
+
+struct chip8_visited {
+    VisitedSet set;
+
+    chip8_visited(size_t capacity) : set(capacity) {}
+};
+
+static long readScore(const chip8_env * env) {
+    long score = 0;
+
+    for (int i = 0; i < env->termCount; i++) {
+        const chip8_reward_term &term = env->terms[i];
+        const byte * ram = env->sys.ram;
+        word a = term.address & (CHIP8_RAM_BYTES - 1);
+        long value = ram[a];
+
+        if (term.kind == CHIP8_REWARD_BCD) {
+            value = 100 * ram[a]
+                + 10 * ram[(a + 1) & (CHIP8_RAM_BYTES - 1)]
+                + ram[(a + 2) & (CHIP8_RAM_BYTES - 1)];
+        }
+        score += term.weight * value;
+    }
+
+    return score;
+}
+
+// Press or release only the keys whose state changed
+static void applyKeys(chip8_env * env, word keys) {
+    word changed = keys ^ env->keys;
+
+    for (int k = 0; changed != 0; k++, changed >>= 1) {
+        if (!(changed & 1))
+            continue;
+
+        if (keys & (1 << k))
+            env->sys.pressKey(k);
+        else
+            env->sys.releaseKey(k);
+    }
+    env->keys = keys;
+}
+
+extern "C" {
+
+int chip8_abi_version(void) {
+    return CHIP8_ABI_VERSION;
+}
+
+chip8_env * chip8_create(const uint8_t * rom, size_t size) {
+    if (size > CHIP8_ROM_BYTES)
+        return nullptr;
+
+    chip8_env * env = new (std::nothrow) chip8_env();
+    if (env == nullptr)
+        return nullptr;
+
+    env->rom.assign(CHIP8_ROM_BYTES, 0);
+    memcpy(env->rom.data(), rom, size);
+    env->cyclesPerFrame = CHIP8_DEFAULT_CYCLES_PER_FRAME;
+    env->termCount = 0;
+    env->seeded = false;
+
+    chip8_reset(env);
+    return env;
+}
+
+void chip8_destroy(chip8_env * env) {
+    delete env;
+}
+
+void chip8_reset(chip8_env * env) {
+    env->sys.reset();
+    env->sys.load(env->rom.data());
+    if (env->seeded)
+        env->sys.seedRandom(env->seed);
+    env->keys = 0;
+    env->score = readScore(env);
+}
+
+void chip8_seed(chip8_env * env, uint32_t seed) {
+    env->seeded = true;
+    env->seed = seed;
+    env->sys.seedRandom(seed);
+}
+
+void chip8_set_cycles_per_frame(chip8_env * env, int cycles) {
+    env->cyclesPerFrame = cycles > 0 ? cycles : 1;
+}
+
+int chip8_set_reward(chip8_env * env, const chip8_reward_term * terms, int count) {
+    if (count < 0 || count > CHIP8_MAX_REWARD_TERMS)
+        return -1;
+
+    memcpy(env->terms, terms, count * sizeof(chip8_reward_term));
+    env->termCount = count;
+    env->score = readScore(env);
+    return 0;
+}
+
+void chip8_step_batch(chip8_env ** envs, const uint16_t * actions, int n, int frames,
+                      float * rewards, uint8_t * faults) {
+    for (int i = 0; i < n; i++) {
+        chip8_env * env = envs[i];
+        Chip8 &sys = env->sys;
+
+        applyKeys(env, actions[i]);
+
+        if (sys.fault == FAULT_NONE) {
+            sys.run(frames * env->cyclesPerFrame);
+        }
+
+        if (rewards != nullptr) {
+            long score = readScore(env);
+            rewards[i] = (float) (score - env->score);
+            env->score = score;
+        }
+
+        if (faults != nullptr) {
+            faults[i] = sys.fault;
+        }
+    }
+}
+
+const uint64_t * chip8_frame(const chip8_env * env) {
+    return env->sys.displayRows;
+}
+
+const uint8_t * chip8_ram(const chip8_env * env) {
+    return env->sys.ram;
+}
+
+uint64_t chip8_fingerprint(const chip8_env * env) {
+    return env->sys.fingerprint();
+}
+
+chip8_visited * chip8_visited_create(size_t capacity) {
+    return new (std::nothrow) chip8_visited(capacity);
+}
+
+void chip8_visited_destroy(chip8_visited * set) {
+    delete set;
+}
+
+int chip8_visited_insert(chip8_visited * set, uint64_t fingerprint) {
+    return set->set.insert(fingerprint);
+}
+
+size_t chip8_visited_size(const chip8_visited * set) {
+    return set->set.size();
+}
+
+}
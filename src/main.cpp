@@ -1,25 +1,62 @@
 #include "chip8.hpp"
+#include "tracer.hpp"
+#include "recorder.hpp"
+#include "scaler.hpp"
+#include "hud.hpp"
+#include "metrics.hpp"
+#include "netplay.hpp"
+#include "xochip.hpp"
+#include "governor.hpp"
+#include "wall.hpp"
+#include "romfile.hpp"
+#include "probes.hpp"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_mixer.h>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <chrono>
 #include <string>
+#include <vector>
+#include <iterator>
+#include <thread>
 
 #define SCREEN_WIDTH 		640
 #define SCREEN_HEIGHT 		320
 #define SIDEBAR_WIDTH 		200
 #define PIXEL_LENGTH 		10
 #define CYCLE_MICROSECONDS 	1429
-#define OFF_COLOUR			0x00, 0x00, 0x00
-#define ON_COLOUR			0x00, 0xFF, 0x55
+#define FRAME_MICROSECONDS 	16667
+#define OFF_COLOUR			0xFF000000
+#define ON_COLOUR			0xFF00FF55
+#define HUD_BACKGROUND		0xFF101010
+#define XO_DEFAULT_IPF		200
+#define WALL_SCALE			2
+#define FOCUS_COLOUR		0xFFFFFFFF
 
 using std::ios_base;
 
 struct ChipFrontend {
 	bool active;
 	Mix_Chunk * beep_sfx;
-	SDL_Rect pixels[32][64];
+	SDL_Renderer * renderer;
+	SDL_Texture * texture;
+	int textureScale;
+	Scaler * scaler;
+	Hud * hud;
+	SDL_Texture * hudTexture;
+	Profile * profile;
+	bool showHud;
+	int presents;
+	Metrics * metrics;
+	FrameGovernor * governor;
+	const char * metricsTarget;
+	const char * netplayTarget;
+	const char * traceFile;
+	const char * recordFile;
+	int xoInstructionsPerFrame;
+	int wallTiles;
+	bool quit;
 };
 
 ChipFrontend fe {
@@ -27,46 +64,86 @@ ChipFrontend fe {
 	nullptr,
 };
 
-byte * loadFileBuf(const std::string &filename) {
-	byte * fileBuf = new byte[CHIP8_ROM_BYTES];
-	std::ifstream in(filename, ios_base::in | ios_base::binary);
 
-	do {
-		in.read((char *) fileBuf, CHIP8_ROM_BYTES);
-	} while (in.gcount() > 0);
+// Scale the display into a streaming texture as large as the window allows
+// and present it centred, with the HUD in the sidebar if shown
+void drawFromChip(Chip8 *sys, SDL_Window *window)
+{
+	sys->draw = false;
+	fe.presents++;
+
+	int windowWidth, windowHeight;
+	SDL_GetWindowSize(window, &windowWidth, &windowHeight);
+	if (fe.showHud)
+		windowWidth -= SIDEBAR_WIDTH;
+	int scale = Scaler::fitScale(CHIP8_SCREEN_WIDTH, CHIP8_SCREEN_HEIGHT, windowWidth, windowHeight);
+	int width = CHIP8_SCREEN_WIDTH * scale;
+	int height = CHIP8_SCREEN_HEIGHT * scale;
+
+	if (fe.texture == nullptr || fe.textureScale != scale) {
+		if (fe.texture != nullptr)
+			SDL_DestroyTexture(fe.texture);
+		fe.texture = SDL_CreateTexture(fe.renderer, SDL_PIXELFORMAT_ARGB8888,
+			SDL_TEXTUREACCESS_STREAMING, width, height);
+		fe.textureScale = scale;
+	}
 
-	return fileBuf;
-}
+	void * pixels;
+	int pitch;
+	if (SDL_LockTexture(fe.texture, nullptr, &pixels, &pitch) == 0) {
+		fe.scaler->render(sys->displayRows, CHIP8_SCREEN_WIDTH, CHIP8_SCREEN_HEIGHT, scale, pixels, pitch);
+		SDL_UnlockTexture(fe.texture);
+	}
 
+	SDL_Rect target = { (windowWidth - width) / 2, (windowHeight - height) / 2, width, height };
+	SDL_SetRenderDrawColor(fe.renderer, 0x00, 0x00, 0x00, 0xFF);
+	SDL_RenderClear(fe.renderer);
+	SDL_RenderCopy(fe.renderer, fe.texture, nullptr, &target);
+	int copies = 1;
+	if (fe.showHud && fe.hudTexture != nullptr) {
+		SDL_Rect sidebar = { windowWidth, 0, HUD_WIDTH, HUD_HEIGHT };
+		SDL_RenderCopy(fe.renderer, fe.hudTexture, nullptr, &sidebar);
+		copies++;
+	}
+	SDL_RenderPresent(fe.renderer);
 
-void configurePixels(SDL_Rect pixels[32][64], int pixLength)
+	if (fe.metrics != nullptr) {
+		fe.metrics->framesPresented.add();
+		fe.metrics->drawCalls.add(copies);
+	}
+}
+
+// Take a frame's counters and redraw the HUD texture. Called once per
+// frame so the overlay costs the same however busy the ROM is; the next
+// governed present shows it.
+void updateHud(double frameMilliseconds)
 {
-    for (int y = 0; y < CHIP8_SCREEN_HEIGHT; y++) {
-        for (int x = 0; x < CHIP8_SCREEN_WIDTH; x++) {
-            pixels[y][x] = {x * pixLength, y * pixLength, pixLength, pixLength};
-        }
-    }
+	fe.hud->sample(*fe.profile, frameMilliseconds, fe.presents);
+	fe.presents = 0;
+
+	if (fe.hudTexture == nullptr) {
+		fe.hudTexture = SDL_CreateTexture(fe.renderer, SDL_PIXELFORMAT_ARGB8888,
+			SDL_TEXTUREACCESS_STREAMING, HUD_WIDTH, HUD_HEIGHT);
+	}
+
+	void * pixels;
+	int pitch;
+	if (SDL_LockTexture(fe.hudTexture, nullptr, &pixels, &pitch) == 0) {
+		fe.hud->render(pixels, pitch);
+		SDL_UnlockTexture(fe.hudTexture);
+	}
 }
 
-void drawFromChip(Chip8 *sys, SDL_Surface *surface, SDL_Rect pixels[32][64])
+// Show or hide the sidebar, widening or narrowing the window to match
+void toggleHud(Chip8 *sys, SDL_Window *window)
 {
-    sys->draw = false;
-
-    for (int y = 0; y < CHIP8_SCREEN_HEIGHT; y++) {
-        for (int x = 0; x < CHIP8_SCREEN_WIDTH; x++) {
-            byte draw = sys->displayBuffer[y][x];
-
-            if (draw == 0) {
-                SDL_FillRect(surface,
-                    &pixels[y][x],
-                    SDL_MapRGB(surface->format, OFF_COLOUR));
-            } else {
-                SDL_FillRect(surface,
-                    &pixels[y][x],
-                    SDL_MapRGB(surface->format, ON_COLOUR));
-            }
-		}
-    }
+	fe.showHud ^= 1;
+	sys->profile = fe.showHud ? fe.profile : nullptr;
+
+	int windowWidth, windowHeight;
+	SDL_GetWindowSize(window, &windowWidth, &windowHeight);
+	SDL_SetWindowSize(window, windowWidth + (fe.showHud ? SIDEBAR_WIDTH : -SIDEBAR_WIDTH), windowHeight);
+	sys->draw = true;
 }
 
 
@@ -78,171 +155,118 @@ void printCurrentInstruction(Chip8 *sys)
     std::cerr << std::hex << instr << std::endl;
 }
 
-void handleKeyDown(SDL_Event * e, Chip8 * sys) {
-
-	if (sys->blockingForKey)
-		sys->lastKeyFromBlock = true;
+// Print the crash snapshot and pause; stepping retries the faulting opcode
+void reportFault(Chip8 *sys)
+{
+	std::cerr << "Fault: " << sys->crash.toJson() << std::endl;
+	fe.active = false;
+	if (fe.metrics != nullptr)
+		fe.metrics->fault(sys->fault);
+}
 
-	switch (e->key.keysym.sym) {
+// The keypad key an SDL key stands for, or -1 if it is not on the keypad
+int keypadKey(SDL_Keycode sym) {
+	switch (sym) {
 
 		// Row 1:  1234 -> 123C
-
-		case SDLK_1:
-			sys->keyState[0x1] = 1;
-			sys->lastKey = 0x1;
-			break;
-		case SDLK_2:
-			sys->keyState[0x2] = 1;
-			sys->lastKey = 0x2;
-			break;
-		case SDLK_3:
-			sys->keyState[0x3] = 1;
-			sys->lastKey = 0x3;
-			break;
-		case SDLK_4:
-			sys->keyState[0xC] = 1;
-			sys->lastKey = 0xC;
-			break;
+		case SDLK_1:	return 0x1;
+		case SDLK_2:	return 0x2;
+		case SDLK_3:	return 0x3;
+		case SDLK_4:	return 0xC;
 
 		// Row 2: QWER -> 456D
-
-		case SDLK_q:
-			sys->keyState[0x4] = 1;
-			sys->lastKey = 0x4;
-			break;
-		case SDLK_w:
-			sys->keyState[0x5] = 1;
-			sys->lastKey = 0x5;
-			break;
-		case SDLK_e:
-			sys->keyState[0x6] = 1;
-			sys->lastKey = 0x6;
-			break;
-		case SDLK_r:
-			sys->keyState[0xD] = 1;
-			sys->lastKey = 0xD;
-			break;
+		case SDLK_q:	return 0x4;
+		case SDLK_w:	return 0x5;
+		case SDLK_e:	return 0x6;
+		case SDLK_r:	return 0xD;
 
 		// Row 3: ASDF -> 789E
-
-		case SDLK_a:
-			sys->keyState[0x7] = 1;
-			sys->lastKey = 0x7;
-			break;
-		case SDLK_s:
-			sys->keyState[0x8] = 1;
-			sys->lastKey = 0x8;
-			break;
-		case SDLK_d:
-			sys->keyState[0x9] = 1;
-			sys->lastKey = 0x9;
-			break;
-		case SDLK_f:
-			sys->keyState[0xE] = 1;
-			sys->lastKey = 0xE;
-			break;
+		case SDLK_a:	return 0x7;
+		case SDLK_s:	return 0x8;
+		case SDLK_d:	return 0x9;
+		case SDLK_f:	return 0xE;
 
 		// Row 4: ZXCV -> A0BF
+		case SDLK_z:	return 0xA;
+		case SDLK_x:	return 0x0;
+		case SDLK_c:	return 0xB;
+		case SDLK_v:	return 0xF;
+	}
+	return -1;
+}
 
-		case SDLK_z:
-			sys->keyState[0xA] = 1;
-			sys->lastKey = 0xA;
-			break;
-		case SDLK_x:
-			sys->keyState[0x0] = 1;
-			sys->lastKey = 0x0;
-			break;
-		case SDLK_c:
-			sys->keyState[0xB] = 1;
-			sys->lastKey = 0xB;
-			break;
-		case SDLK_v:
-			sys->keyState[0xF] = 1;
-			sys->lastKey = 0xF;
-			break;
-		default:
-			// The user pressed a key not on the Chip8 keypad
-			// So we don't track it for GETKEY purposes
-			sys->lastKeyFromBlock = false;
-			break;
+// The keypad and the controls every mode has: pause and quit. The XO-CHIP
+// and wall modes, whose sys only holds keys, use just this.
+void handleKeypadDown(SDL_Event * e, Chip8 * sys) {
+
+	int key = keypadKey(e->key.keysym.sym);
+	if (key >= 0) {
+		sys->pressKey(key);
+	} else {
+		// The user pressed a key not on the Chip8 keypad
+		// So we don't track it for GETKEY purposes
+		sys->lastKeyFromBlock = false;
 	}
-	
-	// Interpreter frontend controls
+
 	switch (e->key.keysym.sym) {
 		case SDLK_SPACE:
 			fe.active ^= 1;
 			break;
-		case SDLK_PERIOD:
-            printCurrentInstruction(sys);
-			sys->cycle();
-			break;
 		case SDLK_ESCAPE:
-			exit(0);
+			// Leave the main loop so an open trace is flushed
+			fe.quit = true;
 			break;
 	}
 }
 
+void handleKeyDown(SDL_Event * e, Chip8 * sys, SDL_Window * window) {
+	handleKeypadDown(e, sys);
 
-void handleKeyUp(SDL_Event * e, Chip8 * sys) {
+	// Controls for the machine emulate() runs and the window it draws
 	switch (e->key.keysym.sym) {
-		case SDLK_1:
-			sys->keyState[0x1] = 0;
-			break;
-		case SDLK_2:
-			sys->keyState[0x2] = 0;
+		case SDLK_PERIOD:
+            printCurrentInstruction(sys);
+			if (sys->cycle() != FAULT_NONE)
+				reportFault(sys);
 			break;
-		case SDLK_3:
-			sys->keyState[0x3] = 0;
+		case SDLK_TAB:
+			fe.scaler->filter = (ScaleFilter) ((fe.scaler->filter + 1) % SCALE_FILTERS);
+			std::cerr << "Filter: " << scaleFilterName(fe.scaler->filter) << std::endl;
+			sys->draw = true;
 			break;
-		case SDLK_4:
-			sys->keyState[0xC]= 0;
+		case SDLK_F1:
+			toggleHud(sys, window);
 			break;
+	}
+}
 
-		case SDLK_q:
-			sys->keyState[0x4] = 0;
-			break;
-		case SDLK_w:
-			sys->keyState[0x5] = 0;
-			break;
-		case SDLK_e:
-			sys->keyState[0x6] = 0;
-			break;
-		case SDLK_r:
-			sys->keyState[0xD] = 0;
-			break;
 
-		case SDLK_a:
-			sys->keyState[0x7] = 0;
-			break;
-		case SDLK_s:
-			sys->keyState[0x8] = 0;
+// Hidden and minimized windows present nothing until shown again
+void handleWindowEvent(SDL_Event * e, Chip8 * sys) {
+	switch (e->window.event) {
+		case SDL_WINDOWEVENT_HIDDEN:
+		case SDL_WINDOWEVENT_MINIMIZED:
+			fe.governor->setVisible(false);
 			break;
-		case SDLK_d:
-			sys->keyState[0x9] = 0;
-			break;
-		case SDLK_f:
-			sys->keyState[0xE] = 0;
-			break;
-
-		case SDLK_z:
-			sys->keyState[0xA] = 0;
-			break;
-		case SDLK_x:
-			sys->keyState[0x0] = 0;
-			break;
-		case SDLK_c:
-			sys->keyState[0xB] = 0;
-			break;
-		case SDLK_v:
-			sys->keyState[0xF] = 0;
-			break;
-		default:
+		case SDL_WINDOWEVENT_SHOWN:
+		case SDL_WINDOWEVENT_RESTORED:
+		case SDL_WINDOWEVENT_MAXIMIZED:
+		case SDL_WINDOWEVENT_EXPOSED:
+			fe.governor->setVisible(true);
 			break;
 	}
+
+	// Redraw at the new size
+	sys->draw = true;
 }
 
-void emulate(SDL_Window * window, SDL_Surface * surface, const char * filename) {
-	SDL_UpdateWindowSurface(window);
+void handleKeyUp(SDL_Event * e, Chip8 * sys) {
+	int key = keypadKey(e->key.keysym.sym);
+	if (key >= 0)
+		sys->releaseKey(key);
+}
+
+void emulate(SDL_Window * window, const char * filename) {
 
 	SDL_Event e;
 	bool running = true;
@@ -250,52 +274,424 @@ void emulate(SDL_Window * window, SDL_Surface * surface, const char * filename)
 	auto now = last;
 
 	Chip8 * sys = new Chip8();
-	sys->load(loadFileBuf(filename));
+	std::vector<byte> rom = loadRom(filename);
+	if (rom.empty()) {
+		std::cerr << "Could not read " << filename << std::endl;
+		exit(1);
+	}
+	sys->load(rom.data());
+
+	Tracer * tracer = nullptr;
+	if (fe.traceFile != nullptr) {
+		tracer = new Tracer(fe.traceFile);
+		if (!tracer->ok())
+			std::cerr << "Could not write " << fe.traceFile << std::endl;
+		sys->tracer = tracer;
+	}
 
-	int pixLength = 10;
+	// The display is sampled once per video tick while recording
+	Recorder * recorder = nullptr;
+	auto recordStart = std::chrono::steady_clock::now();
+	long recordedTicks = 0;
+	if (fe.recordFile != nullptr) {
+		recorder = new Recorder(fe.recordFile);
+	}
 
-	// Set up pixel rectangles: 64x32 10x10px rectangles.
-    configurePixels(fe.pixels, pixLength);
+	// Counters for the HUD, which samples them once per frame
+	fe.profile = new Profile();
+	if (fe.showHud)
+		sys->profile = fe.profile;
+	auto frameStart = std::chrono::steady_clock::now();
+
+	// With netplay, sys only holds the local keys and the shared session
+	// runs one frame per 60 Hz tick instead
+	NetplayLink * link = nullptr;
+	Netplay * netplay = nullptr;
+	if (fe.netplayTarget != nullptr) {
+		std::string target = fe.netplayTarget;
+		std::string host = target.substr(0, target.find(':'));
+		int port = atoi(target.substr(target.find(':') + 1).c_str());
+
+		link = new NetplayLink(host == "host" ? port : 0);
+		if (!link->ok() || (host != "host" && !link->connect(host, port))) {
+			std::cout << "Could not start netplay with " << target << std::endl;
+			exit(1);
+		}
+		netplay = new Netplay(*link, rom, host == "host");
+	}
+
+	sys->draw = true;
 
     while (running) {
 
-		SDL_PollEvent(&e);
+		while (SDL_PollEvent(&e)) {
+			if (e.type == SDL_QUIT) {
+				running = false;
+			}
 
-		if (e.type == SDL_QUIT) {
-			running = false;
-		}
+			if (e.type == SDL_KEYDOWN) {
+				handleKeyDown(&e, sys, window);
+			}
+
+			if (e.type == SDL_KEYUP) {
+				handleKeyUp(&e, sys);
+			}
 
-		if (e.type == SDL_KEYDOWN) {
-			handleKeyDown(&e, sys);
+			if (e.type == SDL_WINDOWEVENT) {
+				handleWindowEvent(&e, sys);
+			}
 		}
 
-		if (e.type == SDL_KEYUP) {
-			handleKeyUp(&e, sys);
+		if (fe.quit) {
+			running = false;
 		}
 
-		// Check time
-		auto elapsed = std::chrono::high_resolution_clock::now() - last;
-		auto elapsedMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+		// Run every cycle due at 700 Hz since the last pass, however long
+		// presenting took, unless so far behind that it is better dropped,
+		now = std::chrono::high_resolution_clock::now();
+		long long behind = std::chrono::duration_cast<std::chrono::microseconds>(now - last).count();
+		if (!fe.active || netplay != nullptr) {
+			last = now;
+		} else if (behind > GOVERNOR_MAX_CATCH_UP_MICROSECONDS) {
+			fe.governor->droppedBacklog(behind);
+			last = now;
+		}
 
-		// If unpaused and a 700th of a second has passed, run next cycle on Chip8
-		if (fe.active && elapsedMicroseconds > CYCLE_MICROSECONDS) {
-			last = std::chrono::high_resolution_clock::now();
+		// in one run(), which decodes and ticks timers in batches
+		if (fe.active && netplay == nullptr && behind >= CYCLE_MICROSECONDS) {
+			int due = behind / CYCLE_MICROSECONDS;
+			last += std::chrono::microseconds((long long) due * CYCLE_MICROSECONDS);
 
-			sys->cycle();
+			int executed = sys->run(due);
+			if (fe.metrics != nullptr)
+				fe.metrics->instructions.add(executed);
+			if (executed < due)
+				reportFault(sys);
 
 			// If the sound flag is set, play a sound then unset it
 			if (sys->sound) {
 				Mix_PlayChannel(-1, fe.beep_sfx, 0);
 				sys->sound = false;
+				if (fe.metrics != nullptr)
+					fe.metrics->soundEvents.add();
+			}
+		}
+
+		auto frameTime = std::chrono::steady_clock::now() - frameStart;
+		if (std::chrono::duration_cast<std::chrono::microseconds>(frameTime).count() >= FRAME_MICROSECONDS) {
+			frameStart += frameTime;
+			if (netplay != nullptr && netplay->poll()) {
+				netplay->frame(keypadMask(sys->keyState));
+				if (netplay->session->desynced) {
+					std::cout << "Netplay desynced at frame " << netplay->session->frame << std::endl;
+					fe.quit = true;
+				}
+				if (netplay->session->sys.sound) {
+					Mix_PlayChannel(-1, fe.beep_sfx, 0);
+					netplay->session->sys.sound = false;
+				}
+			}
+			long long frameMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(frameTime).count();
+			CHIP8_PROBE3(frame, sys->programCounter, combine(sys->ram[sys->programCounter & 0xFFF],
+				sys->ram[(sys->programCounter + 1) & 0xFFF]), frameMicroseconds);
+			if (fe.metrics != nullptr) {
+				fe.metrics->frameSeconds.observe(frameMicroseconds / 1e6);
+				if (frameMicroseconds >= 2 * FRAME_MICROSECONDS)
+					fe.metrics->lateFrames.add(frameMicroseconds / FRAME_MICROSECONDS - 1);
+			}
+
+			// Under netplay the session's machine runs the game, not sys, so
+			// that is the one shown and profiled for the HUD
+			Chip8 * shown = (netplay != nullptr && netplay->session != nullptr) ? &netplay->session->sys : sys;
+			shown->profile = sys->profile;
+
+			// The HUD changes every frame, so it asks for a present too
+			if (fe.showHud)
+				updateHud(std::chrono::duration<double, std::milli>(frameTime).count());
+
+			// Present once a frame at most, and only if the governor has
+			// time for it; the draw flag stays set for the next frame if not
+			if (sys->draw || shown->draw || fe.showHud) {
+				if (fe.governor->shouldPresent(frameMicroseconds - FRAME_MICROSECONDS)) {
+					auto presentStart = std::chrono::steady_clock::now();
+					sys->draw = false;
+					drawFromChip(shown, window);
+					fe.governor->presented(std::chrono::duration_cast<std::chrono::microseconds>(
+						std::chrono::steady_clock::now() - presentStart).count());
+				} else if (fe.metrics != nullptr) {
+					fe.metrics->framesSkipped.add();
+				}
+			}
+		}
+
+		if (recorder != nullptr) {
+			auto recorded = std::chrono::steady_clock::now() - recordStart;
+			long due = std::chrono::duration_cast<std::chrono::microseconds>(recorded).count()
+				* VIDEO_FRAME_RATE / 1000000;
+			if (due > recordedTicks) {
+				recorder->frame(sys->displayRows, due - recordedTicks);
+				recordedTicks = due;
+			}
+		}
+	}
+	std::cout << fe.governor->summary() << std::endl;
+	delete netplay;
+	delete link;
+	delete recorder;
+	if (tracer != nullptr) {
+		tracer->close();
+		if (!tracer->ok())
+			std::cerr << "Could not write " << fe.traceFile << std::endl;
+	}
+	delete tracer;
+	delete sys;
+	delete fe.profile;
+}
+
+// XO-CHIP games: a fixed number of instructions per 60 Hz frame, four
+// colours from the two planes and the audio pattern mixed in as music.
+// sys only holds the keys, as handleKeypadDown and handleKeyUp expect.
+const uint32_t xoPalette[XOCHIP_COLOURS] = { OFF_COLOUR, ON_COLOUR, 0xFFFF5500, 0xFFFFFFFF };
+
+void mixXoAudio(void * data, Uint8 * stream, int length) {
+	XoChip * xo = (XoChip *) data;
+	static double phase = 0;
+	static int16_t mono[4096];
+
+	// Stereo 16-bit frames, the format setupAudio asks for
+	int16_t * out = (int16_t *) stream;
+	int frames = length / 4;
+	while (frames > 0) {
+		int count = frames < 4096 ? frames : 4096;
+		xo->renderAudio(mono, count, 44100, phase);
+		for (int i = 0; i < count; i++) {
+			out[2 * i] = mono[i];
+			out[2 * i + 1] = mono[i];
+		}
+		out += 2 * count;
+		frames -= count;
+	}
+}
+
+void emulateXo(SDL_Window * window, const char * filename) {
+	SDL_Event e;
+	Chip8 * sys = new Chip8();
+	XoChip * xo = new XoChip();
+
+	std::ifstream in(filename, ios_base::in | ios_base::binary);
+	std::vector<byte> rom((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	xo->load(rom.data(), rom.size());
+	Mix_HookMusic(mixXoAudio, xo);
+
+	SDL_Texture * texture = nullptr;
+	int textureScale = 0;
+	byte keys[16] = {};
+	auto frameStart = std::chrono::steady_clock::now();
+
+	while (!fe.quit) {
+		while (SDL_PollEvent(&e)) {
+			if (e.type == SDL_QUIT)
+				fe.quit = true;
+			if (e.type == SDL_KEYDOWN)
+				handleKeypadDown(&e, sys);
+			if (e.type == SDL_KEYUP)
+				handleKeyUp(&e, sys);
+			if (e.type == SDL_WINDOWEVENT) {
+				handleWindowEvent(&e, sys);
+				xo->draw = true;
+			}
+		}
+
+		auto frameTime = std::chrono::steady_clock::now() - frameStart;
+		long long frameMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(frameTime).count();
+		if (frameMicroseconds < FRAME_MICROSECONDS) {
+			SDL_Delay(1);
+			continue;
+		}
+		if (frameMicroseconds > GOVERNOR_MAX_CATCH_UP_MICROSECONDS) {
+			fe.governor->droppedBacklog(frameMicroseconds);
+			frameStart = std::chrono::steady_clock::now();
+		} else {
+			frameStart += std::chrono::microseconds(FRAME_MICROSECONDS);
+		}
+
+		// Edges rather than levels, so FX0A sees the press and release
+		for (int k = 0; k < 16; k++) {
+			if (sys->keyState[k] && !keys[k])
+				xo->pressKey(k);
+			else if (!sys->keyState[k] && keys[k])
+				xo->releaseKey(k);
+			keys[k] = sys->keyState[k];
+		}
+
+		if (fe.active && !xo->exited) {
+			SDL_LockAudio();
+			xo->frame(fe.xoInstructionsPerFrame);
+			SDL_UnlockAudio();
+			if (xo->fault != FAULT_NONE) {
+				std::cout << "Fault: " << xo->crash.toJson() << std::endl;
+				fe.active = false;
+			}
+		}
+
+		if (!xo->draw || !fe.governor->shouldPresent(frameMicroseconds - FRAME_MICROSECONDS))
+			continue;
+		xo->draw = false;
+		auto presentStart = std::chrono::steady_clock::now();
+
+		int windowWidth, windowHeight;
+		SDL_GetWindowSize(window, &windowWidth, &windowHeight);
+		int scale = Scaler::fitScale(XOCHIP_SCREEN_WIDTH, XOCHIP_SCREEN_HEIGHT, windowWidth, windowHeight);
+		int width = XOCHIP_SCREEN_WIDTH * scale;
+		int height = XOCHIP_SCREEN_HEIGHT * scale;
+		if (texture == nullptr || textureScale != scale) {
+			if (texture != nullptr)
+				SDL_DestroyTexture(texture);
+			texture = SDL_CreateTexture(fe.renderer, SDL_PIXELFORMAT_ARGB8888,
+				SDL_TEXTUREACCESS_STREAMING, width, height);
+			textureScale = scale;
+		}
+
+		void * pixels;
+		int pitch;
+		if (SDL_LockTexture(texture, nullptr, &pixels, &pitch) == 0) {
+			xo->render(xoPalette, scale, pixels, pitch);
+			SDL_UnlockTexture(texture);
+		}
+
+		SDL_Rect target = { (windowWidth - width) / 2, (windowHeight - height) / 2, width, height };
+		SDL_SetRenderDrawColor(fe.renderer, 0x00, 0x00, 0x00, 0xFF);
+		SDL_RenderClear(fe.renderer);
+		SDL_RenderCopy(fe.renderer, texture, nullptr, &target);
+		SDL_RenderPresent(fe.renderer);
+		fe.governor->presented(std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - presentStart).count());
+	}
+
+	std::cout << fe.governor->summary() << std::endl;
+
+	Mix_HookMusic(nullptr, nullptr);
+	if (texture != nullptr)
+		SDL_DestroyTexture(texture);
+	delete xo;
+	delete sys;
+}
+
+// Attract mode: many ROMs tiled in one window. Worker threads run them and
+// changed tiles are composed into one atlas texture, uploading only those
+// tiles each frame. The arrow keys move the focus, and the keypad goes to
+// the focused tile.
+void emulateWall(SDL_Window * window, const char * path) {
+	SDL_Event e;
+	Chip8 * sys = new Chip8();
+
+	std::vector<std::string> names;
+	collectRoms(path, names);
+	std::vector<std::vector<byte>> roms;
+	for (size_t i = 0; i < names.size(); i++) {
+		std::vector<byte> rom = loadRom(names[i]);
+		if (rom.empty())
+			std::cerr << "Could not read " << names[i] << std::endl;
+		else
+			roms.push_back(rom);
+	}
+	if (roms.empty()) {
+		std::cout << "No ROMs in " << path << std::endl;
+		exit(1);
+	}
+
+	int threads = std::max(1u, std::thread::hardware_concurrency());
+	AttractWall * wall = new AttractWall(roms, fe.wallTiles, threads);
+	wall->onColour = ON_COLOUR;
+	wall->offColour = OFF_COLOUR;
+	wall->focusColour = FOCUS_COLOUR;
+	wall->borderColour = HUD_BACKGROUND;
+
+	int width = wall->atlasWidth(WALL_SCALE);
+	int height = wall->atlasHeight(WALL_SCALE);
+	std::vector<uint32_t> atlas(width * height);
+	SDL_Texture * texture = SDL_CreateTexture(fe.renderer, SDL_PIXELFORMAT_ARGB8888,
+		SDL_TEXTUREACCESS_STREAMING, width, height);
+	SDL_SetWindowSize(window, width, height);
+
+	byte keys[16] = {};
+	std::vector<WallRect> dirty;
+	bool unpresented = true;
+	fe.active = true;
+	auto frameStart = std::chrono::steady_clock::now();
+
+	while (!fe.quit) {
+		while (SDL_PollEvent(&e)) {
+			if (e.type == SDL_QUIT)
+				fe.quit = true;
+			if (e.type == SDL_KEYDOWN) {
+				switch (e.key.keysym.sym) {
+					case SDLK_LEFT:		wall->moveFocus(-1, 0);	break;
+					case SDLK_RIGHT:	wall->moveFocus(1, 0);	break;
+					case SDLK_UP:		wall->moveFocus(0, -1);	break;
+					case SDLK_DOWN:		wall->moveFocus(0, 1);	break;
+					default:			handleKeypadDown(&e, sys);	break;
+				}
+			}
+			if (e.type == SDL_KEYUP)
+				handleKeyUp(&e, sys);
+			if (e.type == SDL_WINDOWEVENT) {
+				handleWindowEvent(&e, sys);
+				unpresented = true;
 			}
 		}
 
-		// If the draw flag is set, draw, then unset it
-        if (sys->draw) {
-			drawFromChip(sys, surface, fe.pixels);
-	        SDL_UpdateWindowSurface(window);
+		auto frameTime = std::chrono::steady_clock::now() - frameStart;
+		long long frameMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(frameTime).count();
+		if (frameMicroseconds < FRAME_MICROSECONDS) {
+			SDL_Delay(1);
+			continue;
 		}
+		if (frameMicroseconds > GOVERNOR_MAX_CATCH_UP_MICROSECONDS) {
+			fe.governor->droppedBacklog(frameMicroseconds);
+			frameStart = std::chrono::steady_clock::now();
+		} else {
+			frameStart += std::chrono::microseconds(FRAME_MICROSECONDS);
+		}
+
+		// Focus moves release keys on the old tile; the held ones stay
+		// held here so they are not pressed again on the new one
+		for (int k = 0; k < 16; k++) {
+			if (sys->keyState[k] && !keys[k])
+				wall->pressKey(k);
+			else if (!sys->keyState[k] && keys[k])
+				wall->releaseKey(k);
+			keys[k] = sys->keyState[k];
+		}
+
+		if (fe.active)
+			wall->frame();
+
+		// Upload only the tiles that changed, each run of them once
+		if (wall->compose(WALL_SCALE, atlas.data(), width * sizeof(uint32_t), dirty) > 0) {
+			for (size_t i = 0; i < dirty.size(); i++) {
+				SDL_Rect rect = { dirty[i].x, dirty[i].y, dirty[i].width, dirty[i].height };
+				SDL_UpdateTexture(texture, &rect, &atlas[dirty[i].y * width + dirty[i].x], width * sizeof(uint32_t));
+			}
+			unpresented = true;
+		}
+
+		if (!unpresented || !fe.governor->shouldPresent(frameMicroseconds - FRAME_MICROSECONDS))
+			continue;
+		unpresented = false;
+
+		auto presentStart = std::chrono::steady_clock::now();
+		SDL_SetRenderDrawColor(fe.renderer, 0x00, 0x00, 0x00, 0xFF);
+		SDL_RenderClear(fe.renderer);
+		SDL_RenderCopy(fe.renderer, texture, nullptr, nullptr);
+		SDL_RenderPresent(fe.renderer);
+		fe.governor->presented(std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - presentStart).count());
 	}
+
+	std::cout << fe.governor->summary() << std::endl;
+	SDL_DestroyTexture(texture);
+	delete wall;
 	delete sys;
 }
 
@@ -303,6 +699,8 @@ void printInstructions() {
 	std::cout << "Hit [Space] to pause/unpause.\n"
 	"The interpreter is paused when opened.\n"
 	"When paused, hit [.] to step through instructions one at a time.\n"
+	"Hit [Tab] to switch between nearest, scale2x and scale3x scaling.\n"
+	"Hit [F1] to show or hide the performance sidebar.\n"
 	"Hit [Escape] at any time to close the interpreter.\n"
 	<< std::endl;
 }
@@ -323,8 +721,52 @@ int main(int argc, char ** argv)
 		exit(0);
 	}
 
+	std::string filterName;
+	for (int i = 2; i + 1 < argc; i += 2) {
+		if (std::string(argv[i]) == "--trace")
+			fe.traceFile = argv[i + 1];
+		else if (std::string(argv[i]) == "--record")
+			fe.recordFile = argv[i + 1];
+		else if (std::string(argv[i]) == "--filter")
+			filterName = argv[i + 1];
+		else if (std::string(argv[i]) == "--metrics")
+			fe.metricsTarget = argv[i + 1];
+		else if (std::string(argv[i]) == "--netplay")
+			fe.netplayTarget = argv[i + 1];
+		else if (std::string(argv[i]) == "--xo")
+			fe.xoInstructionsPerFrame = atoi(argv[i + 1]);
+		else if (std::string(argv[i]) == "--wall")
+			fe.wallTiles = atoi(argv[i + 1]);
+	}
+
+	// .xo8 files are XO-CHIP unless told how fast to run them
+	std::string extension = argv[1];
+	extension = extension.substr(extension.find_last_of('.') + 1);
+	if (fe.xoInstructionsPerFrame == 0 && extension == "xo8")
+		fe.xoInstructionsPerFrame = XO_DEFAULT_IPF;
+
+	// Published from a background thread until the emulator exits
+	MetricsPublisher * publisher = nullptr;
+	if (fe.metricsTarget != nullptr) {
+		std::string rom = argv[1];
+		fe.metrics = new Metrics(Metrics::label("rom", rom.substr(rom.find_last_of('/') + 1)));
+		publisher = new MetricsPublisher(*fe.metrics, fe.metricsTarget);
+		if (!publisher->ok()) {
+			std::cout << "Could not publish metrics to " << fe.metricsTarget << std::endl;
+			exit(1);
+		}
+	}
+
+	fe.scaler = new Scaler(ON_COLOUR, OFF_COLOUR);
+	fe.hud = new Hud(ON_COLOUR, HUD_BACKGROUND);
+	fe.showHud = true;
+	fe.governor = new FrameGovernor(FRAME_MICROSECONDS);
+	for (int f = 0; f < SCALE_FILTERS; f++) {
+		if (filterName == scaleFilterName(f))
+			fe.scaler->filter = (ScaleFilter) f;
+	}
+
     SDL_Window * window = nullptr;
-	SDL_Surface * surface = nullptr;
 
 	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
 		std::cout << "SDL init failed: " << SDL_GetError() << std::endl;
@@ -343,29 +785,44 @@ int main(int argc, char ** argv)
 	window = SDL_CreateWindow("chip-emu",
 			SDL_WINDOWPOS_UNDEFINED,
 			SDL_WINDOWPOS_UNDEFINED,
-			SCREEN_WIDTH,
+			SCREEN_WIDTH + SIDEBAR_WIDTH,
 			SCREEN_HEIGHT,
-			SDL_WINDOW_SHOWN);
+			SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
 
 	if (window == nullptr) {
 		std::cout << "Window creation failed:" << SDL_GetError() << std::endl;
 		exit(1);
 	} 
 
-	surface = SDL_GetWindowSurface(window);
+	fe.renderer = SDL_CreateRenderer(window, -1, 0);
 
-	SDL_FillRect(surface,
-		NULL,
-		SDL_MapRGB(surface->format, OFF_COLOUR)
-	);
+	if (fe.renderer == nullptr) {
+		std::cout << "Renderer creation failed:" << SDL_GetError() << std::endl;
+		exit(1);
+	}
 
 	std::string fn = argv[1];
 
 	printInstructions();
 
-	emulate(window, surface, fn.c_str());
-
+	if (fe.wallTiles > 0)
+		emulateWall(window, fn.c_str());
+	else if (fe.xoInstructionsPerFrame > 0)
+		emulateXo(window, fn.c_str());
+	else
+		emulate(window, fn.c_str());
+
+	if (fe.texture != nullptr)
+		SDL_DestroyTexture(fe.texture);
+	if (fe.hudTexture != nullptr)
+		SDL_DestroyTexture(fe.hudTexture);
+	SDL_DestroyRenderer(fe.renderer);
 	SDL_DestroyWindow(window);
+	delete fe.scaler;
+	delete fe.hud;
+	delete fe.governor;
+	delete publisher;
+	delete fe.metrics;
 
 	SDL_Quit();
 	return 0;
@@ -0,0 +1,201 @@
+#include "metrics.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Milliseconds to wait for an HTTP request line before sending plain text
+#define REQUEST_WAIT_MILLISECONDS 100
+
+static std::vector<double> frameBounds() {
+    // Around the 16.7 ms a 60 Hz frame should take
+    double bounds[] = {0.008, 0.012, 0.016, 0.017, 0.020, 0.025, 0.033, 0.050, 0.100, 0.250};
+    return std::vector<double>(bounds, bounds + sizeof(bounds) / sizeof(bounds[0]));
+}
+
+MetricHistogram::MetricHistogram(const std::vector<double> &bounds)
+    : bounds(bounds), counts(new std::atomic<uint64_t>[bounds.size() + 1]), sumMillionths(0) {
+    for (size_t i = 0; i <= bounds.size(); i++)
+        counts[i].store(0, std::memory_order_relaxed);
+}
+
+void MetricHistogram::observe(double value) {
+    size_t bucket = 0;
+    while (bucket < bounds.size() && value > bounds[bucket])
+        bucket++;
+    counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    sumMillionths.fetch_add((uint64_t) (value * 1e6 + 0.5), std::memory_order_relaxed);
+}
+
+Metrics::Metrics(const std::string &labels) : frameSeconds(frameBounds()), labels(labels) {}
+
+std::string Metrics::label(const std::string &name, const std::string &value) {
+    std::string escaped;
+    for (char c : value) {
+        if (c == '\\' || c == '"')
+            escaped += '\\';
+        if (c == '\n')
+            escaped += "\\n";
+        else
+            escaped += c;
+    }
+    return name + "=\"" + escaped + "\"";
+}
+
+// Joins the constant labels with a sample's own, braces included
+static std::string labelSet(const std::string &labels, const std::string &extra = "") {
+    if (labels.empty() && extra.empty())
+        return "";
+    return "{" + labels + (labels.empty() || extra.empty() ? "" : ",") + extra + "}";
+}
+
+static void counter(std::ostream &out, const char * name, const char * help,
+                    const std::string &labels, const MetricCounter &value) {
+    out << "# HELP " << name << " " << help << "\n"
+        << "# TYPE " << name << " counter\n"
+        << name << labelSet(labels) << " " << value.value() << "\n";
+}
+
+std::string Metrics::format() const {
+    std::ostringstream out;
+    counter(out, "chip8_instructions_total", "Instructions executed.", labels, instructions);
+    counter(out, "chip8_frames_presented_total", "Frames presented.", labels, framesPresented);
+    counter(out, "chip8_frames_skipped_total", "Frames left unpresented to keep to schedule.", labels, framesSkipped);
+    counter(out, "chip8_late_frames_total", "60 Hz frames missed.", labels, lateFrames);
+    counter(out, "chip8_draw_calls_total", "Textures copied to the renderer.", labels, drawCalls);
+    counter(out, "chip8_sound_events_total", "Beeps started.", labels, soundEvents);
+
+    out << "# HELP chip8_faults_total Faults raised, by kind.\n"
+        << "# TYPE chip8_faults_total counter\n";
+    for (int kind = FAULT_NONE + 1; kind < METRICS_FAULT_KINDS; kind++) {
+        out << "chip8_faults_total" << labelSet(labels, label("fault", faultName(kind)))
+            << " " << faults[kind].value() << "\n";
+    }
+
+    out << "# HELP chip8_frame_seconds Time between 60 Hz frames.\n"
+        << "# TYPE chip8_frame_seconds histogram\n";
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i <= frameSeconds.bounds.size(); i++) {
+        cumulative += frameSeconds.counts[i].load(std::memory_order_relaxed);
+        std::string bound = "+Inf";
+        if (i < frameSeconds.bounds.size()) {
+            char text[32];
+            snprintf(text, sizeof(text), "%g", frameSeconds.bounds[i]);
+            bound = text;
+        }
+        out << "chip8_frame_seconds_bucket" << labelSet(labels, label("le", bound))
+            << " " << cumulative << "\n";
+    }
+    out << "chip8_frame_seconds_sum" << labelSet(labels) << " "
+        << frameSeconds.sumMillionths.load(std::memory_order_relaxed) / 1e6 << "\n"
+        << "chip8_frame_seconds_count" << labelSet(labels) << " " << cumulative << "\n";
+    return out.str();
+}
+
+bool Metrics::writeFile(const std::string &filename) const {
+    std::string temporary = filename + ".tmp";
+    FILE * file = fopen(temporary.c_str(), "w");
+    if (file == nullptr)
+        return false;
+
+    std::string text = format();
+    bool written = fwrite(text.data(), 1, text.size(), file) == text.size();
+    written = fclose(file) == 0 && written;
+    return written && rename(temporary.c_str(), filename.c_str()) == 0;
+}
+
+MetricsPublisher::MetricsPublisher(const Metrics &metrics, const std::string &target)
+    : metrics(metrics), listener(-1), valid(false), stopping(false) {
+    size_t prefix = strlen(METRICS_SOCKET_PREFIX);
+    if (target.compare(0, prefix, METRICS_SOCKET_PREFIX) != 0) {
+        path = target;
+        valid = metrics.writeFile(path);
+    } else {
+        path = target.substr(prefix);
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path))
+            return;
+        strcpy(address.sun_path, path.c_str());
+
+        // A socket left behind by a process that died is replaced
+        unlink(path.c_str());
+        listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        valid = listener >= 0
+            && bind(listener, (sockaddr *) &address, sizeof(address)) == 0
+            && listen(listener, 8) == 0;
+    }
+
+    if (valid)
+        publisher = std::thread(&MetricsPublisher::publishLoop, this);
+}
+
+MetricsPublisher::~MetricsPublisher() {
+    stopping = true;
+    if (publisher.joinable())
+        publisher.join();
+
+    if (listener >= 0) {
+        close(listener);
+        unlink(path.c_str());
+    } else if (valid) {
+        metrics.writeFile(path);
+    }
+}
+
+bool MetricsPublisher::ok() const {
+    return valid;
+}
+
+void MetricsPublisher::publishLoop() {
+    while (!stopping) {
+        if (listener >= 0) {
+            serveSocket();
+        } else {
+            // Sleep in slices so the destructor is not held up
+            for (int waited = 0; waited < METRICS_PUBLISH_MILLISECONDS && !stopping; waited += 50)
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            metrics.writeFile(path);
+        }
+    }
+}
+
+// Wait briefly for a connection and answer it. Clients that send an HTTP
+// request get an HTTP response, anything else just the text.
+void MetricsPublisher::serveSocket() {
+    pollfd waiting = {listener, POLLIN, 0};
+    if (poll(&waiting, 1, 50) <= 0)
+        return;
+
+    int client = accept(listener, nullptr, nullptr);
+    if (client < 0)
+        return;
+
+    // Read the request so closing does not reset the connection
+    char request[1024];
+    pollfd reading = {client, POLLIN, 0};
+    bool http = poll(&reading, 1, REQUEST_WAIT_MILLISECONDS) > 0
+        && recv(client, request, sizeof(request), 0) >= 4
+        && memcmp(request, "GET ", 4) == 0;
+
+    std::string body = metrics.format();
+    std::string response = body;
+    if (http) {
+        response = "HTTP/1.0 200 OK\r\n"
+            "Content-Type: text/plain; version=0.0.4\r\n"
+            "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    }
+
+    size_t sent = 0;
+    while (sent < response.size()) {
+        ssize_t n = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+            break;
+        sent += n;
+    }
+    close(client);
+}
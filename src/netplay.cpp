@@ -0,0 +1,372 @@
+#include "netplay.hpp"
+#include <chrono>
+#include <cstring>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define NO_FRAME 0xFFFFFFFF
+#define HEADER_BYTES 6
+#define WELCOME_BYTES (HEADER_BYTES + 6)
+#define INPUT_HEADER_BYTES (HEADER_BYTES + 23)
+
+static void putWord(std::vector<byte> &out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out.push_back((value >> (8 * i)) & 0xFF);
+    }
+}
+
+static uint64_t getWord(const byte * in, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= (uint64_t) in[i] << (8 * i);
+    }
+    return value;
+}
+
+static std::vector<byte> packetHeader(NetplayPacket type) {
+    std::vector<byte> packet;
+    putWord(packet, NETPLAY_MAGIC, 4);
+    putWord(packet, NETPLAY_VERSION, 1);
+    putWord(packet, type, 1);
+    return packet;
+}
+
+static int64_t nowMilliseconds() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint16_t keypadMask(const byte keyState[16]) {
+    uint16_t mask = 0;
+    for (int key = 0; key < 16; key++) {
+        mask |= (keyState[key] != 0) << key;
+    }
+    return mask;
+}
+
+RollbackSession::RollbackSession(const std::vector<byte> &rom, uint32_t seed, int cyclesPerFrame)
+    : frame(0), remoteFrames(0), desynced(false), rollbacks(0), resimulatedFrames(0),
+      forker(sys), cyclesPerFrame(cyclesPerFrame), ring(NETPLAY_RING),
+      pendingRollback(false), rollbackFrom(0) {
+    std::vector<byte> image(rom);
+    image.resize(CHIP8_ROM_BYTES, 0);
+    sys.load(image.data());
+    sys.seedRandom(seed);
+
+    for (FrameSlot &slot : ring)
+        slot.frame = NO_FRAME;
+}
+
+const RollbackSession::FrameSlot * RollbackSession::find(uint32_t frame) const {
+    const FrameSlot &slot = ring[frame % NETPLAY_RING];
+    return slot.frame == frame ? &slot : nullptr;
+}
+
+// Save the frame's starting state, then run it with the local keys and
+// the remote ones, or the last remote ones known
+void RollbackSession::simulate(uint32_t f) {
+    FrameSlot &slot = ring[f % NETPLAY_RING];
+    slot.frame = f;
+    slot.state = forker.fork();
+    slot.fingerprint = sys.fingerprint();
+
+    if (f < remoteInputs.size() && remoteInputs[f] >= 0) {
+        slot.usedRemote = remoteInputs[f];
+    } else {
+        slot.usedRemote = remoteFrames > 0 ? remoteInputs[remoteFrames - 1] : 0;
+    }
+
+    // Ascending key order, so both sides see the same presses
+    uint16_t keys = localInputs[f] | slot.usedRemote;
+    for (int key = 0; key < 16; key++) {
+        bool down = (keys >> key) & 1;
+        if (down && !sys.keyState[key])
+            sys.pressKey(key);
+        else if (!down && sys.keyState[key])
+            sys.releaseKey(key);
+    }
+
+    sys.run(cyclesPerFrame);
+}
+
+void RollbackSession::settle() {
+    if (!pendingRollback)
+        return;
+
+    forker.restore(find(rollbackFrom)->state);
+    for (uint32_t f = rollbackFrom; f < frame; f++) {
+        simulate(f);
+    }
+    rollbacks++;
+    resimulatedFrames += frame - rollbackFrom;
+    pendingRollback = false;
+}
+
+bool RollbackSession::advance(uint16_t localKeys) {
+    settle();
+    if (frame >= remoteFrames + NETPLAY_MAX_ROLLBACK)
+        return false;
+
+    localInputs.push_back(localKeys);
+    simulate(frame);
+    frame++;
+    return true;
+}
+
+void RollbackSession::remoteInput(uint32_t f, uint16_t keys) {
+    // Beyond what the peer can have run; a bad packet
+    if (f < remoteFrames || f >= frame + NETPLAY_RING)
+        return;
+    if (f >= remoteInputs.size())
+        remoteInputs.resize(f + 1, -1);
+    if (remoteInputs[f] >= 0)
+        return;
+    remoteInputs[f] = keys;
+
+    // Already run with a wrong guess
+    if (f < frame && find(f)->usedRemote != keys) {
+        if (!pendingRollback || f < rollbackFrom)
+            rollbackFrom = f;
+        pendingRollback = true;
+    }
+
+    while (remoteFrames < remoteInputs.size() && remoteInputs[remoteFrames] >= 0)
+        remoteFrames++;
+}
+
+uint16_t RollbackSession::localInput(uint32_t f) const {
+    return f < localInputs.size() ? localInputs[f] : 0;
+}
+
+bool RollbackSession::syncPoint(uint32_t &f, uint64_t &fingerprint) const {
+    if (frame == 0)
+        return false;
+
+    // Frames up to remoteFrames started from confirmed inputs only, unless
+    // a rollback is still to run
+    f = remoteFrames < frame - 1 ? remoteFrames : frame - 1;
+    if (pendingRollback && rollbackFrom < f)
+        f = rollbackFrom;
+
+    const FrameSlot * slot = find(f);
+    if (slot == nullptr)
+        return false;
+    fingerprint = slot->fingerprint;
+    return true;
+}
+
+bool RollbackSession::checkSync(uint32_t f, uint64_t fingerprint) {
+    uint32_t ours;
+    uint64_t unused;
+    if (!syncPoint(ours, unused) || f > ours)
+        return true;
+
+    const FrameSlot * slot = find(f);
+    if (slot != nullptr && slot->fingerprint != fingerprint)
+        desynced = true;
+    return !desynced;
+}
+
+NetplayLink::NetplayLink(int port)
+    : delayMilliseconds(0), lossPercent(0), hasPeer(false), loss(std::random_device()()) {
+    memset(&peer, 0, sizeof(peer));
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+        return;
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(fd, (sockaddr *) &address, sizeof(address)) != 0
+        || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+NetplayLink::~NetplayLink() {
+    if (fd >= 0)
+        close(fd);
+}
+
+bool NetplayLink::ok() const {
+    return fd >= 0;
+}
+
+int NetplayLink::port() const {
+    sockaddr_in address;
+    socklen_t length = sizeof(address);
+    if (fd < 0 || getsockname(fd, (sockaddr *) &address, &length) != 0)
+        return -1;
+    return ntohs(address.sin_port);
+}
+
+bool NetplayLink::connect(const std::string &host, int port) {
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    addrinfo * found = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &found) != 0 || found == nullptr)
+        return false;
+    memcpy(&peer, found->ai_addr, sizeof(peer));
+    peer.sin_port = htons(port);
+    freeaddrinfo(found);
+
+    hasPeer = true;
+    return true;
+}
+
+bool NetplayLink::connected() const {
+    return hasPeer;
+}
+
+void NetplayLink::send(const byte * data, size_t size) {
+    if (!hasPeer || (lossPercent > 0 && (int) (loss() % 100) < lossPercent))
+        return;
+
+    delayed.push_back(Delayed{nowMilliseconds() + delayMilliseconds, std::vector<byte>(data, data + size)});
+    flush();
+}
+
+void NetplayLink::flush() {
+    int64_t now = nowMilliseconds();
+    while (!delayed.empty() && delayed.front().due <= now) {
+        sendto(fd, delayed.front().data.data(), delayed.front().data.size(), 0,
+               (sockaddr *) &peer, sizeof(peer));
+        delayed.pop_front();
+    }
+}
+
+size_t NetplayLink::queued() const {
+    return delayed.size();
+}
+
+int NetplayLink::receive(byte * data, size_t size) {
+    flush();
+
+    while (true) {
+        sockaddr_in from;
+        socklen_t length = sizeof(from);
+        ssize_t n = recvfrom(fd, data, size, 0, (sockaddr *) &from, &length);
+        if (n < 0)
+            return -1;
+
+        if (!hasPeer) {
+            peer = from;
+            hasPeer = true;
+        }
+
+        // Ignore anyone but the peer
+        if (from.sin_addr.s_addr == peer.sin_addr.s_addr && from.sin_port == peer.sin_port)
+            return n;
+    }
+}
+
+Netplay::Netplay(NetplayLink &link, const std::vector<byte> &rom, bool host, uint32_t seed,
+                 int cyclesPerFrame)
+    : session(nullptr), link(link), rom(rom), host(host),
+      seed(seed != 0 ? seed : std::random_device()()), cyclesPerFrame(cyclesPerFrame), peerAck(0) {}
+
+Netplay::~Netplay() {
+    delete session;
+}
+
+bool Netplay::poll() {
+    byte data[NETPLAY_PACKET_BYTES];
+    int n;
+    while ((n = link.receive(data, sizeof(data))) >= 0) {
+        if (n < HEADER_BYTES || getWord(data, 4) != NETPLAY_MAGIC || data[4] != NETPLAY_VERSION)
+            continue;
+
+        switch (data[5]) {
+            case NETPLAY_HELLO:
+                // Answer every hello, in case a welcome was lost
+                if (host) {
+                    if (session == nullptr)
+                        session = new RollbackSession(rom, seed, cyclesPerFrame);
+                    std::vector<byte> welcome = packetHeader(NETPLAY_WELCOME);
+                    putWord(welcome, seed, 4);
+                    putWord(welcome, cyclesPerFrame, 2);
+                    link.send(welcome.data(), welcome.size());
+                }
+                break;
+
+            case NETPLAY_WELCOME:
+                if (!host && session == nullptr && n >= WELCOME_BYTES) {
+                    seed = getWord(data + HEADER_BYTES, 4);
+                    cyclesPerFrame = getWord(data + HEADER_BYTES + 4, 2);
+                    session = new RollbackSession(rom, seed, cyclesPerFrame);
+                }
+                break;
+
+            case NETPLAY_INPUT:
+                if (session != nullptr && n >= INPUT_HEADER_BYTES) {
+                    const byte * p = data + HEADER_BYTES;
+                    uint32_t first = getWord(p, 4);
+                    int count = getWord(p + 4, 2);
+                    uint32_t ack = getWord(p + 6, 4);
+                    bool hasSync = p[10] != 0;
+                    uint32_t syncFrame = getWord(p + 11, 4);
+                    uint64_t syncFingerprint = getWord(p + 15, 8);
+
+                    for (int i = 0; i < count && INPUT_HEADER_BYTES + 2 * i + 2 <= n; i++) {
+                        session->remoteInput(first + i, getWord(p + 23 + 2 * i, 2));
+                    }
+                    if (ack > peerAck)
+                        peerAck = ack;
+                    if (hasSync)
+                        session->checkSync(syncFrame, syncFingerprint);
+                }
+                break;
+        }
+    }
+
+    if (!host && session == nullptr) {
+        std::vector<byte> hello = packetHeader(NETPLAY_HELLO);
+        link.send(hello.data(), hello.size());
+    }
+    return session != nullptr;
+}
+
+bool Netplay::frame(uint16_t localKeys) {
+    if (session == nullptr)
+        return false;
+
+    bool ran = session->advance(localKeys);
+    sendInputs();
+    return ran;
+}
+
+void Netplay::sendInputs() {
+    if (session == nullptr)
+        return;
+
+    // Every input the peer has not acknowledged, oldest first
+    uint32_t first = peerAck;
+    uint32_t count = session->frame - first;
+    if (count > NETPLAY_MAX_INPUTS)
+        count = NETPLAY_MAX_INPUTS;
+
+    uint32_t syncFrame = 0;
+    uint64_t syncFingerprint = 0;
+    bool hasSync = session->syncPoint(syncFrame, syncFingerprint);
+
+    std::vector<byte> packet = packetHeader(NETPLAY_INPUT);
+    putWord(packet, first, 4);
+    putWord(packet, count, 2);
+    putWord(packet, session->remoteFrames, 4);
+    putWord(packet, hasSync, 1);
+    putWord(packet, syncFrame, 4);
+    putWord(packet, syncFingerprint, 8);
+    for (uint32_t i = 0; i < count; i++) {
+        putWord(packet, session->localInput(first + i), 2);
+    }
+    link.send(packet.data(), packet.size());
+}
@@ -0,0 +1,231 @@
+#include "recorder.hpp"
+#include <chrono>
+#include <cstring>
+
+static void putWord(std::vector<byte> &out, unsigned value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out.push_back((value >> (8 * i)) & 0xFF);
+    }
+}
+
+static unsigned getWord(const byte * in, int bytes) {
+    unsigned value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= in[i] << (8 * i);
+    }
+    return value;
+}
+
+// Rows most significant byte first, so each byte is 8 pixels left to right
+static void serialize(const uint64_t rows[CHIP8_SCREEN_HEIGHT], byte out[VIDEO_FRAME_BYTES]) {
+    for (int y = 0; y < CHIP8_SCREEN_HEIGHT; y++) {
+        for (int b = 0; b < 8; b++) {
+            out[y * 8 + b] = rows[y] >> (56 - 8 * b);
+        }
+    }
+}
+
+static void deserialize(const byte in[VIDEO_FRAME_BYTES], uint64_t rows[CHIP8_SCREEN_HEIGHT]) {
+    for (int y = 0; y < CHIP8_SCREEN_HEIGHT; y++) {
+        rows[y] = 0;
+        for (int b = 0; b < 8; b++) {
+            rows[y] = (rows[y] << 8) | in[y * 8 + b];
+        }
+    }
+}
+
+VideoWriter::VideoWriter(const std::string &filename)
+    : out(filename.c_str(), std::ios_base::out | std::ios_base::binary) {
+    memset(previous, 0, sizeof(previous));
+
+    std::vector<byte> header(VIDEO_MAGIC, VIDEO_MAGIC + 8);
+    putWord(header, VIDEO_VERSION, 2);
+    putWord(header, CHIP8_SCREEN_WIDTH, 2);
+    putWord(header, CHIP8_SCREEN_HEIGHT, 2);
+    putWord(header, VIDEO_FRAME_RATE, 2);
+    out.write((const char *) header.data(), header.size());
+}
+
+bool VideoWriter::ok() const {
+    return out.good();
+}
+
+void VideoWriter::write(const VideoFrame &frame) {
+    uint64_t deltaRows[CHIP8_SCREEN_HEIGHT];
+    for (int y = 0; y < CHIP8_SCREEN_HEIGHT; y++) {
+        deltaRows[y] = frame.rows[y] ^ previous[y];
+    }
+    memcpy(previous, frame.rows, sizeof(previous));
+
+    byte deltas[VIDEO_FRAME_BYTES];
+    serialize(deltaRows, deltas);
+
+    // A zero byte is followed by how many zeros it stands for
+    std::vector<byte> payload;
+    int zeros = 0;
+    for (int b = 0; b < VIDEO_FRAME_BYTES; b++) {
+        if (deltas[b] == 0) {
+            zeros++;
+            continue;
+        }
+
+        if (zeros > 0) {
+            payload.push_back(0x00);
+            payload.push_back(zeros);
+            zeros = 0;
+        }
+        payload.push_back(deltas[b]);
+    }
+
+    // A trailing run is implied by the frame size
+    std::vector<byte> header;
+    putWord(header, frame.repeats, 4);
+    putWord(header, payload.size(), 2);
+    out.write((const char *) header.data(), header.size());
+    out.write((const char *) payload.data(), payload.size());
+}
+
+void VideoWriter::flush() {
+    out.flush();
+}
+
+VideoReader::VideoReader(const std::string &filename)
+    : in(filename.c_str(), std::ios_base::in | std::ios_base::binary), valid(false) {
+    memset(previous, 0, sizeof(previous));
+
+    byte header[16];
+    in.read((char *) header, sizeof(header));
+
+    valid = in.gcount() == sizeof(header)
+        && memcmp(header, VIDEO_MAGIC, 8) == 0
+        && getWord(header + 8, 2) == VIDEO_VERSION
+        && getWord(header + 10, 2) == CHIP8_SCREEN_WIDTH
+        && getWord(header + 12, 2) == CHIP8_SCREEN_HEIGHT
+        && getWord(header + 14, 2) == VIDEO_FRAME_RATE;
+}
+
+bool VideoReader::ok() const {
+    return valid;
+}
+
+bool VideoReader::next(VideoFrame &frame) {
+    byte header[6];
+    in.read((char *) header, sizeof(header));
+    if (!valid || in.gcount() != sizeof(header)) {
+        return false;
+    }
+
+    std::vector<byte> payload(getWord(header + 4, 2));
+    in.read((char *) payload.data(), payload.size());
+    if ((size_t) in.gcount() != payload.size()) {
+        valid = false;
+        return false;
+    }
+
+    // Expand zero runs; whatever is left over at the end is zero
+    byte deltas[VIDEO_FRAME_BYTES] = {};
+    size_t length = 0;
+    for (size_t i = 0; i < payload.size() && length < VIDEO_FRAME_BYTES; i++) {
+        if (payload[i] != 0x00) {
+            deltas[length++] = payload[i];
+        } else if (i + 1 < payload.size()) {
+            length += payload[++i];
+        }
+    }
+
+    if (length > VIDEO_FRAME_BYTES) {
+        valid = false;
+        return false;
+    }
+
+    uint64_t deltaRows[CHIP8_SCREEN_HEIGHT];
+    deserialize(deltas, deltaRows);
+    for (int y = 0; y < CHIP8_SCREEN_HEIGHT; y++) {
+        previous[y] ^= deltaRows[y];
+    }
+
+    memcpy(frame.rows, previous, sizeof(frame.rows));
+    frame.repeats = getWord(header, 4);
+    return true;
+}
+
+Recorder::Recorder(const std::string &filename, int ringFrames)
+    : file(filename), head(0), tail(0), stopping(false) {
+    held.repeats = 0;
+
+    // Round the ring up to a power of two so indices wrap with a mask
+    size_t capacity = 1;
+    while (capacity < (size_t) ringFrames) {
+        capacity <<= 1;
+    }
+
+    ring.resize(capacity);
+    mask = capacity - 1;
+    writer = std::thread(&Recorder::writeLoop, this);
+}
+
+Recorder::~Recorder() {
+    if (held.repeats > 0) {
+        push(held);
+    }
+
+    stopping.store(true, std::memory_order_release);
+    writer.join();
+    file.flush();
+}
+
+bool Recorder::ok() const {
+    return file.ok();
+}
+
+void Recorder::frame(const uint64_t rows[CHIP8_SCREEN_HEIGHT], uint32_t ticks) {
+    if (held.repeats > 0 && memcmp(held.rows, rows, sizeof(held.rows)) == 0) {
+        held.repeats += ticks;
+        return;
+    }
+
+    // The held frame is complete once a different one replaces it
+    if (held.repeats > 0) {
+        push(held);
+    }
+    memcpy(held.rows, rows, sizeof(held.rows));
+    held.repeats = ticks;
+}
+
+void Recorder::push(const VideoFrame &frame) {
+    size_t h = head.load(std::memory_order_relaxed);
+
+    // Wait for the writer rather than lose frames. It polls slowly, so
+    // sleep instead of spinning on a core until it wakes.
+    while (h - tail.load(std::memory_order_acquire) > mask) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    ring[h & mask] = frame;
+    head.store(h + 1, std::memory_order_release);
+}
+
+void Recorder::writeLoop() {
+    for (;;) {
+        // Read stopping first so frames published before it are drained
+        bool stop = stopping.load(std::memory_order_acquire);
+        size_t h = head.load(std::memory_order_acquire);
+        size_t t = tail.load(std::memory_order_relaxed);
+
+        if (t == h) {
+            if (stop) {
+                return;
+            }
+            // Frames arrive at most 60 times a second: poll slowly
+            std::this_thread::sleep_for(std::chrono::milliseconds(VIDEO_POLL_MILLISECONDS));
+            continue;
+        }
+
+        for (; t != h; t++) {
+            file.write(ring[t & mask]);
+        }
+
+        tail.store(t, std::memory_order_release);
+        file.flush();
+    }
+}
@@ -0,0 +1,42 @@
+#include "romfile.hpp"
+#include <algorithm>
+#include <fstream>
+#include <dirent.h>
+#include <sys/stat.h>
+
+void collectRoms(const std::string &path, std::vector<std::string> &roms) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0 || !S_ISDIR(info.st_mode)) {
+        roms.push_back(path);
+        return;
+    }
+
+    DIR * dir = opendir(path.c_str());
+    if (dir == nullptr)
+        return;
+
+    std::vector<std::string> found;
+    while (struct dirent * entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() > 4 && name.substr(name.size() - 4) == ".ch8")
+            found.push_back(path + "/" + name);
+    }
+    closedir(dir);
+
+    std::sort(found.begin(), found.end());
+    roms.insert(roms.end(), found.begin(), found.end());
+}
+
+std::vector<byte> loadRom(const std::string &filename, long * length) {
+    std::vector<byte> rom(CHIP8_ROM_BYTES, 0);
+    std::ifstream in(filename, std::ios_base::in | std::ios_base::binary);
+    in.read((char *) rom.data(), CHIP8_ROM_BYTES);
+
+    // Short reads set failbit too; only a read error sets badbit
+    long read = in.gcount();
+    if (length != nullptr)
+        *length = read;
+    if (!in.is_open() || in.bad() || read == 0)
+        rom.clear();
+    return rom;
+}
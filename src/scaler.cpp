@@ -0,0 +1,302 @@
+#include "scaler.hpp"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCALER_X86 1
+#endif
+
+#define TOP_BIT 0x8000000000000000ULL
+
+const char * scaleFilterName(int filter) {
+    switch (filter) {
+        case SCALE_NEAREST: return "nearest";
+        case SCALE_2X: return "scale2x";
+        case SCALE_3X: return "scale3x";
+    }
+    return "unknown";
+}
+
+// Neighbours of every pixel in word w of a row, aligned with the pixel.
+// Pixels on the edge are their own neighbours.
+static uint64_t leftOf(const uint64_t * row, int w) {
+    return (row[w] >> 1) | (w > 0 ? row[w - 1] << 63 : row[w] & TOP_BIT);
+}
+
+static uint64_t rightOf(const uint64_t * row, int w, int words) {
+    return (row[w] << 1) | (w + 1 < words ? row[w + 1] >> 63 : row[w] & 1);
+}
+
+// Pick x where cond is set, e elsewhere
+static uint64_t select(uint64_t cond, uint64_t x, uint64_t e) {
+    return (cond & x) | (~cond & e);
+}
+
+// Bit i of a byte moved to bit factor * i, for factor 2 and 3
+struct SpreadTables {
+    uint32_t by2[256];
+    uint32_t by3[256];
+
+    SpreadTables() {
+        for (int b = 0; b < 256; b++) {
+            by2[b] = 0;
+            by3[b] = 0;
+            for (int i = 0; i < 8; i++) {
+                by2[b] |= ((b >> i) & 1) << (2 * i);
+                by3[b] |= ((b >> i) & 1) << (3 * i);
+            }
+        }
+    }
+};
+
+static const SpreadTables spread;
+
+// Append the low count bits of bits, most significant first, at position
+static void appendBits(uint64_t * out, int &position, uint64_t bits, int count) {
+    int word = position / 64;
+    int free = 64 - position % 64;
+
+    if (count <= free) {
+        out[word] |= bits << (free - count);
+    } else {
+        out[word] |= bits >> (count - free);
+        out[word + 1] |= bits << (64 - (count - free));
+    }
+    position += count;
+}
+
+// Output row pixel 2x + k is plane k's pixel x
+static void interleave2(uint64_t left, uint64_t right, uint64_t * out, int &position) {
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        uint64_t bits = (spread.by2[(left >> shift) & 0xFF] << 1) | spread.by2[(right >> shift) & 0xFF];
+        appendBits(out, position, bits, 16);
+    }
+}
+
+// Output row pixel 3x + k is plane k's pixel x
+static void interleave3(uint64_t left, uint64_t middle, uint64_t right, uint64_t * out, int &position) {
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        uint64_t bits = ((uint64_t) spread.by3[(left >> shift) & 0xFF] << 2)
+            | (spread.by3[(middle >> shift) & 0xFF] << 1)
+            | spread.by3[(right >> shift) & 0xFF];
+        appendBits(out, position, bits, 24);
+    }
+}
+
+// The rules compare whole pixels, which for a 1-bit image are single bits:
+// equal is ~(a ^ b), unequal is a ^ b, 64 pixels per operation.
+void scale2x(const uint64_t * src, int words, int height, uint64_t * dst) {
+    memset(dst, 0, sizeof(uint64_t) * 4 * words * height);
+
+    for (int y = 0; y < height; y++) {
+        const uint64_t * up = src + words * (y > 0 ? y - 1 : y);
+        const uint64_t * row = src + words * y;
+        const uint64_t * down = src + words * (y + 1 < height ? y + 1 : y);
+        uint64_t * top = dst + 2 * words * (2 * y);
+        uint64_t * bottom = top + 2 * words;
+        int topPosition = 0, bottomPosition = 0;
+
+        for (int w = 0; w < words; w++) {
+            uint64_t B = up[w], H = down[w], E = row[w];
+            uint64_t D = leftOf(row, w), F = rightOf(row, w, words);
+
+            uint64_t E0 = select(~(D ^ B) & (B ^ F) & (D ^ H), D, E);
+            uint64_t E1 = select(~(B ^ F) & (B ^ D) & (F ^ H), F, E);
+            uint64_t E2 = select(~(D ^ H) & (D ^ B) & (H ^ F), D, E);
+            uint64_t E3 = select(~(H ^ F) & (D ^ H) & (B ^ F), F, E);
+
+            interleave2(E0, E1, top, topPosition);
+            interleave2(E2, E3, bottom, bottomPosition);
+        }
+    }
+}
+
+void scale3x(const uint64_t * src, int words, int height, uint64_t * dst) {
+    memset(dst, 0, sizeof(uint64_t) * 9 * words * height);
+
+    for (int y = 0; y < height; y++) {
+        const uint64_t * up = src + words * (y > 0 ? y - 1 : y);
+        const uint64_t * row = src + words * y;
+        const uint64_t * down = src + words * (y + 1 < height ? y + 1 : y);
+        uint64_t * out[3];
+        int positions[3] = { 0, 0, 0 };
+        for (int r = 0; r < 3; r++) {
+            out[r] = dst + 3 * words * (3 * y + r);
+        }
+
+        for (int w = 0; w < words; w++) {
+            uint64_t A = leftOf(up, w), B = up[w], C = rightOf(up, w, words);
+            uint64_t D = leftOf(row, w), E = row[w], F = rightOf(row, w, words);
+            uint64_t G = leftOf(down, w), H = down[w], I = rightOf(down, w, words);
+
+            uint64_t topLeft = ~(D ^ B) & (B ^ F) & (D ^ H);
+            uint64_t topRight = ~(B ^ F) & (B ^ D) & (F ^ H);
+            uint64_t bottomLeft = ~(D ^ H) & (D ^ B) & (H ^ F);
+            uint64_t bottomRight = ~(H ^ F) & (D ^ H) & (B ^ F);
+
+            uint64_t E0 = select(topLeft, D, E);
+            uint64_t E1 = select((topLeft & (E ^ C)) | (topRight & (E ^ A)), B, E);
+            uint64_t E2 = select(topRight, F, E);
+            uint64_t E3 = select((topLeft & (E ^ G)) | (bottomLeft & (E ^ A)), D, E);
+            uint64_t E5 = select((topRight & (E ^ I)) | (bottomRight & (E ^ C)), F, E);
+            uint64_t E6 = select(bottomLeft, D, E);
+            uint64_t E7 = select((bottomLeft & (E ^ I)) | (bottomRight & (E ^ G)), H, E);
+            uint64_t E8 = select(bottomRight, F, E);
+
+            interleave3(E0, E1, E2, out[0], positions[0]);
+            interleave3(E3, E, E5, out[1], positions[1]);
+            interleave3(E6, E7, E8, out[2], positions[2]);
+        }
+    }
+}
+
+// One output row: each source pixel becomes factor copies of its colour
+static void expandRowScalar(const uint64_t * src, int width, int factor,
+                            uint32_t onColour, uint32_t offColour, uint32_t * out) {
+    for (int x = 0; x < width; x++) {
+        uint32_t colour = ((src[x / 64] << (x % 64)) & TOP_BIT) ? onColour : offColour;
+        for (int k = 0; k < factor; k++) {
+            *out++ = colour;
+        }
+    }
+}
+
+#ifdef SCALER_X86
+
+// 4 pixels per store. SSE2 is part of x86-64, so this is the baseline.
+__attribute__((target("sse2")))
+static void expandRowSse2(const uint64_t * src, int width, int factor,
+                          uint32_t onColour, uint32_t offColour, uint32_t * out) {
+    const __m128i on = _mm_set1_epi32(onColour);
+    const __m128i off = _mm_set1_epi32(offColour);
+
+    if (factor == 1) {
+        // A nibble of source bits becomes a lane mask
+        const __m128i bits = _mm_setr_epi32(8, 4, 2, 1);
+        int x = 0;
+        for (; x + 4 <= width; x += 4) {
+            int nibble = (src[x / 64] >> (60 - x % 64)) & 0xF;
+            __m128i mask = _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(nibble), bits), bits);
+            __m128i colours = _mm_or_si128(_mm_and_si128(mask, on), _mm_andnot_si128(mask, off));
+            _mm_storeu_si128((__m128i *) (out + x), colours);
+        }
+        for (; x < width; x++) {
+            out[x] = ((src[x / 64] << (x % 64)) & TOP_BIT) ? onColour : offColour;
+        }
+        return;
+    }
+
+    uint32_t * end = out + width * factor;
+    for (int x = 0; x < width; x++) {
+        bool set = (src[x / 64] << (x % 64)) & TOP_BIT;
+        __m128i colour = set ? on : off;
+        uint32_t * run = out + x * factor;
+
+        // Stores may spill into the next pixel's run, which overwrites them
+        int k = 0;
+        for (; k + 4 <= factor || (k < factor && run + k + 4 <= end); k += 4) {
+            _mm_storeu_si128((__m128i *) (run + k), colour);
+        }
+        for (; k < factor; k++) {
+            run[k] = set ? onColour : offColour;
+        }
+    }
+}
+
+// 8 pixels per store
+__attribute__((target("avx2")))
+static void expandRowAvx2(const uint64_t * src, int width, int factor,
+                          uint32_t onColour, uint32_t offColour, uint32_t * out) {
+    const __m256i on = _mm256_set1_epi32(onColour);
+    const __m256i off = _mm256_set1_epi32(offColour);
+
+    if (factor == 1) {
+        // A byte of source bits becomes a lane mask
+        const __m256i bits = _mm256_setr_epi32(128, 64, 32, 16, 8, 4, 2, 1);
+        int x = 0;
+        for (; x + 8 <= width; x += 8) {
+            int byte = (src[x / 64] >> (56 - x % 64)) & 0xFF;
+            __m256i mask = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(byte), bits), bits);
+            _mm256_storeu_si256((__m256i *) (out + x), _mm256_blendv_epi8(off, on, mask));
+        }
+        for (; x < width; x++) {
+            out[x] = ((src[x / 64] << (x % 64)) & TOP_BIT) ? onColour : offColour;
+        }
+        return;
+    }
+
+    uint32_t * end = out + width * factor;
+    for (int x = 0; x < width; x++) {
+        bool set = (src[x / 64] << (x % 64)) & TOP_BIT;
+        __m256i colour = set ? on : off;
+        uint32_t * run = out + x * factor;
+
+        // Stores may spill into the next pixel's run, which overwrites them
+        int k = 0;
+        for (; k + 8 <= factor || (k < factor && run + k + 8 <= end); k += 8) {
+            _mm256_storeu_si256((__m256i *) (run + k), colour);
+        }
+        for (; k < factor; k++) {
+            run[k] = set ? onColour : offColour;
+        }
+    }
+}
+
+#endif
+
+typedef void (*ExpandRow)(const uint64_t *, int, int, uint32_t, uint32_t, uint32_t *);
+
+static ExpandRow chooseExpandRow() {
+#ifdef SCALER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return expandRowAvx2;
+    if (__builtin_cpu_supports("sse2"))
+        return expandRowSse2;
+#endif
+    return expandRowScalar;
+}
+
+void expandPixels(const uint64_t * src, int words, int width, int height, int factor,
+                  uint32_t onColour, uint32_t offColour, void * pixels, int pitch) {
+    static const ExpandRow expandRow = chooseExpandRow();
+    char * out = static_cast<char *>(pixels);
+
+    for (int y = 0; y < height; y++) {
+        uint32_t * first = reinterpret_cast<uint32_t *>(out);
+        expandRow(src + y * words, width, factor, onColour, offColour, first);
+        out += pitch;
+
+        // The other rows of the pixel are copies
+        for (int k = 1; k < factor; k++, out += pitch) {
+            memcpy(out, first, sizeof(uint32_t) * width * factor);
+        }
+    }
+}
+
+Scaler::Scaler(uint32_t onColour, uint32_t offColour)
+    : filter(SCALE_NEAREST), onColour(onColour), offColour(offColour) {}
+
+int Scaler::fitScale(int width, int height, int areaWidth, int areaHeight) {
+    int scale = areaWidth / width < areaHeight / height ? areaWidth / width : areaHeight / height;
+    return scale > 1 ? scale : 1;
+}
+
+void Scaler::render(const uint64_t * rows, int width, int height, int scale,
+                    void * pixels, int pitch) {
+    int words = (width + 63) / 64;
+
+    if (filter == SCALE_2X && scale % 2 == 0) {
+        filtered.resize(4 * words * height);
+        scale2x(rows, words, height, filtered.data());
+        expandPixels(filtered.data(), 2 * words, 2 * width, 2 * height, scale / 2,
+                     onColour, offColour, pixels, pitch);
+    } else if (filter == SCALE_3X && scale % 3 == 0) {
+        filtered.resize(9 * words * height);
+        scale3x(rows, words, height, filtered.data());
+        expandPixels(filtered.data(), 3 * words, 3 * width, 3 * height, scale / 3,
+                     onColour, offColour, pixels, pitch);
+    } else {
+        expandPixels(rows, words, width, height, scale, onColour, offColour, pixels, pitch);
+    }
+}
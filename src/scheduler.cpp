@@ -0,0 +1,217 @@
+#include "scheduler.hpp"
+#include <chrono>
+#include <thread>
+
+Scheduler::Scheduler(int cyclesPerFrame)
+    : ticks(0), resumes(0), cyclesPerFrame(cyclesPerFrame > 0 ? cyclesPerFrame : 1), stopping(false) {}
+
+int Scheduler::add(const byte * rom) {
+    int id;
+    if (freeIds.empty()) {
+        id = sessions.size();
+        sessions.push_back(nullptr);
+    } else {
+        id = freeIds.back();
+        freeIds.pop_back();
+    }
+
+    Session * session = new Session();
+    session->sys.load((byte *) rom);
+    session->wait = WAIT_NONE;
+    session->lastTick = ticks - 1;
+    session->owed = 0;
+    sessions[id].reset(session);
+    schedule(id, ticks);
+    return id;
+}
+
+void Scheduler::remove(int id) {
+    // Wheel entries for the id are dropped when their slot comes up
+    if (get(id) != nullptr) {
+        sessions[id].reset();
+        freeIds.push_back(id);
+    }
+}
+
+Session * Scheduler::get(int id) const {
+    return (id >= 0 && id < (int) sessions.size()) ? sessions[id].get() : nullptr;
+}
+
+void Scheduler::schedule(int id, int64_t at) {
+    sessions[id]->wakeTick = at;
+    wheel[at % SCHEDULER_WHEEL_SLOTS].push_back(id);
+}
+
+// Run the instructions a waiting session skipped up to the end of tick
+// through. A session in FX0A or a spin only ticks its timers; a delay
+// timer poll runs for real, and is never owed past the end of its wait.
+void Scheduler::catchUp(Session &session, int64_t through) {
+    if (session.wait == WAIT_FAULT)
+        return;
+
+    session.owed += (through - session.lastTick) * cyclesPerFrame;
+    session.lastTick = through;
+    if (session.owed <= 0)
+        return;
+
+    if (session.wait == WAIT_KEY || session.wait == WAIT_SPIN)
+        session.sys.tickTimers(session.owed);
+    else
+        session.sys.run(session.owed);
+    session.owed = 0;
+}
+
+void Scheduler::pressKey(int id, byte key) {
+    Session * session = get(id);
+    if (session == nullptr)
+        return;
+
+    // The skipped instructions ran before the key went down
+    catchUp(*session, ticks - 1);
+    session->sys.pressKey(key);
+    if (session->wait != WAIT_FAULT) {
+        session->wait = WAIT_NONE;
+        if (session->wakeTick != ticks)
+            schedule(id, ticks);
+    }
+}
+
+void Scheduler::releaseKey(int id, byte key) {
+    Session * session = get(id);
+    if (session == nullptr)
+        return;
+
+    catchUp(*session, ticks - 1);
+    session->sys.releaseKey(key);
+    if (session->wait != WAIT_FAULT) {
+        session->wait = WAIT_NONE;
+        if (session->wakeTick != ticks)
+            schedule(id, ticks);
+    }
+}
+
+Chip8 &Scheduler::machine(int id) {
+    Session * session = get(id);
+    catchUp(*session, ticks - 1);
+    return session->sys;
+}
+
+SessionWait Scheduler::wait(int id) const {
+    return get(id)->wait;
+}
+
+// Whether the instruction at the PC would only wait, given remaining
+// instructions left in this tick. Sets wake for a timer wait.
+SessionWait Scheduler::detectWait(Session &session, int remaining, int64_t now, int64_t &wake) {
+    Chip8 &sys = session.sys;
+    word pc = sys.programCounter & 0x0FFF;
+    if (pc + 6 > CHIP8_RAM_BYTES)
+        return WAIT_NONE;
+
+    // FX0A already waiting, with no key released since it started
+    word opcode = combine(sys.ram[pc], sys.ram[pc + 1]);
+    if ((opcode & 0xF0FF) == 0xF00A && sys.blockingForKey
+        && !(sys.lastKeyFromBlock && sys.keyState[sys.lastKey] == 0))
+        return WAIT_KEY;
+
+    if (sys.fusedOps[pc] == FUSED_SPIN)
+        return WAIT_SPIN;
+
+    // FX07, 3X00, jump back: polls until FX07 reads 0, which takes at
+    // least delayTimer instructions. Sleep whole ticks within that.
+    word test = combine(sys.ram[pc + 2], sys.ram[pc + 3]);
+    word jump = combine(sys.ram[pc + 4], sys.ram[pc + 5]);
+    if (sys.fusedOps[pc] == FUSED_TIMER_WAIT && (test & 0x00FF) == 0
+        && (jump & 0x0FFF) == pc && sys.delayTimer >= remaining) {
+        int64_t sleep = 1 + (sys.delayTimer - remaining) / cyclesPerFrame;
+        if (sleep >= 2) {
+            wake = now + sleep;
+            return WAIT_TIMER;
+        }
+    }
+    return WAIT_NONE;
+}
+
+void Scheduler::resume(int id, Session &session, int64_t now) {
+    Chip8 &sys = session.sys;
+    catchUp(session, now - 1);
+    session.wait = WAIT_NONE;
+
+    bool drew = false;
+    int done = 0;
+    int64_t wake = -1;
+    while (done < cyclesPerFrame) {
+        SessionWait waiting = detectWait(session, cyclesPerFrame - done, now, wake);
+        if (waiting != WAIT_NONE) {
+            session.wait = waiting;
+            session.owed = cyclesPerFrame - done;
+            break;
+        }
+
+        sys.draw = false;
+        int count = sys.dispatch(cyclesPerFrame - done);
+        drew |= sys.draw;
+        if (count == 0) {
+            session.wait = WAIT_FAULT;
+            break;
+        }
+        done += count;
+    }
+
+    session.lastTick = now;
+    if (session.wait == WAIT_NONE)
+        schedule(id, now + 1);
+    else if (session.wait == WAIT_TIMER)
+        schedule(id, wake);
+    else
+        session.wakeTick = -1;
+
+    sys.draw = false;
+    if (drew && onFrame)
+        onFrame(id, sys);
+}
+
+int Scheduler::tick() {
+    int64_t now = ticks;
+    int slot = now % SCHEDULER_WHEEL_SLOTS;
+    std::vector<int> due;
+    due.swap(wheel[slot]);
+
+    int ran = 0;
+    for (int id : due) {
+        Session * session = get(id);
+
+        // Removed, rescheduled since, or already run this tick
+        if (session == nullptr || session->lastTick == now)
+            continue;
+        if (session->wakeTick != now) {
+            if (session->wakeTick > now && session->wakeTick % SCHEDULER_WHEEL_SLOTS == slot)
+                wheel[slot].push_back(id);
+            continue;
+        }
+
+        resume(id, *session, now);
+        ran++;
+    }
+
+    ticks++;
+    resumes += ran;
+    return ran;
+}
+
+void Scheduler::serve() {
+    auto next = std::chrono::steady_clock::now();
+    while (!stopping) {
+        tick();
+
+        next += std::chrono::microseconds(SCHEDULER_TICK_MICROSECONDS);
+        auto now = std::chrono::steady_clock::now();
+        if (now - next > std::chrono::microseconds(SCHEDULER_TICK_MICROSECONDS))
+            next = now;
+        std::this_thread::sleep_until(next);
+    }
+}
+
+void Scheduler::stop() {
+    stopping = true;
+}
@@ -0,0 +1,115 @@
+#include "terminal.hpp"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+#define ANSI_CLEAR "\x1b[2J"
+#define ANSI_HIDE_CURSOR "\x1b[?25l"
+#define ANSI_SHOW_CURSOR "\x1b[?25h"
+#define ANSI_ON_COLOUR "\x1b[92m"
+#define ANSI_RESET "\x1b[0m"
+
+// Indexed by top pixel | bottom pixel << 1
+static const char * const glyphs[4] = { " ", "▀", "▄", "█" };
+static const size_t glyphBytes[4] = { 1, 3, 3, 3 };
+
+static int cellAt(const uint64_t * rows, int cellRow, int column) {
+    int shift = CHIP8_SCREEN_WIDTH - 1 - column;
+    return ((rows[2 * cellRow] >> shift) & 1) | (((rows[2 * cellRow + 1] >> shift) & 1) << 1);
+}
+
+static int digits(int n) {
+    return n >= 10 ? 2 : 1;
+}
+
+TerminalRenderer::TerminalRenderer(int fd) : fd(fd), valid(false), cursorRow(0), cursorColumn(0) {
+    memset(shown, 0, sizeof(shown));
+}
+
+TerminalRenderer::~TerminalRenderer() {
+    buffer += ANSI_RESET ANSI_SHOW_CURSOR;
+    moveTo(TERMINAL_CELL_ROWS + 1, 1);
+    buffer += "\n";
+    flush();
+}
+
+void TerminalRenderer::invalidate() {
+    valid = false;
+}
+
+// Terminal rows and columns count from 1
+void TerminalRenderer::moveTo(int row, int column) {
+    if (row == cursorRow && column == cursorColumn)
+        return;
+
+    buffer += "\x1b[";
+    buffer += std::to_string(row);
+    buffer += ";";
+    buffer += std::to_string(column);
+    buffer += "H";
+    cursorRow = row;
+    cursorColumn = column;
+}
+
+size_t TerminalRenderer::render(const uint64_t rows[CHIP8_SCREEN_HEIGHT]) {
+    if (!valid) {
+        buffer += ANSI_CLEAR ANSI_HIDE_CURSOR ANSI_ON_COLOUR;
+        cursorRow = 0;
+    }
+
+    for (int cellRow = 0; cellRow < TERMINAL_CELL_ROWS; cellRow++) {
+        uint64_t changed = valid
+            ? (rows[2 * cellRow] ^ shown[2 * cellRow]) | (rows[2 * cellRow + 1] ^ shown[2 * cellRow + 1])
+            : ~0ULL;
+
+        while (changed != 0) {
+            int column = __builtin_clzll(changed);
+            changed &= ~(1ULL << (CHIP8_SCREEN_WIDTH - 1 - column));
+
+            // A short gap on the same row is cheaper to redraw than to skip
+            // over with a cursor move
+            if (cursorRow == cellRow + 1 && cursorColumn <= column + 1) {
+                size_t redraw = 0;
+                for (int c = cursorColumn - 1; c < column; c++) {
+                    redraw += glyphBytes[cellAt(rows, cellRow, c)];
+                }
+
+                if (redraw <= (size_t) (4 + digits(cellRow + 1) + digits(column + 1))) {
+                    for (int c = cursorColumn - 1; c < column; c++) {
+                        buffer += glyphs[cellAt(rows, cellRow, c)];
+                    }
+                    cursorColumn = column + 1;
+                }
+            }
+
+            moveTo(cellRow + 1, column + 1);
+            buffer += glyphs[cellAt(rows, cellRow, column)];
+            cursorColumn++;
+        }
+    }
+
+    memcpy(shown, rows, sizeof(shown));
+    valid = true;
+
+    size_t bytes = buffer.size();
+    flush();
+    return bytes;
+}
+
+void TerminalRenderer::flush() {
+    const char * data = buffer.data();
+    size_t remaining = buffer.size();
+
+    // Normally one call; a slow pipe may take part of the frame at a time
+    while (remaining > 0) {
+        ssize_t written = write(fd, data, remaining);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            break;
+        data += written;
+        remaining -= written;
+    }
+
+    buffer.clear();
+}
@@ -0,0 +1,25 @@
+#include "textfmt.hpp"
+#include <iomanip>
+#include <sstream>
+
+std::string hex(int value, int digits) {
+    std::ostringstream out;
+    out << "0x" << std::hex << std::uppercase << std::setw(digits) << std::setfill('0') << value;
+    return out.str();
+}
+
+std::string jsonString(const std::string &value) {
+    std::string quoted = "\"";
+    for (size_t i = 0; i < value.size(); i++) {
+        unsigned char c = value[i];
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if (c < 0x20) {
+            quoted += "\\u00" + hex(c, 2).substr(2);
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
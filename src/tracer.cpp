@@ -0,0 +1,306 @@
+#include "tracer.hpp"
+#include <chrono>
+#include <cstring>
+
+bool operator==(const TraceRecord &a, const TraceRecord &b) {
+    return a.pc == b.pc && a.opcode == b.opcode && a.index == b.index
+        && a.reg == b.reg && a.value == b.value && a.vf == b.vf;
+}
+
+byte tracedRegister(word opcode) {
+    byte X = (opcode & 0x0F00) >> 8;
+
+    switch (opcode & 0xF000) {
+        case 0x6000:
+        case 0x7000:
+        case 0x8000:
+        case 0xC000:
+            return X;
+        case 0xF000:
+            switch (opcode & 0x00FF) {
+                case 0x07:
+                case 0x0A:
+                case 0x65:
+                    return X;
+            }
+            break;
+    }
+
+    return TRACE_NO_REGISTER;
+}
+
+static void putWord(std::vector<byte> &out, unsigned value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out.push_back((value >> (8 * i)) & 0xFF);
+    }
+}
+
+static unsigned getWord(const byte * in, int bytes) {
+    unsigned value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= in[i] << (8 * i);
+    }
+    return value;
+}
+
+static void serialize(const TraceRecord &r, byte out[TRACE_RECORD_BYTES]) {
+    out[0] = r.pc & 0xFF;
+    out[1] = r.pc >> 8;
+    out[2] = r.opcode & 0xFF;
+    out[3] = r.opcode >> 8;
+    out[4] = r.index & 0xFF;
+    out[5] = r.index >> 8;
+    out[6] = r.reg;
+    out[7] = r.value;
+    out[8] = r.vf;
+}
+
+static TraceRecord deserialize(const byte in[TRACE_RECORD_BYTES]) {
+    TraceRecord r;
+    r.pc = getWord(in, 2);
+    r.opcode = getWord(in + 2, 2);
+    r.index = getWord(in + 4, 2);
+    r.reg = in[6];
+    r.value = in[7];
+    r.vf = in[8];
+    return r;
+}
+
+TraceWriter::TraceWriter(const std::string &filename)
+    : out(filename.c_str(), std::ios_base::out | std::ios_base::binary) {
+    std::vector<byte> header(TRACE_MAGIC, TRACE_MAGIC + 8);
+    putWord(header, TRACE_VERSION, 2);
+    putWord(header, TRACE_RECORD_BYTES, 2);
+    out.write((const char *) header.data(), header.size());
+}
+
+TraceWriter::~TraceWriter() {
+    flush();
+}
+
+bool TraceWriter::ok() const {
+    return out.good();
+}
+
+void TraceWriter::write(const TraceRecord &record) {
+    pending.push_back(record);
+
+    if (pending.size() >= TRACE_CHUNK_RECORDS) {
+        flush();
+    }
+}
+
+// Predicts a record from the one before it and the last one at the same
+// PC: loops make most fields repeat, so the XOR with the prediction is
+// mostly zero bytes.
+struct TracePredictor {
+    std::vector<TraceRecord> lastAtPc;
+    word nextPc;
+
+    TracePredictor() : lastAtPc(CHIP8_RAM_BYTES), nextPc(0) {}
+
+    void predict(byte out[TRACE_RECORD_BYTES]) {
+        TraceRecord guess = lastAtPc[nextPc & 0x0FFF];
+        guess.pc = nextPc;
+        serialize(guess, out);
+    }
+
+    void update(const TraceRecord &actual) {
+        lastAtPc[actual.pc & 0x0FFF] = actual;
+        nextPc = actual.pc + 2;
+    }
+};
+
+void TraceWriter::flush() {
+    if (pending.empty()) {
+        return;
+    }
+
+    // Chunks start from a fresh predictor so they decode independently
+    TracePredictor predictor;
+    byte predicted[TRACE_RECORD_BYTES];
+    byte current[TRACE_RECORD_BYTES];
+    std::vector<byte> payload;
+    int zeros = 0;
+
+    for (size_t i = 0; i < pending.size(); i++) {
+        predictor.predict(predicted);
+        serialize(pending[i], current);
+
+        for (int b = 0; b < TRACE_RECORD_BYTES; b++) {
+            byte delta = current[b] ^ predicted[b];
+
+            // A zero byte is followed by how many zeros it stands for
+            if (delta == 0) {
+                if (++zeros == 0xFF) {
+                    payload.push_back(0x00);
+                    payload.push_back(zeros);
+                    zeros = 0;
+                }
+                continue;
+            }
+
+            if (zeros > 0) {
+                payload.push_back(0x00);
+                payload.push_back(zeros);
+                zeros = 0;
+            }
+            payload.push_back(delta);
+        }
+
+        predictor.update(pending[i]);
+    }
+
+    if (zeros > 0) {
+        payload.push_back(0x00);
+        payload.push_back(zeros);
+    }
+
+    std::vector<byte> header;
+    putWord(header, pending.size(), 4);
+    putWord(header, payload.size(), 4);
+    out.write((const char *) header.data(), header.size());
+    out.write((const char *) payload.data(), payload.size());
+    out.flush();
+
+    pending.clear();
+}
+
+Tracer::Tracer(const std::string &filename, int ringRecords)
+    : file(filename), head(0), tail(0), stopping(false) {
+    // Round the ring up to a power of two so indices wrap with a mask
+    size_t capacity = 1;
+    while (capacity < (size_t) ringRecords) {
+        capacity <<= 1;
+    }
+
+    ring.resize(capacity);
+    mask = capacity - 1;
+    writer = std::thread(&Tracer::writeLoop, this);
+}
+
+Tracer::~Tracer() {
+    close();
+}
+
+void Tracer::close() {
+    if (!writer.joinable())
+        return;
+
+    stopping.store(true, std::memory_order_release);
+    writer.join();
+    file.flush();
+}
+
+bool Tracer::ok() const {
+    return file.ok();
+}
+
+void Tracer::writeLoop() {
+    for (;;) {
+        // Read stopping first so records published before it are drained
+        bool stop = stopping.load(std::memory_order_acquire);
+        size_t h = head.load(std::memory_order_acquire);
+        size_t t = tail.load(std::memory_order_relaxed);
+
+        if (t == h) {
+            if (stop) {
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+            continue;
+        }
+
+        for (; t != h; t++) {
+            TraceRecord r = ring[t & mask];
+
+            if (tracedRegister(r.opcode) == TRACE_NO_REGISTER) {
+                r.reg = TRACE_NO_REGISTER;
+                r.value = 0;
+            }
+            file.write(r);
+        }
+
+        tail.store(t, std::memory_order_release);
+    }
+}
+
+TraceReader::TraceReader(const std::string &filename)
+    : in(filename.c_str(), std::ios_base::in | std::ios_base::binary),
+      valid(false), position(0) {
+    byte header[12];
+    in.read((char *) header, sizeof(header));
+
+    valid = in.gcount() == sizeof(header)
+        && memcmp(header, TRACE_MAGIC, 8) == 0
+        && getWord(header + 8, 2) == TRACE_VERSION
+        && getWord(header + 10, 2) == TRACE_RECORD_BYTES;
+}
+
+bool TraceReader::ok() const {
+    return valid;
+}
+
+bool TraceReader::next(TraceRecord &record) {
+    if (position == chunk.size() && !readChunk()) {
+        return false;
+    }
+
+    record = chunk[position++];
+    return true;
+}
+
+bool TraceReader::readChunk() {
+    byte header[8];
+    in.read((char *) header, sizeof(header));
+    if (!valid || in.gcount() != sizeof(header)) {
+        return false;
+    }
+
+    // Nothing larger was written, so a larger size is a corrupt header
+    size_t records = getWord(header, 4);
+    size_t payloadBytes = getWord(header + 4, 4);
+    if (records > TRACE_CHUNK_RECORDS || payloadBytes > TRACE_CHUNK_PAYLOAD_BYTES) {
+        valid = false;
+        return false;
+    }
+
+    std::vector<byte> payload(payloadBytes);
+    in.read((char *) payload.data(), payload.size());
+    if ((size_t) in.gcount() != payload.size()) {
+        valid = false;
+        return false;
+    }
+
+    // Expand zero runs back into the XOR deltas
+    std::vector<byte> deltas;
+    deltas.reserve(records * TRACE_RECORD_BYTES);
+    for (size_t i = 0; i < payload.size(); i++) {
+        if (payload[i] != 0x00) {
+            deltas.push_back(payload[i]);
+        } else if (i + 1 < payload.size()) {
+            deltas.insert(deltas.end(), (size_t) payload[++i], (byte) 0x00);
+        }
+    }
+
+    if (deltas.size() != records * TRACE_RECORD_BYTES) {
+        valid = false;
+        return false;
+    }
+
+    TracePredictor predictor;
+    byte current[TRACE_RECORD_BYTES];
+    chunk.clear();
+    position = 0;
+
+    for (size_t r = 0; r < records; r++) {
+        predictor.predict(current);
+        for (int b = 0; b < TRACE_RECORD_BYTES; b++) {
+            current[b] ^= deltas[r * TRACE_RECORD_BYTES + b];
+        }
+        chunk.push_back(deserialize(current));
+        predictor.update(chunk.back());
+    }
+
+    return !chunk.empty();
+}
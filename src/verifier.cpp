@@ -0,0 +1,178 @@
+#include "verifier.hpp"
+#include <cstring>
+#include <random>
+#include <sstream>
+
+// Word at a time; much cheaper than the per-byte fingerprint keys
+static uint64_t hashMemory(const Chip8 &sys) {
+    uint64_t h = 0;
+    for (int i = 0; i < CHIP8_RAM_BYTES; i += 8) {
+        uint64_t w;
+        memcpy(&w, sys.ram + i, sizeof(w));
+        h = ((h << 29 | h >> 35) ^ w) * 0x9E3779B97F4A7C15ULL;
+    }
+    for (int y = 0; y < CHIP8_SCREEN_HEIGHT; y++) {
+        h = ((h << 29 | h >> 35) ^ sys.displayRows[y]) * 0x9E3779B97F4A7C15ULL;
+    }
+    return h ^ (h >> 32);
+}
+
+VerifyState::VerifyState(const Chip8 &sys) {
+    memcpy(variableRegisters, sys.variableRegisters, sizeof(variableRegisters));
+    indexRegister = sys.indexRegister;
+    programCounter = sys.programCounter;
+    stackPointer = sys.stackPointer;
+    memcpy(stack, sys.stack, sizeof(stack));
+    delayTimer = sys.delayTimer;
+    soundTimer = sys.soundTimer;
+    fault = sys.fault;
+    memoryHash = hashMemory(sys);
+    memoryFingerprint = sys.memoryFingerprint;
+}
+
+std::vector<std::string> VerifyState::differences(const VerifyState &other) const {
+    std::vector<std::string> fields;
+    for (int i = 0; i < CHIP8_VARIABLE_REGISTERS; i++) {
+        if (variableRegisters[i] != other.variableRegisters[i])
+            fields.push_back("v" + std::to_string(i));
+    }
+    if (indexRegister != other.indexRegister)
+        fields.push_back("i");
+    if (programCounter != other.programCounter)
+        fields.push_back("pc");
+    if (stackPointer != other.stackPointer)
+        fields.push_back("sp");
+    if (memcmp(stack, other.stack, sizeof(stack)) != 0)
+        fields.push_back("stack");
+    if (delayTimer != other.delayTimer)
+        fields.push_back("dt");
+    if (soundTimer != other.soundTimer)
+        fields.push_back("st");
+    if (fault != other.fault)
+        fields.push_back("fault");
+    if (memoryHash != other.memoryHash)
+        fields.push_back("memory");
+    if (memoryFingerprint != other.memoryFingerprint)
+        fields.push_back("fingerprint");
+    return fields;
+}
+
+std::string VerifyState::toJson() const {
+    std::ostringstream out;
+    out << "{\"pc\":" << programCounter
+        << ",\"i\":" << indexRegister
+        << ",\"sp\":" << (int) stackPointer
+        << ",\"dt\":" << (int) delayTimer
+        << ",\"st\":" << (int) soundTimer
+        << ",\"fault\":\"" << faultName(fault) << "\""
+        << ",\"memory\":" << memoryHash
+        << ",\"fingerprint\":" << memoryFingerprint
+        << ",\"v\":[";
+    for (int i = 0; i < CHIP8_VARIABLE_REGISTERS; i++) {
+        out << (i ? "," : "") << (int) variableRegisters[i];
+    }
+    out << "],\"stack\":[";
+    for (int i = 0; i < CHIP8_STACK_HEIGHT; i++) {
+        out << (i ? "," : "") << stack[i];
+    }
+    out << "]}";
+    return out.str();
+}
+
+int fusedBackend(Chip8 &sys, int budget) {
+    return sys.dispatch(budget);
+}
+
+int runBackend(Chip8 &sys, int budget) {
+    return sys.run(budget);
+}
+
+Lockstep::Lockstep(const std::vector<byte> &rom, VerifyBackend backend)
+    : executed(0), mismatch(false), backend(backend), rom(rom), observed(0), faulted(false) {
+    this->rom.resize(CHIP8_ROM_BYTES, 0);
+}
+
+bool Lockstep::run(long instructions, uint32_t seed) {
+    Chip8 * machines[] = {&reference, &candidate};
+    for (Chip8 * sys : machines) {
+        sys->reset();
+        sys->load(rom.data());
+        sys->seedRandom(seed);
+    }
+    candidate.observer = this;
+    executed = 0;
+    mismatch = false;
+    faulted = false;
+    input.seed(seed);
+
+    while (executed < instructions) {
+        changeKeys();
+
+        long budget = instructions - executed;
+        observed = 0;
+        int count = backend(candidate, budget < VERIFY_BATCH_BUDGET ? budget : VERIFY_BATCH_BUDGET);
+        if (mismatch || faulted)
+            return !mismatch;
+
+        // Whatever the backend ran without reporting each step. A faulting
+        // candidate should fault on the reference's cycle after those.
+        bool candidateFaulted = candidate.fault != FAULT_NONE;
+        if ((count > observed || candidateFaulted) && !compare(count - observed, candidateFaulted))
+            return !mismatch;
+    }
+    return true;
+}
+
+bool Lockstep::stepped(Chip8 &, int count) {
+    observed += count;
+    if (!compare(count, false))
+        return false;
+    changeKeys();
+    return true;
+}
+
+bool Lockstep::compare(int count, bool candidateFaulted) {
+    faulted = candidateFaulted;
+    int cycles = count + (candidateFaulted ? 1 : 0);
+    for (int i = 0; i < cycles; i++) {
+        if (reference.cycle() != FAULT_NONE) {
+            faulted = true;
+            break;
+        }
+    }
+
+    mismatch = !VerifyState(reference).differences(VerifyState(candidate)).empty();
+    if (!mismatch)
+        executed += count;
+    return !mismatch && !faulted;
+}
+
+void Lockstep::changeKeys() {
+    if (input() % VERIFY_KEY_PERIOD != 0)
+        return;
+
+    byte key = input() % 16;
+    bool press = reference.keyState[key] == 0;
+    Chip8 * machines[] = {&reference, &candidate};
+    for (Chip8 * sys : machines) {
+        if (press)
+            sys->pressKey(key);
+        else
+            sys->releaseKey(key);
+    }
+}
+
+std::string Lockstep::report() const {
+    VerifyState expected(reference);
+    VerifyState actual(candidate);
+
+    std::ostringstream out;
+    out << "{\"executed\":" << executed << ",\"differences\":[";
+    std::vector<std::string> fields = expected.differences(actual);
+    for (size_t i = 0; i < fields.size(); i++) {
+        out << (i ? "," : "") << "\"" << fields[i] << "\"";
+    }
+    out << "],\"reference\":" << expected.toJson()
+        << ",\"candidate\":" << actual.toJson() << "}";
+    return out.str();
+}
@@ -0,0 +1,79 @@
+#include "visited.hpp"
+
+VisitedSet::VisitedSet(size_t capacity) : capacity(capacity), count(0), zero(false) {
+    size_t tableSlots = 16;
+    while (tableSlots < 2 * capacity) {
+        tableSlots *= 2;
+    }
+
+    slots.reset(new std::atomic<uint64_t>[tableSlots]);
+    for (size_t i = 0; i < tableSlots; i++) {
+        slots[i].store(0, std::memory_order_relaxed);
+    }
+    mask = tableSlots - 1;
+}
+
+bool VisitedSet::insert(uint64_t fingerprint) {
+    uint64_t key = fingerprint;
+
+    // Zero marks an empty slot, so fingerprint 0 lives in its own flag
+    if (key == 0) {
+        if (zero.load(std::memory_order_relaxed))
+            return false;
+        if (count.fetch_add(1, std::memory_order_relaxed) >= capacity) {
+            count.fetch_sub(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (!zero.exchange(true, std::memory_order_relaxed))
+            return true;
+        count.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Fingerprints are already well mixed: the low bits pick the slot
+    for (size_t i = key & mask;; i = (i + 1) & mask) {
+        uint64_t current = slots[i].load(std::memory_order_relaxed);
+
+        if (current == key)
+            return false;
+        if (current != 0)
+            continue;
+
+        // Reserve room before claiming, so the table never fills up
+        if (count.fetch_add(1, std::memory_order_relaxed) >= capacity) {
+            count.fetch_sub(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        if (slots[i].compare_exchange_strong(current, key, std::memory_order_relaxed))
+            return true;
+
+        // Lost the slot to another thread; it may have inserted the same key
+        count.fetch_sub(1, std::memory_order_relaxed);
+        if (current == key)
+            return false;
+    }
+}
+
+bool VisitedSet::contains(uint64_t fingerprint) const {
+    uint64_t key = fingerprint;
+    if (key == 0)
+        return zero.load(std::memory_order_relaxed);
+
+    for (size_t i = key & mask;; i = (i + 1) & mask) {
+        uint64_t current = slots[i].load(std::memory_order_relaxed);
+
+        if (current == key)
+            return true;
+        if (current == 0)
+            return false;
+    }
+}
+
+size_t VisitedSet::size() const {
+    return count.load(std::memory_order_relaxed);
+}
+
+bool VisitedSet::full() const {
+    return size() >= capacity;
+}
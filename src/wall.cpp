@@ -0,0 +1,193 @@
+#include "wall.hpp"
+#include "scaler.hpp"
+#include <cmath>
+#include <cstring>
+
+AttractWall::AttractWall(const std::vector<std::vector<byte>> &roms, int tiles, int threads,
+                         int cyclesPerFrame)
+    : tiles(tiles), focus(0), frames(0), onColour(0xFF00FF55), offColour(0xFF000000),
+      focusColour(0xFFFFFFFF), borderColour(0xFF202020), generation(0), pending(0),
+      stopping(false) {
+    if (threads < 1)
+        threads = 1;
+    if (threads > tiles)
+        threads = tiles;
+
+    // Tiles are 2:1, so a square-ish grid of them is twice as wide as tall
+    columns = (int) std::ceil(std::sqrt((double) tiles));
+    rows = (tiles + columns - 1) / columns;
+    memset(keys, 0, sizeof(keys));
+
+    for (int s = 0; s < threads; s++)
+        shards.push_back(std::unique_ptr<Shard>(new Shard(cyclesPerFrame)));
+
+    tileState.resize(tiles);
+    for (int t = 0; t < tiles; t++) {
+        Tile &tile = tileState[t];
+        Shard &shard = *shards[t % threads];
+        tile.shard = t % threads;
+        tile.session = shard.scheduler.add(roms[t % roms.size()].data());
+        if ((int) shard.sessionTile.size() <= tile.session)
+            shard.sessionTile.resize(tile.session + 1);
+        shard.sessionTile[tile.session] = t;
+        memset(tile.rows, 0, sizeof(tile.rows));
+        tile.dirty = true;
+        tile.borderDirty = true;
+    }
+
+    for (size_t s = 0; s < shards.size(); s++) {
+        Shard &shard = *shards[s];
+        shard.scheduler.onFrame = [this, &shard](int id, const Chip8 &sys) {
+            Tile &tile = tileState[shard.sessionTile[id]];
+            memcpy(tile.rows, sys.displayRows, sizeof(tile.rows));
+            tile.dirty = true;
+        };
+        shard.thread = std::thread(&AttractWall::work, this, std::ref(shard));
+    }
+}
+
+AttractWall::~AttractWall() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    start.notify_all();
+    for (size_t s = 0; s < shards.size(); s++)
+        shards[s]->thread.join();
+}
+
+void AttractWall::work(Shard &shard) {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            start.wait(guard, [&] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+
+        shard.scheduler.tick();
+
+        std::lock_guard<std::mutex> guard(lock);
+        if (--pending == 0)
+            done.notify_one();
+    }
+}
+
+void AttractWall::frame() {
+    std::unique_lock<std::mutex> guard(lock);
+    pending = shards.size();
+    generation++;
+    start.notify_all();
+    done.wait(guard, [&] { return pending == 0; });
+    frames++;
+}
+
+int AttractWall::atlasWidth(int scale) const {
+    return columns * (CHIP8_SCREEN_WIDTH * scale + 2 * WALL_BORDER);
+}
+
+int AttractWall::atlasHeight(int scale) const {
+    return rows * (CHIP8_SCREEN_HEIGHT * scale + 2 * WALL_BORDER);
+}
+
+WallRect AttractWall::tileRect(int tile, int scale) const {
+    int width = CHIP8_SCREEN_WIDTH * scale + 2 * WALL_BORDER;
+    int height = CHIP8_SCREEN_HEIGHT * scale + 2 * WALL_BORDER;
+    WallRect rect = { (tile % columns) * width, (tile / columns) * height, width, height };
+    return rect;
+}
+
+int AttractWall::tileAt(int scale, int x, int y) const {
+    if (x < 0 || y < 0 || x >= atlasWidth(scale) || y >= atlasHeight(scale))
+        return -1;
+    int tile = (y / (CHIP8_SCREEN_HEIGHT * scale + 2 * WALL_BORDER)) * columns
+        + x / (CHIP8_SCREEN_WIDTH * scale + 2 * WALL_BORDER);
+    return tile < tiles ? tile : -1;
+}
+
+void AttractWall::drawBorder(int tile, int scale, void * pixels, int pitch) {
+    WallRect rect = tileRect(tile, scale);
+    uint32_t colour = (tile == focus) ? focusColour : borderColour;
+
+    for (int y = 0; y < rect.height; y++) {
+        uint32_t * line = (uint32_t *) ((byte *) pixels + (rect.y + y) * pitch) + rect.x;
+        if (y < WALL_BORDER || y >= rect.height - WALL_BORDER) {
+            for (int x = 0; x < rect.width; x++)
+                line[x] = colour;
+        } else {
+            for (int x = 0; x < WALL_BORDER; x++) {
+                line[x] = colour;
+                line[rect.width - 1 - x] = colour;
+            }
+        }
+    }
+}
+
+int AttractWall::compose(int scale, void * pixels, int pitch, std::vector<WallRect> &dirty) {
+    dirty.clear();
+
+    for (int t = 0; t < tiles; t++) {
+        Tile &tile = tileState[t];
+        if (!tile.dirty && !tile.borderDirty)
+            continue;
+
+        WallRect rect = tileRect(t, scale);
+        if (tile.borderDirty)
+            drawBorder(t, scale, pixels, pitch);
+        if (tile.dirty) {
+            byte * inside = (byte *) pixels + (rect.y + WALL_BORDER) * pitch
+                + (rect.x + WALL_BORDER) * sizeof(uint32_t);
+            expandPixels(tile.rows, 1, CHIP8_SCREEN_WIDTH, CHIP8_SCREEN_HEIGHT, scale,
+                         onColour, offColour, inside, pitch);
+        }
+        tile.dirty = false;
+        tile.borderDirty = false;
+
+        // Extend the run of dirty tiles to the left in the same grid row
+        if (!dirty.empty() && t % columns != 0 && dirty.back().y == rect.y
+            && dirty.back().x + dirty.back().width == rect.x)
+            dirty.back().width += rect.width;
+        else
+            dirty.push_back(rect);
+    }
+    return dirty.size();
+}
+
+void AttractWall::setFocus(int tile) {
+    if (tile < 0 || tile >= tiles || tile == focus)
+        return;
+
+    for (int k = 0; k < 16; k++) {
+        if (keys[k])
+            releaseKey(k);
+    }
+    tileState[focus].borderDirty = true;
+    tileState[tile].borderDirty = true;
+    focus = tile;
+}
+
+void AttractWall::moveFocus(int dx, int dy) {
+    int x = (focus % columns + dx + columns) % columns;
+    int y = (focus / columns + dy + rows) % rows;
+    int tile = y * columns + x;
+    setFocus(tile < tiles ? tile : tiles - 1);
+}
+
+void AttractWall::pressKey(byte key) {
+    Tile &tile = tileState[focus];
+    keys[key & 0xF] = 1;
+    shards[tile.shard]->scheduler.pressKey(tile.session, key);
+}
+
+void AttractWall::releaseKey(byte key) {
+    Tile &tile = tileState[focus];
+    keys[key & 0xF] = 0;
+    shards[tile.shard]->scheduler.releaseKey(tile.session, key);
+}
+
+const Chip8 &AttractWall::machine(int tile) {
+    Tile &state = tileState[tile];
+    return shards[state.shard]->scheduler.machine(state.session);
+}
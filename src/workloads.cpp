@@ -0,0 +1,149 @@
+#include "workloads.hpp"
+#include "assembler.hpp"
+#include <cstdlib>
+#include <sstream>
+
+static const char * const names[WORKLOADS] = {
+    "alu", "draw", "calls", "memory", "bcd", "timer",
+};
+
+static const int defaults[WORKLOADS] = { 64, 16, 8, 16, 16, 60 };
+static const int limits[WORKLOADS][2] = {
+    {1, 1000}, {1, 200}, {1, CHIP8_STACK_HEIGHT}, {1, CHIP8_VARIABLE_REGISTERS}, {1, 500}, {0, 255},
+};
+
+static int clampParam(Workload workload, int param) {
+    if (param < limits[workload][0])
+        return limits[workload][0];
+    if (param > limits[workload][1])
+        return limits[workload][1];
+    return param;
+}
+
+const char * workloadName(int workload) {
+    return (workload >= 0 && workload < WORKLOADS) ? names[workload] : "unknown";
+}
+
+int workloadDefault(Workload workload) {
+    return defaults[workload];
+}
+
+bool parseWorkload(const std::string &spec, Workload &workload, int &param) {
+    std::string name = spec.substr(0, spec.find(':'));
+    for (int w = 0; w < WORKLOADS; w++) {
+        if (name != names[w])
+            continue;
+        workload = (Workload) w;
+        param = spec.find(':') == std::string::npos ? defaults[w] : atoi(spec.c_str() + name.size() + 1);
+        param = clampParam(workload, param);
+        return true;
+    }
+    return false;
+}
+
+static std::string reg(int X) {
+    std::ostringstream out;
+    out << "V" << std::hex << std::uppercase << X;
+    return out.str();
+}
+
+static void alu(std::ostringstream &out, int param) {
+    static const char * const ops[] = {
+        "ADD", "XOR", "OR", "AND", "SUB", "SHR", "SUBN", "SHL", "LD",
+    };
+    out << "loop:\n";
+    for (int i = 0; i < param; i++) {
+        int X = i % 8;
+        int Y = (i + 3) % 8;
+        if (i % 10 == 9)
+            out << "    ADD " << reg(X) << ", " << (i * 37 & 0xFF) << "\n";
+        else
+            out << "    " << ops[i % 10] << " " << reg(X) << ", " << reg(Y) << "\n";
+    }
+    out << "    JP loop\n";
+}
+
+// Positions run past the right and bottom edges, and past 64 and 32 so
+// the start wraps, to cover the clipping in opDraw
+static void draw(std::ostringstream &out, int param) {
+    out << "loop:\n";
+    for (int i = 0; i < param; i++) {
+        out << "    LD V0, " << (i * 29 + 56) % 72 << "\n"
+            << "    LD V1, " << (i * 11 + 26) % 36 << "\n"
+            << "    LD I, sprite\n"
+            << "    DRW V0, V1, " << 1 + i % 15 << "\n";
+    }
+    out << "    JP loop\n"
+        << "sprite:\n"
+        << "    DB 0xFF, 0x81, 0xBD, 0xA5, 0xA5, 0xBD, 0x81, 0xFF\n"
+        << "    DB 0x18, 0x3C, 0x7E, 0xFF, 0x7E, 0x3C, 0x18\n";
+}
+
+static void calls(std::ostringstream &out, int param) {
+    out << "loop:\n"
+        << "    CALL f1\n"
+        << "    JP loop\n";
+    for (int depth = 1; depth <= param; depth++) {
+        out << "f" << depth << ":\n"
+            << "    ADD V0, 1\n";
+        if (depth < param)
+            out << "    CALL f" << depth + 1 << "\n";
+        out << "    RET\n";
+    }
+}
+
+static void memory(std::ostringstream &out, int param) {
+    out << "loop:\n"
+        << "    LD I, buffer\n"
+        << "    LD [I], " << reg(param - 1) << "\n"
+        << "    LD " << reg(param - 1) << ", [I]\n"
+        << "    ADD V0, 1\n"
+        << "    JP loop\n"
+        << "buffer:\n"
+        << "    DB 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0\n";
+}
+
+static void bcd(std::ostringstream &out, int param) {
+    out << "    LD I, digits\n"
+        << "loop:\n";
+    for (int i = 0; i < param; i++) {
+        out << "    LD B, V0\n"
+            << "    ADD V0, 7\n";
+    }
+    out << "    JP loop\n"
+        << "digits:\n"
+        << "    DB 0, 0, 0\n";
+}
+
+// FX07, 3X00, jump back is the wait the superinstructions fuse
+static void timer(std::ostringstream &out, int param) {
+    out << "loop:\n"
+        << "    LD V0, " << param << "\n"
+        << "    LD DT, V0\n"
+        << "wait:\n"
+        << "    LD V1, DT\n"
+        << "    SE V1, 0\n"
+        << "    JP wait\n"
+        << "    JP loop\n";
+}
+
+std::string workloadSource(Workload workload, int param) {
+    param = clampParam(workload, param);
+
+    std::ostringstream out;
+    out << "; " << names[workload] << ":" << param << "\n";
+    switch (workload) {
+        case WORKLOAD_ALU:      alu(out, param);        break;
+        case WORKLOAD_DRAW:     draw(out, param);       break;
+        case WORKLOAD_CALLS:    calls(out, param);      break;
+        case WORKLOAD_MEMORY:   memory(out, param);     break;
+        case WORKLOAD_BCD:      bcd(out, param);        break;
+        case WORKLOAD_TIMER:    timer(out, param);      break;
+        default:                                        break;
+    }
+    return out.str();
+}
+
+std::vector<byte> workloadRom(Workload workload, int param) {
+    return assemble(workloadSource(workload, param)).image();
+}
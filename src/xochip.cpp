@@ -0,0 +1,562 @@
+#include "xochip.hpp"
+#include <cmath>
+#include <cstring>
+#include <random>
+
+// 16 bits to 32, each bit doubled: low resolution sprites at 128x64
+static uint32_t doubleBits(uint32_t v) {
+    v = (v | (v << 8)) & 0x00FF00FF;
+    v = (v | (v << 4)) & 0x0F0F0F0F;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v | (v << 1);
+}
+
+// Rotate a 128-bit row held as two words, hi holding x = 0
+static void rotateRight(uint64_t &hi, uint64_t &lo, int n) {
+    n &= 127;
+    if (n >= 64) {
+        uint64_t t = hi;
+        hi = lo;
+        lo = t;
+        n -= 64;
+    }
+    if (n != 0) {
+        uint64_t h = (hi >> n) | (lo << (64 - n));
+        lo = (lo >> n) | (hi << (64 - n));
+        hi = h;
+    }
+}
+
+XoChip::XoChip() {
+    seedRandom(std::random_device()());
+    reset();
+}
+
+void XoChip::reset() {
+    memset(ram, 0, sizeof(ram));
+    memset(variableRegisters, 0, sizeof(variableRegisters));
+    memset(flagRegisters, 0, sizeof(flagRegisters));
+    memset(stack, 0, sizeof(stack));
+    memset(planes, 0, sizeof(planes));
+    memset(pattern, 0, sizeof(pattern));
+    memset(keyState, 0, sizeof(keyState));
+
+    stackPointer = 0;
+    programCounter = 0x200;
+    indexRegister = 0;
+    delayTimer = 0;
+    soundTimer = 0;
+    planeMask = 1;
+    hires = false;
+    exited = false;
+    draw = true;
+    pitch = 64;
+    blockingForKey = false;
+    keyFromBlock = false;
+    blockKey = 0;
+    fault = FAULT_NONE;
+    pendingFault = FAULT_NONE;
+    crash = CrashSnapshot();
+
+    byte smallFont[80] = {
+        0xF0, 0x90, 0x90, 0x90, 0xF0, 0x20, 0x60, 0x20, 0x20, 0x70, // 0 1
+        0xF0, 0x10, 0xF0, 0x80, 0xF0, 0xF0, 0x10, 0xF0, 0x10, 0xF0, // 2 3
+        0x90, 0x90, 0xF0, 0x10, 0x10, 0xF0, 0x80, 0xF0, 0x10, 0xF0, // 4 5
+        0xF0, 0x80, 0xF0, 0x90, 0xF0, 0xF0, 0x10, 0x20, 0x40, 0x40, // 6 7
+        0xF0, 0x90, 0xF0, 0x90, 0xF0, 0xF0, 0x90, 0xF0, 0x10, 0xF0, // 8 9
+        0xF0, 0x90, 0xF0, 0x90, 0x90, 0xE0, 0x90, 0xE0, 0x90, 0xE0, // A B
+        0xF0, 0x80, 0x80, 0x80, 0xF0, 0xE0, 0x90, 0x90, 0x90, 0xE0, // C D
+        0xF0, 0x80, 0xF0, 0x80, 0xF0, 0xF0, 0x80, 0xF0, 0x80, 0x80  // E F
+    };
+
+    // Octo's 8x10 font, all 16 digits
+    byte bigFont[160] = {
+        0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+        0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+        0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+        0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+        0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+        0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+        0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+        0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+        0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+        0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+        0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+        0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+    };
+
+    memcpy(ram + XOCHIP_SMALL_FONT, smallFont, sizeof(smallFont));
+    memcpy(ram + XOCHIP_BIG_FONT, bigFont, sizeof(bigFont));
+}
+
+void XoChip::load(const byte * rom, size_t length) {
+    reset();
+    if (length > XOCHIP_ROM_BYTES)
+        length = XOCHIP_ROM_BYTES;
+    memcpy(ram + 0x200, rom, length);
+}
+
+void XoChip::seedRandom(uint32_t seed) {
+    randomState = seed != 0 ? seed : 0x9E3779B9;
+}
+
+Chip8Fault XoChip::cycle() {
+    if (exited)
+        return FAULT_NONE;
+
+    word pc = programCounter;
+    word opcode = combine(ram[pc], ram[(word) (pc + 1)]);
+    programCounter += 2;
+
+    Chip8Fault raised = execute(opcode);
+    pendingFault = FAULT_NONE;
+
+    if (raised != FAULT_NONE) {
+        programCounter = pc;
+        fault = raised;
+        crash.fault = raised;
+        crash.programCounter = pc;
+        crash.opcode = opcode;
+        crash.indexRegister = indexRegister;
+        crash.stackPointer = stackPointer;
+        crash.delayTimer = delayTimer;
+        crash.soundTimer = soundTimer;
+        memcpy(crash.stack, stack, sizeof(stack));
+        memcpy(crash.variableRegisters, variableRegisters, sizeof(variableRegisters));
+    }
+    return raised;
+}
+
+int XoChip::run(int n) {
+    int executed = 0;
+    while (executed < n && !exited) {
+        if (cycle() != FAULT_NONE)
+            break;
+        executed++;
+    }
+    return executed;
+}
+
+int XoChip::frame(int n) {
+    int executed = run(n);
+    tickTimers();
+    return executed;
+}
+
+void XoChip::tickTimers() {
+    if (delayTimer > 0)
+        delayTimer--;
+    if (soundTimer > 0)
+        soundTimer--;
+}
+
+void XoChip::pressKey(byte key) {
+    if (blockingForKey) {
+        keyFromBlock = true;
+        blockKey = key & 0xF;
+    }
+    keyState[key & 0xF] = 1;
+}
+
+void XoChip::releaseKey(byte key) {
+    keyState[key & 0xF] = 0;
+}
+
+Chip8Fault XoChip::execute(word opcode) {
+    byte X = (opcode & 0x0F00) >> 8;
+    byte Y = (opcode & 0x00F0) >> 4;
+    byte N = (opcode & 0x000F);
+    byte NN = opcode & 0x00FF;
+    word NNN = opcode & 0x0FFF;
+    byte * V = variableRegisters;
+
+    switch (opcode & 0xF000) {
+        case 0x0000:    executeClearScroll(opcode);                 break;
+        case 0x1000:    programCounter = NNN;                       break;
+        case 0x2000:
+            if (stackPointer >= CHIP8_STACK_HEIGHT) {
+                raiseFault(FAULT_STACK_OVERFLOW);
+                break;
+            }
+            stack[stackPointer++] = programCounter;
+            programCounter = NNN;
+            break;
+        case 0x3000:    if (V[X] == NN) skip();                     break;
+        case 0x4000:    if (V[X] != NN) skip();                     break;
+        case 0x5000:
+            switch (N) {
+                case 0x0:   if (V[X] == V[Y]) skip();   break;
+                case 0x2:   opSaveRange(X, Y);          break;
+                case 0x3:   opLoadRange(X, Y);          break;
+                default:    raiseFault(FAULT_ILLEGAL_OPCODE);   break;
+            }
+            break;
+        case 0x6000:    V[X] = NN;                                  break;
+        case 0x7000:    V[X] += NN;                                 break;
+        case 0x8000:    executeLogicMathInstruction(opcode, X, Y);  break;
+        case 0x9000:
+            if (N == 0) {
+                if (V[X] != V[Y])
+                    skip();
+            } else {
+                raiseFault(FAULT_ILLEGAL_OPCODE);
+            }
+            break;
+        case 0xA000:    indexRegister = NNN;                        break;
+        case 0xB000:    programCounter = NNN + V[0];                break;
+        case 0xC000:
+            randomState ^= randomState << 13;
+            randomState ^= randomState >> 17;
+            randomState ^= randomState << 5;
+            V[X] = (randomState >> 24) & NN;
+            break;
+        case 0xD000:    opDraw(X, Y, N);                            break;
+        case 0xE000:
+            if (V[X] > 0xF)
+                raiseFault(FAULT_KEY_RANGE);
+            if (NN == 0x9E) {
+                if (keyState[V[X] & 0xF])
+                    skip();
+            } else if (NN == 0xA1) {
+                if (!keyState[V[X] & 0xF])
+                    skip();
+            } else {
+                raiseFault(FAULT_ILLEGAL_OPCODE);
+            }
+            break;
+        case 0xF000:    executeMiscInstruction(opcode, X);          break;
+    }
+
+    return (Chip8Fault) pendingFault;
+}
+
+void XoChip::executeClearScroll(word opcode) {
+    switch (opcode & 0xFFF0) {
+        case 0x00C0:    opScrollDown(opcode & 0xF);     return;
+        case 0x00D0:    opScrollUp(opcode & 0xF);       return;
+    }
+
+    switch (opcode) {
+        case 0x00E0:    opClear();                      break;
+        case 0x00EE:
+            if (stackPointer == 0) {
+                raiseFault(FAULT_STACK_UNDERFLOW);
+                break;
+            }
+            programCounter = stack[--stackPointer];
+            break;
+        case 0x00FB:    opScrollRight();                break;
+        case 0x00FC:    opScrollLeft();                 break;
+        case 0x00FD:    exited = true;                  break;
+        case 0x00FE:    opResolution(false);            break;
+        case 0x00FF:    opResolution(true);             break;
+        default:        raiseFault(FAULT_ILLEGAL_OPCODE);   break;
+    }
+}
+
+void XoChip::executeLogicMathInstruction(word opcode, byte X, byte Y) {
+    byte * V = variableRegisters;
+    byte flag;
+
+    switch (opcode & 0x000F) {
+        case 0x0:   V[X] = V[Y];    break;
+        case 0x1:   V[X] |= V[Y];   break;
+        case 0x2:   V[X] &= V[Y];   break;
+        case 0x3:   V[X] ^= V[Y];   break;
+        case 0x4:
+            flag = (V[X] + V[Y]) > 0xFF;
+            V[X] += V[Y];
+            V[0xF] = flag;
+            break;
+        case 0x5:
+            flag = V[X] >= V[Y];
+            V[X] -= V[Y];
+            V[0xF] = flag;
+            break;
+        case 0x7:
+            flag = V[Y] >= V[X];
+            V[X] = V[Y] - V[X];
+            V[0xF] = flag;
+            break;
+        case 0x6:   opRightShift(X, Y);     break;
+        case 0xE:   opLeftShift(X, Y);      break;
+        default:    raiseFault(FAULT_ILLEGAL_OPCODE);   break;
+    }
+}
+
+void XoChip::executeMiscInstruction(word opcode, byte X) {
+    byte * V = variableRegisters;
+
+    switch (opcode & 0x00FF) {
+        case 0x00:
+            if (X == 0)
+                opLongIndex();
+            else
+                raiseFault(FAULT_ILLEGAL_OPCODE);
+            break;
+        case 0x01:  planeMask = X & (XOCHIP_COLOURS - 1);   break;
+        case 0x02:
+            if (X != 0) {
+                raiseFault(FAULT_ILLEGAL_OPCODE);
+                break;
+            }
+            for (int i = 0; i < XOCHIP_PATTERN_BYTES; i++)
+                pattern[i] = ram[(word) (indexRegister + i)];
+            break;
+        case 0x07:  V[X] = delayTimer;                      break;
+        case 0x0A:  opGetKey(X);                            break;
+        case 0x15:  delayTimer = V[X];                      break;
+        case 0x18:  soundTimer = V[X];                      break;
+        case 0x1E:  indexRegister += V[X];                  break;
+        case 0x29:  indexRegister = XOCHIP_SMALL_FONT + 5 * (V[X] & 0xF);   break;
+        case 0x30:  indexRegister = XOCHIP_BIG_FONT + 10 * (V[X] & 0xF);    break;
+        case 0x33:  opBinaryCodedDecimal(X);                break;
+        case 0x3A:  pitch = V[X];                           break;
+        case 0x55:  opRegistersToRam(X);                    break;
+        case 0x65:  opRamToRegisters(X);                    break;
+        case 0x75:  memcpy(flagRegisters, V, X + 1);        break;
+        case 0x85:  memcpy(V, flagRegisters, X + 1);        break;
+        default:    raiseFault(FAULT_ILLEGAL_OPCODE);       break;
+    }
+}
+
+void XoChip::skip() {
+    word next = combine(ram[programCounter], ram[(word) (programCounter + 1)]);
+    programCounter += (next == 0xF000) ? 4 : 2;
+}
+
+void XoChip::opClear() {
+    for (int p = 0; p < XOCHIP_PLANES; p++) {
+        if (planeMask & (1 << p))
+            memset(planes[p], 0, sizeof(planes[p]));
+    }
+    draw = true;
+}
+
+void XoChip::opScrollDown(byte N) {
+    int rows = hires ? N : N * 2;
+    for (int p = 0; p < XOCHIP_PLANES; p++) {
+        if (!(planeMask & (1 << p)))
+            continue;
+        memmove(planes[p][rows], planes[p][0], (XOCHIP_SCREEN_HEIGHT - rows) * sizeof(planes[p][0]));
+        memset(planes[p][0], 0, rows * sizeof(planes[p][0]));
+    }
+    draw = true;
+}
+
+void XoChip::opScrollUp(byte N) {
+    int rows = hires ? N : N * 2;
+    for (int p = 0; p < XOCHIP_PLANES; p++) {
+        if (!(planeMask & (1 << p)))
+            continue;
+        memmove(planes[p][0], planes[p][rows], (XOCHIP_SCREEN_HEIGHT - rows) * sizeof(planes[p][0]));
+        memset(planes[p][XOCHIP_SCREEN_HEIGHT - rows], 0, rows * sizeof(planes[p][0]));
+    }
+    draw = true;
+}
+
+void XoChip::opScrollRight() {
+    int n = hires ? 4 : 8;
+    for (int p = 0; p < XOCHIP_PLANES; p++) {
+        if (!(planeMask & (1 << p)))
+            continue;
+        for (int y = 0; y < XOCHIP_SCREEN_HEIGHT; y++) {
+            uint64_t * row = planes[p][y];
+            row[1] = (row[1] >> n) | (row[0] << (64 - n));
+            row[0] >>= n;
+        }
+    }
+    draw = true;
+}
+
+void XoChip::opScrollLeft() {
+    int n = hires ? 4 : 8;
+    for (int p = 0; p < XOCHIP_PLANES; p++) {
+        if (!(planeMask & (1 << p)))
+            continue;
+        for (int y = 0; y < XOCHIP_SCREEN_HEIGHT; y++) {
+            uint64_t * row = planes[p][y];
+            row[0] = (row[0] << n) | (row[1] >> (64 - n));
+            row[1] <<= n;
+        }
+    }
+    draw = true;
+}
+
+void XoChip::opResolution(bool high) {
+    hires = high;
+    memset(planes, 0, sizeof(planes));
+    draw = true;
+}
+
+void XoChip::opSaveRange(byte X, byte Y) {
+    int step = (X <= Y) ? 1 : -1;
+    int count = (X <= Y) ? Y - X + 1 : X - Y + 1;
+    for (int i = 0; i < count; i++)
+        ram[(word) (indexRegister + i)] = variableRegisters[X + i * step];
+}
+
+void XoChip::opLoadRange(byte X, byte Y) {
+    int step = (X <= Y) ? 1 : -1;
+    int count = (X <= Y) ? Y - X + 1 : X - Y + 1;
+    for (int i = 0; i < count; i++)
+        variableRegisters[X + i * step] = ram[(word) (indexRegister + i)];
+}
+
+void XoChip::opRightShift(byte X, byte Y) {
+    byte flag = variableRegisters[Y] & 1;
+    variableRegisters[X] = variableRegisters[Y] >> 1;
+    variableRegisters[0xF] = flag;
+}
+
+void XoChip::opLeftShift(byte X, byte Y) {
+    byte flag = variableRegisters[Y] >> 7;
+    variableRegisters[X] = variableRegisters[Y] << 1;
+    variableRegisters[0xF] = flag;
+}
+
+void XoChip::opDraw(byte X, byte Y, byte N) {
+    // Sprite rows are 8 or 16 bits, doubled in width and height at low
+    // resolution; each selected plane takes the next rows * bytes of data
+    int width = (N == 0) ? 16 : 8;
+    int rows = (N == 0) ? 16 : N;
+    int rowBytes = width / 8;
+    int scale = hires ? 1 : 2;
+    int x = (variableRegisters[X] % (XOCHIP_SCREEN_WIDTH / scale)) * scale;
+    int y = (variableRegisters[Y] % (XOCHIP_SCREEN_HEIGHT / scale)) * scale;
+    int bits = width * scale;
+
+    word address = indexRegister;
+    byte collided = 0;
+
+    for (int p = 0; p < XOCHIP_PLANES; p++) {
+        if (!(planeMask & (1 << p)))
+            continue;
+
+        for (int r = 0; r < rows; r++) {
+            uint32_t sprite = ram[address];
+            if (rowBytes == 2)
+                sprite = (sprite << 8) | ram[(word) (address + 1)];
+            address += rowBytes;
+            if (sprite == 0)
+                continue;
+            if (scale == 2)
+                sprite = doubleBits(sprite);
+
+            uint64_t hi = (uint64_t) sprite << (64 - bits);
+            uint64_t lo = 0;
+            rotateRight(hi, lo, x);
+
+            for (int d = 0; d < scale; d++) {
+                uint64_t * row = planes[p][(y + r * scale + d) % XOCHIP_SCREEN_HEIGHT];
+                if ((row[0] & hi) | (row[1] & lo))
+                    collided = 1;
+                row[0] ^= hi;
+                row[1] ^= lo;
+            }
+        }
+    }
+
+    variableRegisters[0xF] = collided;
+    draw = true;
+}
+
+void XoChip::opLongIndex() {
+    indexRegister = combine(ram[programCounter], ram[(word) (programCounter + 1)]);
+    programCounter += 2;
+}
+
+void XoChip::opGetKey(byte X) {
+    // Only a key pressed while waiting counts, once released
+    if (!blockingForKey) {
+        blockingForKey = true;
+        keyFromBlock = false;
+    }
+
+    if (keyFromBlock && keyState[blockKey] == 0) {
+        variableRegisters[X] = blockKey;
+        blockingForKey = false;
+        return;
+    }
+
+    programCounter -= 2;
+}
+
+void XoChip::opBinaryCodedDecimal(byte X) {
+    byte value = variableRegisters[X];
+    ram[indexRegister] = value / 100;
+    ram[(word) (indexRegister + 1)] = (value / 10) % 10;
+    ram[(word) (indexRegister + 2)] = value % 10;
+}
+
+void XoChip::opRegistersToRam(byte X) {
+    for (int i = 0; i <= X; i++)
+        ram[(word) (indexRegister + i)] = variableRegisters[i];
+    indexRegister += X + 1;
+}
+
+void XoChip::opRamToRegisters(byte X) {
+    for (int i = 0; i <= X; i++)
+        variableRegisters[i] = ram[(word) (indexRegister + i)];
+    indexRegister += X + 1;
+}
+
+int XoChip::pixel(int x, int y) const {
+    int colour = 0;
+    for (int p = 0; p < XOCHIP_PLANES; p++) {
+        uint64_t w = planes[p][y][x / 64];
+        colour |= ((w >> (63 - x % 64)) & 1) << p;
+    }
+    return colour;
+}
+
+void XoChip::render(const uint32_t * palette, int scale, void * pixels, int pitch) const {
+    for (int y = 0; y < XOCHIP_SCREEN_HEIGHT; y++) {
+        uint32_t * line = (uint32_t *) ((byte *) pixels + y * scale * pitch);
+
+        // One word per plane at a time: 64 pixels shifted out together
+        for (int w = 0; w < XOCHIP_ROW_WORDS; w++) {
+            uint64_t words[XOCHIP_PLANES];
+            for (int p = 0; p < XOCHIP_PLANES; p++)
+                words[p] = planes[p][y][w];
+
+            for (int b = 0; b < 64; b++) {
+                int colour = 0;
+                for (int p = 0; p < XOCHIP_PLANES; p++)
+                    colour |= ((words[p] >> (63 - b)) & 1) << p;
+                uint32_t * out = line + (w * 64 + b) * scale;
+                for (int s = 0; s < scale; s++)
+                    out[s] = palette[colour];
+            }
+        }
+
+        for (int s = 1; s < scale; s++)
+            memcpy((byte *) line + s * pitch, line, XOCHIP_SCREEN_WIDTH * scale * sizeof(uint32_t));
+    }
+}
+
+double XoChip::patternRate() const {
+    return XOCHIP_PATTERN_RATE * std::pow(2.0, (pitch - 64) / 48.0);
+}
+
+void XoChip::renderAudio(int16_t * out, int count, int sampleRate, double &phase) const {
+    if (soundTimer == 0) {
+        memset(out, 0, count * sizeof(int16_t));
+        return;
+    }
+
+    double step = patternRate() / sampleRate;
+    int patternBits = XOCHIP_PATTERN_BYTES * 8;
+    for (int i = 0; i < count; i++) {
+        int bit = (int) phase;
+        out[i] = ((pattern[bit / 8] >> (7 - bit % 8)) & 1) ? 8000 : -8000;
+        phase += step;
+        if (phase >= patternBits)
+            phase -= patternBits;
+    }
+}
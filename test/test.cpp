@@ -19,6 +19,18 @@ TEST_CASE("Jump to an address", "[Opcodes]") {
     REQUIRE(chip.programCounter == 0xB0B);
 }
 
+TEST_CASE("Jump to an address plus V0", "[Opcodes]") {
+    Chip8 chip{};
+    chip.variableRegisters[0] = 0x10;
+    REQUIRE(chip.execute(0xB300) == FAULT_NONE);
+    REQUIRE(chip.programCounter == 0x310);
+
+    // Past the end of RAM wraps around
+    chip.variableRegisters[0] = 0xFF;
+    REQUIRE(chip.execute(0xBFF0) == FAULT_NONE);
+    REQUIRE(chip.programCounter == 0x0EF);
+}
+
 TEST_CASE("Set register", "[Opcodes]") {
     Chip8 chip{};
     chip.opSetRegister(0x0, 0xBA);
@@ -299,6 +311,33 @@ TEST_CASE("Skip if key not down: false case", "[Opcodes]") {
     REQUIRE(chip.programCounter == 0x200);
 }
 
+TEST_CASE("Set delay timer from register", "[Opcodes]") {
+    Chip8 chip{};
+
+    chip.variableRegisters[0x3] = 0x2A;
+    chip.opSetDelayTimer(0x3);
+
+    REQUIRE(chip.delayTimer == 0x2A);
+}
+
+TEST_CASE("Set sound timer from register", "[Opcodes]") {
+    Chip8 chip{};
+
+    chip.variableRegisters[0x3] = 0x2A;
+    chip.opSetSoundTimer(0x3);
+
+    REQUIRE(chip.soundTimer == 0x2A);
+}
+
+TEST_CASE("Font character address", "[Opcodes]") {
+    Chip8 chip{};
+
+    chip.variableRegisters[0x2] = 0xA;
+    chip.opFontChar(0x2);
+
+    REQUIRE(chip.indexRegister == 0x050 + 5 * 0xA);
+}
+
 TEST_CASE("Binary coded decimal", "[Opcodes]") {
     Chip8 chip{};
 
@@ -309,4 +348,208 @@ TEST_CASE("Binary coded decimal", "[Opcodes]") {
     REQUIRE(chip.ram[0xB00] == 0x02);
     REQUIRE(chip.ram[0xB00 + 1] == 0x05);
     REQUIRE(chip.ram[0xB00 + 2] == 0x05);
-}
\ No newline at end of file
+}
+TEST_CASE("Fuse set index and draw", "[Superinstructions]") {
+    Chip8 chip{};
+    byte rom[CHIP8_ROM_BYTES] = { 0xA0, 0x50, 0xD0, 0x15, 0x12, 0x04 };
+    chip.load(rom);
+
+    REQUIRE(chip.fusedOps[0x200] == FUSED_INDEX_DRAW);
+    REQUIRE(chip.run(10) == 10);
+    REQUIRE(chip.indexRegister == 0x050);
+    REQUIRE(chip.displayBuffer[0][0] == 1);
+    REQUIRE(chip.programCounter == 0x204);
+}
+
+TEST_CASE("Fused timer wait matches single steps", "[Superinstructions]") {
+    // 6005 F015 F007 3000 1204: wait for the delay timer to run out
+    byte rom[CHIP8_ROM_BYTES] = {
+        0x60, 0x05, 0xF0, 0x15, 0xF0, 0x07, 0x30, 0x00, 0x12, 0x04
+    };
+    Chip8 stepped{};
+    Chip8 fused{};
+    stepped.load(rom);
+    fused.load(rom);
+
+    REQUIRE(fused.fusedOps[0x204] == FUSED_TIMER_WAIT);
+
+    for (int i = 0; i < 20; i++) {
+        stepped.cycle();
+    }
+    fused.run(20);
+
+    REQUIRE(fused.programCounter == stepped.programCounter);
+    REQUIRE(fused.delayTimer == stepped.delayTimer);
+    REQUIRE(fused.variableRegisters[0] == stepped.variableRegisters[0]);
+}
+
+TEST_CASE("Writing over code unfuses it", "[Superinstructions]") {
+    Chip8 chip{};
+    byte rom[CHIP8_ROM_BYTES] = { 0x60, 0x01, 0x61, 0x02 };
+    chip.load(rom);
+    REQUIRE(chip.fusedOps[0x200] == FUSED_SET_PAIR);
+
+    chip.indexRegister = 0x202;
+    chip.variableRegisters[0] = 0x00;
+    chip.opRegistersToRam(0);
+    REQUIRE(chip.fusedOps[0x200] == FUSED_NONE);
+}
+
+TEST_CASE("Spin loop only advances timers", "[Superinstructions]") {
+    Chip8 chip{};
+    byte rom[CHIP8_ROM_BYTES] = { 0x12, 0x00 };
+    chip.load(rom);
+    chip.delayTimer = 10;
+    chip.soundTimer = 4;
+
+    REQUIRE(chip.run(100) == 100);
+    REQUIRE(chip.programCounter == 0x200);
+    REQUIRE(chip.delayTimer == 0);
+    REQUIRE(chip.soundTimer == 0);
+    REQUIRE(chip.sound == false);
+}
+
+TEST_CASE("Superinstructions are not run past the end of RAM", "[Superinstructions]") {
+    // A spin fused at 0x000 must not run for a PC of 0x1000
+    byte rom[CHIP8_ROM_BYTES] = { 0x1F, 0xFE };
+    rom[0xDFE] = 0x60;
+    Chip8 fused{}, plain{};
+    for (Chip8 * chip : { &fused, &plain }) {
+        chip->load(rom);
+        chip->ram[0x000] = 0x10;
+        chip->ram[0x001] = 0x00;
+        chip->fuseInstructions();
+        chip->rehashMemory();
+    }
+    plain.useSuperinstructions = false;
+    REQUIRE(fused.fusedOps[0x000] == FUSED_SPIN);
+
+    REQUIRE(fused.run(100) == 2);
+    REQUIRE(plain.run(100) == 2);
+    REQUIRE(fused.fault == FAULT_MEMORY_RANGE);
+    REQUIRE(plain.fault == FAULT_MEMORY_RANGE);
+    REQUIRE(fused.programCounter == plain.programCounter);
+
+    fused.fault = FAULT_NONE;
+    REQUIRE(fused.dispatch(100) == 0);
+    REQUIRE(fused.fault == FAULT_MEMORY_RANGE);
+}
+
+TEST_CASE("Illegal opcode faults instead of exiting", "[Faults]") {
+    Chip8 chip{};
+    byte rom[CHIP8_ROM_BYTES] = { 0xFF, 0xFF };
+    chip.load(rom);
+
+    REQUIRE(chip.cycle() == FAULT_ILLEGAL_OPCODE);
+    REQUIRE(chip.fault == FAULT_ILLEGAL_OPCODE);
+    REQUIRE(chip.programCounter == 0x200);
+    REQUIRE(chip.crash.opcode == 0xFFFF);
+    REQUIRE(chip.crash.programCounter == 0x200);
+}
+
+TEST_CASE("Stack overflow and underflow fault", "[Faults]") {
+    Chip8 chip{};
+    chip.stackPointer = CHIP8_STACK_HEIGHT;
+    REQUIRE(chip.execute(0x2300) == FAULT_STACK_OVERFLOW);
+    REQUIRE(chip.stackPointer == CHIP8_STACK_HEIGHT);
+
+    chip.stackPointer = 0;
+    REQUIRE(chip.execute(0x00EE) == FAULT_STACK_UNDERFLOW);
+    REQUIRE(chip.stackPointer == 0);
+}
+
+TEST_CASE("Out of range RAM access wraps and faults", "[Faults]") {
+    Chip8 chip{};
+    chip.indexRegister = 0xFFF;
+    chip.variableRegisters[0x0] = 0xAA;
+    chip.variableRegisters[0x1] = 0xBB;
+
+    REQUIRE(chip.execute(0xF155) == FAULT_MEMORY_RANGE);
+    REQUIRE(chip.ram[0xFFF] == 0xAA);
+    REQUIRE(chip.ram[0x000] == 0xBB);
+
+    // The next instruction starts clean
+    REQUIRE(chip.execute(0x6000) == FAULT_NONE);
+}
+
+TEST_CASE("Key index above 0xF faults", "[Faults]") {
+    Chip8 chip{};
+    chip.variableRegisters[0x0] = 0x10;
+    REQUIRE(chip.execute(0xE09E) == FAULT_KEY_RANGE);
+}
+
+TEST_CASE("Crash snapshot as JSON", "[Faults]") {
+    Chip8 chip{};
+    byte rom[CHIP8_ROM_BYTES] = { 0x00, 0xEE };
+    chip.load(rom);
+    chip.cycle();
+
+    std::string json = chip.crash.toJson();
+    REQUIRE(json.find("\"fault\":\"stack_underflow\"") != std::string::npos);
+    REQUIRE(json.find("\"pc\":512") != std::string::npos);
+}
+
+TEST_CASE("Packed display rows follow the display buffer", "[Opcodes]") {
+    Chip8 chip{};
+    chip.ram[0x300] = 0xFF;
+    chip.ram[0x301] = 0x81;
+    chip.indexRegister = 0x300;
+    chip.variableRegisters[0x0] = 60;
+    chip.variableRegisters[0x1] = 31;
+
+    // Clipped on the right and at the bottom
+    chip.opDraw(0x0, 0x1, 2);
+    REQUIRE(chip.displayRows[31] == 0xFULL);
+
+    chip.variableRegisters[0x0] = 2;
+    chip.variableRegisters[0x1] = 0;
+    chip.opDraw(0x0, 0x1, 2);
+    chip.opDraw(0x0, 0x1, 1);
+
+    bool same = true;
+    for (int y = 0; y < CHIP8_SCREEN_HEIGHT; y++) {
+        for (int x = 0; x < CHIP8_SCREEN_WIDTH; x++) {
+            same = same && ((chip.displayRows[y] >> (63 - x)) & 1) == chip.displayBuffer[y][x];
+        }
+    }
+    REQUIRE(same);
+    REQUIRE(chip.displayRows[0] == 0);
+    REQUIRE(chip.displayRows[1] == (0x81ULL << 54));
+}
+
+TEST_CASE("Incremental fingerprint matches a full rehash", "[Fingerprint]") {
+    Chip8 chip{};
+    // V0 = 123, I = 0x300, BCD, store V0-V2, draw at (V0, V1), clear, draw, spin
+    byte rom[CHIP8_ROM_BYTES] = { 0x60, 0x7B, 0xA3, 0x00, 0xF0, 0x33, 0xF2, 0x55,
+                                  0xD0, 0x15, 0x00, 0xE0, 0xD0, 0x15, 0x12, 0x0E };
+    chip.load(rom);
+    uint64_t loaded = chip.fingerprint();
+
+    chip.run(20);
+    REQUIRE(chip.fingerprint() != loaded);
+
+    uint64_t incremental = chip.memoryFingerprint;
+    chip.rehashMemory();
+    REQUIRE(chip.memoryFingerprint == incremental);
+}
+
+TEST_CASE("Equal states have equal fingerprints", "[Fingerprint]") {
+    Chip8 a{};
+    Chip8 b{};
+    REQUIRE(a.fingerprint() == b.fingerprint());
+
+    // Write and undo: same state, same fingerprint
+    a.writeRam(0x400, 7);
+    a.writeRam(0x400, 0);
+    a.variableRegisters[0x3] = 1;
+    REQUIRE(a.fingerprint() != b.fingerprint());
+
+    a.variableRegisters[0x3] = 0;
+    REQUIRE(a.fingerprint() == b.fingerprint());
+
+    // Stale stack entries past SP are ignored
+    a.opCall(0x300);
+    a.opReturn();
+    a.programCounter = b.programCounter;
+    REQUIRE(a.fingerprint() == b.fingerprint());
+}
@@ -0,0 +1,89 @@
+#include "assembler.hpp"
+#include "disassembler.hpp"
+#include "verifier.hpp"
+#include "workloads.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <vector>
+
+TEST_CASE("Every disassembled opcode assembles back to itself", "[assembler]") {
+    int checked = 0;
+    for (int opcode = 0; opcode <= 0xFFFF; opcode++) {
+        std::string text = disassemble(opcode);
+        if (text.empty())
+            continue;
+
+        Assembly assembly = assemble(text);
+        INFO(text);
+        REQUIRE(assembly.ok());
+        REQUIRE(assembly.rom.size() == 2);
+        REQUIRE(combine(assembly.rom[0], assembly.rom[1]) == opcode);
+        checked++;
+    }
+    REQUIRE(checked > 30000);
+}
+
+TEST_CASE("Labels, data and offsets", "[assembler]") {
+    Assembly assembly = assemble(
+        "start:  ld i, sprite      ; lower case works too\n"
+        "        drw v0, v1, 2\n"
+        "        jp start+2\n"
+        "        shr v3\n"
+        "sprite: db 0xF0, 0b1001\n"
+        "table:  dw 0x1234, sprite\n");
+
+    REQUIRE(assembly.ok());
+    REQUIRE(assembly.labels["start"] == 0x200);
+    REQUIRE(assembly.labels["sprite"] == 0x208);
+    REQUIRE(assembly.labels["table"] == 0x20A);
+    REQUIRE(assembly.rom == std::vector<byte>({
+        0xA2, 0x08, 0xD0, 0x12, 0x12, 0x02, 0x83, 0x36,
+        0xF0, 0x09, 0x12, 0x34, 0x02, 0x08,
+    }));
+    REQUIRE(assembly.image().size() == CHIP8_ROM_BYTES);
+}
+
+TEST_CASE("Assembly errors name their line", "[assembler]") {
+    Assembly assembly = assemble(
+        "        LD V0, 0x100\n"
+        "        JP nowhere\n"
+        "        FOO V1\n"
+        "V2:     CLS\n");
+
+    REQUIRE_FALSE(assembly.ok());
+    REQUIRE(assembly.errors.size() == 4);
+    REQUIRE(assembly.errors[0].line == 4);
+    REQUIRE(assembly.errors[1].line == 1);
+    REQUIRE(assembly.errors[2].line == 2);
+    REQUIRE(assembly.errors[3].line == 3);
+}
+
+TEST_CASE("Workloads assemble and run without faults", "[assembler]") {
+    for (int w = 0; w < WORKLOADS; w++) {
+        Workload workload;
+        int param;
+        REQUIRE(parseWorkload(workloadName(w), workload, param));
+        REQUIRE(workload == w);
+
+        INFO(workloadName(w));
+        REQUIRE(assemble(workloadSource(workload, param)).ok());
+
+        // Fused and stepped must agree on generated code as well
+        Lockstep lockstep(workloadRom(workload, param));
+        REQUIRE(lockstep.run(20000, 1));
+        REQUIRE(lockstep.executed == 20000);
+        REQUIRE(lockstep.reference.fault == FAULT_NONE);
+    }
+}
+
+TEST_CASE("Call chains reach the full stack depth", "[assembler]") {
+    Workload workload;
+    int param;
+    REQUIRE(parseWorkload("calls:99", workload, param));
+    REQUIRE(param == CHIP8_STACK_HEIGHT);
+
+    Chip8 sys;
+    sys.load(workloadRom(workload, param).data());
+    REQUIRE(sys.run(10000) == 10000);
+    REQUIRE(sys.fault == FAULT_NONE);
+}
@@ -0,0 +1,118 @@
+#include "chip8.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef CHIP8_ROM_DIR
+#define CHIP8_ROM_DIR "roms"
+#endif
+
+// A key going down or up before the given instruction
+struct ScriptedKey {
+    long at;
+    byte key;
+    bool down;
+};
+
+// The display after running a ROM for a fixed number of instructions
+// from seed 1 with scripted input
+struct GoldenFrame {
+    const char * rom;
+    long instructions;
+    std::vector<ScriptedKey> keys;
+    uint64_t frameHash;
+};
+
+static const std::vector<GoldenFrame> goldenFrames = {
+    { "IBM.ch8", 1000, {}, 0x79d962e07c11ef0b },
+    { "chip8logo.ch8", 2000, {}, 0x4483f2e8606cbd26 },
+    { "corax+.ch8", 5000, {}, 0xae1c00afccf01074 },
+    { "4-flags.ch8", 5000, {}, 0x2547a52a70e879a0 },
+    // Pick the FX0A test from the menu, then press and release 5
+    { "6-keypad.ch8", 20000, {{2000, 0x3, true}, {3000, 0x3, false},
+        {8000, 0x5, true}, {9000, 0x5, false}}, 0x53c4c5a15756f5f7 },
+    // Hold B so the beep sprite is up
+    { "7-beep.ch8", 3500, {{1000, 0xB, true}}, 0x7891dc2378b229dd },
+    { "Breakout.ch8", 30000, {{5000, 0x4, true}, {9000, 0x4, false},
+        {12000, 0x6, true}, {20000, 0x6, false}}, 0x71a31d4f43c668ba },
+    { "pong.ch8", 30000, {{2000, 0x1, true}, {8000, 0x1, false},
+        {10000, 0xC, true}, {16000, 0xC, false}}, 0xae7f03a01153104e },
+    { "ZeroPong.ch8", 30000, {{4000, 0x1, true}, {12000, 0x1, false}}, 0x9c127a14f1959431 },
+    { "space-invaders.ch8", 40000, {{3000, 0x5, true}, {4000, 0x5, false},
+        {10000, 0x4, true}, {14000, 0x4, false}, {15000, 0x5, true}, {16000, 0x5, false}}, 0x1a2c8bd1bb9846d3 },
+    { "shooting-stars.ch8", 20000, {}, 0x0cdd5194e4dc9d89 },
+};
+
+static uint64_t hashFrame(const Chip8 &sys) {
+    uint64_t h = 0;
+    for (int y = 0; y < CHIP8_SCREEN_HEIGHT; y++) {
+        h = ((h << 29 | h >> 35) ^ sys.displayRows[y]) * 0x9E3779B97F4A7C15ULL;
+    }
+    return h ^ (h >> 32);
+}
+
+// The frame hash and fault after a golden run, one instruction at a time
+// through cycle() or fused through run(). False if the ROM is missing.
+static bool runGolden(const GoldenFrame &golden, bool fused, uint64_t &frameHash, byte &fault) {
+    std::vector<byte> rom(CHIP8_ROM_BYTES, 0);
+    std::ifstream in(std::string(CHIP8_ROM_DIR) + "/" + golden.rom, std::ios_base::in | std::ios_base::binary);
+    if (!in)
+        return false;
+    in.read((char *) rom.data(), CHIP8_ROM_BYTES);
+
+    Chip8 sys;
+    sys.load(rom.data());
+    sys.seedRandom(1);
+
+    long done = 0;
+    size_t next = 0;
+    while (done < golden.instructions) {
+        while (next < golden.keys.size() && golden.keys[next].at <= done) {
+            if (golden.keys[next].down)
+                sys.pressKey(golden.keys[next].key);
+            else
+                sys.releaseKey(golden.keys[next].key);
+            next++;
+        }
+
+        long until = next < golden.keys.size() ? golden.keys[next].at : golden.instructions;
+        if (fused) {
+            done += sys.run(until - done);
+        } else {
+            for (; done < until && sys.cycle() == FAULT_NONE; done++) {}
+        }
+        if (sys.fault != FAULT_NONE)
+            break;
+    }
+    frameHash = hashFrame(sys);
+    fault = sys.fault;
+    return true;
+}
+
+TEST_CASE("Test ROMs reach their golden frames", "[conformance]") {
+    // Every ROM and path on its own thread; assertions stay on this one
+    size_t count = goldenFrames.size();
+    std::vector<uint64_t> stepped(count), fused(count);
+    std::vector<byte> steppedFault(count), fusedFault(count);
+    std::vector<char> found(count);
+    std::vector<std::thread> runs;
+    for (size_t i = 0; i < count; i++) {
+        runs.push_back(std::thread([&, i]() { found[i] = runGolden(goldenFrames[i], false, stepped[i], steppedFault[i]); }));
+        runs.push_back(std::thread([&, i]() { runGolden(goldenFrames[i], true, fused[i], fusedFault[i]); }));
+    }
+    for (size_t t = 0; t < runs.size(); t++) {
+        runs[t].join();
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        INFO(goldenFrames[i].rom);
+        REQUIRE(found[i]);
+        REQUIRE(steppedFault[i] == FAULT_NONE);
+        REQUIRE(fusedFault[i] == FAULT_NONE);
+        CHECK(stepped[i] == goldenFrames[i].frameHash);
+        CHECK(fused[i] == goldenFrames[i].frameHash);
+    }
+}
@@ -0,0 +1,119 @@
+#include "crawler.hpp"
+#include "assembler.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+
+static CrawlResult crawl(const char * source, long frames = CRAWL_SECONDS * CRAWL_FRAME_RATE) {
+    Assembly assembly = assemble(source);
+    REQUIRE(assembly.ok());
+    return crawlRom("test.ch8", assembly.rom, frames, CRAWL_CYCLES_PER_FRAME, 1);
+}
+
+TEST_CASE("ROMs that keep drawing are ok", "[crawler]") {
+    CrawlResult result = crawl(
+        "loop:   LD F, V0\n"
+        "        DRW V1, V2, 5\n"
+        "        ADD V0, 1\n"
+        "        JP loop\n", 100);
+    REQUIRE(result.verdict == CRAWL_OK);
+    REQUIRE(result.fault == FAULT_NONE);
+    REQUIRE(result.frames == 100);
+    REQUIRE(result.instructions == 100 * CRAWL_CYCLES_PER_FRAME);
+}
+
+TEST_CASE("Waiting for keys is not a hang", "[crawler]") {
+    CrawlResult result = crawl(
+        "loop:   LD V0, K\n"
+        "        LD F, V0\n"
+        "        DRW V1, V2, 5\n"
+        "        JP loop\n");
+    REQUIRE(result.verdict == CRAWL_OK);
+    REQUIRE(result.frames == CRAWL_SECONDS * CRAWL_FRAME_RATE);
+}
+
+TEST_CASE("Faults are classified and end the run", "[crawler]") {
+    CrawlResult illegal = crawl(
+        "        CLS\n"
+        "        DW 0xFFFF\n");
+    REQUIRE(illegal.verdict == CRAWL_ILLEGAL_OPCODE);
+    REQUIRE(illegal.fault == FAULT_ILLEGAL_OPCODE);
+    REQUIRE(illegal.programCounter == 0x202);
+    REQUIRE(illegal.opcode == 0xFFFF);
+    REQUIRE(illegal.frames == 1);
+
+    CrawlResult stack = crawl("self:   CALL self\n");
+    REQUIRE(stack.verdict == CRAWL_STACK_FAULT);
+    REQUIRE(stack.fault == FAULT_STACK_OVERFLOW);
+    REQUIRE(std::string(verdictName(stack.verdict)) == "stack_fault");
+}
+
+TEST_CASE("A frozen screen is a hang unless the ROM finished", "[crawler]") {
+    // Drawn, then parked on a jump to itself
+    CrawlResult finished = crawl(
+        "        LD V0, 5\n"
+        "        LD F, V0\n"
+        "        DRW V1, V2, 5\n"
+        "spin:   JP spin\n");
+    REQUIRE(finished.verdict == CRAWL_OK);
+    REQUIRE(finished.frames == CRAWL_HANG_FRAMES + 1);
+    REQUIRE(finished.programCounter == 0x206);
+    REQUIRE(finished.litPixels == 14);
+
+    // Drawn, then going round a loop that changes nothing else
+    CrawlResult hang = crawl(
+        "        LD F, V0\n"
+        "        DRW V1, V2, 5\n"
+        "loop:   ADD V3, 1\n"
+        "        JP loop\n");
+    REQUIRE(hang.verdict == CRAWL_HANG);
+    REQUIRE(hang.frames == CRAWL_HANG_FRAMES + 1);
+
+    // Parked without drawing anything
+    CrawlResult dark = crawl("spin:   JP spin\n");
+    REQUIRE(dark.verdict == CRAWL_HANG);
+}
+
+TEST_CASE("A screen never lit is a blank screen", "[crawler]") {
+    // Busy writing RAM, never drawing
+    CrawlResult blank = crawl(
+        "        LD I, 0x400\n"
+        "loop:   ADD V0, 1\n"
+        "        LD [I], V0\n"
+        "        JP loop\n");
+    REQUIRE(blank.verdict == CRAWL_BLANK_SCREEN);
+    REQUIRE(blank.litPixels == 0);
+}
+
+TEST_CASE("CSV rows read back for resuming", "[crawler]") {
+    CrawlResult result;
+    result.rom = "roms/a \"quoted\", name.ch8";
+    result.verdict = CRAWL_STACK_FAULT;
+    result.fault = FAULT_STACK_UNDERFLOW;
+    result.programCounter = 0x2A4;
+    result.opcode = 0x00EE;
+    result.frames = 12;
+    result.instructions = 140;
+    result.litPixels = 96;
+
+    CrawlResult read;
+    REQUIRE_FALSE(crawlFromCsv(crawlCsvHeader(), read));
+    REQUIRE_FALSE(crawlFromCsv("roms/x.ch8,maybe,none,0x000,0x0000,0,0,0", read));
+    REQUIRE(crawlToCsv(result) == "\"roms/a \"\"quoted\"\", name.ch8\",stack_fault,stack_underflow,"
+        "0x2A4,0x00EE,12,140,96");
+    REQUIRE(crawlFromCsv(crawlToCsv(result), read));
+    REQUIRE(read.rom == result.rom);
+    REQUIRE(read.verdict == result.verdict);
+    REQUIRE(read.fault == result.fault);
+    REQUIRE(read.programCounter == result.programCounter);
+    REQUIRE(read.opcode == result.opcode);
+    REQUIRE(read.frames == result.frames);
+    REQUIRE(read.instructions == result.instructions);
+    REQUIRE(read.litPixels == result.litPixels);
+
+    REQUIRE(crawlToJson(result) == "{\"rom\":\"roms/a \\\"quoted\\\", name.ch8\",\"verdict\":\"stack_fault\","
+        "\"fault\":\"stack_underflow\",\"pc\":\"0x2A4\",\"opcode\":\"0x00EE\",\"frames\":12,\"instructions\":140,"
+        "\"lit_pixels\":96}");
+
+    result.rom = "roms/tab\there.ch8";
+    REQUIRE(crawlToJson(result).find("{\"rom\":\"roms/tab\\u0009here.ch8\"") == 0);
+}
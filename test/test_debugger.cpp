@@ -0,0 +1,143 @@
+#include "debugger.hpp"
+#include "assembler.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static const char * program =
+    "loop:   ADD V0, 1\n"           // 0x200
+    "        CALL outer\n"          // 0x202
+    "        LD I, 0x300\n"         // 0x204
+    "        LD B, V0\n"            // 0x206
+    "        JP loop\n"             // 0x208
+    "outer:  CALL inner\n"          // 0x20A
+    "        RET\n"                 // 0x20C
+    "inner:  LD V1, V0\n"           // 0x20E
+    "        RET\n";                // 0x210
+
+static bool contains(const std::string &text, const std::string &part) {
+    return text.find(part) != std::string::npos;
+}
+
+struct Machine {
+    Chip8 sys;
+    Debugger debugger;
+
+    Machine() : debugger(sys) {
+        sys.load(assemble(program).image().data());
+    }
+};
+
+TEST_CASE("Breakpoints stop before their instruction", "[debugger]") {
+    Machine m;
+    int id = m.debugger.addBreakpoint(0x20E);
+    REQUIRE(m.debugger.resume(1000) == STOP_BREAKPOINT);
+    REQUIRE(m.debugger.lastHit == id);
+    REQUIRE(m.sys.programCounter == 0x20E);
+
+    // Continuing steps past the breakpoint it stopped at
+    REQUIRE(m.debugger.resume(1000) == STOP_BREAKPOINT);
+    REQUIRE(m.sys.variableRegisters[0] == 2);
+
+    std::vector<word> frames = m.debugger.callStack();
+    REQUIRE(frames == std::vector<word>({0x20C, 0x204}));
+}
+
+TEST_CASE("Conditional breakpoints test a register", "[debugger]") {
+    Machine m;
+    m.debugger.command("break 0x200 if V0 == 5");
+    REQUIRE(m.debugger.resume(1000) == STOP_BREAKPOINT);
+    REQUIRE(m.sys.variableRegisters[0] == 5);
+
+    m.debugger.command("delete 1");
+    REQUIRE(m.debugger.resume(1000) == STOP_LIMIT);
+}
+
+TEST_CASE("Watchpoints stop after RAM or I is touched", "[debugger]") {
+    Machine m;
+    m.debugger.command("watch write 0x302");
+    REQUIRE(m.debugger.resume(1000) == STOP_WATCHPOINT);
+    REQUIRE(m.debugger.lastHitAddress == 0x302);
+    REQUIRE(m.debugger.lastHitPc == 0x206);
+    REQUIRE(m.sys.programCounter == 0x208);
+    REQUIRE(m.sys.ram[0x302] == 1);
+
+    Machine index;
+    index.debugger.command("watch I");
+    REQUIRE(index.debugger.resume(1000) == STOP_WATCHPOINT);
+    REQUIRE(index.debugger.lastHitPc == 0x204);
+
+    // Nothing reads this range
+    Machine unread;
+    unread.debugger.command("watch read 0x300-0x3FF");
+    REQUIRE(unread.debugger.resume(1000) == STOP_LIMIT);
+}
+
+TEST_CASE("Step over and step out follow the stack", "[debugger]") {
+    Machine m;
+    m.debugger.step();
+    REQUIRE(m.sys.programCounter == 0x202);
+    REQUIRE(m.debugger.stepOver() == STOP_STEP);
+    REQUIRE(m.sys.programCounter == 0x204);
+    REQUIRE(m.sys.variableRegisters[1] == 1);
+
+    m.debugger.step(3);
+    REQUIRE(m.debugger.step(3) == STOP_STEP);
+    REQUIRE(m.sys.programCounter == 0x20E);
+    REQUIRE(m.debugger.stepOut() == STOP_STEP);
+    REQUIRE(m.sys.programCounter == 0x20C);
+    REQUIRE(m.debugger.stepOut() == STOP_STEP);
+    REQUIRE(m.sys.programCounter == 0x204);
+}
+
+TEST_CASE("Debugger commands", "[debugger]") {
+    Machine m;
+    REQUIRE(contains(m.debugger.command("break 0x20E"), "breakpoint 1 at 0x20E"));
+    REQUIRE(contains(m.debugger.command("continue"), "breakpoint 1 at 0x20E: 0x8100  LD V1, V0"));
+    REQUIRE(contains(m.debugger.command("stack"), "#2 0x204  called from 0x202"));
+    REQUIRE(contains(m.debugger.command("regs"), "pc 0x20E"));
+    REQUIRE(contains(m.debugger.command("dis 0x20E 1"), ">* 0x20E"));
+    REQUIRE(contains(m.debugger.command("mem 0x200 2"), "0x200: 70 01"));
+    REQUIRE(contains(m.debugger.command("list"), "1\tbreak 0x20E"));
+    REQUIRE(contains(m.debugger.command("bogus"), "unknown command"));
+    m.debugger.command("quit");
+    REQUIRE(m.debugger.quit);
+}
+
+TEST_CASE("Debugger commands over a local socket", "[debugger]") {
+    std::string path = "/tmp/chip8-debug-test-" + std::to_string(getpid());
+    Machine m;
+    DebugSocket server(path);
+    REQUIRE(server.ok());
+
+    int client = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path.c_str());
+    REQUIRE(connect(client, (sockaddr *) &address, sizeof(address)) == 0);
+
+    std::string reply;
+    char buffer[1024];
+    auto readUntil = [&](const std::string &expected) {
+        reply.clear();
+        for (int i = 0; i < 100 && !contains(reply, expected); i++) {
+            server.poll(m.debugger, 10);
+            ssize_t n = recv(client, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (n > 0)
+                reply.append(buffer, n);
+        }
+    };
+
+    readUntil(DEBUGGER_PROMPT);
+    REQUIRE(contains(reply, "at 0x200"));
+
+    std::string command = "break 0x20A\ncontinue\n";
+    REQUIRE(send(client, command.data(), command.size(), 0) == (ssize_t) command.size());
+    readUntil("breakpoint 1 at 0x20A:");
+    REQUIRE(contains(reply, "breakpoint 1 at 0x20A:"));
+    REQUIRE(m.sys.programCounter == 0x20A);
+    close(client);
+}
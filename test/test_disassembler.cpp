@@ -0,0 +1,56 @@
+#include "disassembler.hpp"
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("Disassemble opcodes", "[Disassembler]") {
+    REQUIRE(disassemble(0x00E0) == "CLS");
+    REQUIRE(disassemble(0x1228) == "JP 0x228");
+    REQUIRE(disassemble(0x8AB4) == "ADD VA, VB");
+    REQUIRE(disassemble(0xD01F) == "DRW V0, V1, 0xF");
+    REQUIRE(disassemble(0xF265) == "LD V2, [I]");
+    REQUIRE(disassemble(0x0000).empty());
+    REQUIRE(disassemble(0x8008).empty());
+}
+
+TEST_CASE("Separate code from data", "[Disassembler]") {
+    // 0x200: JP 0x204, 0x202: data, 0x204: JP 0x204
+    byte rom[] = { 0x12, 0x04, 0xFF, 0xFF, 0x12, 0x04 };
+    RomAnalysis analysis = analyzeRom("rom", rom, sizeof(rom));
+
+    REQUIRE(analysis.isCode(0x200));
+    REQUIRE(!analysis.isCode(0x202));
+    REQUIRE(analysis.isCode(0x204));
+    REQUIRE(analysis.blocks.size() == 2);
+    REQUIRE(analysis.blocks[0x204].successors.size() == 1);
+    REQUIRE(analysis.illegalOpcodes.empty());
+}
+
+TEST_CASE("Skips split blocks and calls build the call graph", "[Disassembler]") {
+    // 0x200: CALL 0x208, SE V0 0, JP 0x200, JP 0x206, 0x208: RET
+    byte rom[] = { 0x22, 0x08, 0x30, 0x00, 0x12, 0x00, 0x12, 0x06, 0x00, 0xEE };
+    RomAnalysis analysis = analyzeRom("rom", rom, sizeof(rom));
+
+    REQUIRE(analysis.blocks[0x200].end == 0x204);
+    REQUIRE(analysis.blocks[0x200].successors.size() == 2);
+    REQUIRE(analysis.callGraph[0x200].count(0x208) == 1);
+    REQUIRE(analysis.callGraph[0x208].empty());
+}
+
+TEST_CASE("Flag self-modifying writes and computed jumps", "[Disassembler]") {
+    // LD I 0x206, LD [I] V1, JP 0x206, JP V0 0x200
+    byte rom[] = { 0xA2, 0x06, 0xF1, 0x55, 0x12, 0x06, 0xB2, 0x00 };
+    RomAnalysis analysis = analyzeRom("rom", rom, sizeof(rom));
+
+    REQUIRE(analysis.selfModifyingWrites.size() == 1);
+    REQUIRE(analysis.selfModifyingWrites[0] == 0x202);
+    REQUIRE(analysis.computedJumps.size() == 1);
+    REQUIRE(analysis.computedJumps[0] == 0x206);
+    REQUIRE(disassemble(0xB200) == "JP V0, 0x200");
+}
+
+TEST_CASE("JSON escapes control characters in names", "[Disassembler]") {
+    byte rom[] = { 0x00, 0xE0 };
+    RomAnalysis analysis = analyzeRom("a\"b\\c\td\x01", rom, sizeof(rom));
+
+    std::string json = analysisToJson(analysis);
+    REQUIRE(json.find("{\"rom\":\"a\\\"b\\\\c\\u0009d\\u0001\"") == 0);
+}
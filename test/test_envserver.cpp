@@ -0,0 +1,72 @@
+#include "envserver.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+static std::string uniqueName(const char * suffix) {
+    return "/chip8test-" + std::to_string(getpid()) + "-" + suffix;
+}
+
+TEST_CASE("Clients step environments hosted by a server", "[envserver]") {
+    // V0 = 123, I = 0x300, BCD V0, draw font 0 at (V1, V1) = (0, 0), spin
+    std::vector<uint8_t> rom = { 0x60, 0x7B, 0xA3, 0x00, 0xF0, 0x33, 0xA0, 0x50, 0xD1, 0x15,
+                                 0x12, 0x0A };
+    std::string name = uniqueName("step");
+    EnvServer server(name, rom, 3, 2, 1);
+    REQUIRE(server.ok());
+
+    chip8_reward_term score = { 0x300, CHIP8_REWARD_BCD, 1 };
+    server.setReward(std::vector<chip8_reward_term>(1, score));
+    std::thread serving(&EnvServer::serve, &server);
+
+    EnvClient client(name);
+    REQUIRE(client.ok());
+    REQUIRE(client.envCount() == 3);
+
+    for (int e = 0; e < 3; e++) {
+        client.submit(e, 0);
+    }
+    client.flush();
+    for (int e = 0; e < 3; e++) {
+        client.wait(e);
+        REQUIRE(client.reward(e) == 123.0f);
+        REQUIRE(client.fault(e) == 0);
+        REQUIRE(client.frame(e)[0] == (0xF0ULL << 56));
+    }
+
+    // No score change without a reset; a reset replays the BCD write
+    client.submit(0, 0);
+    client.submit(1, 0, true);
+    client.flush();
+    client.wait(0);
+    client.wait(1);
+    REQUIRE(client.reward(0) == 0.0f);
+    REQUIRE(client.reward(1) == 123.0f);
+
+    server.stop();
+    serving.join();
+}
+
+TEST_CASE("Clients reject missing segments", "[envserver]") {
+    EnvClient client(uniqueName("missing"));
+    REQUIRE(!client.ok());
+}
+
+TEST_CASE("Servers never take over a segment in use", "[envserver]") {
+    std::vector<uint8_t> rom = { 0x12, 0x00 };
+    std::string name = uniqueName("taken");
+    EnvServer first(name, rom, 1, 1, 1);
+    REQUIRE(first.ok());
+
+    EnvServer second(name, rom, 1, 1, 1);
+    REQUIRE(!second.ok());
+    REQUIRE(second.error().find("already exists") != std::string::npos);
+
+    EnvClient client(name);
+    REQUIRE(client.ok());
+    REQUIRE(client.envCount() == 1);
+
+    EnvServer empty(uniqueName("empty"), rom, 0, 1, 1);
+    REQUIRE(!empty.ok());
+}
@@ -0,0 +1,67 @@
+#include "fork.hpp"
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("Forks share pages they have not written", "[Fork]") {
+    Chip8 chip{};
+    byte rom[CHIP8_ROM_BYTES] = { 0x60, 0x07, 0xA3, 0x00, 0xF0, 0x33 };
+    chip.load(rom);
+    Forker forker(chip);
+
+    MachineState before = forker.fork();
+    for (int i = 0; i < 3; i++) {
+        chip.cycle();
+    }
+    MachineState after = forker.fork();
+
+    // FX33 wrote page 3 only
+    REQUIRE(after.pages[2] == before.pages[2]);
+    REQUIRE(after.pages[3] != before.pages[3]);
+    REQUIRE(after.display == before.display);
+    REQUIRE(after.programCounter == 0x206);
+}
+
+TEST_CASE("Restore a fork after diverging", "[Fork]") {
+    Chip8 chip{};
+    byte rom[CHIP8_ROM_BYTES] = { 0x60, 0x07, 0xA3, 0x00, 0xF0, 0x55, 0xD0, 0x01 };
+    chip.load(rom);
+    Forker forker(chip);
+    MachineState root = forker.fork();
+    uint64_t rootFingerprint = chip.fingerprint();
+
+    for (int i = 0; i < 4; i++) {
+        chip.cycle();
+    }
+    uint64_t branchFingerprint = chip.fingerprint();
+    REQUIRE(chip.ram[0x300] == 0x07);
+    REQUIRE(chip.displayBuffer[7][12] == 1);
+    MachineState branch = forker.fork();
+
+    forker.restore(root);
+    REQUIRE(chip.programCounter == 0x200);
+    REQUIRE(chip.variableRegisters[0] == 0x00);
+    REQUIRE(chip.ram[0x300] == 0x00);
+    REQUIRE(chip.displayBuffer[7][12] == 0);
+    REQUIRE(chip.fingerprint() == rootFingerprint);
+
+    forker.restore(branch);
+    REQUIRE(chip.programCounter == 0x208);
+    REQUIRE(chip.ram[0x300] == 0x07);
+    REQUIRE(chip.displayBuffer[7][12] == 1);
+    REQUIRE(chip.fingerprint() == branchFingerprint);
+}
+
+TEST_CASE("Restore undoes writes made since the last fork", "[Fork]") {
+    Chip8 chip{};
+    byte rom[CHIP8_ROM_BYTES] = { 0xA3, 0x00, 0xF0, 0x55 };
+    chip.load(rom);
+    chip.variableRegisters[0] = 0x42;
+    Forker forker(chip);
+    MachineState root = forker.fork();
+
+    chip.cycle();
+    chip.cycle();
+    REQUIRE(chip.ram[0x300] == 0x42);
+
+    forker.restore(root);
+    REQUIRE(chip.ram[0x300] == 0x00);
+}
@@ -0,0 +1,65 @@
+#include "fuzz.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <vector>
+
+// Key events first, then the ROM
+static std::vector<uint8_t> fuzzInput(const std::vector<uint8_t> &script, const std::vector<uint8_t> &rom) {
+    std::vector<uint8_t> input(1, script.size() / 2);
+    input.insert(input.end(), script.begin(), script.end());
+    input.insert(input.end(), rom.begin(), rom.end());
+    return input;
+}
+
+TEST_CASE("Fuzz inputs run as a freshly loaded machine would", "[fuzz]") {
+    std::vector<uint8_t> rom = {0x60, 0x05, 0xA2, 0x20, 0xF0, 0x33, 0xC1, 0xFF, 0xD0, 0x15, 0x12, 0x00};
+    std::vector<uint8_t> input = fuzzInput({}, rom);
+
+    Chip8 fresh;
+    fresh.seedRandom(FUZZ_SEED);
+    std::vector<byte> image(CHIP8_ROM_BYTES);
+    std::copy(rom.begin(), rom.end(), image.begin());
+    fresh.load(image.data());
+    fresh.run(FUZZ_INSTRUCTIONS);
+
+    FuzzHarness harness;
+    REQUIRE(harness.run(input.data(), input.size()) == FUZZ_INSTRUCTIONS);
+    REQUIRE(harness.sys.fingerprint() == fresh.fingerprint());
+    REQUIRE(harness.checkInvariants().empty());
+
+    // The incremental fingerprint matches one from scratch
+    uint64_t kept = harness.sys.memoryFingerprint;
+    harness.sys.rehashMemory();
+    REQUIRE(harness.sys.memoryFingerprint == kept);
+
+    // Nothing leaks from one input into the next
+    std::vector<uint8_t> other = fuzzInput({}, {0x6A, 0x01, 0xA3, 0x00, 0xFA, 0x55, 0x12, 0x06});
+    harness.run(other.data(), other.size());
+    harness.run(input.data(), input.size());
+    REQUIRE(harness.sys.fingerprint() == fresh.fingerprint());
+}
+
+TEST_CASE("The keypad script presses and releases keys", "[fuzz]") {
+    // FX0A waits for key 5 pressed after 2 steps and released after 1 more
+    std::vector<uint8_t> input = fuzzInput({2, 0x15, 1, 0x05}, {0xF3, 0x0A, 0x00, 0xE0, 0x12, 0x04});
+    FuzzHarness harness;
+    REQUIRE(harness.run(input.data(), input.size()) == FUZZ_INSTRUCTIONS);
+    REQUIRE(harness.sys.variableRegisters[3] == 5);
+
+    // Scripts longer than the input are cut short
+    uint8_t truncated[] = {10, 0, 0x11, 0x12};
+    harness.run(truncated, sizeof(truncated));
+    REQUIRE(harness.sys.keyState[1] == 1);
+}
+
+TEST_CASE("Faulting inputs stop early and keep the invariants", "[fuzz]") {
+    FuzzHarness harness;
+    std::vector<uint8_t> underflow = fuzzInput({}, {0x00, 0xEE});
+    REQUIRE(harness.run(underflow.data(), underflow.size()) == 0);
+    REQUIRE(harness.sys.fault == FAULT_STACK_UNDERFLOW);
+    REQUIRE(harness.checkInvariants().empty());
+
+    std::vector<uint8_t> empty;
+    REQUIRE(harness.run(empty.data(), 0) == 0);
+    REQUIRE(harness.sys.fault == FAULT_ILLEGAL_OPCODE);
+}
@@ -0,0 +1,49 @@
+#include "governor.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+
+TEST_CASE("Frames are presented while on schedule", "[governor]") {
+    FrameGovernor governor(16667);
+    for (int i = 0; i < 10; i++) {
+        REQUIRE(governor.shouldPresent(200));
+        governor.presented(3000);
+    }
+    REQUIRE(governor.presents == 10);
+    REQUIRE(governor.skippedBehind == 0);
+    REQUIRE(governor.averageCost == 3000);
+}
+
+TEST_CASE("Slow presents are skipped, but not for long", "[governor]") {
+    FrameGovernor governor(16667);
+    governor.presented(12000);
+
+    // Late enough that a 12 ms present would run into the next frame
+    int shown = 0;
+    for (int i = 0; i < 20; i++)
+        shown += governor.shouldPresent(6000);
+    REQUIRE(shown == 20 / (GOVERNOR_MAX_SKIP + 1));
+    REQUIRE(governor.skippedBehind == 20 - shown);
+
+    // The average follows cheaper presents back down
+    for (int i = 0; i < 40; i++)
+        governor.presented(1000);
+    REQUIRE(governor.averageCost < 2000);
+    REQUIRE(governor.shouldPresent(6000));
+}
+
+TEST_CASE("Hidden windows present nothing", "[governor]") {
+    FrameGovernor governor(16667);
+    governor.setVisible(false);
+    for (int i = 0; i < 10; i++)
+        REQUIRE_FALSE(governor.shouldPresent(0));
+    REQUIRE(governor.skippedHidden == 10);
+    REQUIRE(governor.skippedBehind == 0);
+
+    governor.setVisible(true);
+    REQUIRE(governor.shouldPresent(0));
+
+    governor.droppedBacklog(300000);
+    std::string summary = governor.summary();
+    REQUIRE(summary.find("skipped 0 behind schedule and 10 while hidden") != std::string::npos);
+    REQUIRE(summary.find("dropped 300 ms of emulation in 1 stalls") != std::string::npos);
+}
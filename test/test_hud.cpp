@@ -0,0 +1,93 @@
+#include "hud.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <vector>
+
+static void runProgram(Chip8 &sys, const std::vector<byte> &program, int cycles) {
+    std::vector<byte> rom(CHIP8_ROM_BYTES, 0);
+    for (size_t i = 0; i < program.size(); i++)
+        rom[i] = program[i];
+    sys.load(rom.data());
+    for (int i = 0; i < cycles; i++)
+        sys.cycle();
+}
+
+TEST_CASE("Profile counts instructions and RAM traffic", "[hud]") {
+    Chip8 sys;
+    Profile profile = {};
+    sys.profile = &profile;
+
+    // 0x200: I = 0x300; V0 = 7; FX33; D005; jump 0x208
+    runProgram(sys, {0xA3, 0x00, 0x60, 0x07, 0xF0, 0x33, 0xD0, 0x05, 0x12, 0x08}, 9);
+
+    REQUIRE(profile.instructions == 9);
+    REQUIRE(profile.pcHits[0x200] == 1);
+    REQUIRE(profile.pcHits[0x208] == 5);
+    REQUIRE(profile.sprites == 1);
+    REQUIRE(profile.writes[0x300] == 1);
+    REQUIRE(profile.writes[0x302] == 1);
+    REQUIRE(profile.reads[0x304] == 1);
+    REQUIRE(profile.reads[0x305] == 0);
+
+    sys.profile = nullptr;
+    sys.cycle();
+    REQUIRE(profile.instructions == 9);
+}
+
+TEST_CASE("Superinstructions count hits at each PC they run", "[hud]") {
+    // 0x200: V0 = 7; V1 = 5; I = 0x300; D015; jump 0x208
+    std::vector<byte> program = {0x60, 0x07, 0x61, 0x05, 0xA3, 0x00, 0xD0, 0x15, 0x12, 0x08};
+    Chip8 stepped;
+    Profile steppedProfile = {};
+    stepped.profile = &steppedProfile;
+    runProgram(stepped, program, 40);
+
+    Chip8 fused;
+    Profile fusedProfile = {};
+    fused.profile = &fusedProfile;
+    runProgram(fused, program, 0);
+    REQUIRE(fused.run(40) == 40);
+
+    REQUIRE(fusedProfile.instructions == 40);
+    REQUIRE(fusedProfile.pcHits[0x208] == 36);
+    for (int pc = 0x200; pc < 0x20A; pc += 2)
+        REQUIRE(fusedProfile.pcHits[pc] == steppedProfile.pcHits[pc]);
+}
+
+TEST_CASE("HUD samples and clears a frame of counters", "[hud]") {
+    Hud hud(0xFFFFFFFF, 0xFF000000);
+    Profile profile = {};
+
+    profile.instructions = 350;
+    profile.sprites = 3;
+    profile.pcHits[0x208] = 300;
+    profile.pcHits[0x200] = 40;
+    profile.pcHits[0x202] = 10;
+    profile.writes[0x300] = 2;
+    hud.sample(profile, 500.0, 1);
+
+    REQUIRE(hud.instructionsPerSecond == 700.0);
+    REQUIRE(hud.emulatedFrameMilliseconds == 500.0);
+    REQUIRE(hud.sprites == 3);
+    REQUIRE(hud.hotCount == 3);
+    REQUIRE(hud.hotPcs[0] == 0x208);
+    REQUIRE(hud.hotPcs[1] == 0x200);
+    REQUIRE(hud.hotPcs[2] == 0x202);
+    REQUIRE(hud.hotShares[0] > 0.85f);
+    REQUIRE(hud.writeHeat[0x300] == 2.0f);
+    REQUIRE(hud.histogram[HUD_HISTOGRAM_BUCKETS - 1] == 1.0f);
+    REQUIRE(profile.instructions == 0);
+    REQUIRE(profile.pcHits[0x208] == 0);
+
+    // Heat fades once the accesses stop
+    hud.sample(profile, 16.0, 1);
+    REQUIRE(hud.writeHeat[0x300] < 2.0f);
+    REQUIRE(hud.histogram[8] == 1.0f);
+
+    std::vector<uint32_t> pixels(HUD_WIDTH * HUD_HEIGHT, 0);
+    hud.render(pixels.data(), HUD_WIDTH * 4);
+    int lit = 0;
+    for (uint32_t p : pixels)
+        lit += p == 0xFFFFFFFF;
+    REQUIRE(lit > 0);
+    REQUIRE(pixels[HUD_WIDTH * HUD_HEIGHT - 1] == 0xFF000000);
+}
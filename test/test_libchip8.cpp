@@ -0,0 +1,83 @@
+#include "libchip8.h"
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("Step a batch and read BCD rewards", "[libchip8]") {
+    // V0 = 123, I = 0x300, BCD V0, spin
+    uint8_t rom[] = { 0x60, 0x7B, 0xA3, 0x00, 0xF0, 0x33, 0x12, 0x06 };
+    chip8_env * envs[2] = { chip8_create(rom, sizeof(rom)), chip8_create(rom, sizeof(rom)) };
+    REQUIRE(envs[0] != nullptr);
+
+    chip8_reward_term score = { 0x300, CHIP8_REWARD_BCD, 1 };
+    REQUIRE(chip8_set_reward(envs[0], &score, 1) == 0);
+
+    uint16_t actions[2] = { 0, 0 };
+    float rewards[2];
+    uint8_t faults[2];
+    chip8_step_batch(envs, actions, 2, 1, rewards, faults);
+
+    REQUIRE(rewards[0] == 123.0f);
+    REQUIRE(rewards[1] == 0.0f);
+    REQUIRE(faults[0] == 0);
+    REQUIRE(chip8_ram(envs[0])[0x300] == 1);
+
+    // Reward is the change in score
+    chip8_step_batch(envs, actions, 2, 1, rewards, faults);
+    REQUIRE(rewards[0] == 0.0f);
+
+    chip8_destroy(envs[0]);
+    chip8_destroy(envs[1]);
+}
+
+TEST_CASE("Frames are views into the machine", "[libchip8]") {
+    // I = font 0, draw at (0, 0), spin
+    uint8_t rom[] = { 0xA0, 0x50, 0xD0, 0x05, 0x12, 0x04 };
+    chip8_env * env = chip8_create(rom, sizeof(rom));
+    const uint64_t * frame = chip8_frame(env);
+    REQUIRE(frame[0] == 0);
+
+    uint16_t action = 0;
+    chip8_step_batch(&env, &action, 1, 1, nullptr, nullptr);
+    REQUIRE(frame[0] == (0xF0ULL << 56));
+    REQUIRE(frame[1] == (0x90ULL << 56));
+
+    chip8_reset(env);
+    REQUIRE(frame[0] == 0);
+    chip8_destroy(env);
+}
+
+TEST_CASE("Faulted environments report and stop", "[libchip8]") {
+    uint8_t rom[] = { 0x00, 0xEE };
+    chip8_env * env = chip8_create(rom, sizeof(rom));
+
+    uint16_t action = 0;
+    uint8_t fault = 0;
+    chip8_step_batch(&env, &action, 1, 4, nullptr, &fault);
+    REQUIRE(fault != 0);
+
+    chip8_reset(env);
+    chip8_step_batch(&env, &action, 1, 0, nullptr, &fault);
+    REQUIRE(fault == 0);
+    chip8_destroy(env);
+}
+
+TEST_CASE("Seeded environments replay their random numbers", "[libchip8]") {
+    // V0 = random, V1 = random, I = 0x300, store V0-V1, spin
+    uint8_t rom[] = { 0xC0, 0xFF, 0xC1, 0xFF, 0xA3, 0x00, 0xF1, 0x55, 0x12, 0x08 };
+    chip8_env * envs[2] = { chip8_create(rom, sizeof(rom)), chip8_create(rom, sizeof(rom)) };
+    chip8_seed(envs[0], 7);
+    chip8_seed(envs[1], 7);
+
+    uint16_t actions[2] = { 0, 0 };
+    chip8_step_batch(envs, actions, 2, 1, nullptr, nullptr);
+    uint8_t first[2] = { chip8_ram(envs[0])[0x300], chip8_ram(envs[0])[0x301] };
+    REQUIRE(chip8_ram(envs[1])[0x300] == first[0]);
+    REQUIRE(chip8_ram(envs[1])[0x301] == first[1]);
+
+    chip8_reset(envs[0]);
+    chip8_step_batch(envs, actions, 1, 1, nullptr, nullptr);
+    REQUIRE(chip8_ram(envs[0])[0x300] == first[0]);
+    REQUIRE(chip8_ram(envs[0])[0x301] == first[1]);
+
+    chip8_destroy(envs[0]);
+    chip8_destroy(envs[1]);
+}
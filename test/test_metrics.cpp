@@ -0,0 +1,90 @@
+#include "metrics.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static bool contains(const std::string &text, const std::string &line) {
+    return text.find(line + "\n") != std::string::npos;
+}
+
+TEST_CASE("Metrics use the Prometheus text format", "[metrics]") {
+    Metrics metrics(Metrics::label("rom", "a\"b.ch8"));
+    metrics.instructions.add(700);
+    metrics.lateFrames.add();
+    metrics.fault(FAULT_STACK_OVERFLOW);
+    metrics.frameSeconds.observe(0.0167);
+    metrics.frameSeconds.observe(0.040);
+    metrics.frameSeconds.observe(1.0);
+
+    std::string text = metrics.format();
+    REQUIRE(contains(text, "# TYPE chip8_instructions_total counter"));
+    REQUIRE(contains(text, "chip8_instructions_total{rom=\"a\\\"b.ch8\"} 700"));
+    REQUIRE(contains(text, "chip8_late_frames_total{rom=\"a\\\"b.ch8\"} 1"));
+    REQUIRE(contains(text, "chip8_faults_total{rom=\"a\\\"b.ch8\",fault=\"stack_overflow\"} 1"));
+    REQUIRE(contains(text, "chip8_faults_total{rom=\"a\\\"b.ch8\",fault=\"illegal_opcode\"} 0"));
+
+    // Buckets are cumulative
+    REQUIRE(contains(text, "chip8_frame_seconds_bucket{rom=\"a\\\"b.ch8\",le=\"0.016\"} 0"));
+    REQUIRE(contains(text, "chip8_frame_seconds_bucket{rom=\"a\\\"b.ch8\",le=\"0.017\"} 1"));
+    REQUIRE(contains(text, "chip8_frame_seconds_bucket{rom=\"a\\\"b.ch8\",le=\"0.05\"} 2"));
+    REQUIRE(contains(text, "chip8_frame_seconds_bucket{rom=\"a\\\"b.ch8\",le=\"+Inf\"} 3"));
+    REQUIRE(contains(text, "chip8_frame_seconds_count{rom=\"a\\\"b.ch8\"} 3"));
+    REQUIRE(contains(text, "chip8_frame_seconds_sum{rom=\"a\\\"b.ch8\"} 1.0567"));
+
+    Metrics unlabelled;
+    REQUIRE(contains(unlabelled.format(), "chip8_sound_events_total 0"));
+}
+
+TEST_CASE("Metrics are published to a file", "[metrics]") {
+    std::string path = "/tmp/chip8_test_metrics.prom";
+    Metrics metrics;
+    metrics.framesPresented.add(3);
+    {
+        MetricsPublisher publisher(metrics, path);
+        REQUIRE(publisher.ok());
+        metrics.framesPresented.add(2);
+    }
+
+    std::ifstream in(path);
+    std::stringstream text;
+    text << in.rdbuf();
+    REQUIRE(contains(text.str(), "chip8_frames_presented_total 5"));
+    remove(path.c_str());
+}
+
+TEST_CASE("Metrics are served on a Unix socket", "[metrics]") {
+    std::string path = "/tmp/chip8_test_metrics.sock";
+    Metrics metrics;
+    metrics.drawCalls.add(42);
+    MetricsPublisher publisher(metrics, METRICS_SOCKET_PREFIX + path);
+    REQUIRE(publisher.ok());
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path.c_str());
+
+    for (int http = 0; http < 2; http++) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        REQUIRE(connect(fd, (sockaddr *) &address, sizeof(address)) == 0);
+        if (http) {
+            const char * request = "GET /metrics HTTP/1.0\r\n\r\n";
+            REQUIRE(write(fd, request, strlen(request)) > 0);
+        }
+
+        std::string response;
+        char data[4096];
+        ssize_t n;
+        while ((n = read(fd, data, sizeof(data))) > 0)
+            response.append(data, n);
+        close(fd);
+
+        REQUIRE((response.compare(0, 15, "HTTP/1.0 200 OK") == 0) == (http == 1));
+        REQUIRE(contains(response, "chip8_draw_calls_total 42"));
+    }
+}
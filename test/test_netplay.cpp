@@ -0,0 +1,166 @@
+#include "netplay.hpp"
+#include "assembler.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <random>
+#include <vector>
+
+// Polls every key, mixing key presses and CXNN into V2 and RAM
+static const std::vector<byte> keyMixer = assemble(
+    "        LD V1, 0\n"
+    "poll:   SKP V1\n"
+    "        JP mix\n"
+    "        ADD V2, 1\n"
+    "mix:    RND V3, 0x0F\n"
+    "        ADD V2, V3\n"
+    "        ADD V1, 1\n"
+    "        LD I, 0x300\n"
+    "        LD B, V2\n"
+    "        JP poll\n").image();
+
+static uint16_t keysFor(int side, uint32_t frame) {
+    return (frame / 5) % 3 == 0 ? 1 << ((frame * 7 + side * 3) % 16) : 0;
+}
+
+TEST_CASE("Keypad mask sets a bit per key down", "[netplay]") {
+    byte keyState[16] = {0};
+    keyState[0x0] = 1;
+    keyState[0xA] = 1;
+    REQUIRE(keypadMask(keyState) == 0x0401);
+}
+
+TEST_CASE("Rollback sessions agree with late and reordered inputs", "[netplay]") {
+    const uint32_t frames = 300;
+    RollbackSession a(keyMixer, 7), b(keyMixer, 7);
+    RollbackSession reference(keyMixer, 7);
+
+    // Both sides' inputs known up front
+    for (uint32_t f = 0; f < frames; f++) {
+        reference.remoteInput(f, keysFor(1, f));
+        REQUIRE(reference.advance(keysFor(0, f)));
+    }
+
+    // Inputs arrive 0 to 6 ticks after they are sent, in any order
+    struct InFlight {
+        int due;
+        bool toA;
+        uint32_t frame;
+        uint16_t keys;
+    };
+    std::vector<InFlight> flight;
+    std::mt19937 latency(1);
+
+    for (int tick = 0; a.remoteFrames < frames || b.remoteFrames < frames; tick++) {
+        REQUIRE(tick < 10000);
+
+        if (a.frame < frames && a.advance(keysFor(0, a.frame)))
+            flight.push_back(InFlight{tick + (int) (latency() % 7), false, a.frame - 1, keysFor(0, a.frame - 1)});
+        if (b.frame < frames && b.advance(keysFor(1, b.frame)))
+            flight.push_back(InFlight{tick + (int) (latency() % 7), true, b.frame - 1, keysFor(1, b.frame - 1)});
+
+        for (size_t i = 0; i < flight.size();) {
+            if (flight[i].due <= tick) {
+                (flight[i].toA ? a : b).remoteInput(flight[i].frame, flight[i].keys);
+                flight[i] = flight.back();
+                flight.pop_back();
+            } else {
+                i++;
+            }
+        }
+
+        // The other side's sync point is always consistent with ours
+        uint32_t syncFrame;
+        uint64_t fingerprint;
+        if (b.syncPoint(syncFrame, fingerprint))
+            REQUIRE(a.checkSync(syncFrame, fingerprint));
+    }
+
+    a.settle();
+    b.settle();
+    REQUIRE(a.frame == frames);
+    REQUIRE(b.frame == frames);
+    REQUIRE_FALSE(a.desynced);
+    REQUIRE(a.rollbacks > 0);
+    REQUIRE(b.rollbacks > 0);
+    REQUIRE(a.sys.fingerprint() == reference.sys.fingerprint());
+    REQUIRE(b.sys.fingerprint() == reference.sys.fingerprint());
+}
+
+TEST_CASE("Rollback sessions stall rather than run too far ahead", "[netplay]") {
+    RollbackSession session(keyMixer, 1);
+    for (int f = 0; f < NETPLAY_MAX_ROLLBACK; f++) {
+        REQUIRE(session.advance(0));
+    }
+    REQUIRE_FALSE(session.advance(0));
+    REQUIRE(session.frame == NETPLAY_MAX_ROLLBACK);
+
+    session.remoteInput(0, 0);
+    REQUIRE(session.advance(0));
+}
+
+TEST_CASE("A differing sync point is reported as a desync", "[netplay]") {
+    RollbackSession session(keyMixer, 1);
+    for (uint32_t f = 0; f < 4; f++) {
+        session.remoteInput(f, 0);
+        session.advance(0);
+    }
+
+    uint32_t syncFrame;
+    uint64_t fingerprint;
+    REQUIRE(session.syncPoint(syncFrame, fingerprint));
+    REQUIRE(session.checkSync(syncFrame, fingerprint));
+    REQUIRE_FALSE(session.checkSync(syncFrame, fingerprint ^ 1));
+    REQUIRE(session.desynced);
+}
+
+TEST_CASE("Netplay over loopback UDP with packet loss and delay", "[netplay]") {
+    const uint32_t frames = 120;
+    NetplayLink hostLink, joinLink;
+    REQUIRE(hostLink.ok());
+    REQUIRE(joinLink.ok());
+    REQUIRE(joinLink.connect("127.0.0.1", hostLink.port()));
+    hostLink.lossPercent = 20;
+    joinLink.lossPercent = 20;
+    hostLink.delayMilliseconds = 3;
+    joinLink.delayMilliseconds = 5;
+
+    Netplay host(hostLink, keyMixer, true, 42);
+    Netplay join(joinLink, keyMixer, false);
+    Netplay * sides[2] = {&host, &join};
+
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+    bool done = false;
+    while (!done && std::chrono::steady_clock::now() < deadline) {
+        done = true;
+        for (int side = 0; side < 2; side++) {
+            if (!sides[side]->poll()) {
+                done = false;
+                continue;
+            }
+            RollbackSession &session = *sides[side]->session;
+            if (session.frame < frames)
+                sides[side]->frame(keysFor(side, session.frame));
+            else
+                sides[side]->sendInputs();
+            done &= session.frame == frames && session.remoteFrames == frames;
+        }
+    }
+    REQUIRE(done);
+
+    // Deliver and check the sync points still waiting out the delay
+    while ((hostLink.queued() > 0 || joinLink.queued() > 0) && std::chrono::steady_clock::now() < deadline) {
+        host.poll();
+        join.poll();
+    }
+    REQUIRE(hostLink.queued() == 0);
+    REQUIRE(joinLink.queued() == 0);
+    // The last flush may have sent to a side that already polled
+    host.poll();
+    join.poll();
+
+    host.session->settle();
+    join.session->settle();
+    REQUIRE_FALSE(host.session->desynced);
+    REQUIRE_FALSE(join.session->desynced);
+    REQUIRE(host.session->sys.fingerprint() == join.session->sys.fingerprint());
+}
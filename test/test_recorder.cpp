@@ -0,0 +1,58 @@
+#include "recorder.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+static std::string tempVideo() {
+    return "/tmp/chip8test-" + std::to_string(getpid()) + ".video";
+}
+
+TEST_CASE("Repeated frames are folded into one record", "[recorder]") {
+    std::string filename = tempVideo();
+    uint64_t blank[CHIP8_SCREEN_HEIGHT] = {};
+    uint64_t drawn[CHIP8_SCREEN_HEIGHT] = {};
+    drawn[0] = 0xF000000000000000ULL;
+    drawn[31] = 0x1ULL;
+
+    {
+        Recorder recorder(filename, 4);
+        REQUIRE(recorder.ok());
+        recorder.frame(blank);
+        recorder.frame(blank);
+        recorder.frame(drawn, 3);
+        // More distinct frames than the ring holds
+        for (int i = 0; i < 10; i++) {
+            recorder.frame(i % 2 ? drawn : blank);
+        }
+    }
+
+    VideoReader reader(filename);
+    REQUIRE(reader.ok());
+    VideoFrame frame;
+
+    REQUIRE(reader.next(frame));
+    REQUIRE(frame.repeats == 2);
+    REQUIRE(memcmp(frame.rows, blank, sizeof(blank)) == 0);
+
+    REQUIRE(reader.next(frame));
+    REQUIRE(frame.repeats == 3);
+    REQUIRE(memcmp(frame.rows, drawn, sizeof(drawn)) == 0);
+
+    int distinct = 0;
+    while (reader.next(frame)) {
+        REQUIRE(frame.repeats == 1);
+        REQUIRE(memcmp(frame.rows, distinct % 2 ? drawn : blank, sizeof(blank)) == 0);
+        distinct++;
+    }
+    REQUIRE(distinct == 10);
+    REQUIRE(reader.ok());
+
+    remove(filename.c_str());
+}
+
+TEST_CASE("Video files are checked on open", "[recorder]") {
+    VideoReader reader("/nonexistent.video");
+    REQUIRE(!reader.ok());
+}
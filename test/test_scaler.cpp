@@ -0,0 +1,136 @@
+#include "scaler.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdlib>
+#include <vector>
+
+#define ON 0xFF00FF55
+#define OFF 0xFF000000
+
+static bool pixel(const std::vector<uint64_t> &image, int words, int x, int y) {
+    return (image[y * words + x / 64] >> (63 - x % 64)) & 1;
+}
+
+// Clamped neighbour, the edge pixel standing in for ones past it
+static bool at(const std::vector<uint64_t> &image, int words, int height, int x, int y) {
+    x = x < 0 ? 0 : (x >= 64 * words ? 64 * words - 1 : x);
+    y = y < 0 ? 0 : (y >= height ? height - 1 : y);
+    return pixel(image, words, x, y);
+}
+
+static std::vector<uint64_t> randomImage(int words, int height) {
+    std::vector<uint64_t> image(words * height);
+    for (size_t i = 0; i < image.size(); i++) {
+        // Sparse, so the filters see plenty of edges and diagonals
+        image[i] = ((uint64_t) rand() << 40 ^ (uint64_t) rand() << 20 ^ rand())
+            & ((uint64_t) rand() << 33 ^ rand());
+    }
+    return image;
+}
+
+TEST_CASE("Scale2x matches the per-pixel rules", "[scaler]") {
+    for (int words = 1; words <= 2; words++) {
+        int height = 32;
+        std::vector<uint64_t> src = randomImage(words, height);
+        std::vector<uint64_t> dst(4 * words * height);
+        scale2x(src.data(), words, height, dst.data());
+
+        bool same = true;
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < 64 * words; x++) {
+                bool B = at(src, words, height, x, y - 1), H = at(src, words, height, x, y + 1);
+                bool D = at(src, words, height, x - 1, y), F = at(src, words, height, x + 1, y);
+                bool E = pixel(src, words, x, y);
+
+                bool E0 = (D == B && B != F && D != H) ? D : E;
+                bool E1 = (B == F && B != D && F != H) ? F : E;
+                bool E2 = (D == H && D != B && H != F) ? D : E;
+                bool E3 = (H == F && D != H && B != F) ? F : E;
+
+                same = same && pixel(dst, 2 * words, 2 * x, 2 * y) == E0
+                    && pixel(dst, 2 * words, 2 * x + 1, 2 * y) == E1
+                    && pixel(dst, 2 * words, 2 * x, 2 * y + 1) == E2
+                    && pixel(dst, 2 * words, 2 * x + 1, 2 * y + 1) == E3;
+            }
+        }
+        REQUIRE(same);
+    }
+}
+
+TEST_CASE("Scale3x matches the per-pixel rules", "[scaler]") {
+    for (int words = 1; words <= 2; words++) {
+        int height = 32;
+        std::vector<uint64_t> src = randomImage(words, height);
+        std::vector<uint64_t> dst(9 * words * height);
+        scale3x(src.data(), words, height, dst.data());
+
+        bool same = true;
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < 64 * words; x++) {
+                bool A = at(src, words, height, x - 1, y - 1), B = at(src, words, height, x, y - 1);
+                bool C = at(src, words, height, x + 1, y - 1), D = at(src, words, height, x - 1, y);
+                bool E = pixel(src, words, x, y), F = at(src, words, height, x + 1, y);
+                bool G = at(src, words, height, x - 1, y + 1), H = at(src, words, height, x, y + 1);
+                bool I = at(src, words, height, x + 1, y + 1);
+
+                bool expected[9];
+                expected[0] = (D == B && B != F && D != H) ? D : E;
+                expected[1] = ((D == B && B != F && D != H && E != C) || (B == F && B != D && F != H && E != A)) ? B : E;
+                expected[2] = (B == F && B != D && F != H) ? F : E;
+                expected[3] = ((D == B && B != F && D != H && E != G) || (D == H && D != B && H != F && E != A)) ? D : E;
+                expected[4] = E;
+                expected[5] = ((B == F && B != D && F != H && E != I) || (H == F && D != H && B != F && E != C)) ? F : E;
+                expected[6] = (D == H && D != B && H != F) ? D : E;
+                expected[7] = ((D == H && D != B && H != F && E != I) || (H == F && D != H && B != F && E != G)) ? H : E;
+                expected[8] = (H == F && D != H && B != F) ? F : E;
+
+                for (int k = 0; k < 9; k++) {
+                    same = same && pixel(dst, 3 * words, 3 * x + k % 3, 3 * y + k / 3) == expected[k];
+                }
+            }
+        }
+        REQUIRE(same);
+    }
+}
+
+TEST_CASE("Nearest neighbour fills factor x factor blocks", "[scaler]") {
+    std::vector<uint64_t> src = randomImage(1, 32);
+
+    for (int factor = 1; factor <= 11; factor++) {
+        int width = 64 * factor, height = 32 * factor;
+        int pitch = 4 * (width + 3);    // Padded, as textures may be
+        std::vector<uint32_t> pixels(pitch / 4 * height, 0);
+        expandPixels(src.data(), 1, 64, 32, factor, ON, OFF, pixels.data(), pitch);
+
+        bool same = true;
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                same = same && pixels[y * pitch / 4 + x] == (pixel(src, 1, x / factor, y / factor) ? ON : OFF);
+            }
+            // Padding is not written
+            same = same && pixels[y * pitch / 4 + width] == 0;
+        }
+        REQUIRE(same);
+    }
+}
+
+TEST_CASE("Filters apply only when they divide the scale", "[scaler]") {
+    std::vector<uint64_t> src(32, 0);
+    src[10] = 1ULL << 40;
+    src[11] = 1ULL << 39;    // Diagonal pair: Scale2x rounds the corner
+
+    Scaler scaler(ON, OFF);
+    std::vector<uint32_t> filtered(128 * 64), nearest(128 * 64);
+    scaler.filter = SCALE_2X;
+    scaler.render(src.data(), 64, 32, 2, filtered.data(), 128 * 4);
+    scaler.filter = SCALE_NEAREST;
+    scaler.render(src.data(), 64, 32, 2, nearest.data(), 128 * 4);
+    REQUIRE(filtered != nearest);
+
+    // Scale3x cannot produce scale 2
+    scaler.filter = SCALE_3X;
+    scaler.render(src.data(), 64, 32, 2, filtered.data(), 128 * 4);
+    REQUIRE(filtered == nearest);
+
+    REQUIRE(Scaler::fitScale(64, 32, 640, 330) == 10);
+    REQUIRE(Scaler::fitScale(64, 32, 10, 10) == 1);
+}
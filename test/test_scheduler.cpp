@@ -0,0 +1,152 @@
+#include "scheduler.hpp"
+#include "verifier.hpp"
+#include "assembler.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include <vector>
+
+// VF = 15 and FF15 give DT = 15 whether FX15 takes X or VX
+static const std::vector<byte> keyWait = assemble(
+    "        LD VF, 15\n"
+    "        LD DT, VF\n"
+    "wait:   LD V1, K\n"
+    "        ADD V2, 1\n"
+    "        LD DT, VF\n"
+    "        JP wait\n").image();
+
+static const std::vector<byte> timerWait = assemble(
+    "start:  LD VF, 15\n"
+    "        LD DT, VF\n"
+    "wait:   LD V1, DT\n"
+    "        SE V1, 0\n"
+    "        JP wait\n"
+    "        ADD V2, 1\n"
+    "        JP start\n").image();
+
+static const std::vector<byte> spin = assemble(
+    "        LD VF, 15\n"
+    "        LD ST, VF\n"
+    "spin:   JP spin\n").image();
+
+// Runs the same ROM with cycle(), cyclesPerFrame instructions per tick
+struct Reference {
+    Chip8 sys;
+    int cyclesPerFrame;
+
+    Reference(const std::vector<byte> &image, int cyclesPerFrame) : cyclesPerFrame(cyclesPerFrame) {
+        sys.load((byte *) image.data());
+    }
+
+    void tick() {
+        for (int i = 0; i < cyclesPerFrame && sys.fault == FAULT_NONE; i++)
+            sys.cycle();
+    }
+};
+
+static bool same(Chip8 &a, Chip8 &b) {
+    return VerifyState(a).differences(VerifyState(b)).empty();
+}
+
+TEST_CASE("Sessions in FX0A park until a key event", "[scheduler]") {
+    Scheduler scheduler(12);
+    int id = scheduler.add(keyWait.data());
+    Reference reference(keyWait, 12);
+
+    for (int t = 0; t < 100; t++) {
+        scheduler.tick();
+        reference.tick();
+    }
+    REQUIRE(scheduler.wait(id) == WAIT_KEY);
+    REQUIRE(scheduler.resumes == 1);
+    REQUIRE(same(scheduler.machine(id), reference.sys));
+
+    scheduler.pressKey(id, 0x7);
+    reference.sys.pressKey(0x7);
+    scheduler.tick();
+    reference.tick();
+    scheduler.releaseKey(id, 0x7);
+    reference.sys.releaseKey(0x7);
+    for (int t = 0; t < 5; t++) {
+        scheduler.tick();
+        reference.tick();
+    }
+
+    Chip8 &sys = scheduler.machine(id);
+    REQUIRE(sys.variableRegisters[1] == 0x7);
+    REQUIRE(sys.variableRegisters[2] >= 1);
+    REQUIRE(same(sys, reference.sys));
+}
+
+TEST_CASE("Delay timer polls sleep on the timer wheel", "[scheduler]") {
+    Scheduler scheduler(2);
+    int id = scheduler.add(timerWait.data());
+    Reference reference(timerWait, 2);
+
+    for (int t = 0; t < 200; t++) {
+        scheduler.tick();
+        reference.tick();
+        REQUIRE(same(scheduler.machine(id), reference.sys));
+    }
+
+    // Each 15-tick wait is mostly slept through
+    REQUIRE(scheduler.resumes < 100);
+    REQUIRE(reference.sys.variableRegisters[2] > 10);
+}
+
+TEST_CASE("Spinning sessions cost nothing until woken", "[scheduler]") {
+    Scheduler scheduler(12);
+    std::vector<int> ids;
+    for (int i = 0; i < 2000; i++)
+        ids.push_back(scheduler.add(spin.data()));
+
+    REQUIRE(scheduler.tick() == 2000);
+    REQUIRE(scheduler.tick() == 0);
+    REQUIRE(scheduler.tick() == 0);
+    REQUIRE(scheduler.wait(ids[5]) == WAIT_SPIN);
+
+    // Timers still run out as if the spin had executed
+    Reference reference(spin, 12);
+    for (int t = 0; t < 3; t++)
+        reference.tick();
+    REQUIRE(same(scheduler.machine(ids[5]), reference.sys));
+
+    scheduler.remove(ids[5]);
+    scheduler.pressKey(ids[6], 1);
+    REQUIRE(scheduler.tick() == 1);
+}
+
+TEST_CASE("Random input keeps sessions in step with cycle()", "[scheduler]") {
+    const std::vector<byte> * roms[] = {&keyWait, &timerWait, &spin};
+    Scheduler scheduler(5);
+    std::vector<Reference *> references;
+    std::vector<int> ids;
+    for (int i = 0; i < 30; i++) {
+        ids.push_back(scheduler.add(roms[i % 3]->data()));
+        references.push_back(new Reference(*roms[i % 3], 5));
+    }
+
+    std::mt19937 input(3);
+    for (int t = 0; t < 2000; t++) {
+        int i = input() % ids.size();
+        byte key = input() % 16;
+        if (input() % 4 == 0) {
+            if (references[i]->sys.keyState[key]) {
+                scheduler.releaseKey(ids[i], key);
+                references[i]->sys.releaseKey(key);
+            } else {
+                scheduler.pressKey(ids[i], key);
+                references[i]->sys.pressKey(key);
+            }
+        }
+        scheduler.tick();
+        for (Reference * reference : references)
+            reference->tick();
+    }
+
+    bool allSame = true;
+    for (size_t i = 0; i < ids.size(); i++) {
+        allSame &= same(scheduler.machine(ids[i]), references[i]->sys);
+        delete references[i];
+    }
+    REQUIRE(allSame);
+}
@@ -0,0 +1,45 @@
+#include "terminal.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <unistd.h>
+
+static std::string drain(int fd) {
+    char data[65536];
+    ssize_t count = read(fd, data, sizeof(data));
+    return std::string(data, count > 0 ? count : 0);
+}
+
+TEST_CASE("Only changed cells are redrawn", "[terminal]") {
+    int pipeFds[2];
+    REQUIRE(pipe(pipeFds) == 0);
+    uint64_t rows[CHIP8_SCREEN_HEIGHT] = {};
+
+    {
+        TerminalRenderer renderer(pipeFds[1]);
+
+        // First frame draws all 64 x 16 cells
+        REQUIRE(renderer.render(rows) > 64 * TERMINAL_CELL_ROWS);
+        drain(pipeFds[0]);
+
+        REQUIRE(renderer.render(rows) == 0);
+
+        // Top pixel of cell (2, 10) and bottom pixel of cell (2, 11)
+        rows[4] = 1ULL << (63 - 10);
+        rows[5] = 1ULL << (63 - 11);
+        renderer.render(rows);
+        REQUIRE(drain(pipeFds[0]) == "\x1b[3;11H▀▄");
+
+        // Far apart cells on one row are reached with a cursor move
+        rows[4] = 0;
+        rows[5] = 1ULL << 63 | 1;
+        renderer.render(rows);
+        REQUIRE(drain(pipeFds[0]) == "\x1b[3;1H▄\x1b[3;11H  \x1b[3;64H▄");
+
+        renderer.invalidate();
+        REQUIRE(renderer.render(rows) > 64 * TERMINAL_CELL_ROWS);
+        drain(pipeFds[0]);
+    }
+
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+}
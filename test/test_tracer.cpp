@@ -0,0 +1,107 @@
+#include "tracer.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+static std::string tempTrace(const char * suffix) {
+    return "/tmp/chip8test-" + std::to_string(getpid()) + "-" + suffix + ".trace";
+}
+
+TEST_CASE("Registers written by opcodes", "[Tracer]") {
+    REQUIRE(tracedRegister(0x6A12) == 0xA);
+    REQUIRE(tracedRegister(0x8124) == 0x1);
+    REQUIRE(tracedRegister(0xF365) == 0x3);
+    REQUIRE(tracedRegister(0xA123) == TRACE_NO_REGISTER);
+    REQUIRE(tracedRegister(0xF315) == TRACE_NO_REGISTER);
+}
+
+TEST_CASE("Trace files round trip across chunks", "[Tracer]") {
+    std::string filename = tempTrace("roundtrip");
+    int count = TRACE_CHUNK_RECORDS + 10;
+
+    {
+        TraceWriter writer(filename);
+        for (int i = 0; i < count; i++) {
+            TraceRecord r = { (word) (0x200 + 2 * i), 0x7001, 0x300, 0, (byte) i, 0 };
+            writer.write(r);
+        }
+    }
+
+    TraceReader reader(filename);
+    REQUIRE(reader.ok());
+
+    TraceRecord r;
+    int read = 0;
+    bool same = true;
+    while (reader.next(r)) {
+        same = same && r.pc == 0x200 + 2 * read && r.value == (byte) read;
+        read++;
+    }
+
+    REQUIRE(read == count);
+    REQUIRE(same);
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("Tracer records each cycle", "[Tracer]") {
+    std::string filename = tempTrace("cycles");
+    byte rom[CHIP8_ROM_BYTES] = { 0x60, 0x05, 0xA1, 0x23, 0x70, 0xFF };
+
+    {
+        Chip8 chip{};
+        Tracer tracer(filename, 2);
+        chip.load(rom);
+        chip.tracer = &tracer;
+        for (int i = 0; i < 3; i++) {
+            chip.cycle();
+        }
+    }
+
+    TraceReader reader(filename);
+    TraceRecord r;
+
+    REQUIRE(reader.next(r));
+    REQUIRE(r.pc == 0x200);
+    REQUIRE(r.reg == 0x0);
+    REQUIRE(r.value == 0x05);
+
+    REQUIRE(reader.next(r));
+    REQUIRE(r.index == 0x123);
+    REQUIRE(r.reg == TRACE_NO_REGISTER);
+
+    REQUIRE(reader.next(r));
+    REQUIRE(r.value == 0x04);
+    REQUIRE(r.vf == 0);
+
+    REQUIRE(!reader.next(r));
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("Chunks larger than a writer emits are rejected", "[Tracer]") {
+    std::string filename = tempTrace("oversized");
+
+    {
+        TraceWriter writer(filename);
+    }
+    {
+        // One record claiming a 4 GB payload
+        std::ofstream out(filename, std::ios_base::app | std::ios_base::binary);
+        const char chunk[] = { 1, 0, 0, 0, '\xFF', '\xFF', '\xFF', '\xFF' };
+        out.write(chunk, sizeof(chunk));
+    }
+
+    TraceReader reader(filename);
+    REQUIRE(reader.ok());
+    TraceRecord r;
+    REQUIRE(!reader.next(r));
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("Tracers report files they cannot write", "[Tracer]") {
+    Tracer tracer("/nonexistent/chip8test.trace");
+    REQUIRE(!tracer.ok());
+    tracer.close();
+    REQUIRE(!tracer.ok());
+}
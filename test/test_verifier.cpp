@@ -0,0 +1,121 @@
+#include "verifier.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <vector>
+
+// Loop at 0x200: V0 = random; V1 = 0, V2 = 0 (fused pair); draw V0 at
+// (V1, V2) (fused index + draw); V3 += 1 and skip if V3 == 0 (fused add +
+// skip); jump back to 0x200
+static const std::vector<byte> loop = {
+    0xC0, 0xFF, 0x61, 0x00, 0x62, 0x00, 0xA2, 0x00, 0xD1, 0x25,
+    0x73, 0x01, 0x33, 0x00, 0x12, 0x00, 0x12, 0x10,
+};
+
+TEST_CASE("Random numbers follow the machine's seed", "[verifier]") {
+    Chip8 a, b;
+    a.seedRandom(42);
+    b.seedRandom(42);
+    for (int i = 0; i < 100; i++) {
+        a.opRandom(0, 0xFF);
+        rand();
+        b.opRandom(0, 0xFF);
+        REQUIRE(a.variableRegisters[0] == b.variableRegisters[0]);
+    }
+}
+
+TEST_CASE("Superinstructions match cycle() in lockstep", "[verifier]") {
+    Lockstep lockstep(loop);
+    REQUIRE(lockstep.run(100000, 7));
+    REQUIRE(lockstep.executed == 100000);
+    REQUIRE_FALSE(lockstep.mismatch);
+}
+
+TEST_CASE("Inline decoding in run() matches cycle() in lockstep", "[verifier]") {
+    Lockstep lockstep(loop, runBackend);
+    REQUIRE(lockstep.run(100000, 7));
+    REQUIRE(lockstep.executed == 100000);
+
+    // A timer wait between register and shift work: 6XNN, 8XY4, 8XY6,
+    // FX15, then FX07 and 3XNN polling it
+    Lockstep timers({0x60, 0x05, 0x81, 0x04, 0x81, 0x16, 0x61, 0x09, 0xF1, 0x15,
+                     0xF2, 0x07, 0x32, 0x00, 0x12, 0x0A, 0x12, 0x00}, runBackend);
+    REQUIRE(timers.run(100000, 3));
+}
+
+TEST_CASE("Lockstep stops at the first mismatch", "[verifier]") {
+    // Plain cycles, except that V3 is corrupted at instruction 1000
+    long count = 0;
+    Lockstep lockstep(loop, [&count](Chip8 &sys, int) {
+        if (sys.cycle() != FAULT_NONE)
+            return 0;
+        if (++count == 1000)
+            sys.variableRegisters[3] ^= 0x80;
+        return 1;
+    });
+
+    REQUIRE_FALSE(lockstep.run(100000, 7));
+    REQUIRE(lockstep.mismatch);
+    REQUIRE(lockstep.executed == 999);
+    std::string report = lockstep.report();
+    REQUIRE(report.find("\"differences\":[\"v3\"]") != std::string::npos);
+    REQUIRE(report.find("\"reference\":{") != std::string::npos);
+}
+
+// Passes steps on, flipping V3 at the step that reaches instruction 1000
+// and flipping it back at the next, so the damage heals inside one run()
+struct HealingCorruption : StepObserver {
+    StepObserver * next = nullptr;
+    long seen = 0;
+    int flips = 0;
+
+    bool stepped(Chip8 &sys, int count) override {
+        seen += count;
+        if (seen >= 1000 && flips < 2) {
+            sys.variableRegisters[3] ^= 0x80;
+            flips++;
+        }
+        return next->stepped(sys, count);
+    }
+};
+
+TEST_CASE("run() is compared after every step, not every batch", "[verifier]") {
+    HealingCorruption corruption;
+    Lockstep lockstep(loop, [&corruption](Chip8 &sys, int budget) {
+        corruption.next = sys.observer;
+        sys.observer = &corruption;
+        int count = sys.run(budget);
+        sys.observer = corruption.next;
+        return count;
+    });
+
+    REQUIRE_FALSE(lockstep.run(100000, 7));
+    REQUIRE(lockstep.executed < 1000);
+    REQUIRE(lockstep.executed >= 1000 - 3);
+    REQUIRE(lockstep.report().find("\"differences\":[\"v3\"]") != std::string::npos);
+}
+
+TEST_CASE("RAM writes missing from the fingerprint are caught", "[verifier]") {
+    Lockstep lockstep(loop, [](Chip8 &sys, int) {
+        if (sys.cycle() != FAULT_NONE)
+            return 0;
+        sys.ram[0x300] = 1;
+        return 1;
+    });
+
+    REQUIRE_FALSE(lockstep.run(1000, 1));
+    REQUIRE(lockstep.report().find("\"differences\":[\"memory\"]") != std::string::npos);
+}
+
+TEST_CASE("Faults end both machines together", "[verifier]") {
+    // 00EE with an empty stack
+    Lockstep lockstep({0x60, 0x01, 0x00, 0xEE});
+    REQUIRE(lockstep.run(1000, 1));
+    REQUIRE(lockstep.executed == 1);
+    REQUIRE(lockstep.reference.fault == FAULT_STACK_UNDERFLOW);
+
+    // run() reports the instruction before the fault as run
+    Lockstep batched({0x60, 0x01, 0x00, 0xEE}, runBackend);
+    REQUIRE(batched.run(1000, 1));
+    REQUIRE(batched.executed == 1);
+    REQUIRE(batched.candidate.fault == FAULT_STACK_UNDERFLOW);
+}
@@ -0,0 +1,60 @@
+#include "visited.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Fingerprints are inserted once", "[visited]") {
+    VisitedSet set(100);
+    REQUIRE(set.insert(42));
+    REQUIRE(!set.insert(42));
+    REQUIRE(set.insert(0));
+    REQUIRE(!set.insert(0));
+    REQUIRE(set.contains(42));
+    REQUIRE(!set.contains(43));
+    REQUIRE(set.size() == 2);
+}
+
+TEST_CASE("Fingerprint 0 does not collide with any other", "[visited]") {
+    VisitedSet set(100);
+    REQUIRE(!set.contains(0));
+    REQUIRE(set.insert(0x8000000000000000ULL));
+    REQUIRE(!set.contains(0));
+    REQUIRE(set.insert(0));
+    REQUIRE(set.contains(0));
+    REQUIRE(set.contains(0x8000000000000000ULL));
+    REQUIRE(set.size() == 2);
+}
+
+TEST_CASE("A full set rejects new fingerprints", "[visited]") {
+    VisitedSet set(4);
+    for (uint64_t i = 1; i <= 4; i++) {
+        REQUIRE(set.insert(i * 0x10000));
+    }
+    REQUIRE(set.full());
+    REQUIRE(!set.insert(99));
+    REQUIRE(!set.contains(99));
+    REQUIRE(set.size() == 4);
+}
+
+TEST_CASE("Concurrent inserts count each fingerprint once", "[visited]") {
+    VisitedSet set(1 << 16);
+    std::atomic<int> added(0);
+    std::vector<std::thread> workers;
+
+    // Every thread inserts the same overlapping range
+    for (int t = 0; t < 4; t++) {
+        workers.push_back(std::thread([&]() {
+            for (uint64_t i = 0; i < 20000; i++) {
+                if (set.insert(i * 0x9E3779B97F4A7C15ULL))
+                    added++;
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+
+    REQUIRE(added == 20000);
+    REQUIRE(set.size() == 20000);
+}
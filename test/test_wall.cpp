@@ -0,0 +1,104 @@
+#include "wall.hpp"
+#include "assembler.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <vector>
+
+// Draws digit 5 at the top left, then spins
+static const char * digit =
+    "        LD V0, 5\n"
+    "        LD F, V0\n"
+    "        DRW V1, V2, 5\n"
+    "spin:   JP spin\n";
+
+// Draws whichever key is pressed, then spins
+static const char * waitKey =
+    "        LD V3, K\n"
+    "        LD F, V3\n"
+    "        DRW V1, V2, 5\n"
+    "spin:   JP spin\n";
+
+static std::vector<std::vector<byte>> roms(const char * source) {
+    return std::vector<std::vector<byte>>(1, assemble(source).image());
+}
+
+// Tile size in the atlas at scale 1
+static const int cellWidth = 64 + 2 * WALL_BORDER;
+static const int cellHeight = 32 + 2 * WALL_BORDER;
+
+static uint32_t atlasPixel(const std::vector<uint32_t> &atlas, const AttractWall &wall, int x, int y) {
+    return atlas[y * wall.atlasWidth(1) + x];
+}
+
+TEST_CASE("Tiles are laid out in a near-square grid", "[wall]") {
+    AttractWall sixteen(roms(digit), 16, 4);
+    REQUIRE(sixteen.columns == 4);
+    REQUIRE(sixteen.rows == 4);
+
+    AttractWall five(roms(digit), 5, 2);
+    REQUIRE(five.columns == 3);
+    REQUIRE(five.rows == 2);
+    REQUIRE(five.atlasWidth(2) == 3 * (128 + 2 * WALL_BORDER));
+    REQUIRE(five.atlasHeight(2) == 2 * (64 + 2 * WALL_BORDER));
+    REQUIRE(five.tileAt(2, 128 + 2 * WALL_BORDER + 5, 64 + 2 * WALL_BORDER + 5) == 4);
+    REQUIRE(five.tileAt(2, 2 * (128 + 2 * WALL_BORDER) + 5, 64 + 2 * WALL_BORDER + 5) == -1);
+}
+
+TEST_CASE("Every tile runs and only changed tiles are composed", "[wall]") {
+    AttractWall wall(roms(digit), 6, 3);
+    int width = wall.atlasWidth(1), height = wall.atlasHeight(1);
+    std::vector<uint32_t> atlas(width * height);
+    int pitch = width * sizeof(uint32_t);
+
+    // Each grid row of tiles is one run
+    wall.frame();
+    std::vector<WallRect> dirty;
+    REQUIRE(wall.compose(1, atlas.data(), pitch, dirty) == 2);
+    REQUIRE(dirty[1].x == 0);
+    REQUIRE(dirty[1].y == cellHeight);
+    REQUIRE(dirty[1].width == width);
+    REQUIRE(dirty[1].height == height / 2);
+
+    // Digit 5's top row is 0xF0; tile 4 is the second in the second row
+    int x = cellWidth + WALL_BORDER, y = cellHeight + WALL_BORDER;
+    for (int i = 0; i < 4; i++)
+        REQUIRE(atlasPixel(atlas, wall, x + i, y) == wall.onColour);
+    REQUIRE(atlasPixel(atlas, wall, x + 4, y) == wall.offColour);
+    REQUIRE(atlasPixel(atlas, wall, 0, 0) == wall.focusColour);
+    REQUIRE(atlasPixel(atlas, wall, x - WALL_BORDER, y - WALL_BORDER) == wall.borderColour);
+    REQUIRE(wall.machine(5).programCounter == 0x206);
+
+    // Spinning tiles do not redraw
+    wall.frame();
+    REQUIRE(wall.compose(1, atlas.data(), pitch, dirty) == 0);
+}
+
+TEST_CASE("Keys go to the focused tile only", "[wall]") {
+    AttractWall wall(roms(waitKey), 4, 2);
+    std::vector<uint32_t> atlas(wall.atlasWidth(1) * wall.atlasHeight(1));
+    int pitch = wall.atlasWidth(1) * sizeof(uint32_t);
+    std::vector<WallRect> dirty;
+    wall.frame();
+    wall.compose(1, atlas.data(), pitch, dirty);
+
+    wall.moveFocus(1, 1);
+    REQUIRE(wall.focus == 3);
+    REQUIRE(wall.compose(1, atlas.data(), pitch, dirty) == 2);      // Tiles 0 and 3 changed borders
+    REQUIRE(atlasPixel(atlas, wall, 0, 0) == wall.borderColour);
+
+    wall.pressKey(7);
+    wall.frame();
+    wall.releaseKey(7);
+    wall.frame();
+    wall.frame();
+
+    REQUIRE(wall.machine(3).variableRegisters[3] == 7);
+    REQUIRE(wall.machine(0).programCounter == 0x200);
+    REQUIRE(wall.machine(1).programCounter == 0x200);
+
+    // Only the tile that drew is uploaded
+    REQUIRE(wall.compose(1, atlas.data(), pitch, dirty) == 1);
+    REQUIRE(dirty[0].x == cellWidth);
+    REQUIRE(dirty[0].y == cellHeight);
+    REQUIRE(dirty[0].width == cellWidth);
+    REQUIRE(dirty[0].height == cellHeight);
+}
@@ -0,0 +1,156 @@
+#include "xochip.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <vector>
+
+// Loads the opcodes at 0x200 and runs them all
+static void runProgram(XoChip &xo, const std::vector<word> &program) {
+    std::vector<byte> rom;
+    for (size_t i = 0; i < program.size(); i++) {
+        rom.push_back(program[i] >> 8);
+        rom.push_back(program[i] & 0xFF);
+    }
+    xo.load(rom.data(), rom.size());
+    xo.run((int) program.size());
+}
+
+TEST_CASE("F000 NNNN loads a 16-bit index and skips step over it", "[xochip]") {
+    XoChip xo;
+    runProgram(xo, {0x6005, 0x3005, 0xF000, 0x1234, 0x6101, 0xF000, 0xABCD, 0x00FD});
+    REQUIRE(xo.fault == FAULT_NONE);
+    REQUIRE(xo.variableRegisters[1] == 1);
+    REQUIRE(xo.indexRegister == 0xABCD);
+    REQUIRE(xo.exited);
+    REQUIRE(xo.programCounter == 0x210);
+}
+
+TEST_CASE("Registers reach RAM above 4 KB", "[xochip]") {
+    XoChip xo;
+    runProgram(xo, {0x6011, 0x6122, 0x6233, 0xF000, 0x8000, 0xF255, 0x00FD});
+    REQUIRE(xo.ram[0x8000] == 0x11);
+    REQUIRE(xo.ram[0x8002] == 0x33);
+    REQUIRE(xo.indexRegister == 0x8003);
+
+    // 5XY2 and 5XY3 leave I alone and run in either direction
+    runProgram(xo, {0x6111, 0x6222, 0x6333, 0xA300, 0x5132, 0xA310, 0x5312, 0xA300, 0x5653, 0x00FD});
+    REQUIRE(xo.ram[0x300] == 0x11);
+    REQUIRE(xo.ram[0x302] == 0x33);
+    REQUIRE(xo.ram[0x310] == 0x33);
+    REQUIRE(xo.ram[0x312] == 0x11);
+    REQUIRE(xo.variableRegisters[6] == 0x11);
+    REQUIRE(xo.variableRegisters[5] == 0x22);
+    REQUIRE(xo.indexRegister == 0x300);
+
+    // Flag registers keep all 16
+    runProgram(xo, {0x6F42, 0xFF75, 0x6F00, 0xFF85, 0x00FD});
+    REQUIRE(xo.variableRegisters[0xF] == 0x42);
+}
+
+TEST_CASE("Both planes draw from consecutive sprite data", "[xochip]") {
+    XoChip xo;
+    // Sprite data at 0x210: plane 0 row, then plane 1 row
+    runProgram(xo, {0x00FF, 0xF301, 0xA210, 0x6000, 0xD001, 0x00FD, 0x0000, 0x0000, 0xF0CC});
+    REQUIRE(xo.hires);
+    REQUIRE(xo.pixel(0, 0) == 3);
+    REQUIRE(xo.pixel(2, 0) == 1);
+    REQUIRE(xo.pixel(4, 0) == 2);
+    REQUIRE(xo.pixel(6, 0) == 0);
+    REQUIRE(xo.variableRegisters[0xF] == 0);
+
+    // Drawing again on plane 1 only collides and erases it
+    runProgram(xo, {0x00FF, 0xF301, 0xA212, 0x6000, 0xD001, 0xF201, 0xA213, 0xD001, 0x00FD, 0xF0CC});
+    REQUIRE(xo.variableRegisters[0xF] == 1);
+    REQUIRE(xo.pixel(0, 0) == 1);
+    REQUIRE(xo.pixel(4, 0) == 0);
+}
+
+TEST_CASE("Sprites wrap across the row words and the edges", "[xochip]") {
+    XoChip xo;
+    runProgram(xo, {0x00FF, 0xA210, 0x607C, 0x613F, 0xD012, 0x603C, 0xD012, 0x00FD, 0xFFFF});
+    for (int x = 0; x < 8; x++) {
+        INFO(x);
+        REQUIRE(xo.pixel((124 + x) % 128, 63) == 1);
+        REQUIRE(xo.pixel((124 + x) % 128, 0) == 1);
+        REQUIRE(xo.pixel(60 + x, 63) == 1);
+    }
+    REQUIRE(xo.pixel(4, 63) == 0);
+    REQUIRE(xo.pixel(59, 63) == 0);
+    REQUIRE(xo.pixel(68, 63) == 0);
+}
+
+TEST_CASE("Low resolution doubles pixels, 16x16 sprites read 32 bytes", "[xochip]") {
+    XoChip xo;
+    runProgram(xo, {0xA20A, 0x6001, 0xD001, 0x00FD, 0x0000, 0x8000});
+    REQUIRE_FALSE(xo.hires);
+    REQUIRE(xo.pixel(2, 2) == 1);
+    REQUIRE(xo.pixel(3, 3) == 1);
+    REQUIRE(xo.pixel(4, 2) == 0);
+    REQUIRE(xo.pixel(2, 4) == 0);
+
+    std::vector<word> program = {0x00FF, 0xA20A, 0x6000, 0xD000, 0x00FD};
+    program.resize(5 + 16, 0xFFFF);
+    runProgram(xo, program);
+    REQUIRE(xo.pixel(15, 15) == 1);
+    REQUIRE(xo.pixel(16, 0) == 0);
+    REQUIRE(xo.pixel(0, 16) == 0);
+}
+
+TEST_CASE("Scrolling moves only the selected planes", "[xochip]") {
+    XoChip xo;
+    runProgram(xo, {0x00FF, 0xF301, 0xA216, 0x603E, 0xD011, 0xF101, 0x00C3, 0x00FB,
+                    0xF201, 0x00FC, 0x00FD, 0xFF80});
+    REQUIRE(xo.pixel(62, 3) == 0);
+    REQUIRE(xo.pixel(66, 3) == 1);      // Plane 0 crossed into the second word
+    REQUIRE(xo.pixel(58, 0) == 2);      // Plane 1 moved left only
+
+    // Scrolls up shift out, lores scrolls are doubled
+    runProgram(xo, {0xA20E, 0x6101, 0xD011, 0x00D1, 0x00FB, 0x00FD, 0x0000, 0x8000});
+    REQUIRE(xo.pixel(8, 0) == 1);
+    REQUIRE(xo.pixel(8, 2) == 0);
+    REQUIRE(xo.pixel(0, 0) == 0);
+}
+
+TEST_CASE("Audio pattern and pitch", "[xochip]") {
+    XoChip xo;
+    // Alternating bits, pitch 64 plays 4000 bits a second
+    runProgram(xo, {0xA210, 0xF002, 0x6040, 0xF03A, 0x6010, 0xF018, 0x00FD, 0, 0xAAAA, 0xAAAA,
+                    0xAAAA, 0xAAAA, 0xAAAA, 0xAAAA, 0xAAAA, 0xAAAA});
+    REQUIRE(xo.pattern[0] == 0xAA);
+    REQUIRE(xo.patternRate() == 4000.0);
+
+    int16_t samples[8];
+    double phase = 0;
+    xo.renderAudio(samples, 8, 4000, phase);
+    REQUIRE(samples[0] > 0);
+    REQUIRE(samples[1] < 0);
+    REQUIRE(samples[2] > 0);
+    REQUIRE(phase == 8.0);
+
+    for (int i = 0; i < 0x10; i++)
+        xo.tickTimers();
+    xo.renderAudio(samples, 8, 4000, phase);
+    REQUIRE(samples[0] == 0);
+}
+
+TEST_CASE("XO-CHIP faults and key waits", "[xochip]") {
+    XoChip xo;
+    runProgram(xo, {0x6001, 0x00EE});
+    REQUIRE(xo.fault == FAULT_STACK_UNDERFLOW);
+    REQUIRE(xo.crash.programCounter == 0x202);
+    REQUIRE(xo.crash.variableRegisters[0] == 1);
+
+    // FX0A ignores keys already held and waits for the release
+    byte wait[] = {0xF5, 0x0A, 0x00, 0xFD};
+    xo.load(wait, sizeof(wait));
+    xo.pressKey(3);
+    xo.run(5);
+    xo.releaseKey(3);
+    xo.run(5);
+    REQUIRE(xo.programCounter == 0x200);
+    xo.pressKey(7);
+    xo.run(5);
+    REQUIRE(xo.programCounter == 0x200);
+    xo.releaseKey(7);
+    xo.run(5);
+    REQUIRE(xo.variableRegisters[5] == 7);
+    REQUIRE(xo.exited);
+}